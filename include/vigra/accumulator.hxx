@@ -59,6 +59,7 @@
 #include "functorexpression.hxx"
 #include "labelimage.hxx"
 #include "multi_labeling.hxx"
+#include "threadpool.hxx"
 #include <algorithm>
 #include <iostream>
 
@@ -924,6 +925,10 @@ struct AccumulatorEndImpl
     void mergeImpl(U const &)
     {}
 
+    template <unsigned, class U>
+    void mergePassImpl(U const &)
+    {}
+
     template <class U>
     void resize(U const &)
     {}
@@ -1003,6 +1008,9 @@ struct DecoratorImpl
     template <class T>
     static void exec(A &, T const &, double)
     {}
+
+    static void mergeImpl(A &, A const &)
+    {}
 };
 
 template <class A, unsigned CurrentPass>
@@ -1110,6 +1118,40 @@ struct DecoratorImpl<A, CurrentPass, true, CurrentPass>
     }
 };
 
+    // IsMergeable<TAG> tells if the statistic TAG supports operator+=(). Only
+    // statistics that work in pass 1 need to be registered here: the parallel
+    // version of extractFeatures() merges pass 1 only and executes later passes
+    // sequentially.
+template <class TAG>
+struct IsMergeable
+: public VigraTrueType
+{};
+
+    // Check at compile-time (plain chains) or run-time (dynamic chains) if all
+    // active accumulators of pass 1 can be merged.
+template <class A, class Tag=typename A::Tag>
+struct MergeableInPass1
+{
+    template <class ActiveFlags>
+    static bool exec(ActiveFlags const & flags)
+    {
+        bool const mergeable = A::workInPass != 1 ||
+                               IsMergeable<Tag>::value ||
+                               (A::allowRuntimeActivation && !A::isActiveImpl(flags));
+        return mergeable && MergeableInPass1<typename A::InternalBaseType>::exec(flags);
+    }
+};
+
+template <class A>
+struct MergeableInPass1<A, AccumulatorEnd>
+{
+    template <class ActiveFlags>
+    static bool exec(ActiveFlags const &)
+    {
+        return true;
+    }
+};
+
     // Generic reshape function (expands to a no-op when T has fixed shape, and to
     // the appropriate specialized call otherwise). Shape is an instance of MultiArrayShape<N>::type.
 template <class T, class Shape>
@@ -1494,8 +1536,40 @@ struct LabelDispatch
             regions_[labelMapping[k]].mergeImpl(o.regions_[k]);
         next_.mergeImpl(o.next_);
     }
+
+        // merge only the accumulators working in pass N
+    template <unsigned N>
+    void mergePassImpl(LabelDispatch const & o)
+    {
+        for(unsigned int k=0; k<regions_.size(); ++k)
+            regions_[k].template mergePassImpl<N>(o.regions_[k]);
+        next_.template mergePassImpl<N>(o.next_);
+    }
+
+    template <unsigned N, class ArrayLike>
+    void mergePassImpl(LabelDispatch const & o, ArrayLike const & labelMapping)
+    {
+        MultiArrayIndex newMaxLabel = std::max<MultiArrayIndex>(maxRegionLabel(), *argMax(labelMapping.begin(), labelMapping.end()));
+        setMaxRegionLabel(newMaxLabel);
+        for(unsigned int k=0; k<labelMapping.size(); ++k)
+            regions_[labelMapping[k]].template mergePassImpl<N>(o.regions_[k]);
+        next_.template mergePassImpl<N>(o.next_);
+    }
 };
 
+template <class A>
+bool mergeableInPass1(A const & a)
+{
+    return MergeableInPass1<A>::exec(getAccumulator<AccumulatorEnd>(a).active_accumulators_);
+}
+
+template <class T, class GlobalAccumulators, class RegionAccumulators>
+bool mergeableInPass1(LabelDispatch<T, GlobalAccumulators, RegionAccumulators> const & a)
+{
+    return mergeableInPass1(a.next_) &&
+           MergeableInPass1<RegionAccumulators>::exec(a.active_region_accumulators_);
+}
+
 template <class TargetTag, class TagList>
 struct FindNextTag;
 
@@ -1714,6 +1788,13 @@ struct AccumulatorFactory
             this->next_.mergeImpl(o.next_);
         }
 
+        template <unsigned N>
+        void mergePassImpl(Accumulator const & o)
+        {
+            DecoratorImpl<Accumulator, N, allowRuntimeActivation>::mergeImpl(*this, o);
+            this->next_.template mergePassImpl<N>(o.next_);
+        }
+
         void applyHistogramOptions(HistogramOptions const & options)
         {
             DecoratorImpl<Accumulator, workInPass, allowRuntimeActivation>::applyHistogramOptions(*this, options);
@@ -3077,6 +3158,27 @@ namespace vigra { namespace acc {
 \endcode
 Of course, the number and types of the arrays specified in <tt>CoupledArrays</tt> must conform to the number and types of the arrays passed to <tt>extractFeatures()</tt>.
 
+The two-array form (typically data and labels) has a parallel variant:
+\code
+namespace vigra { namespace acc {
+
+    template <unsigned int N, class T1, class S1,
+                              class T2, class S2,
+              class ACCUMULATOR>
+    void extractFeatures(MultiArrayView<N, T1, S1> const & a1,
+                         MultiArrayView<N, T2, S2> const & a2,
+                         ACCUMULATOR & a,
+                         ParallelOptions const & options);
+}}
+\endcode
+It splits the arrays into slabs along the last dimension and executes the first pass in several threads. Each thread collects its statistics in a private copy of the accumulator chain, and the copies are merged into <tt>a</tt> afterwards. When the number of regions is large in comparison to the number of pixels, the private chains are instead restricted to the regions occurring in each slab (via a slab-local labeling) and merged by means of a label mapping, so that memory consumption does not grow with the product of thread and region count. Statistics working in later passes (e.g. <tt>Skewness</tt> or <tt>Principal<...></tt>) cannot be merged in general and are computed by subsequent sequential passes over the data. If a statistic of the first pass cannot be merged (e.g. <tt>RegionContour</tt>), if <tt>a</tt> has already seen data, or if <tt>options.getNumThreads() == 0</tt>, the function falls back to the sequential algorithm. The result equals the one of the sequential version up to round-off.
+\code
+    AccumulatorChainArray<CoupledArrays<3, float, UInt32>,
+                          Select<DataArg<1>, LabelArg<2>, Count, Mean, RegionCenter> > a;
+
+    extractFeatures(data, labels, a, ParallelOptions().numThreads(8));
+\endcode
+
 See \ref FeatureAccumulators for more information about feature computation via accumulators.
 */
 doxygen_overloaded_function(template <...> void extractFeatures)
@@ -3165,6 +3267,263 @@ void extractFeatures(MultiArrayView<N, T1, S1> const & a1,
     extractFeatures(start, end, a);
 }
 
+namespace acc_detail {
+
+    // Helpers for the sparse parallel scan: access the label array (at
+    // position LabelIndex of the CoupledHandle) and create a coupled iterator
+    // over a slab where the labels are replaced by slab-local labels.
+template <int LabelIndex>
+struct ParallelLabelArray;
+
+template <>
+struct ParallelLabelArray<1>
+{
+    template <unsigned int N, class T1, class S1, class T2, class S2>
+    static MultiArrayView<N, T1, StridedArrayTag>
+    labels(MultiArrayView<N, T1, S1> const & a1, MultiArrayView<N, T2, S2> const &)
+    {
+        return a1;
+    }
+
+    template <unsigned int N, class T1, class S1, class T2, class S2, class SHAPE>
+    static typename CoupledIteratorType<N, T1, T2>::type
+    createIterator(MultiArrayView<N, T1, S1> const &, MultiArrayView<N, T2, S2> const & a2,
+                   MultiArrayView<N, T1> const & localLabels, SHAPE const & start, SHAPE const & stop)
+    {
+        return createCoupledIterator(localLabels, a2.subarray(start, stop));
+    }
+};
+
+template <>
+struct ParallelLabelArray<2>
+{
+    template <unsigned int N, class T1, class S1, class T2, class S2>
+    static MultiArrayView<N, T2, StridedArrayTag>
+    labels(MultiArrayView<N, T1, S1> const &, MultiArrayView<N, T2, S2> const & a2)
+    {
+        return a2;
+    }
+
+    template <unsigned int N, class T1, class S1, class T2, class S2, class SHAPE>
+    static typename CoupledIteratorType<N, T1, T2>::type
+    createIterator(MultiArrayView<N, T1, S1> const & a1, MultiArrayView<N, T2, S2> const &,
+                   MultiArrayView<N, T2> const & localLabels, SHAPE const & start, SHAPE const & stop)
+    {
+        return createCoupledIterator(a1.subarray(start, stop), localLabels);
+    }
+};
+
+    // Execute pass 1 in parallel: every thread owns a copy of 'a' and scans
+    // slabs along the last dimension. Since the iterators refer to the
+    // entire arrays, coordinates need no adjustment.
+template <unsigned int N, class T1, class S1, class T2, class S2, class ACCUMULATOR>
+void extractFeaturesPass1Dense(MultiArrayView<N, T1, S1> const & a1,
+                               MultiArrayView<N, T2, S2> const & a2,
+                               ACCUMULATOR & a, ParallelOptions const & options)
+{
+    typedef typename CoupledIteratorType<N, T1, T2>::type Iterator;
+    Iterator start = createCoupledIterator(a1, a2);
+    MultiArrayIndex const slabCount = a1.shape(N-1),
+                          slabSize  = a1.size() / slabCount;
+
+    std::vector<ACCUMULATOR> chains(options.getActualNumThreads(), a);
+    parallel_foreach(options, slabCount,
+        [&](int thread_id, MultiArrayIndex slab)
+        {
+            ACCUMULATOR & chain = chains[thread_id];
+            Iterator i   = start + slab*slabSize,
+                     end = i + slabSize;
+            for(; i < end; ++i)
+                chain.template update<1>(*i);
+        }
+    );
+    for(unsigned int k=0; k<chains.size(); ++k)
+        a.next_.template mergePassImpl<1>(chains[k].next_);
+}
+
+    // Execute pass 1 in parallel for region statistics when there are many
+    // regions: every slab is relabeled with consecutive local labels, so that
+    // the slab's accumulator chain only holds the regions actually present.
+    // The result is merged into 'a' via the label mapping.
+template <unsigned int N, class T1, class S1, class T2, class S2, class ACCUMULATOR>
+void extractFeaturesPass1Sparse(MultiArrayView<N, T1, S1> const & a1,
+                                MultiArrayView<N, T2, S2> const & a2,
+                                ACCUMULATOR & a, ACCUMULATOR const & prototype,
+                                ParallelOptions const & options)
+{
+    typedef typename ACCUMULATOR::InternalBaseType                         LabelDispatchType;
+    typedef typename CoupledIteratorType<N, T1, T2>::type                  Iterator;
+    typedef HandleArgSelector<typename CoupledIteratorType<N, T1, T2>::HandleType, LabelArgTag,
+                              typename LabelDispatchType::GlobalAccumulatorChain> LabelHandle;
+    typedef ParallelLabelArray<LabelHandle::value>                         LabelArray;
+    typedef typename LabelHandle::value_type                               Label;
+    typedef typename MultiArrayShape<N>::type                              Shape;
+    typedef typename LabelDispatchType::CoordinateType                     CoordinateType;
+
+    MultiArrayView<N, Label, StridedArrayTag> labels = LabelArray::labels(a1, a2);
+    MultiArrayIndex const depth          = a1.shape(N-1),
+                          threadCount    = options.getActualNumThreads(),
+                          slabCount      = std::min(depth, std::max(4*threadCount, a1.size() >> 20)),
+                          regionCount    = a.regionCount(),
+                          ignoredLabel   = a.next_.ignoredLabel();
+    Label const           ignoreSentinel = NumericTraits<Label>::max();
+
+    std::vector<std::vector<MultiArrayIndex> > localIndices(threadCount);
+    threading::mutex merge_mutex;
+    parallel_foreach(options, slabCount,
+        [&](int thread_id, MultiArrayIndex slab)
+        {
+            Shape start, stop(a1.shape());
+            start[N-1] = slab*depth / slabCount;
+            stop[N-1]  = (slab+1)*depth / slabCount;
+
+            std::vector<MultiArrayIndex> & localIndex = localIndices[thread_id];
+            if(localIndex.size() == 0)
+                localIndex.resize(regionCount, -1);
+
+            // relabel the slab consecutively (ignored pixels get an invalid label)
+            MultiArrayView<N, Label, StridedArrayTag> slabLabels = labels.subarray(start, stop);
+            MultiArray<N, Label> localLabels(slabLabels.shape());
+            ArrayVector<Label> labelMapping;
+            typename MultiArrayView<N, Label, StridedArrayTag>::iterator l = slabLabels.begin();
+            typename MultiArray<N, Label>::iterator ll = localLabels.begin(),
+                                                    llend = localLabels.end();
+            for(; ll != llend; ++l, ++ll)
+            {
+                if((MultiArrayIndex)*l == ignoredLabel)
+                {
+                    *ll = ignoreSentinel;
+                    continue;
+                }
+                MultiArrayIndex & k = localIndex[*l];
+                if(k < 0)
+                {
+                    k = labelMapping.size();
+                    labelMapping.push_back(*l);
+                }
+                *ll = (Label)k;
+            }
+            for(unsigned int k=0; k<labelMapping.size(); ++k)
+                localIndex[labelMapping[k]] = -1;
+            if(labelMapping.size() == 0)
+                return;
+
+            ACCUMULATOR chain(prototype);
+            chain.setMaxRegionLabel(labelMapping.size() - 1);
+            if(ignoredLabel >= 0)
+                chain.ignoreLabel(ignoreSentinel);
+            CoordinateType offset(a.next_.coordinateOffset_);
+            if(LabelDispatchType::coordIndex == 0)
+                offset[N-1] += start[N-1];
+            chain.setCoordinateOffset(offset);
+
+            Iterator i   = LabelArray::createIterator(a1, a2, localLabels, start, stop),
+                     end = i.getEndIterator();
+            for(; i < end; ++i)
+                chain.template update<1>(*i);
+
+            threading::lock_guard<threading::mutex> guard(merge_mutex);
+            a.next_.template mergePassImpl<1>(chain.next_, labelMapping);
+        }
+    );
+}
+
+template <unsigned int N, class T1, class S1, class T2, class S2, class ACCUMULATOR>
+void extractFeaturesPass1Parallel(MultiArrayView<N, T1, S1> const & a1,
+                                  MultiArrayView<N, T2, S2> const & a2,
+                                  ACCUMULATOR & a, ParallelOptions const & options,
+                                  VigraFalseType /* no region statistics */)
+{
+    a.next_.resize(shapeOf(*createCoupledIterator(a1, a2)));
+    a.current_pass_ = 1;
+    extractFeaturesPass1Dense(a1, a2, a, options);
+}
+
+template <unsigned int N, class T1, class S1, class T2, class S2, class ACCUMULATOR>
+void extractFeaturesPass1Parallel(MultiArrayView<N, T1, S1> const & a1,
+                                  MultiArrayView<N, T2, S2> const & a2,
+                                  ACCUMULATOR & a, ParallelOptions const & options,
+                                  VigraTrueType /* region statistics */)
+{
+    typedef typename ACCUMULATOR::InternalBaseType                         LabelDispatchType;
+    typedef HandleArgSelector<typename CoupledIteratorType<N, T1, T2>::HandleType, LabelArgTag,
+                              typename LabelDispatchType::GlobalAccumulatorChain> LabelHandle;
+    typedef typename LabelHandle::value_type                               Label;
+
+    // determine the number of regions in parallel (LabelDispatch::resize()
+    // would do this sequentially)
+    MultiArrayIndex regionCount = a.regionCount();
+    if(regionCount == 0)
+    {
+        MultiArrayView<N, Label, StridedArrayTag> labels =
+            ParallelLabelArray<LabelHandle::value>::labels(a1, a2);
+        MultiArrayIndex const depth = a1.shape(N-1);
+        std::vector<Label> maxima(depth);
+        parallel_foreach(options, depth,
+            [&](int /* thread_id */, MultiArrayIndex k)
+            {
+                typename MultiArrayShape<N>::type start, stop(labels.shape());
+                start[N-1] = k;
+                stop[N-1]  = k+1;
+                Label minimum;
+                labels.subarray(start, stop).minmax(&minimum, &maxima[k]);
+            }
+        );
+        regionCount = (MultiArrayIndex)*std::max_element(maxima.begin(), maxima.end()) + 1;
+    }
+
+    // use per-thread copies of all region accumulators unless their number
+    // is large compared to the number of pixels each thread has to process
+    MultiArrayIndex const threadCount = options.getActualNumThreads();
+    if(16*threadCount*regionCount <= a1.size())
+    {
+        a.setMaxRegionLabel(regionCount - 1);
+        a.next_.resize(shapeOf(*createCoupledIterator(a1, a2)));
+        a.current_pass_ = 1;
+        extractFeaturesPass1Dense(a1, a2, a, options);
+    }
+    else
+    {
+        ACCUMULATOR prototype(a);
+        prototype.setMaxRegionLabel(0);
+        a.setMaxRegionLabel(regionCount - 1);
+        a.next_.resize(shapeOf(*createCoupledIterator(a1, a2)));
+        a.current_pass_ = 1;
+        extractFeaturesPass1Sparse(a1, a2, a, prototype, options);
+    }
+}
+
+} // namespace acc_detail
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2,
+          class ACCUMULATOR>
+void extractFeatures(MultiArrayView<N, T1, S1> const & a1,
+                     MultiArrayView<N, T2, S2> const & a2,
+                     ACCUMULATOR & a,
+                     ParallelOptions const & options)
+{
+    typedef typename CoupledIteratorType<N, T1, T2>::type Iterator;
+    typedef typename IsSameType<typename ACCUMULATOR::InternalBaseType::Tag,
+                                LabelDispatchTag>::type HasRegions;
+
+    Iterator start = createCoupledIterator(a1, a2),
+             end   = start.getEndIterator();
+    if(options.getNumThreads() == 0 || a.current_pass_ != 0 || a1.size() == 0 ||
+       !acc_detail::mergeableInPass1(a.next_))
+    {
+        extractFeatures(start, end, a);
+        return;
+    }
+
+    acc_detail::extractFeaturesPass1Parallel(a1, a2, a, options, HasRegions());
+
+    // later passes depend on the final results of pass 1 and are executed sequentially
+    for(unsigned int k=2; k <= a.passesRequired(); ++k)
+        for(Iterator i=start; i < end; ++i)
+            a.updatePassN(*i, k);
+}
+
 /****************************************************************************/
 /*                                                                          */
 /*                          AccumulatorResultTraits                         */
@@ -5322,7 +5681,11 @@ class FirstSeen
         void operator+=(Impl const & o)
         {
             // FIXME: only works for Coord<FirstSeen>
-            if(reverse(o.value_) < reverse(value_))
+            // Count is merged after this statistic, so both counts still refer
+            // to the unmerged parts. An empty part has no anchor.
+            if(getDependency<Count>(o) == 0)
+                return;
+            if(getDependency<Count>(*this) == 0 || reverse(o.value_) < reverse(value_))
                 value_ = o.value_;
         }
 
@@ -5344,6 +5707,17 @@ class FirstSeen
     };
 };
 
+namespace acc_detail {
+
+    // the first data value cannot be determined from the values alone,
+    // only Coord<FirstSeen> (which is ordered by scan order) is mergeable
+template <>
+struct IsMergeable<FirstSeen>
+: public VigraFalseType
+{};
+
+} // namespace acc_detail
+
 /** \brief Return both the minimum and maximum in <tt>std::pair</tt>.
 
     Usually used as <tt>Coord<Range></tt> (alias <tt>BoundingBox</tt>).
@@ -6162,6 +6536,15 @@ class RegionContour
     };
 };
 
+namespace acc_detail {
+
+template <>
+struct IsMergeable<RegionContour>
+: public VigraFalseType
+{};
+
+} // namespace acc_detail
+
 
 /** \brief Compute the perimeter of a 2D region.
 
@@ -0,0 +1,399 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2026 by the VIGRA developers                 */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+
+/************************************************************************/
+
+#ifndef VIGRA_BLOCKWISE_DISTANCE_HXX
+#define VIGRA_BLOCKWISE_DISTANCE_HXX
+
+#include "multi_array.hxx"
+#include "multi_array_chunked.hxx"
+#include "multi_distance.hxx"
+#include "threadpool.hxx"
+
+#include <cmath>
+
+namespace vigra
+{
+
+/** \addtogroup DistanceTransform
+*/
+//@{
+
+namespace blockwise_distance_detail
+{
+
+    // One pass of the separable distance transform along dimension 'd'. The array
+    // is cut into slabs that contain complete lines along 'd' and are one chunk
+    // thick in all other dimensions, so that concurrently processed slabs never
+    // share a chunk. 'load(begin, slab)' fills a slab, 'store(begin, slab)' writes
+    // the result back.
+template <unsigned int N, class Real, class Load, class Store>
+void
+distParabolaSlabs(typename MultiArrayShape<N>::type const & shape,
+                  typename MultiArrayShape<N>::type const & chunk_shape,
+                  unsigned int d, double sigma,
+                  ParallelOptions const & options,
+                  Load load, Store store)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    Shape slabs = (shape + chunk_shape - Shape(1)) / chunk_shape;
+    slabs[d] = 1;
+
+    parallel_foreach(options, prod(slabs),
+        [&](int /*thread*/, MultiArrayIndex k)
+        {
+            Shape index;
+            detail::ScanOrderToCoordinate<N>::exec(k, slabs, index);
+            Shape begin = index * chunk_shape,
+                  end   = min(begin + chunk_shape, shape);
+            begin[d] = 0;
+            end[d]   = shape[d];
+
+            MultiArray<N, Real> slab(end - begin);
+            load(begin, slab);
+            detail::distParabolaLines(slab, d, sigma, 0, slab.size() / slab.shape(d));
+            store(begin, slab);
+        });
+}
+
+template <unsigned int N, class T1, class T2, class Work, class Array>
+void
+separableMultiDistBlockwiseImpl(ChunkedArray<N, T1> const & source,
+                                ChunkedArray<N, T2> & dest,
+                                Work & work,
+                                bool background,
+                                Array const & pixelPitch,
+                                double maxDist,
+                                bool takeRoot,
+                                ParallelOptions const & options)
+{
+    typedef typename MultiArrayShape<N>::type       Shape;
+    typedef typename NumericTraits<T2>::RealPromote Real;
+
+    // chunk transfers run in the calling worker
+    ParallelOptions transfer_options = ParallelOptions().numThreads(ParallelOptions::NoThreads);
+    Shape shape = source.shape();
+    T1 zero = NumericTraits<T1>::zero();
+
+    for(unsigned int d = 0; d < N; ++d)
+    {
+        auto load = [&](Shape const & begin, MultiArray<N, Real> & slab)
+        {
+            if(d > 0)
+            {
+                work.checkoutSubarray(begin, slab, transfer_options);
+                return;
+            }
+            // threshold the mask so that all objects have infinite distance in the beginning
+            MultiArray<N, T1> mask(slab.shape());
+            source.checkoutSubarray(begin, mask, transfer_options);
+            for(MultiArrayIndex i = 0; i < mask.size(); ++i)
+                slab.data()[i] = ((mask.data()[i] == zero) == background)
+                                      ? Real(maxDist)
+                                      : Real(0.0);
+        };
+        auto store = [&](Shape const & begin, MultiArray<N, Real> & slab)
+        {
+            if(d + 1 < N)
+            {
+                work.commitSubarray(begin, slab, transfer_options);
+                return;
+            }
+            if(takeRoot)
+            {
+                for(MultiArrayIndex i = 0; i < slab.size(); ++i)
+                    slab.data()[i] = std::sqrt(Real(detail::RequiresExplicitCast<T2>::cast(slab.data()[i])));
+            }
+            dest.commitSubarray(begin, slab, transfer_options);
+        };
+        distParabolaSlabs<N, Real>(shape, dest.chunkShape(), d, pixelPitch[d], options, load, store);
+    }
+}
+
+template <unsigned int N, class T1, class T2, class T3, class Array>
+void
+separableMultiDistBlockwise(ChunkedArray<N, T1> const & source,
+                            ChunkedArray<N, T2> & dest,
+                            bool background,
+                            Array const & pixelPitch,
+                            ChunkedArray<N, T3> * temporary,
+                            bool takeRoot,
+                            ParallelOptions const & options)
+{
+    typedef typename NumericTraits<T2>::RealPromote Real;
+
+    vigra_precondition(source.shape() == dest.shape(),
+        "separableMultiDistSquaredBlockwise(): shape mismatch between input and output.");
+
+    double dmax = 0.0;
+    if(detail::distSquaredNeedsTmp<T2>(source.shape(), pixelPitch, dmax)) // need temporary storage to avoid overflows
+    {
+        if(temporary != 0)
+        {
+            vigra_precondition(temporary->shape() == dest.shape() && temporary->chunkShape() == dest.chunkShape(),
+                "separableMultiDistSquaredBlockwise(): temporary storage must have the same shape and chunk shape as the output.");
+            separableMultiDistBlockwiseImpl(source, dest, *temporary, background, pixelPitch,
+                                            dmax, takeRoot, options);
+        }
+        else
+        {
+            ChunkedArrayLazy<N, Real> tmp(dest.shape(), dest.chunkShape());
+            separableMultiDistBlockwiseImpl(source, dest, tmp, background, pixelPitch,
+                                            dmax, takeRoot, options);
+        }
+    }
+    else        // work directly on the destination array
+    {
+        separableMultiDistBlockwiseImpl(source, dest, dest, background, pixelPitch,
+                                        (double)T2(std::ceil(dmax)), takeRoot, options);
+    }
+}
+
+} // namespace blockwise_distance_detail
+
+/********************************************************/
+/*                                                      */
+/*          separableMultiDistSquaredBlockwise          */
+/*                                                      */
+/********************************************************/
+
+/** \brief Euclidean distance squared on ChunkedArrays.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        // explicitly specify pixel pitch for each coordinate
+        template <unsigned int N, class T1, class T2, class Array>
+        void
+        separableMultiDistSquaredBlockwise(ChunkedArray<N, T1> const & source,
+                                           ChunkedArray<N, T2> & dest,
+                                           bool background,
+                                           Array const & pixelPitch,
+                                           ParallelOptions const & options = ParallelOptions());
+
+        // use default pixel pitch = 1.0 for each coordinate
+        template <unsigned int N, class T1, class T2>
+        void
+        separableMultiDistSquaredBlockwise(ChunkedArray<N, T1> const & source,
+                                           ChunkedArray<N, T2> & dest,
+                                           bool background,
+                                           ParallelOptions const & options = ParallelOptions());
+
+        // provide temporary storage
+        template <unsigned int N, class T1, class T2, class T3, class Array>
+        void
+        separableMultiDistSquaredBlockwise(ChunkedArray<N, T1> const & source,
+                                           ChunkedArray<N, T2> & dest,
+                                           bool background,
+                                           Array const & pixelPitch,
+                                           ChunkedArray<N, T3> & temporary_storage,
+                                           ParallelOptions const & options = ParallelOptions());
+    }
+    \endcode
+
+    Computes the same result as \ref separableMultiDistSquared(), but never holds more
+    than one slab of complete lines per thread in memory: the pass along dimension
+    <tt>d</tt> processes slabs which span the entire array along <tt>d</tt> and are one chunk
+    thick along all other dimensions. Slabs are processed in parallel as specified by
+    \a options. In-between passes, the intermediate results are stored in \a dest.
+    When \a dest cannot hold them without overflow (see \ref separableMultiDistSquared()),
+    \a temporary_storage is used instead, which must have the same shape and chunk shape as
+    \a dest and a real-valued type (e.g. a \ref ChunkedArrayCompressed or \ref ChunkedArrayHDF5
+    to keep memory bounded). If it is not provided, a \ref ChunkedArrayLazy is created.
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/blockwise_distance.hxx\><br/>
+    Namespace: vigra
+
+    \code
+    Shape3 shape(2048), chunk_shape(64);
+    ChunkedArrayCompressed<3, UInt8> mask(shape, chunk_shape);
+    ChunkedArrayCompressed<3, float> dist(shape, chunk_shape);
+    ...
+
+    // Calculate Euclidean distance squared for all background pixels
+    separableMultiDistSquaredBlockwise(mask, dist, true, ParallelOptions().numThreads(16));
+    \endcode
+
+    \see vigra::separableMultiDistSquared(), vigra::separableMultiDistanceBlockwise()
+*/
+doxygen_overloaded_function(template <...> void separableMultiDistSquaredBlockwise)
+
+template <unsigned int N, class T1, class T2, class Array>
+inline void
+separableMultiDistSquaredBlockwise(ChunkedArray<N, T1> const & source,
+                                   ChunkedArray<N, T2> & dest,
+                                   bool background,
+                                   Array const & pixelPitch,
+                                   ParallelOptions const & options = ParallelOptions())
+{
+    blockwise_distance_detail::separableMultiDistBlockwise(source, dest, background, pixelPitch,
+                                      (ChunkedArray<N, typename NumericTraits<T2>::RealPromote> *)0,
+                                      false, options);
+}
+
+template <unsigned int N, class T1, class T2>
+inline void
+separableMultiDistSquaredBlockwise(ChunkedArray<N, T1> const & source,
+                                   ChunkedArray<N, T2> & dest,
+                                   bool background,
+                                   ParallelOptions const & options = ParallelOptions())
+{
+    ArrayVector<double> pixelPitch(N, 1.0);
+    separableMultiDistSquaredBlockwise(source, dest, background, pixelPitch, options);
+}
+
+template <unsigned int N, class T1, class T2, class T3, class Array>
+inline void
+separableMultiDistSquaredBlockwise(ChunkedArray<N, T1> const & source,
+                                   ChunkedArray<N, T2> & dest,
+                                   bool background,
+                                   Array const & pixelPitch,
+                                   ChunkedArray<N, T3> & temporary_storage,
+                                   ParallelOptions const & options = ParallelOptions())
+{
+    blockwise_distance_detail::separableMultiDistBlockwise(source, dest, background, pixelPitch,
+                                                           &temporary_storage, false, options);
+}
+
+/********************************************************/
+/*                                                      */
+/*           separableMultiDistanceBlockwise            */
+/*                                                      */
+/********************************************************/
+
+/** \brief Euclidean distance on ChunkedArrays.
+
+    <b> Declarations:</b>
+
+    \code
+    namespace vigra {
+        // explicitly specify pixel pitch for each coordinate
+        template <unsigned int N, class T1, class T2, class Array>
+        void
+        separableMultiDistanceBlockwise(ChunkedArray<N, T1> const & source,
+                                        ChunkedArray<N, T2> & dest,
+                                        bool background,
+                                        Array const & pixelPitch,
+                                        ParallelOptions const & options = ParallelOptions());
+
+        // use default pixel pitch = 1.0 for each coordinate
+        template <unsigned int N, class T1, class T2>
+        void
+        separableMultiDistanceBlockwise(ChunkedArray<N, T1> const & source,
+                                        ChunkedArray<N, T2> & dest,
+                                        bool background,
+                                        ParallelOptions const & options = ParallelOptions());
+
+        // provide temporary storage
+        template <unsigned int N, class T1, class T2, class T3, class Array>
+        void
+        separableMultiDistanceBlockwise(ChunkedArray<N, T1> const & source,
+                                        ChunkedArray<N, T2> & dest,
+                                        bool background,
+                                        Array const & pixelPitch,
+                                        ChunkedArray<N, T3> & temporary_storage,
+                                        ParallelOptions const & options = ParallelOptions());
+    }
+    \endcode
+
+    Computes the same result as \ref separableMultiDistance(). The square root is taken
+    in the last pass of \ref separableMultiDistSquaredBlockwise(), so that no additional
+    pass over the array is required. See there for more documentation.
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/blockwise_distance.hxx\><br/>
+    Namespace: vigra
+
+    \code
+    Shape3 shape(2048), chunk_shape(64);
+    ChunkedArrayCompressed<3, UInt8> mask(shape, chunk_shape);
+    ChunkedArrayCompressed<3, float> dist(shape, chunk_shape);
+    ...
+
+    // Calculate Euclidean distance for all background pixels
+    separableMultiDistanceBlockwise(mask, dist, true, ParallelOptions().numThreads(16));
+    \endcode
+
+    \see vigra::separableMultiDistance(), vigra::separableMultiDistSquaredBlockwise()
+*/
+doxygen_overloaded_function(template <...> void separableMultiDistanceBlockwise)
+
+template <unsigned int N, class T1, class T2, class Array>
+inline void
+separableMultiDistanceBlockwise(ChunkedArray<N, T1> const & source,
+                                ChunkedArray<N, T2> & dest,
+                                bool background,
+                                Array const & pixelPitch,
+                                ParallelOptions const & options = ParallelOptions())
+{
+    blockwise_distance_detail::separableMultiDistBlockwise(source, dest, background, pixelPitch,
+                                      (ChunkedArray<N, typename NumericTraits<T2>::RealPromote> *)0,
+                                      true, options);
+}
+
+template <unsigned int N, class T1, class T2>
+inline void
+separableMultiDistanceBlockwise(ChunkedArray<N, T1> const & source,
+                                ChunkedArray<N, T2> & dest,
+                                bool background,
+                                ParallelOptions const & options = ParallelOptions())
+{
+    ArrayVector<double> pixelPitch(N, 1.0);
+    separableMultiDistanceBlockwise(source, dest, background, pixelPitch, options);
+}
+
+template <unsigned int N, class T1, class T2, class T3, class Array>
+inline void
+separableMultiDistanceBlockwise(ChunkedArray<N, T1> const & source,
+                                ChunkedArray<N, T2> & dest,
+                                bool background,
+                                Array const & pixelPitch,
+                                ChunkedArray<N, T3> & temporary_storage,
+                                ParallelOptions const & options = ParallelOptions())
+{
+    blockwise_distance_detail::separableMultiDistBlockwise(source, dest, background, pixelPitch,
+                                                           &temporary_storage, true, options);
+}
+
+//@}
+
+} // namespace vigra
+
+#endif // VIGRA_BLOCKWISE_DISTANCE_HXX
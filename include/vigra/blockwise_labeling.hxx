@@ -37,7 +37,9 @@
 #define VIGRA_BLOCKWISE_LABELING_HXX
 
 #include <algorithm>
+#include <vector>
 
+#include "threading.hxx"
 #include "threadpool.hxx"
 #include "counting_iterator.hxx"
 #include "multi_gridgraph.hxx"
@@ -173,9 +175,12 @@ blockwiseLabeling(DataBlocksIterator data_blocks_begin, DataBlocksIterator data_
         //std::vector<int> ids(d);
         //std::iota(ids.begin(), ids.end(), 0 );
 
-        parallel_foreach(options.getNumThreads(), d,
+        parallel_foreach(options, d,
             [&](const int /*threadId*/, const uint64_t i){
-                Label resVal = labelMultiArray(data_blocks_it[i], label_blocks_it[i],
+                // keep the iterators alive, so that chunked blocks stay referenced
+                DataBlocksIterator data_block = data_blocks_it + i;
+                LabelBlocksIterator label_block = label_blocks_it + i;
+                Label resVal = labelMultiArray(*data_block, *label_block,
                                                options, equal);
                 if(has_background) // FIXME: reversed condition?
                     ++resVal;
@@ -221,8 +226,9 @@ blockwiseLabeling(DataBlocksIterator data_blocks_begin, DataBlocksIterator data_
         border_visitor.v_label_offset = label_offsets[v];
         border_visitor.global_unions = &global_unions;
         border_visitor.equal = &equal;
-        visitBorder(data_blocks_begin[u], label_blocks_begin[u],
-                    data_blocks_begin[v], label_blocks_begin[v],
+        DataBlocksIterator data_u = data_blocks_begin + u, data_v = data_blocks_begin + v;
+        LabelBlocksIterator label_u = label_blocks_begin + u, label_v = label_blocks_begin + v;
+        visitBorder(*data_u, *label_u, *data_v, *label_v,
                     difference, options.getNeighborhood(), border_visitor);
     }
 
@@ -296,6 +302,320 @@ void toGlobalLabels(LabelBlocksIterator label_blocks_begin, LabelBlocksIterator
     }
 }
 
+// Union-find over a shared parent array of scan-order pixel indices which can be
+// modified by several threads at once. Roots are linked by compare-and-swap such that
+// the smaller index always becomes the root, i.e. the root of every region is its
+// first pixel in scan order.
+template <class Index>
+class ConcurrentUnionFind
+{
+  public:
+    static const Index background = Index(~Index(0));
+
+    explicit ConcurrentUnionFind(std::size_t size)
+    : parent_(size)
+    {}
+
+    Index parent(Index i) const
+    {
+        return parent_[i].load(threading::memory_order_relaxed);
+    }
+
+    void setParent(Index i, Index p)
+    {
+        parent_[i].store(p, threading::memory_order_relaxed);
+    }
+
+    Index find(Index i)
+    {
+        // path halving: non-roots never become roots again, so any ancestor
+        // is a valid replacement for the parent, even under concurrent updates
+        Index p = parent(i);
+        while(p != i)
+        {
+            Index pp = parent(p);
+            if(pp != p)
+                setParent(i, pp);
+            i = p;
+            p = pp;
+        }
+        return i;
+    }
+
+        // merge the regions of 'a' and 'b', returns the root that was attached to the
+        // other one (i.e. that is no longer a root), or 'background' if a == b already
+    Index makeUnion(Index a, Index b)
+    {
+        for(;;)
+        {
+            a = find(a);
+            b = find(b);
+            if(a == b)
+                return background;
+            if(a < b)
+                std::swap(a, b);
+            Index expected = a;
+            if(parent_[a].compare_exchange_weak(expected, b))
+                return a;
+        }
+    }
+
+  private:
+    std::vector<threading::atomic<Index> > parent_;
+};
+
+template <class Index>
+const Index ConcurrentUnionFind<Index>::background;
+
+// Find the runs of equal values along the first axis in the row at 'in', skipping the background.
+// The label of each run is the scan-order index of its first pixel.
+template <class T, class Index, class Equal>
+void
+findLabelRuns(T const * in, MultiArrayIndex stride, MultiArrayIndex width, Index index,
+              bool has_background, T const & background_value, Equal const & equal,
+              std::vector<detail::LabelRun<T, Index> > & runs)
+{
+    runs.clear();
+    for(MultiArrayIndex x = 0; x < width; )
+    {
+        T const & value = in[x*stride];
+        MultiArrayIndex end = x + 1;
+        while(end < width && equal(value, in[end*stride]))
+            ++end;
+        if(!has_background || !equal(value, background_value))
+        {
+            detail::LabelRun<T, Index> run = { x, end, value, (Index)(index + x) };
+            runs.push_back(run);
+        }
+        x = end;
+    }
+}
+
+template <unsigned int N, class Index, class T, class S1,
+                                       class Label, class S2,
+          class Equal>
+Label
+labelMultiArrayParallelImpl(MultiArrayView<N, T, S1> const & data,
+                            MultiArrayView<N, Label, S2> labels,
+                            BlockwiseLabelOptions const & options,
+                            Equal equal)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+    typedef ConcurrentUnionFind<Index> UnionFind;
+    typedef std::vector<detail::LabelRun<T, Index> > RunRow;
+
+    Shape const shape = data.shape();
+    MultiArrayIndex const width = shape[0],
+                          row_count = data.size() / width,
+                          slice_count = N > 1 ? shape[N-1] : 1,
+                          rows_per_slice = row_count / slice_count;
+
+    bool const has_background = options.hasBackgroundValue();
+    T const background_value = options.template getBackgroundValue<T>();
+    NeighborhoodType const neighborhood = options.getNeighborhood();
+    MultiArrayIndex const ext = neighborhood == DirectNeighborhood ? 0 : 1;
+
+    // rows are numbered in scan order of their coordinates along axes 1...N-1
+    Shape row_stride;
+    for(unsigned int k = 1; k < N; ++k)
+        row_stride[k] = k == 1 ? 1 : row_stride[k-1]*shape[k-1];
+
+    auto row_coordinate = [&](MultiArrayIndex row)
+    {
+        Shape c;
+        for(unsigned int k = 1; k < N; ++k)
+        {
+            c[k] = row % shape[k];
+            row /= shape[k];
+        }
+        return c;
+    };
+
+    // offsets from a row to the rows of its causal neighbors (those preceding it in scan order),
+    // and the largest distance between a row and a neighbor row
+    std::vector<Shape> neighbor_rows;
+    MultiArrayIndex max_row_distance = 0;
+    {
+        Shape cube(neighborhood == DirectNeighborhood ? 2 : 3);
+        cube[0] = 1;
+        MultiCoordinateIterator<N> i(cube), end = i.getEndIterator();
+        for(; i != end; ++i)
+        {
+            Shape d = *i - Shape(1);
+            d[0] = 0;
+            if(neighborhood == DirectNeighborhood && sum(abs(d)) != 1)
+                continue;
+            int k = N - 1;
+            while(k > 0 && d[k] == 0)
+                --k;
+            if(k > 0 && d[k] < 0)
+            {
+                neighbor_rows.push_back(d);
+                max_row_distance = std::max(max_row_distance, -dot(d, row_stride));
+            }
+        }
+    }
+
+    // split the array into slabs along the last axis, several per thread for load balancing
+    MultiArrayIndex const slab_count = std::min<MultiArrayIndex>(slice_count, 4*std::max(options.getActualNumThreads(), 1)),
+                          slices_per_slab = (slice_count + slab_count - 1) / slab_count,
+                          rows_per_slab = slices_per_slab*rows_per_slice;
+    std::vector<threading::atomic<std::ptrdiff_t> > slab_roots(slab_count);
+    std::vector<std::ptrdiff_t> slab_offsets(slab_count + 1, 0);
+    for(MultiArrayIndex slab = 0; slab < slab_count; ++slab)
+        slab_roots[slab].store(0);
+
+    UnionFind regions(data.size());
+
+    // merge the runs of a row with the touching runs of equal value in a neighbor row
+    auto merge_runs = [&](RunRow const & row, RunRow const & neighbor)
+    {
+        std::size_t pos = 0;
+        for(std::size_t r = 0; r < row.size(); ++r)
+        {
+            while(pos < neighbor.size() && neighbor[pos].end + ext <= row[r].begin)
+                ++pos;
+            for(std::size_t k = pos; k < neighbor.size() && neighbor[k].begin < row[r].end + ext; ++k)
+            {
+                if(!equal(row[r].value, neighbor[k].value))
+                    continue;
+                Index attached = regions.makeUnion(row[r].label, neighbor[k].label);
+                if(attached != UnionFind::background)
+                    --slab_roots[attached / (width*rows_per_slab)];
+            }
+        }
+    };
+
+    // pass 1: initialize each pixel's parent with the start of its run, and merge the runs
+    //         within each slab (keeping the runs of the rows that may still be needed)
+    parallel_foreach(options, slab_count,
+        [&](int /*thread_id*/, MultiArrayIndex slab)
+        {
+            MultiArrayIndex const row_begin = slab*rows_per_slab,
+                                  row_end = std::min(row_count, row_begin + rows_per_slab);
+            std::vector<RunRow> runs(max_row_distance + 1);
+            std::ptrdiff_t run_count = 0;
+            for(MultiArrayIndex row = row_begin; row < row_end; ++row)
+            {
+                Shape const c = row_coordinate(row);
+                Index const index = (Index)(row*width);
+                RunRow & current = runs[row % runs.size()];
+                findLabelRuns(&data[c], data.stride(0), width, index,
+                              has_background, background_value, equal, current);
+                run_count += current.size();
+
+                MultiArrayIndex x = 0;
+                for(std::size_t r = 0; r < current.size(); ++r)
+                {
+                    for(; x < current[r].begin; ++x)
+                        regions.setParent(index + x, UnionFind::background);
+                    for(; x < current[r].end; ++x)
+                        regions.setParent(index + x, current[r].label);
+                }
+                for(; x < width; ++x)
+                    regions.setParent(index + x, UnionFind::background);
+
+                // the slab border is handled in pass 2
+                for(std::size_t k = 0; k < neighbor_rows.size(); ++k)
+                {
+                    MultiArrayIndex const neighbor = row + dot(neighbor_rows[k], row_stride);
+                    if(neighbor >= row_begin && data.isInside(c + neighbor_rows[k]))
+                        merge_runs(current, runs[neighbor % runs.size()]);
+                }
+            }
+            slab_roots[slab] += run_count;
+        });
+
+    // pass 2: merge across the slab borders
+    parallel_foreach(options, slab_count - 1,
+        [&](int /*thread_id*/, MultiArrayIndex slab)
+        {
+            MultiArrayIndex const row_begin = (slab + 1)*rows_per_slab,
+                                  row_end = std::min(row_count, row_begin + rows_per_slice);
+            RunRow current, neighbor_runs;
+            for(MultiArrayIndex row = row_begin; row < row_end; ++row)
+            {
+                Shape const c = row_coordinate(row);
+                findLabelRuns(&data[c], data.stride(0), width, (Index)(row*width),
+                              has_background, background_value, equal, current);
+                for(std::size_t k = 0; k < neighbor_rows.size(); ++k)
+                {
+                    Shape const nc = c + neighbor_rows[k];
+                    if(neighbor_rows[k][N-1] == 0 || !data.isInside(nc))
+                        continue;
+                    MultiArrayIndex const neighbor = row + dot(neighbor_rows[k], row_stride);
+                    findLabelRuns(&data[nc], data.stride(0), width, (Index)(neighbor*width),
+                                  has_background, background_value, equal, neighbor_runs);
+                    merge_runs(current, neighbor_runs);
+                }
+            }
+        });
+
+    // the roots are numbered consecutively in scan order
+    for(MultiArrayIndex slab = 0; slab < slab_count; ++slab)
+        slab_offsets[slab+1] = slab_offsets[slab] + slab_roots[slab].load();
+    vigra_precondition((std::size_t)slab_offsets[slab_count] <= (std::size_t)NumericTraits<Label>::max(),
+        "labelMultiArrayParallel(): Need more labels than can be represented in the destination type.");
+
+    // pass 3: label the roots
+    parallel_foreach(options, slab_count,
+        [&](int /*thread_id*/, MultiArrayIndex slab)
+        {
+            MultiArrayIndex const row_begin = slab*rows_per_slab,
+                                  row_end = std::min(row_count, row_begin + rows_per_slab);
+            Label label = (Label)slab_offsets[slab];
+            for(MultiArrayIndex row = row_begin; row < row_end; ++row)
+            {
+                Label * out = &labels[row_coordinate(row)];
+                Index const index = (Index)(row*width);
+                for(MultiArrayIndex x = 0; x < width; ++x)
+                {
+                    if(regions.parent(index + x) == index + x)
+                        out[x*labels.stride(0)] = ++label;
+                }
+            }
+        });
+
+    // pass 4: copy the root labels to all other pixels
+    parallel_foreach(options, slab_count,
+        [&](int /*thread_id*/, MultiArrayIndex slab)
+        {
+            MultiArrayIndex const row_begin = slab*rows_per_slab,
+                                  row_end = std::min(row_count, row_begin + rows_per_slab);
+            Index last_parent = UnionFind::background;
+            Label last_label = 0;
+            for(MultiArrayIndex row = row_begin; row < row_end; ++row)
+            {
+                Label * out = &labels[row_coordinate(row)];
+                Index const index = (Index)(row*width);
+                for(MultiArrayIndex x = 0; x < width; ++x)
+                {
+                    Index const parent = regions.parent(index + x);
+                    if(parent == index + x)
+                        continue;
+                    if(parent != last_parent)
+                    {
+                        last_parent = parent;
+                        if(parent == UnionFind::background)
+                        {
+                            last_label = 0;
+                        }
+                        else
+                        {
+                            Index const root = regions.find(parent);
+                            Shape p = row_coordinate(root / width);
+                            p[0] = root % width;
+                            last_label = labels[p];
+                        }
+                    }
+                    out[x*labels.stride(0)] = last_label;
+                }
+            }
+        });
+
+    return (Label)slab_offsets[slab_count];
+}
+
 } // namespace blockwise_labeling_detail
 
 /*************************************************************/
@@ -355,6 +675,7 @@ void toGlobalLabels(LabelBlocksIterator label_blocks_begin, LabelBlocksIterator
     \endcode
 
     The resulting labeling is equivalent to a labeling by \ref labelMultiArray, that is, the connected components are the same but may have different ids.
+    For arrays in memory, \ref labelMultiArrayParallel() is usually faster and needs less memory.
     \ref NeighborhoodType and background value (if any) can be specified with the LabelOptions object.
     If the \a mapping parameter is provided, each chunk is labeled seperately and contiguously (starting at one, zero for background),
     with \a mapping containing a mapping of local labels to global labels for each chunk.
@@ -473,6 +794,8 @@ Label labelMultiArrayBlockwise(const ChunkedArray<N, Data>& data,
 
     DataChunkIterator data_chunks_begin = data.chunk_begin(Shape(0), data.shape());
     LabelChunkIterator label_chunks_begin = labels.chunk_begin(Shape(0), labels.shape());
+    // load the next data chunks in the background while the present ones are labeled
+    data_chunks_begin.setPrefetchWindow(2);
 
     return blockwiseLabeling(data_chunks_begin, data_chunks_begin.getEndIterator(),
                              label_chunks_begin, label_chunks_begin.getEndIterator(),
@@ -489,7 +812,9 @@ Label labelMultiArrayBlockwise(const ChunkedArray<N, Data>& data,
     MultiArray<N, std::vector<Label> > mapping(data.chunkArrayShape());
     Label result = labelMultiArrayBlockwise(data, labels, options, equal, mapping);
     typedef typename ChunkedArray<N, Data>::shape_type Shape;
-    toGlobalLabels(labels.chunk_begin(Shape(0), data.shape()), labels.chunk_end(Shape(0), data.shape()), mapping.begin(), mapping.end());
+    typename ChunkedArray<N, Label>::chunk_iterator label_chunks = labels.chunk_begin(Shape(0), data.shape());
+    label_chunks.setPrefetchWindow(2);
+    toGlobalLabels(label_chunks, label_chunks.getEndIterator(), mapping.begin(), mapping.end());
     return result;
 }
 
@@ -501,6 +826,94 @@ Label labelMultiArrayBlockwise(const ChunkedArray<N, Data>& data,
     return labelMultiArrayBlockwise(data, labels, options, std::equal_to<Data>());
 }
 
+/*************************************************************/
+/*                                                           */
+/*                      labelMultiArrayParallel              */
+/*                                                           */
+/*************************************************************/
+
+/** \weakgroup ParallelProcessing
+    \sa labelMultiArrayParallel <B>(...)</B>
+*/
+
+/** \brief Parallel connected components labeling for MultiArrayViews.
+
+    <b> Declaration:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class T, class S1,
+                                  class Label, class S2,
+                  class Equal = std::equal_to<T> >
+        Label labelMultiArrayParallel(MultiArrayView<N, T, S1> const & data,
+                                      MultiArrayView<N, Label, S2> labels,
+                                      BlockwiseLabelOptions const & options = BlockwiseLabelOptions(),
+                                      Equal equal = std::equal_to<T>());
+    }
+    \endcode
+
+    In contrast to \ref labelMultiArrayBlockwise(), all threads share a single
+    union-find structure over the entire array, which is updated lock-free by means
+    of atomic compare-and-swap operations. The array is split into slabs along its last
+    axis which are processed in parallel. Regions are then numbered in a single final
+    pass, without per-block label mappings. The result is identical to the one of
+    \ref labelMultiArray(), i.e. the region labels are consecutive and ordered
+    by the scan-order position of each region's first pixel. The union-find structure
+    needs 4 bytes per pixel (8 bytes for arrays with more than 2<sup>32</sup> pixels).
+
+    Neighborhood, background value, and number of threads are taken from \a options,
+    the block shape is ignored.
+
+    Return: the number of regions found (=largest region label)
+
+    <b> Usage: </b>
+
+    <b>\#include </b> \<vigra/blockwise_labeling.hxx\><br>
+    Namespace: vigra
+
+    \code
+    MultiArray<3, UInt8> data(Shape3(512));
+    MultiArray<3, UInt32> labels(data.shape());
+    // fill data ...
+
+    UInt32 max_label = labelMultiArrayParallel(data, labels,
+                           BlockwiseLabelOptions().neighborhood(IndirectNeighborhood)
+                                                  .ignoreBackgroundValue(0)
+                                                  .numThreads(8));
+    \endcode
+*/
+doxygen_overloaded_function(template <...> unsigned int labelMultiArrayParallel)
+
+template <unsigned int N, class T, class S1,
+                          class Label, class S2,
+          class Equal>
+Label labelMultiArrayParallel(MultiArrayView<N, T, S1> const & data,
+                              MultiArrayView<N, Label, S2> labels,
+                              BlockwiseLabelOptions const & options,
+                              Equal equal)
+{
+    using namespace blockwise_labeling_detail;
+
+    vigra_precondition(data.shape() == labels.shape(),
+        "labelMultiArrayParallel(): shape mismatch between input and output.");
+    if(data.size() == 0)
+        return 0;
+    if(data.size() < (MultiArrayIndex)NumericTraits<UInt32>::max())
+        return labelMultiArrayParallelImpl<N, UInt32>(data, labels, options, equal);
+    else
+        return labelMultiArrayParallelImpl<N, UInt64>(data, labels, options, equal);
+}
+
+template <unsigned int N, class T, class S1,
+                          class Label, class S2>
+inline Label
+labelMultiArrayParallel(MultiArrayView<N, T, S1> const & data,
+                        MultiArrayView<N, Label, S2> labels,
+                        BlockwiseLabelOptions const & options = BlockwiseLabelOptions())
+{
+    return labelMultiArrayParallel(data, labels, options, std::equal_to<T>());
+}
+
 //@}
 
 } // namespace vigra
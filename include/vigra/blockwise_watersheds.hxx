@@ -43,8 +43,10 @@
 #include "blockwise_labeling.hxx"
 #include "metaprogramming.hxx"
 #include "overlapped_blocks.hxx"
+#include "multi_watersheds.hxx"
 
 #include <limits>
+#include <vector>
 
 namespace vigra
 {
@@ -72,11 +74,13 @@ void prepareBlockwiseWatersheds(const Overlaps<DataArray>& overlaps,
     MultiCoordinateIterator<DataArray::actual_dimension> end = itBegin.getEndIterator();
     typedef typename MultiCoordinateIterator<DataArray::actual_dimension>::value_type Coordinate;
 
-    parallel_foreach(options.getNumThreads(),
+    parallel_foreach(options,
         itBegin,end,
         [&](const int /*threadId*/, const Coordinate  iterVal){
 
-            DirectionsBlock directions_block = directions_blocks_begin[iterVal];
+            // the iterator keeps a chunked block referenced while we write to it
+            DirectionsBlocksIterator directions_it = directions_blocks_begin + iterVal;
+            DirectionsBlock directions_block = *directions_it;
             OverlappingBlock<DataArray> data_block = overlaps[iterVal];
 
             typedef GridGraph<DataArray::actual_dimension, undirected_tag> Graph;
@@ -131,6 +135,458 @@ struct UnionFindWatershedsEquality
     {};
 };
 
+    // The blockwise seeded watershed reproduces the flooding order of the serial
+    // region growing algorithm in two passes. The first pass computes for every
+    // point the key (cost, dist): 'cost' is the flooding level at which the point
+    // is reached, and 'dist' its position in the FIFO order of the serial algorithm
+    // within this level (0 for seeds, 1 for points entering the level from below,
+    // and the parent's 'dist' plus 2 for every step along a plateau, so that the
+    // descendants of seeds precede those of entry points as in the serial queue).
+    // The second pass gives each point the smallest label among its neighbors of
+    // minimal key. Both passes are monotone and are therefore iterated blockwise
+    // until the keys and labels at all block borders are consistent.
+static const UInt32 unreachedWatershedNode = std::numeric_limits<UInt32>::max();
+
+template <class Cost>
+inline bool
+watershedKeyLess(Cost c1, UInt32 d1, Cost c2, UInt32 d2)
+{
+    if(d1 == unreachedWatershedNode)
+        return false;
+    if(d2 == unreachedWatershedNode)
+        return true;
+    if(c1 < c2)
+        return true;
+    if(c2 < c1)
+        return false;
+    return d1 < d2;
+}
+
+    // queue entry, ordered by the flooding level 'cost' (the queue's priority)
+template <class Label>
+struct SeededWatershedsEntry
+{
+    MultiArrayIndex index;
+    UInt32 dist;
+    Label label;
+};
+
+    // copy an ROI of 'array' into 'block' (whose shape determines the ROI size)
+template <unsigned int N, class T, class S, class U, class S2>
+inline void
+checkoutBlock(MultiArrayView<N, T, S> const & array,
+              typename MultiArrayShape<N>::type const & start,
+              MultiArrayView<N, U, S2> block)
+{
+    block = array.subarray(start, start + block.shape());
+}
+
+template <unsigned int N, class T, class U, class S2>
+inline void
+checkoutBlock(ChunkedArray<N, T> const & array,
+              typename MultiArrayShape<N>::type const & start,
+              MultiArrayView<N, U, S2> block)
+{
+    array.checkoutSubarray(start, block, ParallelOptions().numThreads(ParallelOptions::NoThreads));
+}
+
+template <unsigned int N, class T, class S, class U, class S2>
+inline void
+commitBlock(MultiArrayView<N, T, S> array,
+            typename MultiArrayShape<N>::type const & start,
+            MultiArrayView<N, U, S2> const & block)
+{
+    array.subarray(start, start + block.shape()) = block;
+}
+
+template <unsigned int N, class T, class U, class S2>
+inline void
+commitBlock(ChunkedArray<N, T> & array,
+            typename MultiArrayShape<N>::type const & start,
+            MultiArrayView<N, U, S2> const & block)
+{
+    array.commitSubarray(start, block, ParallelOptions().numThreads(ParallelOptions::NoThreads));
+}
+
+    // Working copy of one block of the blockwise seeded watershed, padded by two
+    // points on each side: the first layer holds the halo (the neighboring blocks'
+    // current results, which act as boundary conditions), and the second layer
+    // ensures that all neighbors of halo points can be addressed by a constant offset.
+template <unsigned int N, class Data, class Label>
+class SeededWatershedsBlock
+{
+  public:
+    typedef typename MultiArrayShape<N>::type       Shape;
+    typedef SeededWatershedsEntry<Label>            Entry;
+    typedef typename lemon_graph::graph_detail::WatershedQueue<Entry, Data>::type Queue;
+
+    enum { Outside = 0, Inside = 1, Border = 2 };
+
+    SeededWatershedsBlock(Shape const & shape, Shape const & begin, Shape const & end,
+                          NeighborhoodType neighborhood)
+    : begin_(begin),
+      end_(end),
+      outer_begin_(max(begin - Shape(1), Shape())),
+      outer_end_(min(end + Shape(1), shape)),
+      cost_(end - begin + Shape(4)),
+      dist_(end - begin + Shape(4), unreachedWatershedNode),
+      mask_(end - begin + Shape(4)),
+      modified_(false)
+    {
+        Shape inner_shape = end - begin;
+        mask_.subarray(Shape(2), Shape(2) + inner_shape) = Border;
+        if(min(inner_shape) > 2)
+            mask_.subarray(Shape(3), Shape(1) + inner_shape) = Inside;
+
+        MultiCoordinateIterator<N> i(Shape(3)), iend(i.getEndIterator());
+        for(; i != iend; ++i)
+        {
+            Shape diff = *i - Shape(1);
+            int nonzero = 0;
+            for(unsigned int k = 0; k < N; ++k)
+                nonzero += diff[k] != 0;
+            if(nonzero == 0 || (neighborhood == DirectNeighborhood && nonzero != 1))
+                continue;
+            offsets_.push_back(dot(diff, mask_.stride()));
+        }
+    }
+
+    template <class CostArray, class DistArray>
+    void loadKeys(CostArray const & cost, DistArray const & dist)
+    {
+        checkoutHalo(cost, cost_);
+        checkoutHalo(dist, dist_);
+    }
+
+    template <class CostArray, class DistArray>
+    void storeKeys(CostArray & cost, DistArray & dist) const
+    {
+        commitInner(cost, cost_);
+        commitInner(dist, dist_);
+    }
+
+    template <class LabelArray>
+    void loadLabels(LabelArray const & labels)
+    {
+        labels_.reshape(mask_.shape());
+        checkoutHalo(labels, labels_);
+    }
+
+    template <class LabelArray>
+    void storeLabels(LabelArray & labels) const
+    {
+        commitInner(labels, labels_);
+    }
+
+        // Has the last call to computeKeys() or computeLabels() changed any inner point?
+    bool modified() const
+    {
+        return modified_;
+    }
+
+        // Flood the block from the halo (and, when 'first' is true, from the seeds
+        // inside the block), lowering the keys of inner points where possible.
+        // Returns true when a key on the block border has changed.
+    template <class DataArray>
+    bool computeKeys(DataArray const & data, bool first)
+    {
+        MultiArray<N, Data> data_block(mask_.shape());
+        checkoutBlock(data, begin_, data_block.subarray(Shape(2), end_ - begin_ + Shape(2)));
+
+        // the padded buffers are contiguous, so points are addressed by their scan order index
+        Data const * values = data_block.data();
+        Data * cost = cost_.data();
+        UInt32 * dist = dist_.data();
+        UInt8 const * mask = mask_.data();
+
+        Queue pqueue;
+        for(MultiArrayIndex i = 0; i < mask_.size(); ++i)
+        {
+            if(dist[i] == unreachedWatershedNode)
+                continue;
+            if(mask[i] == Outside || (first && dist[i] == 0))
+            {
+                Entry entry = { i, dist[i], Label() };
+                pqueue.push(entry, cost[i]);
+            }
+        }
+
+        bool changed = false;
+        modified_ = false;
+        while(!pqueue.empty())
+        {
+            Entry entry = pqueue.top();
+            Data entry_cost = pqueue.topPriority();
+            pqueue.pop();
+            if(entry.dist != dist[entry.index] || entry_cost != cost[entry.index])
+                continue; // superseded by a smaller key
+
+            for(std::size_t k = 0; k < offsets_.size(); ++k)
+            {
+                MultiArrayIndex target = entry.index + offsets_[k];
+                if(mask[target] == Outside || dist[target] == 0)
+                    continue;
+
+                Entry next = { target, entry.dist + 2, Label() };
+                Data next_cost = entry_cost;
+                if(entry_cost < values[target])
+                {
+                    next_cost = values[target];
+                    next.dist = 1;
+                }
+                if(!watershedKeyLess(next_cost, next.dist, cost[target], dist[target]))
+                    continue;
+
+                cost[target] = next_cost;
+                dist[target] = next.dist;
+                modified_ = true;
+                if(mask[target] == Border)
+                    changed = true;
+                pqueue.push(next, next_cost);
+            }
+        }
+        return changed;
+    }
+
+        // Propagate labels from the halo (and, when 'first' is true, from the seeds
+        // inside the block) to all points whose minimal neighbor carries a smaller
+        // label. Requires the final keys. Returns true when a label on the block
+        // border has changed.
+    bool computeLabels(bool first)
+    {
+        // minimal neighbor keys are computed on demand
+        MultiArray<N, Data>   min_cost_array(mask_.shape());
+        MultiArray<N, UInt32> min_dist_array(mask_.shape(), unreachedWatershedNode);
+
+        Data * min_cost = min_cost_array.data();
+        UInt32 * min_dist = min_dist_array.data();
+        Data const * cost = cost_.data();
+        UInt32 const * dist = dist_.data();
+        Label * labels = labels_.data();
+        UInt8 const * mask = mask_.data();
+
+        Queue pqueue;
+        for(MultiArrayIndex i = 0; i < mask_.size(); ++i)
+        {
+            if(labels[i] == 0)
+                continue;
+            if(mask[i] == Outside || (first && dist[i] == 0))
+            {
+                Entry entry = { i, dist[i], labels[i] };
+                pqueue.push(entry, cost[i]);
+            }
+        }
+
+        bool changed = false;
+        modified_ = false;
+        while(!pqueue.empty())
+        {
+            Entry entry = pqueue.top();
+            pqueue.pop();
+            if(entry.label != labels[entry.index])
+                continue; // superseded by a smaller label
+
+            for(std::size_t k = 0; k < offsets_.size(); ++k)
+            {
+                MultiArrayIndex target = entry.index + offsets_[k];
+                if(mask[target] == Outside || dist[target] == 0 ||
+                   (labels[target] != 0 && !(entry.label < labels[target])))
+                    continue;
+
+                if(min_dist[target] == unreachedWatershedNode)
+                {
+                    for(std::size_t j = 0; j < offsets_.size(); ++j)
+                    {
+                        MultiArrayIndex neighbor = target + offsets_[j];
+                        if(watershedKeyLess(cost[neighbor], dist[neighbor],
+                                            min_cost[target], min_dist[target]))
+                        {
+                            min_cost[target] = cost[neighbor];
+                            min_dist[target] = dist[neighbor];
+                        }
+                    }
+                }
+                if(dist[entry.index] != min_dist[target] || cost[entry.index] != min_cost[target])
+                    continue;
+
+                labels[target] = entry.label;
+                modified_ = true;
+                if(mask[target] == Border)
+                    changed = true;
+                Entry next = { target, dist[target], entry.label };
+                pqueue.push(next, cost[target]);
+            }
+        }
+        return changed;
+    }
+
+  private:
+    template <class Array, class T>
+    void checkoutHalo(Array const & array, MultiArray<N, T> & buffer) const
+    {
+        checkoutBlock(array, outer_begin_,
+                      buffer.subarray(outer_begin_ - begin_ + Shape(2), outer_end_ - begin_ + Shape(2)));
+    }
+
+    template <class Array, class T>
+    void commitInner(Array & array, MultiArray<N, T> const & buffer) const
+    {
+        commitBlock(array, begin_, buffer.subarray(Shape(2), end_ - begin_ + Shape(2)));
+    }
+
+    Shape begin_, end_, outer_begin_, outer_end_;
+    MultiArray<N, Data>   cost_;
+    MultiArray<N, UInt32> dist_;
+    MultiArray<N, Label>  labels_;
+    MultiArray<N, UInt8>  mask_;
+    ArrayVector<MultiArrayIndex> offsets_;
+    bool modified_;
+};
+
+    // Apply 'f(block_index, first)' to all blocks repeatedly until no block border
+    // changes anymore. In every round, the blocks are visited in 2^N phases according
+    // to the parity of their block coordinates, so that blocks processed concurrently
+    // never read each other's inner region. A block is only revisited when the border
+    // of one of its neighbors has changed since its last visit.
+template <unsigned int N, class F>
+void
+iterateSeededWatershedsBlocks(std::vector<typename MultiArrayShape<N>::type> const & blocks,
+                              typename MultiArrayShape<N>::type const & blocks_shape,
+                              BlockwiseLabelOptions const & options,
+                              F f)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    MultiCoordinateIterator<N> neighbors(Shape(3)), neighbors_end(neighbors.getEndIterator());
+    std::vector<std::ptrdiff_t> last_visit(blocks.size(), -1),
+                                last_change(blocks.size(), 0);
+    std::vector<std::size_t> todo;
+    std::ptrdiff_t phase = 0;
+    for(bool active = true; active; )
+    {
+        active = false;
+        for(unsigned int color = 0; color < (1u << N); ++color, ++phase)
+        {
+            todo.clear();
+            for(std::size_t k = 0; k < blocks.size(); ++k)
+            {
+                unsigned int block_color = 0;
+                for(unsigned int d = 0; d < N; ++d)
+                    block_color |= (unsigned int)(blocks[k][d] & 1) << d;
+                if(block_color != color)
+                    continue;
+
+                bool needs_visit = last_visit[k] < 0;
+                for(MultiCoordinateIterator<N> n = neighbors; !needs_visit && n != neighbors_end; ++n)
+                {
+                    Shape neighbor = blocks[k] + *n - Shape(1);
+                    if(neighbor == blocks[k] || !allLessEqual(Shape(), neighbor) || !allLess(neighbor, blocks_shape))
+                        continue;
+                    needs_visit = last_change[detail::CoordinateToScanOrder<N>::exec(blocks_shape, neighbor)] > last_visit[k];
+                }
+                if(needs_visit)
+                    todo.push_back(k);
+            }
+            if(todo.empty())
+                continue;
+            active = true;
+
+            parallel_foreach(options, todo.size(),
+                [&](int /*thread*/, std::size_t t)
+                {
+                    std::size_t k = todo[t];
+                    bool changed = f(k, last_visit[k] < 0);
+                    last_visit[k] = phase;
+                    if(changed)
+                        last_change[k] = phase;
+                });
+        }
+    }
+}
+
+template <unsigned int N, class DataArray, class CostArray, class DistArray, class LabelArray>
+typename LabelArray::value_type
+seededWatershedsBlockwiseImpl(DataArray const & data,
+                              CostArray & cost,
+                              DistArray & dist,
+                              LabelArray & labels,
+                              typename MultiArrayShape<N>::type const & block_shape,
+                              BlockwiseLabelOptions const & options)
+{
+    typedef typename MultiArrayShape<N>::type  Shape;
+    typedef typename DataArray::value_type     Data;
+    typedef typename LabelArray::value_type    Label;
+    typedef SeededWatershedsBlock<N, Data, Label> Block;
+
+    Shape shape = data.shape();
+    vigra_precondition(min(block_shape) > 0,
+        "seededWatershedsBlockwise(): block shape must be positive.");
+    Shape blocks_shape = (shape + block_shape - Shape(1)) / block_shape;
+
+    std::vector<Shape> blocks;
+    MultiCoordinateIterator<N> b(blocks_shape), bend(b.getEndIterator());
+    for(; b != bend; ++b)
+        blocks.push_back(*b);
+
+    // seeds are reached at their own data value, all other points are unreached
+    std::vector<Label> max_labels(options.getActualNumThreads(), Label());
+    parallel_foreach(options, blocks.size(),
+        [&](int thread, std::size_t k)
+        {
+            Shape begin = blocks[k] * block_shape,
+                  end   = min(begin + block_shape, shape);
+            MultiArray<N, Data>   data_block(end - begin), cost_block(end - begin);
+            MultiArray<N, UInt32> dist_block(end - begin);
+            MultiArray<N, Label>  label_block(end - begin);
+            checkoutBlock(data, begin, data_block);
+            checkoutBlock(labels, begin, label_block);
+            for(MultiArrayIndex i = 0; i < label_block.size(); ++i)
+            {
+                Label label = label_block.data()[i];
+                if(label != 0)
+                {
+                    cost_block.data()[i] = data_block.data()[i];
+                    dist_block.data()[i] = 0;
+                    if(max_labels[thread] < label)
+                        max_labels[thread] = label;
+                }
+                else
+                {
+                    dist_block.data()[i] = unreachedWatershedNode;
+                }
+            }
+            commitBlock(cost, begin, cost_block);
+            commitBlock(dist, begin, dist_block);
+        });
+
+    iterateSeededWatershedsBlocks<N>(blocks, blocks_shape, options,
+        [&](std::size_t k, bool first)
+        {
+            Shape begin = blocks[k] * block_shape;
+            Block block(shape, begin, min(begin + block_shape, shape), options.getNeighborhood());
+            block.loadKeys(cost, dist);
+            bool changed = block.computeKeys(data, first);
+            if(block.modified())
+                block.storeKeys(cost, dist);
+            return changed;
+        });
+
+    iterateSeededWatershedsBlocks<N>(blocks, blocks_shape, options,
+        [&](std::size_t k, bool first)
+        {
+            Shape begin = blocks[k] * block_shape;
+            Block block(shape, begin, min(begin + block_shape, shape), options.getNeighborhood());
+            block.loadKeys(cost, dist);
+            block.loadLabels(labels);
+            bool changed = block.computeLabels(first);
+            if(block.modified())
+                block.storeLabels(labels);
+            return changed;
+        });
+
+    return *std::max_element(max_labels.begin(), max_labels.end());
+}
+
 } // namespace blockwise_watersheds_detail
 
 /*************************************************************/
@@ -194,6 +650,8 @@ struct UnionFindWatershedsEquality
 
     unionFindWatershedsBlockwise(data, labels, IndirectNeighborhood);
     \endcode
+
+    See \ref seededWatershedsBlockwise() for a blockwise version of seeded region growing watersheds.
     */
 doxygen_overloaded_function(template <...> unsigned int unionFindWatershedsBlockwise)
 
@@ -257,6 +715,115 @@ unionFindWatershedsBlockwise(const ChunkedArray<N, Data>& data,
     return unionFindWatershedsBlockwise(data, labels, options, directions);
 }
 
+/*************************************************************/
+/*                                                           */
+/*                      seededWatershedsBlockwise            */
+/*                                                           */
+/*************************************************************/
+
+/** \weakgroup ParallelProcessing
+    \sa seededWatershedsBlockwise <B>(...)</B>
+*/
+
+/** \brief Blockwise parallel seeded watersheds for MultiArrays and ChunkedArrays.
+
+    <b> Declaration:</b>
+
+    \code
+    namespace vigra {
+        template <unsigned int N, class Data, class S1,
+                                  class Label, class S2>
+        Label
+        seededWatershedsBlockwise(MultiArrayView<N, Data, S1> const & data,
+                                  MultiArrayView<N, Label, S2> labels,
+                                  BlockwiseLabelOptions const & options = BlockwiseLabelOptions());
+
+        template <unsigned int N, class Data, class Label>
+        Label
+        seededWatershedsBlockwise(const ChunkedArray<N, Data>& data,
+                                  ChunkedArray<N, Label>& labels,
+                                  BlockwiseLabelOptions const & options = BlockwiseLabelOptions());
+    }
+    \endcode
+
+    On entry, \a labels must contain the seeds (non-zero labels, all other points zero).
+    On exit, every point that is connected to a seed carries the label of the region
+    it was flooded from, exactly as with the region growing variant of \ref watershedsMultiArray()
+    (i.e. \ref lemon_graph::watershedsGraph() with <tt>WatershedOptions().regionGrowing()</tt>
+    and the seeds passed in \a labels). The only freedom is in genuine ties: when a point is
+    reached from two different regions at the same flooding level and at the same position
+    of the serial algorithm's FIFO order along a plateau, the serial algorithm decides by the
+    internal order of its priority queue, whereas this function always takes the smaller label.
+    In particular, the results are identical for data whose values are pairwise distinct, and
+    the result of this function never depends on the block shape or the number of threads.
+
+    The array is split into blocks (of shape <tt>options.getBlockShape()</tt> for MultiArrayViews,
+    and the chunks for ChunkedArrays). Each block is flooded independently, using the current
+    results in a one-pixel halo around the block as boundary conditions, first to determine the
+    flooding order and then to propagate the labels. Blocks are processed in parallel and
+    revisited (incrementally) until no block border changes anymore. Adjacent blocks are never
+    processed concurrently. ChunkedArrays are accessed one block at a time, i.e. only the
+    chunks of the current blocks (and of two temporary \ref vigra::ChunkedArrayLazy arrays with
+    the same chunk shape) need to be in memory. Options such as biased labels, thresholds or
+    contours are not supported.
+
+    Return: the largest seed label
+
+    <b> Usage: </b>
+
+    <b>\#include </b> \<vigra/blockwise_watersheds.hxx\><br>
+    Namespace: vigra
+
+    \code
+    Shape3 shape(200);
+    MultiArray<3, float> data(shape);
+    MultiArray<3, UInt32> labels(shape);
+    // fill data and place seeds in labels ...
+
+    seededWatershedsBlockwise(data, labels,
+                              BlockwiseLabelOptions().neighborhood(IndirectNeighborhood)
+                                                     .blockShape(Shape3(64))
+                                                     .numThreads(8));
+    \endcode
+    */
+doxygen_overloaded_function(template <...> unsigned int seededWatershedsBlockwise)
+
+template <unsigned int N, class Data, class S1,
+                          class Label, class S2>
+Label seededWatershedsBlockwise(MultiArrayView<N, Data, S1> const & data,
+                                MultiArrayView<N, Label, S2> labels,
+                                BlockwiseLabelOptions const & options = BlockwiseLabelOptions())
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+    Shape shape = data.shape();
+    vigra_precondition(shape == labels.shape(),
+        "seededWatershedsBlockwise(): shapes of data and labels do not match");
+
+    MultiArray<N, Data>   cost(shape);
+    MultiArray<N, UInt32> dist(shape);
+    return blockwise_watersheds_detail::seededWatershedsBlockwiseImpl<N>(
+                   data, cost, dist, labels, options.getBlockShapeN<N>(), options);
+}
+
+template <unsigned int N, class Data, class Label>
+Label seededWatershedsBlockwise(const ChunkedArray<N, Data>& data,
+                                ChunkedArray<N, Label>& labels,
+                                BlockwiseLabelOptions const & options = BlockwiseLabelOptions())
+{
+    typedef typename ChunkedArray<N, Data>::shape_type Shape;
+    Shape shape = data.shape();
+    vigra_precondition(shape == labels.shape(),
+        "seededWatershedsBlockwise(): shapes of data and labels do not match");
+    Shape chunk_shape = data.chunkShape();
+    vigra_precondition(chunk_shape == labels.chunkShape(),
+        "seededWatershedsBlockwise(): chunk shapes do not match");
+
+    ChunkedArrayLazy<N, Data>   cost(shape, chunk_shape);
+    ChunkedArrayLazy<N, UInt32> dist(shape, chunk_shape);
+    return blockwise_watersheds_detail::seededWatershedsBlockwiseImpl<N>(
+                   data, cost, dist, labels, chunk_shape, options);
+}
+
 //@}
 
 } // namespace vigra
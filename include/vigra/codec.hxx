@@ -203,6 +203,22 @@ namespace vigra
         virtual const void * currentScanlineOfBand( unsigned int ) const = 0;
         virtual void nextScanline() = 0;
 
+        // Restrict decoding to the region [upperLeft, upperLeft + size) and
+        // deliver only every step-th row and column of it (codecs that scale
+        // natively, like JPEG, may average step x step blocks instead).
+        // Must be called before the first nextScanline(). Codecs that can skip
+        // the work outside the region override this function and return true;
+        // afterwards, getWidth() and getHeight() report the decoded size
+        // (i.e. size / step, rounded up), and the scanlines cover the region only.
+        // Use getDecoder() with a region argument to get a fallback for codecs
+        // that don't support regions.
+        virtual bool setRegion( const vigra::Diff2D & /*upperLeft*/,
+                                const vigra::Size2D & /*size*/,
+                                unsigned int /*step*/ )
+        {
+            return false;
+        }
+
         typedef ArrayVector<unsigned char> ICCProfile;
 
         const ICCProfile & getICCProfile() const
@@ -282,6 +298,14 @@ namespace vigra
     VIGRA_EXPORT VIGRA_UNIQUE_PTR<Decoder>
     getDecoder( const std::string &, const std::string & = "undefined", unsigned int = 0 );
 
+    // get a decoder restricted to a region of interest (see Decoder::setRegion()).
+    // If the codec cannot decode regions natively, the returned decoder reads
+    // the full image and drops the rows and columns outside the region.
+    VIGRA_EXPORT VIGRA_UNIQUE_PTR<Decoder>
+    getDecoder( const std::string & filename, const std::string & filetype,
+                unsigned int imageindex, const vigra::Diff2D & upperLeft,
+                const vigra::Size2D & size, unsigned int step = 1 );
+
     VIGRA_EXPORT VIGRA_UNIQUE_PTR<Encoder>
     getEncoder( const std::string &, const std::string & = "undefined", const std::string & = "w" );
 
@@ -50,22 +50,48 @@ enum CompressionMethod {  DEFAULT_COMPRESSION=-2,  // use default method (depend
                           ZLIB_FAST=1, // fastest compression using zlib
                           ZLIB=6,      // zlib default compression level
                           ZLIB_BEST=9, // highest compression using zlib
-                          LZ4          // very fast LZ4 algorithm
+                          LZ4,         // very fast LZ4 algorithm
+                          SHUFFLE_LZ4,    // byte shuffle, followed by LZ4
+                          BITSHUFFLE_LZ4, // bit shuffle, followed by LZ4
+                          SHUFFLE_ZSTD,   // byte shuffle, followed by zstd at level 3
+                          ZSTD_FAST=101,  // fastest compression using zstd (level 1)
+                          ZSTD=103,       // zstd default compression level (3)
+                          ZSTD_BEST=119   // highest regular compression using zstd (level 19)
                        };
 
+/** Return the CompressionMethod id for zstd at the given compression
+    level (1 ... 22). Levels between \ref ZSTD_FAST and \ref ZSTD_BEST
+    have named constants only for the common cases.
+*/
+inline CompressionMethod zstdCompression(int level)
+{
+    vigra_precondition(level >= 1 && level <= 22,
+        "zstdCompression(): level must be in [1, 22].");
+    return CompressionMethod(ZSTD_FAST - 1 + level);
+}
+
 /** Compress the source buffer.
 
     The destination array will be resized as required.
+    
+    The shuffle methods (\ref SHUFFLE_LZ4, \ref BITSHUFFLE_LZ4, \ref SHUFFLE_ZSTD)
+    reorder the data before compression such that bytes (or bits) of equal 
+    significance are stored together. This requires the size of the data 
+    type in bytes as <tt>typesize</tt>. The same <tt>typesize</tt> must be 
+    passed to uncompress(). Other methods ignore this parameter.
 */
-VIGRA_EXPORT void compress(char const * source, std::size_t size, ArrayVector<char> & dest, CompressionMethod method);
-VIGRA_EXPORT void compress(char const * source, std::size_t size, std::vector<char> & dest, CompressionMethod method);
+VIGRA_EXPORT void compress(char const * source, std::size_t size, ArrayVector<char> & dest, 
+                           CompressionMethod method, std::size_t typesize = 1);
+VIGRA_EXPORT void compress(char const * source, std::size_t size, std::vector<char> & dest, 
+                           CompressionMethod method, std::size_t typesize = 1);
 
 /** Uncompress the source buffer when the uncompressed size is known.
 
     The destination buffer must be allocated to the correct size.
 */
 VIGRA_EXPORT void uncompress(char const * source, std::size_t srcSize, 
-                             char * dest, std::size_t destSize, CompressionMethod method);
+                             char * dest, std::size_t destSize, CompressionMethod method,
+                             std::size_t typesize = 1);
 
 
 } // namespace vigra
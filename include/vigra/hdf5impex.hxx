@@ -80,6 +80,7 @@
 #include "multi_impex.hxx"
 #include "utilities.hxx"
 #include "error.hxx"
+#include "compression.hxx"
 
 #if defined(_MSC_VER)
 #  include <io.h>
@@ -787,6 +788,64 @@ class HDF5ImportInfo
 
 namespace detail {
 
+    // Filter ids registered with the HDF Group for the third-party LZ4,
+    // bitshuffle and zstd plugins. These filters are loaded dynamically
+    // from HDF5_PLUGIN_PATH when a dataset uses them.
+enum { H5FilterLZ4 = 32004, H5FilterBitshuffle = 32008, H5FilterZSTD = 32015 };
+
+inline void h5SetPluginFilter(hid_t plist, int filter, std::string const & name,
+                              size_t nvalues = 0, unsigned int const * values = 0)
+{
+    vigra_precondition(H5Zfilter_avail(filter) > 0,
+        "HDF5File: the HDF5 filter plugin for " + name + " compression is not available "
+        "(check HDF5_PLUGIN_PATH).");
+    H5Pset_filter(plist, filter, H5Z_FLAG_MANDATORY, nvalues, values);
+}
+
+    // Translate a compression parameter (a zlib level or a CompressionMethod)
+    // into HDF5 filters. Values 1...9 select the built-in deflate filter.
+inline void h5SetCompression(hid_t plist, int compression)
+{
+    if(compression <= 0)
+        return;
+    if(compression <= ZLIB_BEST)
+    {
+        H5Pset_deflate(plist, compression);
+        return;
+    }
+    switch(compression)
+    {
+      case LZ4:
+        h5SetPluginFilter(plist, H5FilterLZ4, "LZ4");
+        break;
+      case SHUFFLE_LZ4:
+        H5Pset_shuffle(plist);
+        h5SetPluginFilter(plist, H5FilterLZ4, "LZ4");
+        break;
+      case BITSHUFFLE_LZ4:
+      {
+        // block size (0: automatic) and inner codec (2: LZ4)
+        unsigned int values[2] = { 0, 2 };
+        h5SetPluginFilter(plist, H5FilterBitshuffle, "bitshuffle", 2, values);
+        break;
+      }
+      case SHUFFLE_ZSTD:
+      {
+        unsigned int level = ZSTD - ZSTD_FAST + 1;
+        H5Pset_shuffle(plist);
+        h5SetPluginFilter(plist, H5FilterZSTD, "ZSTD", 1, &level);
+        break;
+      }
+      default:
+      {
+        vigra_precondition(compression >= ZSTD_FAST && compression < ZSTD_FAST + 22,
+            "HDF5File: unknown compression method.");
+        unsigned int level = compression - ZSTD_FAST + 1;
+        h5SetPluginFilter(plist, H5FilterZSTD, "ZSTD", 1, &level);
+      }
+    }
+}
+
 template <class T>
 struct HDF5TypeTraits
 {
@@ -1778,6 +1837,7 @@ class HDF5File
             \code compression = parameter; // 0 \< parameter \<= 9
             \endcode
             where 0 stands for no compression and 9 for maximum compression.
+            See \ref createDataset() for the plugin-based compression methods.
 
             If the first character of datasetName is a "/", the path will be interpreted as absolute path,
             otherwise it will be interpreted as path relative to the current group.
@@ -2190,6 +2250,10 @@ class HDF5File
             where 0 stands for no compression and 9 for maximum compression. If
             a non-zero compression level is specified, but the chunk size is zero,
             a default chunk size will be chosen (compression always requires chunks).
+            Alternatively, <tt>compression</tt> can be one of the \ref CompressionMethod 
+            ids LZ4, SHUFFLE_LZ4, BITSHUFFLE_LZ4, SHUFFLE_ZSTD or ZSTD_FAST ... ZSTD_BEST.
+            These use the registered third-party HDF5 filter plugins, which must be 
+            installed in <tt>HDF5_PLUGIN_PATH</tt> for writing and reading.
 
             If the first character of datasetName is a "/", the path will be interpreted as absolute path,
             otherwise it will be interpreted as path relative to the current group.
@@ -2815,10 +2879,7 @@ HDF5File::createDataset(std::string datasetName,
     }
 
     // enable compression
-    if(compressionParameter > 0)
-    {
-        H5Pset_deflate(plist, compressionParameter);
-    }
+    detail::h5SetCompression(plist, compressionParameter);
 
     //create the dataset.
     HDF5HandleShared datasetHandle(H5Dcreate(parent, setname.c_str(),
@@ -2881,10 +2942,7 @@ void HDF5File::write_(std::string &datasetName,
     }
 
     // enable compression
-    if(compressionParameter > 0)
-    {
-        H5Pset_deflate(plist, compressionParameter);
-    }
+    detail::h5SetCompression(plist, compressionParameter);
 
     // create dataset
     HDF5Handle datasetHandle(H5Dcreate(groupHandle, setname.c_str(), datatype, dataspace,H5P_DEFAULT, plist, H5P_DEFAULT),
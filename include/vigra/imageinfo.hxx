@@ -562,6 +562,11 @@ class ImageImportInfo
 // return a decoder for a given ImageImportInfo object
 VIGRA_EXPORT VIGRA_UNIQUE_PTR<Decoder> decoder( const ImageImportInfo & info );
 
+// return a decoder for a region of interest of the image given by an ImageImportInfo
+// object, delivering every step-th row and column (see Decoder::setRegion())
+VIGRA_EXPORT VIGRA_UNIQUE_PTR<Decoder> decoder( const ImageImportInfo & info,
+                                                const Rect2D & roi, unsigned int step = 1 );
+
 //@}
 
 } // namespace vigra
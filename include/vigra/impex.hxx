@@ -197,34 +197,32 @@ namespace vigra
 
         template <class ImageIterator, class ImageAccessor>
         void
-        importImage(const ImageImportInfo& import_info,
+        importImage(Decoder * decoder,
                     ImageIterator image_iterator, ImageAccessor image_accessor,
                     /* isScalar? */ VigraTrueType)
         {
-            VIGRA_UNIQUE_PTR<Decoder> decoder(vigra::decoder(import_info));
-
             switch (pixel_t_of_string(decoder->getPixelType()))
             {
             case UNSIGNED_INT_8:
-                read_image_band<UInt8>(decoder.get(), image_iterator, image_accessor);
+                read_image_band<UInt8>(decoder, image_iterator, image_accessor);
                 break;
             case UNSIGNED_INT_16:
-                read_image_band<UInt16>(decoder.get(), image_iterator, image_accessor);
+                read_image_band<UInt16>(decoder, image_iterator, image_accessor);
                 break;
             case UNSIGNED_INT_32:
-                read_image_band<UInt32>(decoder.get(), image_iterator, image_accessor);
+                read_image_band<UInt32>(decoder, image_iterator, image_accessor);
                 break;
             case SIGNED_INT_16:
-                read_image_band<Int16>(decoder.get(), image_iterator, image_accessor);
+                read_image_band<Int16>(decoder, image_iterator, image_accessor);
                 break;
             case SIGNED_INT_32:
-                read_image_band<Int32>(decoder.get(), image_iterator, image_accessor);
+                read_image_band<Int32>(decoder, image_iterator, image_accessor);
                 break;
             case IEEE_FLOAT_32:
-                read_image_band<float>(decoder.get(), image_iterator, image_accessor);
+                read_image_band<float>(decoder, image_iterator, image_accessor);
                 break;
             case IEEE_FLOAT_64:
-                read_image_band<double>(decoder.get(), image_iterator, image_accessor);
+                read_image_band<double>(decoder, image_iterator, image_accessor);
                 break;
             default:
                 vigra_fail("detail::importImage<scalar>: not reached");
@@ -236,39 +234,36 @@ namespace vigra
 
         template <class ImageIterator, class ImageAccessor>
         void
-        importImage(const ImageImportInfo& import_info,
+        importImage(Decoder * decoder,
                     ImageIterator image_iterator, ImageAccessor image_accessor,
                     /* isScalar? */ VigraFalseType)
         {
-            vigra_precondition((static_cast<unsigned int>(import_info.numBands())
-                                == image_accessor.size(image_iterator)) ||
-                               import_info.numBands() == 1,
+            vigra_precondition(decoder->getNumBands() == image_accessor.size(image_iterator) ||
+                               decoder->getNumBands() == 1,
                 "importImage(): Number of channels in input and destination image don't match.");
 
-            VIGRA_UNIQUE_PTR<Decoder> decoder(vigra::decoder(import_info));
-            
             switch (pixel_t_of_string(decoder->getPixelType()))
             {
             case UNSIGNED_INT_8:
-                read_image_bands<UInt8>(decoder.get(), image_iterator, image_accessor);
+                read_image_bands<UInt8>(decoder, image_iterator, image_accessor);
                 break;
             case UNSIGNED_INT_16:
-                read_image_bands<UInt16>(decoder.get(), image_iterator, image_accessor);
+                read_image_bands<UInt16>(decoder, image_iterator, image_accessor);
                 break;
             case UNSIGNED_INT_32:
-                read_image_bands<UInt32>(decoder.get(), image_iterator, image_accessor);
+                read_image_bands<UInt32>(decoder, image_iterator, image_accessor);
                 break;
             case SIGNED_INT_16:
-                read_image_bands<Int16>(decoder.get(), image_iterator, image_accessor);
+                read_image_bands<Int16>(decoder, image_iterator, image_accessor);
                 break;
             case SIGNED_INT_32:
-                read_image_bands<Int32>(decoder.get(), image_iterator, image_accessor);
+                read_image_bands<Int32>(decoder, image_iterator, image_accessor);
                 break;
             case IEEE_FLOAT_32:
-                read_image_bands<float>(decoder.get(), image_iterator, image_accessor);
+                read_image_bands<float>(decoder, image_iterator, image_accessor);
                 break;
             case IEEE_FLOAT_64:
-                read_image_bands<double>(decoder.get(), image_iterator, image_accessor);
+                read_image_bands<double>(decoder, image_iterator, image_accessor);
                 break;
             default:
                 vigra_fail("vigra::detail::importImage<non-scalar>: not reached");
@@ -277,6 +272,16 @@ namespace vigra
             decoder->close();
         }
 
+        template <class ImageIterator, class ImageAccessor, class IsScalar>
+        void
+        importImage(const ImageImportInfo& import_info,
+                    ImageIterator image_iterator, ImageAccessor image_accessor,
+                    IsScalar is_scalar)
+        {
+            VIGRA_UNIQUE_PTR<Decoder> decoder(vigra::decoder(import_info));
+            importImage(decoder.get(), image_iterator, image_accessor, is_scalar);
+        }
+
         template<class ValueType,
                  class ImageIterator, class ImageAccessor, class ImageScaler>
         void
@@ -654,6 +659,14 @@ namespace vigra
         importImage(ImageImportInfo const & import_info,
                     MultiArrayView<2, T, S> image);
 
+        // read only the region of interest 'roi', keeping every step-th
+        // row and column, into an array view of appropriate size
+        template <class T, class S>
+        void
+        importImage(ImageImportInfo const & import_info,
+                    MultiArrayView<2, T, S> image,
+                    Rect2D const & roi, unsigned int step = 1);
+
         // resize the given array and then read the data
         template <class T, class A>
         void
@@ -721,6 +734,24 @@ namespace vigra
     // resize image and read the data
     importImage("myimage.png", image);
     \endcode
+    A region of interest can be read without decoding the entire image, if the
+    codec supports it (JPEG, PNG, and TIFF do). A reduced resolution
+    (e.g. a thumbnail) is requested by a <tt>step</tt> greater than one. Then,
+    the destination shape must be the region's shape divided by <tt>step</tt>
+    (rounded up). Most codecs keep every <tt>step</tt>-th row and column, but
+    JPEG averages <tt>step x step</tt> blocks in the DCT domain when <tt>step</tt>
+    is 2, 4, or 8 and the region starts at a multiple of <tt>step</tt>:
+    \code
+    ImageImportInfo info("large.jpg");
+
+    // read the 256x256 window at (1024, 512) at full resolution
+    MultiArray<2, RGBValue<UInt8> > window(256, 256);
+    importImage(info, window, Rect2D(Point2D(1024, 512), Size2D(256, 256)));
+
+    // read the whole image at 1/8 of its resolution
+    MultiArray<2, RGBValue<UInt8> > thumbnail((info.width() + 7) / 8, (info.height() + 7) / 8);
+    importImage(info, thumbnail, Rect2D(Size2D(info.width(), info.height())), 8);
+    \endcode
 
     \deprecatedUsage{importImage}
     \code
@@ -787,7 +818,7 @@ namespace vigra
 
 
     template <class ImageIterator, class ImageAccessor>
-    inline void
+    inline typename enable_if<!IsSameType<ImageAccessor, Rect2D>::value>::type
     importImage(const ImageImportInfo& import_info,
                 ImageIterator image_iterator, ImageAccessor image_accessor)
     {
@@ -819,6 +850,28 @@ namespace vigra
         importImage(import_info, destImage(image));
     }
 
+    template <class T, class S>
+    inline void
+    importImage(ImageImportInfo const & import_info,
+                MultiArrayView<2, T, S> image,
+                Rect2D const & roi, unsigned int step = 1)
+    {
+        typedef typename NumericTraits<T>::isScalar is_scalar;
+
+        vigra_precondition(step > 0 && !roi.isEmpty() &&
+                           roi.left() >= 0 && roi.top() >= 0 &&
+                           roi.right() <= import_info.width() &&
+                           roi.bottom() <= import_info.height(),
+            "importImage(): region of interest is outside the image.");
+        vigra_precondition(image.shape() == Shape2((roi.width() + step - 1) / step,
+                                                   (roi.height() + step - 1) / step),
+            "importImage(): shape mismatch between region of interest and output.");
+
+        VIGRA_UNIQUE_PTR<Decoder> decoder(vigra::decoder(import_info, roi, step));
+        detail::importImage(decoder.get(), destImage(image).first,
+                            destImage(image).second, is_scalar());
+    }
+
     template <class T, class A>
     inline void
     importImage(char const * name,
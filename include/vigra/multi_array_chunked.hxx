@@ -129,8 +129,11 @@
 #ifndef VIGRA_MULTI_ARRAY_CHUNKED_HXX
 #define VIGRA_MULTI_ARRAY_CHUNKED_HXX
 
-#include <queue>
 #include <string>
+#include <vector>
+#include <exception>
+#include <fstream>
+#include <cstring>
 
 #include "multi_fwd.hxx"
 #include "multi_handle.hxx"
@@ -138,6 +141,7 @@
 #include "memory.hxx"
 #include "metaprogramming.hxx"
 #include "threading.hxx"
+#include "threadpool.hxx"
 #include "compression.hxx"
 
 #ifdef _WIN32
@@ -319,6 +323,49 @@ defaultCacheSize(TinyVector<T, M> const & shape)
     return res + 1;
 }
 
+    // One shard of the chunk cache of a ChunkedArray. It holds the cached chunks
+    // whose index is mapped to this shard, in the order of the CLOCK algorithm.
+template <class Handle>
+struct ChunkCacheShard
+{
+    ChunkCacheShard()
+    : hand_(0)
+    {}
+
+    threading::mutex lock_;
+    std::vector<Handle *> chunks_;
+    std::size_t hand_;
+
+  private:
+    ChunkCacheShard(ChunkCacheShard const &);
+    ChunkCacheShard & operator=(ChunkCacheShard const &);
+};
+
+    // The chunk cache of a ChunkedArray. Chunks are distributed over several
+    // independently locked shards, so that threads loading or releasing
+    // different chunks rarely compete for the same lock.
+template <class Handle>
+struct ChunkCache
+{
+    enum { shard_count = 16 };
+
+    ChunkCache()
+    : size_()
+    , next_shard_()
+    {
+        size_.store(0);
+        next_shard_.store(0);
+    }
+
+    ChunkCacheShard<Handle> shards_[shard_count];
+    threading::atomic_long size_;       // total number of chunks in all shards
+    threading::atomic_long next_shard_; // where the next eviction starts
+
+  private:
+    ChunkCache(ChunkCache const &);
+    ChunkCache & operator=(ChunkCache const &);
+};
+
 } // namespace detail
 
 template <unsigned int N, class T>
@@ -357,15 +404,19 @@ class SharedChunkHandle
     SharedChunkHandle()
     : pointer_(0)
     , chunk_state_()
+    , chunk_referenced_()
     {
         chunk_state_ = chunk_uninitialized;
+        chunk_referenced_ = 0;
     }
 
     SharedChunkHandle(SharedChunkHandle const & rhs)
     : pointer_(rhs.pointer_)
     , chunk_state_()
+    , chunk_referenced_()
     {
         chunk_state_ = chunk_uninitialized;
+        chunk_referenced_ = 0;
     }
 
     shape_type const & strides() const
@@ -375,6 +426,7 @@ class SharedChunkHandle
 
     ChunkBase<N, T> * pointer_;
     mutable threading::atomic_long chunk_state_;
+    mutable threading::atomic_int chunk_referenced_; // 'used' bit of the CLOCK algorithm
 
   private:
     SharedChunkHandle & operator=(SharedChunkHandle const & rhs);
@@ -423,6 +475,11 @@ class ChunkedArrayBase
         return false;
     }
 
+    // Hint that the chunks intersecting the given ROI will be accessed soon.
+    // The default implementation does nothing.
+    virtual void prefetch(shape_type const &, shape_type const &) const
+    {}
+
     MultiArrayIndex size() const
     {
         return prod(shape_);
@@ -1273,6 +1330,9 @@ class ChunkedArrayOptions
     : fill_value(0.0)
     , cache_max(-1)
     , compression_method(DEFAULT_COMPRESSION)
+    , prefetch_threads(1)
+    , background_compression(true)
+    , direct_chunk_io(false)
     {}
 
     /** \brief Element value for read-only access of uninitialized chunks.
@@ -1320,9 +1380,70 @@ class ChunkedArrayOptions
         return ChunkedArrayOptions(*this).compression(v);
     }
 
+    /** \brief Number of background threads used by ChunkedArray::prefetch().
+
+        The threads are only started when prefetch() is called for the first time.
+        Zero disables prefetching.
+
+        Default: 1
+    */
+    ChunkedArrayOptions & prefetchThreads(int v)
+    {
+        prefetch_threads = v;
+        return *this;
+    }
+
+    ChunkedArrayOptions prefetchThreads(int v) const
+    {
+        return ChunkedArrayOptions(*this).prefetchThreads(v);
+    }
+
+    /** \brief Compress chunks evicted from the cache in a background thread.
+
+        Only used by ChunkedArrayCompressed. When true, the thread whose access 
+        triggers the eviction doesn't wait for the compression. Otherwise, 
+        chunks are compressed immediately.
+
+        Default: true
+    */
+    ChunkedArrayOptions & backgroundCompression(bool v)
+    {
+        background_compression = v;
+        return *this;
+    }
+
+    ChunkedArrayOptions backgroundCompression(bool v) const
+    {
+        return ChunkedArrayOptions(*this).backgroundCompression(v);
+    }
+
+    /** \brief Transfer raw chunks between file and memory.
+
+        Only used by ChunkedArrayHDF5. When true, and the dataset's chunks
+        coincide with the array's chunks, compressed chunks are read and
+        written as a whole, bypassing the HDF5 chunk cache and filter
+        pipeline. Compression and decompression then run in the calling
+        threads, so that several chunks can be processed concurrently.
+
+        Default: false
+    */
+    ChunkedArrayOptions & directChunkIO(bool v)
+    {
+        direct_chunk_io = v;
+        return *this;
+    }
+
+    ChunkedArrayOptions directChunkIO(bool v) const
+    {
+        return ChunkedArrayOptions(*this).directChunkIO(v);
+    }
+
     double fill_value;
     int cache_max;
     CompressionMethod compression_method;
+    int prefetch_threads;
+    bool background_compression;
+    bool direct_chunk_io;
 };
 
 /** \weakgroup ParallelProcessing
@@ -1363,6 +1484,10 @@ Namespace: vigra
     <li>ChunkedArrayHDF5: Chunks are stored in a HDF5 dataset by means of
     HDF5's native chunked storage capabilities. Temporarily unused chunks are
     written to the hard-drive in compressed form and deleted from memory.
+
+    <li>ChunkedArrayZarr: Chunks are stored as separate files in a Zarr
+    directory store (see <tt>\<vigra/multi_array_chunked_zarr.hxx\></tt>).
+    Independent processes can write disjoint chunks concurrently.
 </ul>
 You must use these derived classes to construct a chunked array because
 ChunkedArray itself is an abstract class.
@@ -1613,7 +1738,8 @@ class ChunkedArray
     typedef ChunkBase<N, T> Chunk;
     typedef MultiArrayView<N, T, ChunkedArrayTag>                   view_type;
     typedef MultiArrayView<N, T const, ChunkedArrayTag>             const_view_type;
-    typedef std::queue<Handle*> CacheType;
+    typedef detail::ChunkCache<Handle> CacheType;
+    typedef detail::ChunkCacheShard<Handle> CacheShard;
 
     static const long chunk_asleep = Handle::chunk_asleep;
     static const long chunk_uninitialized = Handle::chunk_uninitialized;
@@ -1629,11 +1755,33 @@ class ChunkedArray
     , mask_(this->chunk_shape_ -shape_type(1))
     , cache_max_size_(options.cache_max)
     , chunk_lock_(new threading::mutex())
+    , cache_(new CacheType())
     , fill_value_(T(options.fill_value))
     , fill_scalar_(options.fill_value)
     , handle_array_(detail::computeChunkArrayShape(shape, bits_, mask_))
-    , data_bytes_()
+    , data_bytes_(0)
     , overhead_bytes_(handle_array_.size()*sizeof(Handle))
+    , prefetch_threads_(options.prefetch_threads)
+    {
+        fill_value_chunk_.pointer_ = &fill_value_;
+        fill_value_handle_.pointer_ = &fill_value_chunk_;
+        fill_value_handle_.chunk_state_.store(1);
+    }
+
+    // the copy gets its own cache, which is initially empty
+    ChunkedArray(ChunkedArray const & rhs)
+    : ChunkedArrayBase<N, T>(rhs)
+    , bits_(rhs.bits_)
+    , mask_(rhs.mask_)
+    , cache_max_size_(rhs.cache_max_size_)
+    , chunk_lock_(new threading::mutex())
+    , cache_(new CacheType())
+    , fill_value_(rhs.fill_value_)
+    , fill_scalar_(rhs.fill_scalar_)
+    , handle_array_(rhs.handle_array_)
+    , data_bytes_(rhs.data_bytes_.load())
+    , overhead_bytes_(rhs.overhead_bytes_.load())
+    , prefetch_threads_(rhs.prefetch_threads_)
     {
         fill_value_chunk_.pointer_ = &fill_value_;
         fill_value_handle_.pointer_ = &fill_value_chunk_;
@@ -1657,13 +1805,14 @@ class ChunkedArray
     virtual ~ChunkedArray()
     {
         // std::cerr << "    final cache size: " << cacheSize() << " (max: " << cacheMaxSize() << ")\n";
+        stopPrefetch();
     }
 
     /** \brief Number of chunks currently fitting into the cache.
     */
     int cacheSize() const
     {
-        return cache_.size();
+        return cache_->size_.load();
     }
 
     /** \brief Bytes of main memory occupied by the array's data.
@@ -1816,6 +1965,23 @@ class ChunkedArray
 
     virtual bool unloadChunk(Chunk * chunk, bool destroy = false) = 0;
 
+    // internal function to send a chunk asleep when the cache evicts it.
+    // Backends may defer expensive work (e.g. compression) to a background
+    // thread, provided the chunk remains valid until then. The handle is
+    // locked by the caller.
+    virtual void evictChunk(Handle * handle)
+    {
+        unloadChunk(handle->pointer_, false);
+    }
+
+    // Returns true if the backend allows loadChunk() and unloadChunk() to be called
+    // concurrently for different chunks. Otherwise, these calls are serialized
+    // by means of the chunk_lock_.
+    virtual bool concurrentChunkIO() const
+    {
+        return false;
+    }
+
     Handle * lookupHandle(shape_type const & index)
     {
         return &handle_array_[index];
@@ -1850,10 +2016,7 @@ class ChunkedArray
             unrefChunk(chunks[k]);
 
         if(cacheMaxSize() > 0)
-        {
-            threading::lock_guard<threading::mutex> guard(*chunk_lock_);
-            cleanCache(cache_.size());
-        }
+            cleanCache();
     }
 
     // Increase the reference counter of the given chunk.
@@ -1904,25 +2067,36 @@ class ChunkedArray
 
         long rc = acquireRef(handle);
         if(rc >= 0)
+        {
+            // mark the chunk as recently used (test first to avoid
+            // needless writes to a cache line shared between threads)
+            if(handle->chunk_referenced_.load(threading::memory_order_relaxed) == 0)
+                handle->chunk_referenced_.store(1, threading::memory_order_relaxed);
             return handle->pointer_->pointer_;
+        }
 
-        threading::lock_guard<threading::mutex> guard(*chunk_lock_);
+        // Now the chunk is in state 'chunk_locked' and thus exclusively ours.
         try
         {
-            T * p = self->loadChunk(&handle->pointer_, chunk_index);
-            Chunk * chunk = handle->pointer_;
-            if(!isConst && rc == chunk_uninitialized)
-                std::fill(p, p + prod(chunkShape(chunk_index)), this->fill_value_);
-
-            self->data_bytes_ += dataBytes(chunk);
+            T * p;
+            {
+                threading::unique_lock<threading::mutex> guard(*chunk_lock_, threading::defer_lock);
+                if(!concurrentChunkIO())
+                    guard.lock();
+                // replace the size of the sleeping chunk (if any) with the active size
+                if(handle->pointer_)
+                    self->data_bytes_ -= dataBytes(handle->pointer_);
+                p = self->loadChunk(&handle->pointer_, chunk_index);
+                if(!isConst && rc == chunk_uninitialized)
+                    std::fill(p, p + prod(chunkShape(chunk_index)), this->fill_value_);
+                self->data_bytes_ += dataBytes(handle->pointer_);
+            }
 
             if(cacheMaxSize() > 0 && insertInCache)
             {
-                // insert in queue of mapped chunks
-                self->cache_.push(handle);
-
-                // do cache management if cache is full
-                // (note that we still hold the chunk_lock_)
+                // insert into the cache and evict old chunks if the cache is full
+                // (the present chunk is still locked and will therefore be kept)
+                self->insertInCache(handle);
                 self->cleanCache(2);
             }
             handle->chunk_state_.store(1, threading::memory_order_release);
@@ -1989,9 +2163,11 @@ class ChunkedArray
         return chunkForIteratorImpl(point, strides, upper_bound, h, true);
     }
 
-    // NOTE: This function must only be called while we hold the chunk_lock_.
-    //       This implies refcount != chunk_locked, so that race conditions are avoided.
-    long releaseChunk(Handle * handle, bool destroy = false)
+    // Unload the given chunk if it is not in use. Returns the chunk's previous state,
+    // i.e. the chunk was unloaded if the result is 0 (or chunk_asleep when 'destroy'
+    // is true). Locking the chunk during unloading avoids race conditions.
+    // 'evict' is true when the cache replacement releases the chunk.
+    long releaseChunk(Handle * handle, bool destroy = false, bool evict = false)
     {
         long rc = 0;
         bool mayUnload = handle->chunk_state_.compare_exchange_strong(rc, chunk_locked);
@@ -2007,9 +2183,16 @@ class ChunkedArray
             {
                 vigra_invariant(handle != &fill_value_handle_,
                    "ChunkedArray::releaseChunk(): attempt to release fill_value_handle_.");
+                threading::unique_lock<threading::mutex> guard(*chunk_lock_, threading::defer_lock);
+                if(!concurrentChunkIO())
+                    guard.lock();
                 Chunk * chunk = handle->pointer_;
                 this->data_bytes_ -= dataBytes(chunk);
-                int didDestroy = unloadChunk(chunk, destroy);
+                bool didDestroy = false;
+                if(evict && !destroy)
+                    evictChunk(handle);
+                else
+                    didDestroy = unloadChunk(chunk, destroy);
                 this->data_bytes_ += dataBytes(chunk);
                 if(didDestroy)
                     handle->chunk_state_.store(chunk_uninitialized);
@@ -2025,19 +2208,111 @@ class ChunkedArray
         return rc;
     }
 
-    // NOTE: this function must only be called while we hold the chunk_lock_
+    // Add a chunk to the cache shard determined by its index.
+    void insertInCache(Handle * handle)
+    {
+        CacheShard & shard = cache_->shards_[(handle - handle_array_.data()) % CacheType::shard_count];
+        handle->chunk_referenced_.store(0, threading::memory_order_relaxed);
+        threading::lock_guard<threading::mutex> guard(shard.lock_);
+        shard.chunks_.push_back(handle);
+        ++cache_->size_;
+    }
+
+    // Remove one chunk from the given cache shard, using the CLOCK algorithm:
+    // the hand moves at most once around the shard's chunks, giving a second chance
+    // to those that were used since the hand passed last. Chunks still in use are
+    // skipped. Entries whose chunk was already sent asleep by other means are removed
+    // as well. Returns false if no chunk could be removed.
+    bool evictFromCache(CacheShard & shard)
+    {
+        threading::lock_guard<threading::mutex> guard(shard.lock_);
+        for(std::size_t k = 0, steps = shard.chunks_.size(); k < steps && shard.chunks_.size() > 0; ++k)
+        {
+            if(shard.hand_ >= shard.chunks_.size())
+                shard.hand_ = 0;
+            Handle * handle = shard.chunks_[shard.hand_];
+            if(handle->chunk_referenced_.load(threading::memory_order_relaxed) != 0)
+            {
+                handle->chunk_referenced_.store(0, threading::memory_order_relaxed);
+                ++shard.hand_;
+                continue;
+            }
+            long rc = releaseChunk(handle, false, true);
+            if(rc > 0 || rc == chunk_locked)
+            {
+                // chunk is still needed or currently being loaded
+                ++shard.hand_;
+                continue;
+            }
+            shard.chunks_[shard.hand_] = shard.chunks_.back();
+            shard.chunks_.pop_back();
+            --cache_->size_;
+            return true;
+        }
+        return false;
+    }
+
+    // Evict chunks until the cache size drops to cacheMaxSize() or 'how_many'
+    // chunks have been evicted (-1: no limit). The cache may temporarily
+    // hold more chunks if they are all in use.
     void cleanCache(int how_many = -1)
     {
-        if(how_many == -1)
-            how_many = cache_.size();
-        for(; cache_.size() > cacheMaxSize() && how_many > 0; --how_many)
+        const long shard_count = CacheType::shard_count;
+        for(; how_many != 0 && cache_->size_.load() > (long)cacheMaxSize(); --how_many)
+        {
+            // Start at a different shard each time to spread the evictions. If all
+            // chunks got a second chance in the first round, the second round
+            // evicts one of them (this approximates a global CLOCK hand).
+            long start = cache_->next_shard_.fetch_add(1);
+            bool evicted = false;
+            for(long k = 0; k < 2*shard_count && !evicted; ++k)
+                evicted = evictFromCache(cache_->shards_[(start + k) % shard_count]);
+            if(!evicted)
+                break;
+        }
+    }
+
+    // the pool executing prefetch() requests, created on first use
+    ThreadPool & prefetchPool()
+    {
+        threading::lock_guard<threading::mutex> guard(prefetch_lock_);
+        if(!prefetch_pool_)
+            prefetch_pool_.reset(new ThreadPool(prefetch_threads_));
+        return *prefetch_pool_;
+    }
+
+    // Background part of prefetch(). The loaded chunk is marked as recently
+    // used, so that it stays in the cache until it is actually accessed.
+    // Errors are stored and reported by waitForPrefetch().
+    void prefetchChunk(Handle * handle, shape_type const & chunk_index)
+    {
+        try
+        {
+            if(handle->chunk_state_.load() != chunk_asleep)
+                return;
+            getChunk(handle, true, true, chunk_index);
+            handle->chunk_referenced_.store(1, threading::memory_order_relaxed);
+            unrefChunk(handle);
+        }
+        catch(...)
+        {
+            threading::lock_guard<threading::mutex> guard(prefetch_lock_);
+            if(!prefetch_error_)
+                prefetch_error_ = std::current_exception();
+        }
+    }
+
+    // Finish all pending background loads. Derived classes must call this
+    // in their destructor before they release the chunk storage.
+    void stopPrefetch()
+    {
+        VIGRA_SHARED_PTR<ThreadPool> pool;
         {
-            Handle * handle = cache_.front();
-            cache_.pop();
-            long rc = releaseChunk(handle);
-            if(rc > 0) // refcount was positive => chunk is still needed
-                cache_.push(handle);
+            threading::lock_guard<threading::mutex> guard(prefetch_lock_);
+            pool.swap(prefetch_pool_);
         }
+        // the pool's destructor completes all queued tasks
+        pool.reset();
     }
 
     /** Sends all chunks asleep which are completely inside the given ROI.
@@ -2065,37 +2340,124 @@ class ChunkedArray
             }
 
             Handle * handle = this->lookupHandle(*i);
-            threading::lock_guard<threading::mutex> guard(*chunk_lock_);
             releaseChunk(handle, destroy);
         }
 
         // remove all chunks from the cache that are asleep or unitialized
-        threading::lock_guard<threading::mutex> guard(*chunk_lock_);
-        int cache_size = cache_.size();
-        for(int k=0; k < cache_size; ++k)
+        for(int k=0; k < CacheType::shard_count; ++k)
         {
-            Handle * handle = cache_.front();
-            cache_.pop();
-            if(handle->chunk_state_.load() >= 0)
-                cache_.push(handle);
+            CacheShard & shard = cache_->shards_[k];
+            threading::lock_guard<threading::mutex> guard(shard.lock_);
+            for(std::size_t j=0; j < shard.chunks_.size();)
+            {
+                long rc = shard.chunks_[j]->chunk_state_.load();
+                if(rc >= 0 || rc == chunk_locked)
+                {
+                    ++j;
+                    continue;
+                }
+                shard.chunks_[j] = shard.chunks_.back();
+                shard.chunks_.pop_back();
+                --cache_->size_;
+            }
         }
     }
 
+    /** \brief Load the chunks intersecting the given ROI in the background.
+
+        Chunks in the ROI that are currently asleep (i.e. compressed, swapped out,
+        or not yet read from the file) are loaded by background threads and put
+        into the cache, so that subsequent accesses don't have to wait for I/O or
+        decompression. The function returns immediately. Prefetched chunks are
+        subject to the usual cache replacement, so the cache should be able to hold
+        them in addition to the chunks currently in use. The number of background
+        threads is set by ChunkedArrayOptions::prefetchThreads().
+
+        See also ChunkIterator::setPrefetchWindow().
+    */
+    virtual void prefetch(shape_type const & start, shape_type const & stop) const
+    {
+        checkSubarrayBounds(start, stop, "ChunkedArray::prefetch()");
+        if(prefetch_threads_ == 0)
+            return;
+
+        ChunkedArray * self = const_cast<ChunkedArray *>(this);
+        shape_type chunk_start(chunkStart(start));
+        MultiCoordinateIterator<N> i(chunk_start, chunkStop(stop)),
+                                   end(i.getEndIterator());
+        for(; i != end; ++i)
+        {
+            shape_type chunk_index = *i + chunk_start;
+            Handle * handle = self->lookupHandle(chunk_index);
+            // skip chunks that are active, being loaded, or have no data yet
+            if(handle->chunk_state_.load() != chunk_asleep)
+                continue;
+            self->prefetchPool().enqueue(
+                [self, handle, chunk_index](int)
+                {
+                    self->prefetchChunk(handle, chunk_index);
+                });
+        }
+    }
+
+    /** \brief Wait until all chunks requested by prefetch() have been loaded.
+
+        If a background load failed, its exception is rethrown here.
+    */
+    void waitForPrefetch() const
+    {
+        ChunkedArray * self = const_cast<ChunkedArray *>(this);
+        VIGRA_SHARED_PTR<ThreadPool> pool;
+        {
+            threading::lock_guard<threading::mutex> guard(self->prefetch_lock_);
+            pool = prefetch_pool_;
+        }
+        if(pool)
+            pool->waitFinished();
+
+        std::exception_ptr error;
+        {
+            threading::lock_guard<threading::mutex> guard(self->prefetch_lock_);
+            std::swap(error, self->prefetch_error_);
+        }
+        if(error)
+            std::rethrow_exception(error);
+    }
+
     /** \brief Copy an ROI of the chunked array into an ordinary MultiArrayView.
 
         The ROI's lower bound is given by 'start', its upper bound (in 'beyond' sense)
         is 'start + subarray.shape()'. Chunks in the ROI are only activated while
         the read is in progress.
+
+        If the backend can load chunks concurrently (e.g. ChunkedArrayCompressed),
+        the chunks are processed in parallel on the thread pool selected by 
+        'options'. By default, the process-wide ThreadPool::defaultPool() is used.
     */
     template <class U, class Stride>
     void
     checkoutSubarray(shape_type const & start,
-                     MultiArrayView<N, U, Stride> & subarray) const
+                     MultiArrayView<N, U, Stride> & subarray,
+                     ParallelOptions const & options = ParallelOptions().useDefaultPool()) const
     {
         shape_type stop   = start + subarray.shape();
 
         checkSubarrayBounds(start, stop, "ChunkedArray::checkoutSubarray()");
 
+        ArrayVector<shape_type> chunks;
+        if(parallelTransferChunks(start, stop, options, chunks))
+        {
+            parallel_foreach(options, chunks.size(),
+                [&](int, std::size_t k)
+                {
+                    shape_type chunk_start = max(start, chunks[k] * this->chunk_shape_),
+                               chunk_stop  = min(stop, (chunks[k] + shape_type(1)) * this->chunk_shape_);
+                    subarray.subarray(chunk_start-start, chunk_stop-start) = 
+                                                *chunk_cbegin(chunk_start, chunk_stop);
+                });
+            return;
+        }
+
         chunk_const_iterator i = chunk_cbegin(start, stop);
         for(; i.isValid(); ++i)
         {
@@ -2108,11 +2470,14 @@ class ChunkedArray
         The ROI's lower bound is given by 'start', its upper bound (in 'beyond' sense)
         is 'start + subarray.shape()'. Chunks in the ROI are only activated while
         the write is in progress.
+
+        Chunks are processed in parallel as in checkoutSubarray().
     */
     template <class U, class Stride>
     void
     commitSubarray(shape_type const & start,
-                   MultiArrayView<N, U, Stride> const & subarray)
+                   MultiArrayView<N, U, Stride> const & subarray,
+                   ParallelOptions const & options = ParallelOptions().useDefaultPool())
     {
         shape_type stop   = start + subarray.shape();
 
@@ -2120,6 +2485,20 @@ class ChunkedArray
                            "ChunkedArray::commitSubarray(): array is read-only.");
         checkSubarrayBounds(start, stop, "ChunkedArray::commitSubarray()");
 
+        ArrayVector<shape_type> chunks;
+        if(parallelTransferChunks(start, stop, options, chunks))
+        {
+            parallel_foreach(options, chunks.size(),
+                [&](int, std::size_t k)
+                {
+                    shape_type chunk_start = max(start, chunks[k] * this->chunk_shape_),
+                               chunk_stop  = min(stop, (chunks[k] + shape_type(1)) * this->chunk_shape_);
+                    *chunk_begin(chunk_start, chunk_stop) = 
+                                    subarray.subarray(chunk_start-start, chunk_stop-start);
+                });
+            return;
+        }
+
         chunk_iterator i = chunk_begin(start, stop);
         for(; i.isValid(); ++i)
         {
@@ -2127,6 +2506,23 @@ class ChunkedArray
         }
     }
 
+    // helper function for checkoutSubarray() and commitSubarray(): returns true
+    // and the indices of the chunks intersecting the ROI if the transfer
+    // should be executed in parallel
+    bool parallelTransferChunks(shape_type const & start, shape_type const & stop,
+                                ParallelOptions const & options,
+                                ArrayVector<shape_type> & chunks) const
+    {
+        if(!concurrentChunkIO() || options.getNumThreads() <= 1)
+            return false;
+        shape_type chunk_start(chunkStart(start));
+        MultiCoordinateIterator<N> i(chunk_start, chunkStop(stop)),
+                                   end(i.getEndIterator());
+        for(; i != end; ++i)
+            chunks.push_back(*i + chunk_start);
+        return chunks.size() > 1;
+    }
+
     // helper function for subarray()
     template <class View>
     void subarrayImpl(shape_type const & start, shape_type const & stop,
@@ -2159,8 +2555,7 @@ class ChunkedArray
             if(isConst && handle->chunk_state_.load() == chunk_uninitialized)
                 handle = &self->fill_value_handle_;
 
-            // This potentially acquires the chunk_lock_ in each iteration.
-            // Would it be better to acquire it once before the loop?
+            // This only acquires a lock when the chunk must be loaded.
             pointer p = getChunk(handle, isConst, true, *i);
 
             ChunkBase<N, T> * mini_chunk = &view.chunks_[*i - chunk_start];
@@ -2369,11 +2764,8 @@ class ChunkedArray
     void setCacheMaxSize(std::size_t c)
     {
         cache_max_size_ = c;
-        if(c < cache_.size())
-        {
-            threading::lock_guard<threading::mutex> guard(*chunk_lock_);
+        if((long)c < cache_->size_.load())
             cleanCache();
-        }
     }
 
     /** \brief Create a scan-order iterator for the entire chunked array.
@@ -2476,13 +2868,17 @@ class ChunkedArray
     shape_type bits_, mask_;
     int cache_max_size_;
     VIGRA_SHARED_PTR<threading::mutex> chunk_lock_;
-    CacheType cache_;
+    VIGRA_SHARED_PTR<CacheType> cache_;
     Chunk fill_value_chunk_;
     Handle fill_value_handle_;
     value_type fill_value_;
     double fill_scalar_;
     MultiArray<N, Handle> handle_array_;
-    std::size_t data_bytes_, overhead_bytes_;
+    threading::atomic<std::size_t> data_bytes_, overhead_bytes_;
+    int prefetch_threads_;
+    threading::mutex prefetch_lock_;
+    VIGRA_SHARED_PTR<ThreadPool> prefetch_pool_;
+    std::exception_ptr prefetch_error_;
 };
 
 /** Returns a CoupledScanOrderIterator to simultaneously iterate over image m1 and its coordinates.
@@ -2754,6 +3150,7 @@ class ChunkedArrayLazy
 
     ~ChunkedArrayLazy()
     {
+        this->stopPrefetch();
         typename ChunkStorage::iterator i   = this->handle_array_.begin(),
                                         end = this->handle_array_.end();
         for(; i != end; ++i)
@@ -2781,6 +3178,11 @@ class ChunkedArrayLazy
         return destroy;
     }
 
+    virtual bool concurrentChunkIO() const
+    {
+        return true;
+    }
+
     virtual std::string backend() const
     {
         return "ChunkedArrayLazy";
@@ -2834,6 +3236,7 @@ class ChunkedArrayCompressed
         : ChunkBase<N, T>(detail::defaultStride(shape))
         , compressed_()
         , size_(prod(shape))
+        , compress_pending_(false)
         {}
 
         ~Chunk()
@@ -2862,7 +3265,8 @@ class ChunkedArrayCompressed
                 vigra_invariant(compressed_.size() == 0,
                     "ChunkedArrayCompressed::Chunk::compress(): compressed and uncompressed pointer are both non-zero.");
 
-                ::vigra::compress((char const *)this->pointer_, size_*sizeof(T), compressed_, method);
+                ::vigra::compress((char const *)this->pointer_, size_*sizeof(T), compressed_, 
+                                  method, sizeof(T));
 
                 // std::cerr << "compression ratio: " << double(compressed_.size())/(this->size()*sizeof(T)) << "\n";
                 detail::destroy_dealloc_n(this->pointer_, size_, alloc_);
@@ -2879,7 +3283,7 @@ class ChunkedArrayCompressed
                     this->pointer_ = alloc_.allocate((typename Alloc::size_type)size_);
 
                     ::vigra::uncompress(compressed_.data(), compressed_.size(),
-                                        (char*)this->pointer_, size_*sizeof(T), method);
+                                        (char*)this->pointer_, size_*sizeof(T), method, sizeof(T));
                     compressed_.clear();
                 }
                 else
@@ -2898,6 +3302,7 @@ class ChunkedArrayCompressed
         ArrayVector<char> compressed_;
         MultiArrayIndex size_;
         Alloc alloc_;
+        bool compress_pending_;  // evicted, but not yet compressed in the background
 
       private:
         Chunk & operator=(Chunk const &);
@@ -2918,14 +3323,28 @@ class ChunkedArrayCompressed
         <li>ZLIB_FAST: Fast compression using 'zlib' (slower than LZ4, but higher compression).
         <li>ZLIB_BEST: Best compression using 'zlib', slow.
         <li>ZLIB_NONE: Use 'zlib' format without compression.
+        <li>SHUFFLE_LZ4: Byte shuffle followed by LZ4. Much better than plain LZ4
+            for multi-byte types (e.g. UInt16, float) at similar speed.
+        <li>BITSHUFFLE_LZ4: Bit shuffle followed by LZ4. Best for integer data
+            with a small dynamic range.
+        <li>SHUFFLE_ZSTD: Byte shuffle followed by 'zstd'.
+        <li>ZSTD_FAST, ZSTD, ZSTD_BEST (or <tt>zstdCompression(level)</tt>): Use 'zstd' 
+            at the given level.
         <li>DEFAULT_COMPRESSION: Same as LZ4.
         </ul>
+        The 'zlib' and 'zstd' methods are only available when VIGRA was compiled
+        with the respective library.
+
+        Chunks evicted from the cache are compressed by a background thread,
+        unless this is switched off by ChunkedArrayOptions::backgroundCompression().
     */
     explicit ChunkedArrayCompressed(shape_type const & shape,
                                     shape_type const & chunk_shape=shape_type(),
                                     ChunkedArrayOptions const & options = ChunkedArrayOptions())
     : ChunkedArray<N, T>(shape, chunk_shape, options),
-       compression_method_(options.compression_method)
+       compression_method_(options.compression_method),
+       background_compression_(options.background_compression),
+       compressions_pending_(0)
     {
         if(compression_method_ == DEFAULT_COMPRESSION)
             compression_method_ = LZ4;
@@ -2933,6 +3352,8 @@ class ChunkedArrayCompressed
 
     ~ChunkedArrayCompressed()
     {
+        this->stopPrefetch();
+        stopCompression();
         typename ChunkStorage::iterator i   = this->handle_array_.begin(),
                                         end = this->handle_array_.end();
         for(; i != end; ++i)
@@ -2950,11 +3371,16 @@ class ChunkedArrayCompressed
             *p = new Chunk(this->chunkShape(index));
             this->overhead_bytes_ += sizeof(Chunk);
         }
-        return static_cast<Chunk *>(*p)->uncompress(compression_method_);
+        Chunk * chunk = static_cast<Chunk *>(*p);
+        // if the chunk is still waiting for background compression,
+        // we can simply reuse its data
+        chunk->compress_pending_ = false;
+        return chunk->uncompress(compression_method_);
     }
 
     virtual bool unloadChunk(ChunkBase<N, T> * chunk, bool destroy)
     {
+        static_cast<Chunk *>(chunk)->compress_pending_ = false;
         if(destroy)
             static_cast<Chunk *>(chunk)->deallocate();
         else
@@ -2962,6 +3388,120 @@ class ChunkedArrayCompressed
         return destroy;
     }
 
+    virtual void evictChunk(SharedChunkHandle<N, T> * handle)
+    {
+        Chunk * chunk = static_cast<Chunk *>(handle->pointer_);
+        // Compress in the calling thread if the background thread lags behind
+        // by more than the cache size (to bound the memory consumption) or
+        // if a background compression failed (to report the error).
+        if(!background_compression_ || chunk->pointer_ == 0 || compressionFailed() ||
+           compressions_pending_.load() >= std::max<long>(this->cacheMaxSize(), 1))
+        {
+            unloadChunk(chunk, false);
+            return;
+        }
+        chunk->compress_pending_ = true;
+        ++compressions_pending_;
+        compressionPool().enqueue(
+            [this, handle](int)
+            {
+                this->compressInBackground(handle);
+            });
+    }
+
+    // Background part of evictChunk(). The chunk is locked while being
+    // compressed, and is skipped if it was reactivated or destroyed since its
+    // eviction. The evicting thread may still hold the lock when we get here.
+    void compressInBackground(SharedChunkHandle<N, T> * handle)
+    {
+        for(;;)
+        {
+            long rc = this->chunk_asleep;
+            if(handle->chunk_state_.compare_exchange_strong(rc, this->chunk_locked))
+                break;
+            if(rc != this->chunk_locked)
+            {
+                --compressions_pending_;
+                return;
+            }
+            threading::this_thread::yield();
+        }
+        Chunk * chunk = static_cast<Chunk *>(handle->pointer_);
+        try
+        {
+            if(chunk->compress_pending_)
+            {
+                this->data_bytes_ -= dataBytes(chunk);
+                chunk->compress(compression_method_);
+                this->data_bytes_ += dataBytes(chunk);
+            }
+        }
+        catch(...)
+        {
+            // the chunk remains valid in uncompressed form
+            threading::lock_guard<threading::mutex> guard(compression_lock_);
+            if(!compression_error_)
+                compression_error_ = std::current_exception();
+        }
+        chunk->compress_pending_ = false;
+        handle->chunk_state_.store(this->chunk_asleep);
+        --compressions_pending_;
+    }
+
+    bool compressionFailed()
+    {
+        threading::lock_guard<threading::mutex> guard(compression_lock_);
+        return bool(compression_error_);
+    }
+
+    // the background thread compressing evicted chunks, created on first use
+    ThreadPool & compressionPool()
+    {
+        threading::lock_guard<threading::mutex> guard(compression_lock_);
+        if(!compression_pool_)
+            compression_pool_.reset(new ThreadPool(1));
+        return *compression_pool_;
+    }
+
+    // finish all pending background compressions
+    void stopCompression()
+    {
+        VIGRA_SHARED_PTR<ThreadPool> pool;
+        {
+            threading::lock_guard<threading::mutex> guard(compression_lock_);
+            pool.swap(compression_pool_);
+        }
+        pool.reset();
+    }
+
+    /** \brief Wait until all chunks evicted from the cache have been compressed.
+
+        If a background compression failed, its exception is rethrown here.
+    */
+    void waitForCompression()
+    {
+        VIGRA_SHARED_PTR<ThreadPool> pool;
+        {
+            threading::lock_guard<threading::mutex> guard(compression_lock_);
+            pool = compression_pool_;
+        }
+        if(pool)
+            pool->waitFinished();
+
+        std::exception_ptr error;
+        {
+            threading::lock_guard<threading::mutex> guard(compression_lock_);
+            std::swap(error, compression_error_);
+        }
+        if(error)
+            std::rethrow_exception(error);
+    }
+
+    virtual bool concurrentChunkIO() const
+    {
+        return true;
+    }
+
     virtual std::string backend() const
     {
         switch(compression_method_)
@@ -2976,7 +3516,22 @@ class ChunkedArrayCompressed
             return "ChunkedArrayCompressed<ZLIB_BEST>";
           case LZ4:
             return "ChunkedArrayCompressed<LZ4>";
+          case SHUFFLE_LZ4:
+            return "ChunkedArrayCompressed<SHUFFLE_LZ4>";
+          case BITSHUFFLE_LZ4:
+            return "ChunkedArrayCompressed<BITSHUFFLE_LZ4>";
+          case SHUFFLE_ZSTD:
+            return "ChunkedArrayCompressed<SHUFFLE_ZSTD>";
+          case ZSTD_FAST:
+            return "ChunkedArrayCompressed<ZSTD_FAST>";
+          case ZSTD:
+            return "ChunkedArrayCompressed<ZSTD>";
+          case ZSTD_BEST:
+            return "ChunkedArrayCompressed<ZSTD_BEST>";
           default:
+            if(compression_method_ > ZSTD_FAST && compression_method_ < ZSTD_FAST + 22)
+                return std::string("ChunkedArrayCompressed<ZSTD(") + 
+                       asString(compression_method_ - ZSTD_FAST + 1) + ")>";
             return "unknown";
         }
     }
@@ -2994,6 +3549,11 @@ class ChunkedArrayCompressed
     }
 
     CompressionMethod compression_method_;
+    bool background_compression_;
+    threading::atomic<long> compressions_pending_;
+    threading::mutex compression_lock_;
+    VIGRA_SHARED_PTR<ThreadPool> compression_pool_;
+    std::exception_ptr compression_error_;
 };
 
 /** \weakgroup ParallelProcessing
@@ -3050,13 +3610,16 @@ class ChunkedArrayTmpFile
         typedef value_type * pointer;
         typedef value_type & reference;
 
+        // 'offset' need not be a multiple of mmap_alignment. If 'copy_on_write'
+        // is true, changes to the chunk are not written back to the file.
         Chunk(shape_type const & shape,
               std::size_t offset, size_t alloc_size,
-              FileHandle file)
+              FileHandle file, bool copy_on_write = false)
         : ChunkBase<N, T>(detail::defaultStride(shape))
         , offset_(offset)
         , alloc_size_(alloc_size)
         , file_(file)
+        , copy_on_write_(copy_on_write)
         {}
 
         ~Chunk()
@@ -3068,19 +3631,21 @@ class ChunkedArrayTmpFile
         {
             if(this->pointer_ == 0)
             {
+                std::size_t start = mapStart();
             #ifdef _WIN32
                 static const std::size_t bits = sizeof(DWORD)*8,
                                          mask = (std::size_t(1) << bits) - 1;
-                this->pointer_ = (pointer)MapViewOfFile(file_, FILE_MAP_ALL_ACCESS,
-                                           std::size_t(offset_) >> bits, offset_ & mask, alloc_size_);
-                if(this->pointer_ == 0)
+                char * base = (char*)MapViewOfFile(file_, copy_on_write_ ? FILE_MAP_COPY : FILE_MAP_ALL_ACCESS,
+                                                   start >> bits, start & mask, mapSize());
+                if(base == 0)
                     winErrorToException("ChunkedArrayChunk::map(): ");
             #else
-                this->pointer_ = (pointer)mmap(0, alloc_size_, PROT_READ | PROT_WRITE, MAP_SHARED,
-                                  file_, offset_);
-                if(this->pointer_ == 0)
+                void * base = mmap(0, mapSize(), PROT_READ | PROT_WRITE,
+                                   copy_on_write_ ? MAP_PRIVATE : MAP_SHARED, file_, start);
+                if(base == MAP_FAILED)
                     throw std::runtime_error("ChunkedArrayChunk::map(): mmap() failed.");
             #endif
+                this->pointer_ = (pointer)((char*)base + (offset_ - start));
             }
             return this->pointer_;
         }
@@ -3089,17 +3654,44 @@ class ChunkedArrayTmpFile
         {
             if(this->pointer_ != 0)
             {
+                char * base = (char*)this->pointer_ - (offset_ - mapStart());
         #ifdef _WIN32
-                ::UnmapViewOfFile(this->pointer_);
+                ::UnmapViewOfFile(base);
         #else
-                munmap(this->pointer_, alloc_size_);
+                munmap(base, mapSize());
         #endif
                 this->pointer_ = 0;
             }
         }
 
+        // write the chunk's data to disk if it is currently mapped
+        void sync()
+        {
+            if(this->pointer_ != 0 && !copy_on_write_)
+            {
+                char * base = (char*)this->pointer_ - (offset_ - mapStart());
+        #ifdef _WIN32
+                ::FlushViewOfFile(base, mapSize());
+        #else
+                msync(base, mapSize(), MS_SYNC);
+        #endif
+            }
+        }
+
+        // mappings must start at a multiple of mmap_alignment
+        std::size_t mapStart() const
+        {
+            return offset_ & ~(mmap_alignment - 1);
+        }
+
+        std::size_t mapSize() const
+        {
+            return alloc_size_ + (offset_ - mapStart());
+        }
+
         std::size_t offset_, alloc_size_;
         FileHandle file_;
+        bool copy_on_write_;
 
       private:
         Chunk & operator=(Chunk const &);
@@ -3187,6 +3779,7 @@ class ChunkedArrayTmpFile
 
     ~ChunkedArrayTmpFile()
     {
+        this->stopPrefetch();
         typename ChunkStorage::iterator  i = this->handle_array_.begin(),
                                          end = this->handle_array_.end();
         for(; i != end; ++i)
@@ -3235,6 +3828,15 @@ class ChunkedArrayTmpFile
         return false; // never destroys the data
     }
 
+    virtual bool concurrentChunkIO() const
+    {
+      #ifdef VIGRA_NO_SPARSE_FILE
+        return false; // loadChunk() extends the file
+      #else
+        return true;
+      #endif
+    }
+
     virtual std::string backend() const
     {
         return "ChunkedArrayTmpFile";
@@ -3263,6 +3865,406 @@ class ChunkedArrayTmpFile
     std::size_t file_size_, file_capacity_;
 };
 
+namespace detail {
+
+// Fixed part of the ChunkedArrayMmap file header. It is followed by the
+// array shape and the chunk shape (N Int64 each), and by one byte per chunk
+// telling if the chunk has ever been written. Chunk data start at 'data_offset'.
+struct ChunkedArrayMmapHeader
+{
+    char magic[8];
+    UInt32 version;
+    UInt32 dimension;
+    char scalar_kind;    // 'i', 'u', or 'f'
+    UInt8 scalar_size;
+    UInt16 bands;
+    UInt32 reserved;
+    double fill_value;
+    UInt64 data_offset;
+
+    template <class T>
+    void setType()
+    {
+        typedef typename NumericTraits<T>::ValueType Scalar;
+        scalar_kind = NumericTraits<Scalar>::isIntegral::value
+                          ? (NumericTraits<Scalar>::isSigned::value ? 'i' : 'u')
+                          : 'f';
+        scalar_size = (UInt8)sizeof(Scalar);
+        bands = (UInt16)(sizeof(T) / sizeof(Scalar));
+    }
+
+    template <class T>
+    bool hasType() const
+    {
+        ChunkedArrayMmapHeader h;
+        h.setType<T>();
+        return scalar_kind == h.scalar_kind &&
+               scalar_size == h.scalar_size &&
+               bands == h.bands;
+    }
+};
+
+} // namespace detail
+
+/** \weakgroup ParallelProcessing
+    \sa ChunkedArrayMmap
+*/
+
+/** Implement ChunkedArray as a persistent, uncompressed file whose chunks
+    are memory-mapped on demand.
+
+    <b>\#include</b> \<vigra/multi_array_chunked.hxx\> <br/>
+    Namespace: vigra
+
+    The file starts with a small header (element type, shape, chunk shape,
+    fill value, and which chunks have been written so far), followed by
+    the chunks in scan order. Chunks are not copied when they are activated,
+    but accessed directly in the operating system's page cache. Therefore,
+    reopening a file requires no load step, and several processes
+    reading the same file share the memory. The file uses the native byte
+    order of the machine that created it.
+
+    When the file is opened read-only, chunks are mapped copy-on-write:
+    modifications remain private to the present process and are lost
+    when a chunk is evicted from the cache. Writes from different processes
+    to the same file are not synchronized.
+
+    \code
+    {
+        ChunkedArrayMmap<3, float> a("volume.vmm", Shape3(1000), Shape3(64));
+        ... // fill the array
+    }   // the data are persistent
+
+    ChunkedArrayMmap<3, float> b("volume.vmm");  // read-only by default
+    \endcode
+*/
+template <unsigned int N, class T>
+class ChunkedArrayMmap
+: public ChunkedArray<N, T>
+{
+  public:
+    typedef typename ChunkedArrayTmpFile<N, T>::Chunk       Chunk;
+    typedef typename ChunkedArrayTmpFile<N, T>::FileHandle  FileHandle;
+    typedef detail::ChunkedArrayMmapHeader                  Header;
+
+    typedef MultiArray<N, SharedChunkHandle<N, T>  > ChunkStorage;
+    typedef MultiArray<N, std::size_t>               OffsetStorage;
+    typedef typename ChunkStorage::difference_type   shape_type;
+    typedef T value_type;
+    typedef value_type * pointer;
+    typedef value_type & reference;
+
+    enum OpenMode { ReadOnly, ReadWrite };
+
+    // alignment of the first chunk in the file
+    static const std::size_t data_alignment = 4096;
+
+    /** \brief Create a new file with given 'shape', 'chunk_shape' and 'options'.
+
+        An existing file of the same name is overwritten. The file is
+        allocated sparsely, i.e. disk space is only used when chunks are
+        written. Chunks that were never written hold the fill value.
+    */
+    ChunkedArrayMmap(std::string const & filename,
+                     shape_type const & shape,
+                     shape_type const & chunk_shape=shape_type(),
+                     ChunkedArrayOptions const & options = ChunkedArrayOptions())
+    : ChunkedArray<N, T>(shape, chunk_shape, options)
+    , offset_array_(this->chunkArrayShape())
+    , filename_(filename)
+    , read_only_(false)
+    {
+        vigra_precondition(this->size() > 0,
+            "ChunkedArrayMmap(): invalid shape.");
+
+        Header header;
+        std::memset(&header, 0, sizeof(Header));
+        std::memcpy(header.magic, "VIGRAMAP", 8);
+        header.version = 1;
+        header.dimension = N;
+        header.setType<T>();
+        header.fill_value = this->fill_scalar_;
+        header.data_offset = (headerSize() + data_alignment - 1) / data_alignment * data_alignment;
+
+        openFile(header.data_offset, true);
+
+        std::memcpy(header_, &header, sizeof(Header));
+        Int64 * shapes = (Int64 *)(header_ + sizeof(Header));
+        for(unsigned int k=0; k<N; ++k)
+        {
+            shapes[k] = this->shape_[k];
+            shapes[N+k] = this->chunk_shape_[k];
+        }
+    }
+
+    /** \brief Open an existing file.
+
+        The array's shape, chunk shape and fill value are read from the file,
+        the respective entries of 'options' are ignored. The element type
+        of the file must match 'T'.
+    */
+    explicit ChunkedArrayMmap(std::string const & filename,
+                              OpenMode mode = ReadOnly,
+                              ChunkedArrayOptions const & options = ChunkedArrayOptions())
+    : ChunkedArrayMmap(filename, readFileInfo(filename), mode, options)
+    {}
+
+    ~ChunkedArrayMmap()
+    {
+        this->stopPrefetch();
+        typename ChunkStorage::iterator  i = this->handle_array_.begin(),
+                                         end = this->handle_array_.end();
+        for(; i != end; ++i)
+        {
+            if(i->pointer_)
+                delete static_cast<Chunk*>(i->pointer_);
+            i->pointer_ = 0;
+        }
+    #ifdef _WIN32
+        ::UnmapViewOfFile(header_);
+        ::CloseHandle(mappedFile_);
+        ::CloseHandle(file_);
+    #else
+        munmap(header_, data_offset_);
+        ::close(file_);
+    #endif
+    }
+
+    /** \brief Write all active chunks and the header to disk.
+
+        This is not necessary for other processes to see the data (they share
+        the page cache), but makes sure that the file is complete after a crash.
+        It must not be called while other threads are accessing the array.
+    */
+    void flushToDisk()
+    {
+        if(read_only_)
+            return;
+        typename ChunkStorage::iterator  i = this->handle_array_.begin(),
+                                         end = this->handle_array_.end();
+        for(; i != end; ++i)
+        {
+            if(i->pointer_)
+                static_cast<Chunk*>(i->pointer_)->sync();
+        }
+    #ifdef _WIN32
+        ::FlushViewOfFile(header_, data_offset_);
+        ::FlushFileBuffers(file_);
+    #else
+        msync(header_, data_offset_, MS_SYNC);
+    #endif
+    }
+
+    /** \brief Name of the underlying file.
+    */
+    std::string const & fileName() const
+    {
+        return filename_;
+    }
+
+    virtual bool isReadOnly() const
+    {
+        return read_only_;
+    }
+
+    virtual pointer loadChunk(ChunkBase<N, T> ** p, shape_type const & index)
+    {
+        if(*p == 0)
+        {
+            shape_type shape = this->chunkShape(index);
+            *p = new Chunk(shape, offset_array_[index], prod(shape)*sizeof(T),
+                           mappedFile_, read_only_);
+            this->overhead_bytes_ += sizeof(Chunk);
+            // chunks are only loaded when they hold data or are about to be written
+            if(!read_only_)
+                written_[dot(index, this->handle_array_.stride())] = 1;
+        }
+        return static_cast<Chunk*>(*p)->map();
+    }
+
+    virtual bool unloadChunk(ChunkBase<N, T> * chunk, bool /* destroy*/)
+    {
+        static_cast<Chunk *>(chunk)->unmap();
+        return false; // never destroys the data
+    }
+
+    virtual bool concurrentChunkIO() const
+    {
+        return true;
+    }
+
+    virtual std::string backend() const
+    {
+        return "ChunkedArrayMmap";
+    }
+
+    virtual std::size_t dataBytes(ChunkBase<N,T> * c) const
+    {
+        return c->pointer_ == 0
+                 ? 0
+                 : static_cast<Chunk*>(c)->alloc_size_;
+    }
+
+    virtual std::size_t overheadBytesPerChunk() const
+    {
+        return sizeof(Chunk) + sizeof(SharedChunkHandle<N, T>) + sizeof(std::size_t);
+    }
+
+  private:
+    struct FileInfo
+    {
+        Header header;
+        shape_type shape, chunk_shape;
+    };
+
+    ChunkedArrayMmap(std::string const & filename, FileInfo const & info,
+                     OpenMode mode, ChunkedArrayOptions const & options)
+    : ChunkedArray<N, T>(info.shape, info.chunk_shape,
+                         options.fillValue(info.header.fill_value))
+    , offset_array_(this->chunkArrayShape())
+    , filename_(filename)
+    , read_only_(mode == ReadOnly)
+    {
+        openFile((std::size_t)info.header.data_offset, false);
+
+        // chunks that were written before are asleep, the others hold the fill value
+        typename ChunkStorage::iterator i   = this->handle_array_.begin(),
+                                        end = this->handle_array_.end();
+        for(std::size_t k=0; i != end; ++i, ++k)
+        {
+            if(written_[k])
+                i->chunk_state_.store(ChunkedArray<N, T>::chunk_asleep);
+        }
+    }
+
+    ChunkedArrayMmap(ChunkedArrayMmap const &);
+    ChunkedArrayMmap & operator=(ChunkedArrayMmap const &);
+
+    static FileInfo readFileInfo(std::string const & filename)
+    {
+        FileInfo info;
+        Int64 shapes[2*N];
+        std::ifstream stream(filename.c_str(), std::ios::binary);
+        stream.read((char *)&info.header, sizeof(Header));
+        stream.read((char *)shapes, sizeof(shapes));
+        if(!stream)
+            throw std::runtime_error("ChunkedArrayMmap(): unable to read header of '" + filename + "'.");
+        vigra_precondition(std::memcmp(info.header.magic, "VIGRAMAP", 8) == 0 &&
+                           info.header.version == 1,
+            "ChunkedArrayMmap(): '" + filename + "' is not a ChunkedArrayMmap file.");
+        vigra_precondition(info.header.dimension == N,
+            "ChunkedArrayMmap(): file has wrong dimension.");
+        vigra_precondition(info.header.template hasType<T>(),
+            "ChunkedArrayMmap(): file has wrong element type.");
+        for(unsigned int k=0; k<N; ++k)
+        {
+            info.shape[k] = shapes[k];
+            info.chunk_shape[k] = shapes[N+k];
+        }
+        return info;
+    }
+
+    std::size_t headerSize() const
+    {
+        return sizeof(Header) + 2*N*sizeof(Int64) + this->handle_array_.size();
+    }
+
+    // Open (or create) the file, map the header, and compute the chunk offsets.
+    void openFile(std::size_t data_offset, bool create)
+    {
+        data_offset_ = data_offset;
+        std::size_t file_size = data_offset;
+        typename OffsetStorage::iterator i = offset_array_.begin(),
+                                         end = offset_array_.end();
+        for(; i != end; ++i)
+        {
+            *i = file_size;
+            file_size += prod(this->chunkShape(i.point()))*sizeof(T);
+        }
+        this->overhead_bytes_ += offset_array_.size()*sizeof(std::size_t);
+
+    #ifdef _WIN32
+        file_ = ::CreateFile(filename_.c_str(),
+                             read_only_ ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE,
+                             FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                             create ? CREATE_ALWAYS : OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file_ == INVALID_HANDLE_VALUE)
+            winErrorToException("ChunkedArrayMmap(): ");
+
+        if(create)
+        {
+            DWORD dwTemp;
+            if(!::DeviceIoControl(file_, FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &dwTemp, NULL))
+                winErrorToException("ChunkedArrayMmap(): ");
+        }
+        else
+        {
+            LARGE_INTEGER current_size;
+            if(!::GetFileSizeEx(file_, &current_size))
+                winErrorToException("ChunkedArrayMmap(): ");
+            vigra_precondition((std::size_t)current_size.QuadPart >= file_size,
+                "ChunkedArrayMmap(): file is truncated.");
+        }
+
+        // resizes the file when it was just created
+        static const std::size_t bits = sizeof(LONG)*8, mask = (std::size_t(1) << bits) - 1;
+        mappedFile_ = CreateFileMapping(file_, NULL, read_only_ ? PAGE_READONLY : PAGE_READWRITE,
+                                        file_size >> bits, file_size & mask, NULL);
+        if(!mappedFile_)
+            winErrorToException("ChunkedArrayMmap(): ");
+
+        header_ = (char *)MapViewOfFile(mappedFile_, read_only_ ? FILE_MAP_READ : FILE_MAP_ALL_ACCESS,
+                                        0, 0, data_offset_);
+        if(header_ == 0)
+            winErrorToException("ChunkedArrayMmap(): ");
+    #else
+        int flags = create
+                       ? O_RDWR | O_CREAT | O_TRUNC
+                       : read_only_ ? O_RDONLY : O_RDWR;
+        mappedFile_ = file_ = ::open(filename_.c_str(), flags, 0644);
+        if(file_ == -1)
+            throw std::runtime_error("ChunkedArrayMmap(): unable to open file '" + filename_ + "'.");
+
+        if(create)
+        {
+            if(ftruncate(file_, file_size) == -1)
+            {
+                ::close(file_);
+                throw std::runtime_error("ChunkedArrayMmap(): unable to resize file.");
+            }
+        }
+        else
+        {
+            struct stat info;
+            if(fstat(file_, &info) == -1 || (std::size_t)info.st_size < file_size)
+            {
+                ::close(file_);
+                vigra_precondition(false, "ChunkedArrayMmap(): file is truncated.");
+            }
+        }
+
+        void * header = mmap(0, data_offset_, read_only_ ? PROT_READ : PROT_READ | PROT_WRITE,
+                             MAP_SHARED, file_, 0);
+        if(header == MAP_FAILED)
+        {
+            ::close(file_);
+            throw std::runtime_error("ChunkedArrayMmap(): mmap() failed.");
+        }
+        header_ = (char *)header;
+    #endif
+        written_ = (UInt8 *)(header_ + sizeof(Header) + 2*N*sizeof(Int64));
+    }
+
+    OffsetStorage offset_array_;  // the start of each chunk in the file
+    std::string filename_;
+    bool read_only_;
+    FileHandle file_, mappedFile_;
+    char * header_;               // the mapped file header
+    UInt8 * written_;             // per-chunk flags in the mapped header
+    std::size_t data_offset_;
+};
+
 template<unsigned int N, class U>
 class ChunkIterator
 : public MultiCoordinateIterator<N>
@@ -3293,6 +4295,9 @@ class ChunkIterator
     ChunkIterator()
     : base_type()
     , base_type2()
+    , array_(0)
+    , prefetch_window_(0)
+    , prefetched_until_(0)
     {}
 
     ChunkIterator(array_type * array,
@@ -3305,6 +4310,8 @@ class ChunkIterator
     , start_(start - chunk_.offset_)
     , stop_(end - chunk_.offset_)
     , chunk_shape_(chunk_shape)
+    , prefetch_window_(0)
+    , prefetched_until_(0)
     {
         getChunk();
     }
@@ -3317,20 +4324,33 @@ class ChunkIterator
     , start_(rhs.start_)
     , stop_(rhs.stop_)
     , chunk_shape_(rhs.chunk_shape_)
+    , prefetch_window_(rhs.prefetch_window_)
+    , prefetched_until_(rhs.prefetched_until_)
     {
         getChunk();
     }
 
+    ~ChunkIterator()
+    {
+        // release the chunk we are pointing to, so that the cache can evict it
+        if(array_)
+            array_->unrefChunk(&chunk_);
+    }
+
     ChunkIterator & operator=(ChunkIterator const & rhs)
     {
         if(this != &rhs)
         {
+            if(array_)
+                array_->unrefChunk(&chunk_);
             base_type::operator=(rhs);
             array_ = rhs.array_;
             chunk_ = rhs.chunk_;
             start_ = rhs.start_;
             stop_ = rhs.stop_;
             chunk_shape_ = rhs.chunk_shape_;
+            prefetch_window_ = rhs.prefetch_window_;
+            prefetched_until_ = rhs.prefetched_until_;
             getChunk();
         }
         return *this;
@@ -3368,13 +4388,52 @@ class ChunkIterator
 
     void getChunk()
     {
-        if(array_)
+        if(array_ && !this->isValid())
+        {
+            // past-the-end iterators must not hold a chunk outside the ROI
+            array_->unrefChunk(&chunk_);
+            this->m_ptr = 0;
+            this->m_shape = shape_type();
+        }
+        else if(array_)
         {
             shape_type array_point = max(start_, this->point()*chunk_shape_),
                        upper_bound(SkipInitialization);
             this->m_ptr = array_->chunkForIterator(array_point, this->m_stride, upper_bound, &chunk_);
             this->m_shape = min(upper_bound, stop_) - array_point;
+            prefetchAhead();
+        }
+    }
+
+    /** \brief Load the next \a window chunks in the background.
+
+        Whenever the iterator moves, the upcoming \a window chunks (in scan
+        order) are requested by means of ChunkedArray::prefetch(), so that
+        processing the current chunk overlaps with loading the next ones.
+        Copies of the iterator inherit the window. Zero (the default)
+        disables prefetching.
+    */
+    ChunkIterator & setPrefetchWindow(int window)
+    {
+        prefetch_window_ = window;
+        prefetchAhead();
+        return *this;
+    }
+
+    void prefetchAhead()
+    {
+        if(!array_ || prefetch_window_ <= 0)
+            return;
+        MultiArrayIndex current = this->scanOrderIndex(),
+                        end = std::min<MultiArrayIndex>(current + 1 + prefetch_window_,
+                                                        prod(base_type::shape()));
+        for(MultiArrayIndex k = std::max(current + 1, prefetched_until_); k < end; ++k)
+        {
+            shape_type p = (static_cast<base_type const &>(*this) + (k - current)).point();
+            array_->prefetch(max(start_, p*chunk_shape_) + chunk_.offset_,
+                             min(stop_, (p + shape_type(1))*chunk_shape_) + chunk_.offset_);
         }
+        prefetched_until_ = std::max(prefetched_until_, end);
     }
 
     shape_type chunkStart() const
@@ -3481,6 +4540,8 @@ class ChunkIterator
     array_type * array_;
     Chunk chunk_;
     shape_type start_, stop_, chunk_shape_, array_point_;
+    int prefetch_window_;
+    MultiArrayIndex prefetched_until_;
 };
 
 //@}
@@ -40,6 +40,14 @@
 
 #include "multi_array_chunked.hxx"
 #include "hdf5impex.hxx"
+#include "compression.hxx"
+
+    // H5Dread_chunk() and H5Dwrite_chunk() are available since HDF5 1.10.3
+#ifdef H5_VERSION_GE
+# if H5_VERSION_GE(1, 10, 3)
+#  define VIGRA_HDF5_DIRECT_CHUNK_IO
+# endif
+#endif
 
 // Bounds checking Macro used if VIGRA_CHECK_BOUNDS is defined.
 #ifdef VIGRA_CHECK_BOUNDS
@@ -51,6 +59,19 @@
 
 namespace vigra {
 
+namespace detail {
+
+    // The HDF5 library is usually not thread-safe. In direct chunk I/O mode,
+    // where file access no longer happens under the chunk_lock_, all HDF5
+    // calls of ChunkedArrayHDF5 are serialized by this mutex.
+inline threading::mutex & hdf5ChunkIOMutex()
+{
+    static threading::mutex m;
+    return m;
+}
+
+} // namespace detail
+
 /** \addtogroup ChunkedArrayClasses
 */
 //@{
@@ -67,6 +88,16 @@ namespace vigra {
     This uses the native chunking and compression functionality provided by the
     HDF5 library. Note: This file must only be included when the HDF5 headers
     and libraries are installed on the system.
+
+    When <tt>ChunkedArrayOptions().directChunkIO(true)</tt> is passed, and the
+    chunks of the dataset coincide with the array's chunks, chunks are transferred
+    with <tt>H5Dread_chunk()</tt> and <tt>H5Dwrite_chunk()</tt> in their raw
+    (compressed) form. The HDF5 chunk cache is then switched off, and (de-)compression
+    is done by VIGRA's own codecs (see \ref compress()) outside of any lock, so that
+    concurrent readers and writers scale with the number of threads. This requires
+    HDF5 1.10.3 or later and a filter pipeline VIGRA can reproduce: no filter,
+    'deflate', 'zstd', or 'shuffle' followed by 'zstd'. Otherwise, the option is
+    ignored (see directChunkIO()).
 */
 template <unsigned int N, class T, class Alloc = std::allocator<T> >
 class ChunkedArrayHDF5
@@ -113,14 +144,24 @@ class ChunkedArrayHDF5
 
         void write(bool deallocate = true)
         {
+            // in direct mode, write() may be called concurrently by
+            // unloadChunk() and flushToDisk()
+            threading::lock_guard<threading::mutex> guard(io_lock_);
             if(this->pointer_ != 0)
             {
+                MultiArrayView<N, T> view(shape_, this->strides_, this->pointer_);
                 if(!array_->file_.isReadOnly())
                 {
-                    herr_t status = array_->file_.writeBlock(array_->dataset_, start_,
-                                          MultiArrayView<N, T>(shape_, this->strides_, this->pointer_));
-                    vigra_postcondition(status >= 0,
-                        "ChunkedArrayHDF5: write to dataset failed.");
+                    if(array_->direct_chunk_io_)
+                    {
+                        array_->writeChunkDirect(start_, view);
+                    }
+                    else
+                    {
+                        herr_t status = array_->file_.writeBlock(array_->dataset_, start_, view);
+                        vigra_postcondition(status >= 0,
+                            "ChunkedArrayHDF5: write to dataset failed.");
+                    }
                 }
                 if(deallocate)
                 {
@@ -132,13 +173,21 @@ class ChunkedArrayHDF5
 
         pointer read()
         {
+            threading::lock_guard<threading::mutex> guard(io_lock_);
             if(this->pointer_ == 0)
             {
                 this->pointer_ = alloc_.allocate(this->size());
-                herr_t status = array_->file_.readBlock(array_->dataset_, start_, shape_,
-                                     MultiArrayView<N, T>(shape_, this->strides_, this->pointer_));
-                vigra_postcondition(status >= 0,
-                    "ChunkedArrayHDF5: read from dataset failed.");
+                MultiArrayView<N, T> view(shape_, this->strides_, this->pointer_);
+                if(array_->direct_chunk_io_)
+                {
+                    array_->readChunkDirect(start_, view);
+                }
+                else
+                {
+                    herr_t status = array_->file_.readBlock(array_->dataset_, start_, shape_, view);
+                    vigra_postcondition(status >= 0,
+                        "ChunkedArrayHDF5: read from dataset failed.");
+                }
             }
             return this->pointer_;
         }
@@ -146,6 +195,7 @@ class ChunkedArrayHDF5
         shape_type shape_, start_;
         ChunkedArrayHDF5 * array_;
         Alloc alloc_;
+        threading::mutex io_lock_;
 
       private:
         Chunk & operator=(Chunk const &);
@@ -182,6 +232,9 @@ class ChunkedArrayHDF5
         <li>ZLIB_BEST: Best compression using 'zlib', slow.
         <li>ZLIB_NONE: Use 'zlib' format without compression.
         <li>DEFAULT_COMPRESSION: Same as ZLIB_FAST.
+        <li>LZ4, SHUFFLE_LZ4, BITSHUFFLE_LZ4, SHUFFLE_ZSTD, ZSTD_FAST ... ZSTD_BEST:
+            Use the registered HDF5 filter plugins for these codecs. The plugins 
+            must be found in <tt>HDF5_PLUGIN_PATH</tt>.
         </ul>
     */
     ChunkedArrayHDF5(HDF5File const & file, std::string const & dataset,
@@ -195,7 +248,10 @@ class ChunkedArrayHDF5
       dataset_name_(dataset),
       dataset_(),
       compression_(options.compression_method),
-      alloc_(alloc)
+      alloc_(alloc),
+      direct_chunk_io_requested_(options.direct_chunk_io),
+      direct_chunk_io_(false),
+      direct_codec_(NO_COMPRESSION)
     {
         init(mode);
     }
@@ -220,6 +276,9 @@ class ChunkedArrayHDF5
         <li>ZLIB_BEST: Best compression using 'zlib', slow.
         <li>ZLIB_NONE: Use 'zlib' format without compression.
         <li>DEFAULT_COMPRESSION: Same as ZLIB_FAST.
+        <li>LZ4, SHUFFLE_LZ4, BITSHUFFLE_LZ4, SHUFFLE_ZSTD, ZSTD_FAST ... ZSTD_BEST:
+            Use the registered HDF5 filter plugins for these codecs. The plugins 
+            must be found in <tt>HDF5_PLUGIN_PATH</tt>.
         </ul>
     */
     ChunkedArrayHDF5(HDF5File const & file, std::string const & dataset,
@@ -233,7 +292,10 @@ class ChunkedArrayHDF5
       dataset_name_(dataset),
       dataset_(),
       compression_(options.compression_method),
-      alloc_(alloc)
+      alloc_(alloc),
+      direct_chunk_io_requested_(options.direct_chunk_io),
+      direct_chunk_io_(false),
+      direct_codec_(NO_COMPRESSION)
     {
         init(mode);
     }
@@ -245,7 +307,10 @@ class ChunkedArrayHDF5
     file_(src.file_),
     dataset_name_(src.dataset_name_),
     compression_(src.compression_),
-    alloc_(src.alloc_)
+    alloc_(src.alloc_),
+    direct_chunk_io_requested_(src.direct_chunk_io_requested_),
+    direct_chunk_io_(false),
+    direct_codec_(NO_COMPRESSION)
     {
         if( file_.isReadOnly() )
             init(HDF5File::ReadOnly);
@@ -281,7 +346,8 @@ class ChunkedArrayHDF5
         if(!exists || mode == HDF5File::New)
         {
             // FIXME: set rdcc_nbytes to 0 (disable cache, because we don't
-            //        need two caches
+            //        need two caches -- done in direct chunk I/O mode, see
+            //        initDirectChunkIO())
             // H5Pset_chunk_cache (dapl, rdcc_nslots, rdcc_nbytes, rdcc_w0);
             // Chunk cache size (rdcc_nbytes) should be large
             // enough to hold all the chunks in a selection
@@ -299,8 +365,6 @@ class ChunkedArrayHDF5
             // chunks as are needed for a single array chunk.
             if(compression_ == DEFAULT_COMPRESSION)
                 compression_ = ZLIB_FAST;
-            vigra_precondition(compression_ != LZ4,
-                "ChunkedArrayHDF5(): HDF5 does not support LZ4 compression.");
 
             vigra_precondition(this->size() > 0,
                 "ChunkedArrayHDF5(): invalid shape.");
@@ -358,6 +422,214 @@ class ChunkedArrayHDF5
                 i->chunk_state_.store(base_type::chunk_asleep);
             }
         }
+
+        if(direct_chunk_io_requested_)
+            initDirectChunkIO();
+    }
+
+    // Switch to direct chunk I/O when the dataset's chunks and filters permit.
+    void initDirectChunkIO()
+    {
+    #ifdef VIGRA_HDF5_DIRECT_CHUNK_IO
+        typedef detail::HDF5TypeTraits<T> TypeTraits;
+        int const bands = TypeTraits::numberOfBands(),
+                  rank  = bands > 1 ? N+1 : N;
+
+        HDF5Handle plist(H5Dget_create_plist(dataset_), &H5Pclose,
+                         "ChunkedArrayHDF5: unable to get dataset creation properties.");
+        if(H5Pget_layout(plist) != H5D_CHUNKED)
+            return;
+
+        // raw chunks bypass HDF5's type conversion, so the file must store
+        // exactly our element type (including the byte order)
+        HDF5Handle file_type(H5Dget_type(dataset_), &H5Tclose,
+                             "ChunkedArrayHDF5: unable to get dataset type.");
+        if(H5Tequal(file_type, TypeTraits::getH5DataType()) <= 0)
+            return;
+
+        // the file's chunks must coincide with our chunks (HDF5 uses reversed axis order)
+        ArrayVector<hsize_t> file_chunk_shape(rank);
+        if(H5Pget_chunk(plist, rank, file_chunk_shape.data()) != rank)
+            return;
+        for(unsigned int k=0; k<N; ++k)
+            if(file_chunk_shape[N-1-k] != (hsize_t)this->chunk_shape_[k])
+                return;
+        if(bands > 1 && file_chunk_shape[N] != (hsize_t)bands)
+            return;
+
+        // the filter pipeline must be one we can reproduce
+        ArrayVector<H5Z_filter_t> filters;
+        CompressionMethod codec = NO_COMPRESSION;
+        int filter_count = H5Pget_nfilters(plist);
+        for(int k=0; k<filter_count; ++k)
+        {
+            unsigned int flags = 0, config = 0, values[8];
+            size_t value_count = 8;
+            char name[64];
+            H5Z_filter_t filter = H5Pget_filter2(plist, k, &flags, &value_count, values,
+                                                 sizeof(name), name, &config);
+            if(filter == H5Z_FILTER_DEFLATE)
+            {
+                unsigned int level = value_count > 0 ? values[0] : 6;
+                codec = level == 0
+                           ? ZLIB_NONE
+                           : level <= 3
+                               ? ZLIB_FAST
+                               : level <= 7
+                                   ? ZLIB
+                                   : ZLIB_BEST;
+            }
+            else if(filter == detail::H5FilterZSTD)
+            {
+                unsigned int level = value_count > 0 ? values[0] : 3;
+                codec = zstdCompression(std::max(1u, std::min(level, 22u)));
+            }
+            else if(filter != H5Z_FILTER_SHUFFLE)
+            {
+                return;
+            }
+            filters.push_back(filter);
+        }
+        bool pipeline_ok = filters.size() == 0 ||
+                           (filters.size() == 1 && filters[0] != H5Z_FILTER_SHUFFLE) ||
+                           (filters.size() == 2 && filters[0] == H5Z_FILTER_SHUFFLE &&
+                                                   filters[1] == detail::H5FilterZSTD);
+        if(!pipeline_ok)
+            return;
+
+        // reopen the dataset without HDF5 chunk cache (we have our own)
+        HDF5Handle access(H5Pcreate(H5P_DATASET_ACCESS), &H5Pclose,
+                          "ChunkedArrayHDF5: unable to create dataset access properties.");
+        H5Pset_chunk_cache(access, 0, 0, 1.0);
+        HDF5Handle file_id(H5Iget_file_id(dataset_), &H5Fclose,
+                           "ChunkedArrayHDF5: unable to get file handle.");
+        ssize_t name_size = H5Iget_name(dataset_, 0, 0);
+        ArrayVector<char> path(name_size + 1);
+        H5Iget_name(dataset_, path.data(), name_size + 1);
+        dataset_ = HDF5HandleShared(H5Dopen(file_id, path.data(), access), &H5Dclose,
+                                    "ChunkedArrayHDF5: unable to reopen dataset.");
+
+        filters_.swap(filters);
+        direct_codec_ = codec;
+        direct_chunk_io_ = true;
+    #endif
+    }
+
+    // Determine the codec for a chunk whose filters in 'filter_mask' were skipped.
+    CompressionMethod directCompression(unsigned int filter_mask) const
+    {
+        bool shuffle = false, compressed = false;
+        for(unsigned int k=0; k<filters_.size(); ++k)
+        {
+            if(filter_mask & (1u << k))
+                continue;
+            if(filters_[k] == H5Z_FILTER_SHUFFLE)
+                shuffle = true;
+            else
+                compressed = true;
+        }
+        vigra_precondition(!shuffle || compressed,
+            "ChunkedArrayHDF5: unsupported filter combination in chunk.");
+        if(!compressed)
+            return NO_COMPRESSION;
+        return shuffle
+                  ? SHUFFLE_ZSTD
+                  : direct_codec_;
+    }
+
+    // Offset of the chunk starting at 'start' in HDF5 coordinates.
+    ArrayVector<hsize_t> directChunkOffset(shape_type const & start) const
+    {
+        int const rank = detail::HDF5TypeTraits<T>::numberOfBands() > 1 ? N+1 : N;
+        ArrayVector<hsize_t> offset(rank, hsize_t(0));
+        for(unsigned int k=0; k<N; ++k)
+            offset[N-1-k] = start[k];
+        return offset;
+    }
+
+    // Read the raw chunk at 'start' and decompress it into 'chunk'. HDF5 stores
+    // chunks at the border of the dataset with the full chunk shape.
+    void readChunkDirect(shape_type const & start, MultiArrayView<N, T> chunk)
+    {
+    #ifdef VIGRA_HDF5_DIRECT_CHUNK_IO
+        typedef typename detail::HDF5TypeTraits<T>::value_type Scalar;
+        ArrayVector<hsize_t> offset(directChunkOffset(start));
+        ArrayVector<char> buffer;
+        uint32_t filter_mask = 0;
+        {
+            threading::lock_guard<threading::mutex> guard(detail::hdf5ChunkIOMutex());
+            hsize_t nbytes = 0;
+            herr_t status;
+            H5E_BEGIN_TRY  // an unallocated chunk is not an error
+            {
+                status = H5Dget_chunk_storage_size(dataset_, offset.data(), &nbytes);
+            }
+            H5E_END_TRY;
+            if(status < 0 || nbytes == 0)
+            {
+                // chunk not yet allocated in the file: let HDF5 apply the fill value
+                status = file_.readBlock(dataset_, start, chunk.shape(), chunk);
+                vigra_postcondition(status >= 0,
+                    "ChunkedArrayHDF5: read from dataset failed.");
+                return;
+            }
+            buffer.resize(nbytes);
+            status = H5Dread_chunk(dataset_, H5P_DEFAULT, offset.data(), &filter_mask, buffer.data());
+            vigra_postcondition(status >= 0,
+                "ChunkedArrayHDF5: read of raw chunk failed.");
+        }
+
+        CompressionMethod method = directCompression(filter_mask);
+        vigra_postcondition(method != NO_COMPRESSION ||
+                            buffer.size() == prod(this->chunk_shape_)*sizeof(T),
+            "ChunkedArrayHDF5: raw chunk has unexpected size.");
+        if(chunk.shape() == this->chunk_shape_)
+        {
+            uncompress(buffer.data(), buffer.size(), (char*)chunk.data(), chunk.size()*sizeof(T),
+                       method, sizeof(Scalar));
+        }
+        else
+        {
+            MultiArray<N, T> full(this->chunk_shape_);
+            uncompress(buffer.data(), buffer.size(), (char*)full.data(), full.size()*sizeof(T),
+                       method, sizeof(Scalar));
+            chunk = full.subarray(shape_type(), chunk.shape());
+        }
+    #else
+        (void)start;
+        (void)chunk;
+    #endif
+    }
+
+    // Compress 'chunk' and write it as raw chunk at 'start'.
+    void writeChunkDirect(shape_type const & start, MultiArrayView<N, T> const & chunk)
+    {
+    #ifdef VIGRA_HDF5_DIRECT_CHUNK_IO
+        typedef typename detail::HDF5TypeTraits<T>::value_type Scalar;
+        ArrayVector<char> buffer;
+        if(chunk.shape() == this->chunk_shape_)
+        {
+            compress((char const *)chunk.data(), chunk.size()*sizeof(T), buffer,
+                     directCompression(0), sizeof(Scalar));
+        }
+        else
+        {
+            MultiArray<N, T> full(this->chunk_shape_, this->fill_value_);
+            full.subarray(shape_type(), chunk.shape()) = chunk;
+            compress((char const *)full.data(), full.size()*sizeof(T), buffer,
+                     directCompression(0), sizeof(Scalar));
+        }
+
+        ArrayVector<hsize_t> offset(directChunkOffset(start));
+        threading::lock_guard<threading::mutex> guard(detail::hdf5ChunkIOMutex());
+        herr_t status = H5Dwrite_chunk(dataset_, H5P_DEFAULT, 0, offset.data(),
+                                       buffer.size(), buffer.data());
+        vigra_postcondition(status >= 0,
+            "ChunkedArrayHDF5: write of raw chunk failed.");
+    #else
+        (void)start;
+        (void)chunk;
+    #endif
     }
 
     ~ChunkedArrayHDF5()
@@ -372,7 +644,10 @@ class ChunkedArrayHDF5
 
     void closeImpl(bool force_destroy)
     {
+        this->stopPrefetch();
         flushToDiskImpl(true, force_destroy);
+        threading::lock_guard<threading::mutex> guard(detail::hdf5ChunkIOMutex());
+        dataset_ = HDF5HandleShared();
         file_.close();
     }
 
@@ -413,6 +688,7 @@ class ChunkedArrayHDF5
                 chunk->write(false);
             }
         }
+        threading::lock_guard<threading::mutex> io_guard(detail::hdf5ChunkIOMutex());
         file_.flushToDisk();
     }
 
@@ -421,6 +697,21 @@ class ChunkedArrayHDF5
         return file_.isReadOnly();
     }
 
+    virtual bool concurrentChunkIO() const
+    {
+        return direct_chunk_io_;
+    }
+
+    /** \brief Check if chunks are transferred with direct chunk I/O.
+
+        This is the case when <tt>ChunkedArrayOptions::directChunkIO()</tt> was requested
+        and the dataset satisfies the requirements (see \ref ChunkedArrayHDF5).
+    */
+    bool directChunkIO() const
+    {
+        return direct_chunk_io_;
+    }
+
     virtual pointer loadChunk(ChunkBase<N, T> ** p, shape_type const & index)
     {
         vigra_precondition(file_.isOpen(),
@@ -473,6 +764,9 @@ class ChunkedArrayHDF5
     HDF5HandleShared dataset_;
     CompressionMethod compression_;
     Alloc alloc_;
+    bool direct_chunk_io_requested_, direct_chunk_io_;
+    ArrayVector<H5Z_filter_t> filters_;
+    CompressionMethod direct_codec_;
 };
 
 //@}
@@ -0,0 +1,940 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2026 by the VIGRA developers                 */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_MULTI_ARRAY_CHUNKED_ZARR_HXX
+#define VIGRA_MULTI_ARRAY_CHUNKED_ZARR_HXX
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <limits>
+
+#include "multi_array_chunked.hxx"
+#include "compression.hxx"
+
+#ifdef _WIN32
+# include <direct.h>
+# include <process.h>
+#else
+# include <sys/stat.h>
+# include <sys/types.h>
+# include <unistd.h>
+#endif
+
+namespace vigra {
+
+namespace detail {
+
+// Minimal JSON document model, sufficient to read Zarr metadata.
+class ZarrJson
+{
+  public:
+    enum Type { Null, Boolean, Number, String, Array, Object };
+
+    ZarrJson()
+    : type_(Null)
+    , number_(0.0)
+    {}
+
+    static ZarrJson parse(std::string const & text)
+    {
+        char const * p = text.c_str();
+        ZarrJson res;
+        res.parseValue(p);
+        skipWhitespace(p);
+        vigra_precondition(*p == 0,
+            "ZarrJson::parse(): unexpected characters after JSON value.");
+        return res;
+    }
+
+    Type type() const
+    {
+        return type_;
+    }
+
+    bool isNull() const
+    {
+        return type_ == Null;
+    }
+
+    double number() const
+    {
+        vigra_precondition(type_ == Number || type_ == Boolean,
+            "ZarrJson::number(): value is not a number.");
+        return number_;
+    }
+
+    std::string const & string() const
+    {
+        vigra_precondition(type_ == String,
+            "ZarrJson::string(): value is not a string.");
+        return string_;
+    }
+
+        // number of elements of an array or object
+    std::size_t size() const
+    {
+        return children_.size();
+    }
+
+    ZarrJson const & operator[](std::size_t k) const
+    {
+        vigra_precondition(type_ == Array && k < children_.size(),
+            "ZarrJson::operator[]: index out of range.");
+        return children_[k];
+    }
+
+        // returns a null value if 'key' doesn't exist
+    ZarrJson const & operator[](std::string const & key) const
+    {
+        static const ZarrJson null_value;
+        for(std::size_t k=0; k<keys_.size(); ++k)
+            if(keys_[k] == key)
+                return children_[k];
+        return null_value;
+    }
+
+    bool hasKey(std::string const & key) const
+    {
+        return std::find(keys_.begin(), keys_.end(), key) != keys_.end();
+    }
+
+  private:
+    static void skipWhitespace(char const * & p)
+    {
+        while(*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+            ++p;
+    }
+
+    static std::string parseString(char const * & p)
+    {
+        std::string res;
+        for(++p; *p != '"'; ++p)
+        {
+            vigra_precondition(*p != 0,
+                "ZarrJson::parse(): unterminated string.");
+            if(*p != '\\')
+            {
+                res += *p;
+                continue;
+            }
+            switch(*++p)
+            {
+              case 'b': res += '\b'; break;
+              case 'f': res += '\f'; break;
+              case 'n': res += '\n'; break;
+              case 'r': res += '\r'; break;
+              case 't': res += '\t'; break;
+              case 'u':
+              {
+                // only ASCII characters are needed in Zarr metadata
+                vigra_precondition(std::strlen(p) > 4,
+                    "ZarrJson::parse(): unterminated string.");
+                long c = std::strtol(std::string(p+1, 4).c_str(), 0, 16);
+                res += c < 128 ? (char)c : '?';
+                p += 4;
+                break;
+              }
+              case 0:
+                vigra_precondition(false,
+                    "ZarrJson::parse(): unterminated string.");
+                break;
+              default:
+                res += *p;
+            }
+        }
+        ++p;
+        return res;
+    }
+
+    void parseValue(char const * & p)
+    {
+        skipWhitespace(p);
+        if(*p == '{' || *p == '[')
+        {
+            bool is_object = *p == '{';
+            char const close = is_object ? '}' : ']';
+            type_ = is_object ? Object : Array;
+            ++p;
+            skipWhitespace(p);
+            if(*p == close)
+            {
+                ++p;
+                return;
+            }
+            for(;;)
+            {
+                skipWhitespace(p);
+                if(is_object)
+                {
+                    vigra_precondition(*p == '"',
+                        "ZarrJson::parse(): object key expected.");
+                    keys_.push_back(parseString(p));
+                    skipWhitespace(p);
+                    vigra_precondition(*p == ':',
+                        "ZarrJson::parse(): ':' expected.");
+                    ++p;
+                }
+                children_.push_back(ZarrJson());
+                children_.back().parseValue(p);
+                skipWhitespace(p);
+                if(*p == ',')
+                {
+                    ++p;
+                    continue;
+                }
+                vigra_precondition(*p == close,
+                    "ZarrJson::parse(): ',' or end of array/object expected.");
+                ++p;
+                return;
+            }
+        }
+        else if(*p == '"')
+        {
+            type_ = String;
+            string_ = parseString(p);
+        }
+        else if(std::strncmp(p, "true", 4) == 0 || std::strncmp(p, "false", 5) == 0)
+        {
+            type_ = Boolean;
+            number_ = *p == 't' ? 1.0 : 0.0;
+            p += *p == 't' ? 4 : 5;
+        }
+        else if(std::strncmp(p, "null", 4) == 0)
+        {
+            type_ = Null;
+            p += 4;
+        }
+        else
+        {
+            // strtod() also accepts the non-standard 'NaN' and 'Infinity' written by Python
+            char * end = 0;
+            number_ = std::strtod(p, &end);
+            vigra_precondition(end != p,
+                "ZarrJson::parse(): invalid value.");
+            type_ = Number;
+            p = end;
+        }
+    }
+
+    Type type_;
+    double number_;
+    std::string string_;
+    std::vector<std::string> keys_;
+    std::vector<ZarrJson> children_;
+};
+
+inline bool zarrIsLittleEndian()
+{
+    static const UInt32 one = 1;
+    return *(UInt8 const *)&one == 1;
+}
+
+    // Zarr's dtype string (e.g. "<f4") of the scalar type of T in native byte order.
+template <class T>
+std::string zarrDtype()
+{
+    typedef typename NumericTraits<T>::ValueType Scalar;
+    std::ostringstream s;
+    s << (sizeof(Scalar) == 1 ? '|' : zarrIsLittleEndian() ? '<' : '>')
+      << (NumericTraits<Scalar>::isIntegral::value
+             ? (NumericTraits<Scalar>::isSigned::value ? 'i' : 'u')
+             : 'f')
+      << sizeof(Scalar);
+    return s.str();
+}
+
+    // Detects modifications of a chunk between load and unload, so that chunks
+    // that were only read are never written back.
+inline UInt64 zarrChecksum(char const * data, std::size_t size)
+{
+    UInt64 h = 0xcbf29ce484222325ull;
+    std::size_t k = 0;
+    for(; k + 8 <= size; k += 8)
+    {
+        UInt64 w;
+        std::memcpy(&w, data + k, 8);
+        h = (h ^ w) * 0x100000001b3ull;
+        h ^= h >> 29;
+    }
+    for(; k < size; ++k)
+        h = (h ^ (UInt8)data[k]) * 0x100000001b3ull;
+    return h;
+}
+
+inline bool zarrReadFile(std::string const & name, ArrayVector<char> & buffer)
+{
+    std::ifstream stream(name.c_str(), std::ios::binary);
+    if(!stream)
+        return false;
+    stream.seekg(0, std::ios::end);
+    std::streamoff size = stream.tellg();
+    stream.seekg(0, std::ios::beg);
+    buffer.resize((std::size_t)size);
+    stream.read(buffer.data(), size);
+    if(!stream)
+        throw std::runtime_error("ChunkedArrayZarr: unable to read '" + name + "'.");
+    return true;
+}
+
+inline bool zarrFileExists(std::string const & name)
+{
+    return (bool)std::ifstream(name.c_str(), std::ios::binary);
+}
+
+    // Create directory 'name' if it doesn't exist. When 'parents' is true,
+    // missing parent directories are created as well.
+inline void zarrMakeDirectory(std::string const & name, bool parents = false)
+{
+    if(parents)
+    {
+        std::string::size_type pos = name.find_last_of("/\\");
+        if(pos != std::string::npos && pos > 0)
+            zarrMakeDirectory(name.substr(0, pos), true);
+    }
+#ifdef _WIN32
+    int res = ::_mkdir(name.c_str());
+#else
+    int res = ::mkdir(name.c_str(), 0755);
+#endif
+    if(res != 0 && errno != EEXIST)
+        throw std::runtime_error("ChunkedArrayZarr: unable to create directory '" + name + "'.");
+}
+
+    // Write 'header' and 'data' to a temporary file and move it to 'name' in
+    // an atomic operation, so that other processes never see partial files.
+inline void zarrWriteFile(std::string const & name,
+                          char const * header, std::size_t header_size,
+                          char const * data, std::size_t size)
+{
+    static threading::atomic_long counter(0);
+    std::ostringstream tmp_name;
+#ifdef _WIN32
+    tmp_name << name << ".__tmp" << ::_getpid() << "_" << counter.fetch_add(1);
+#else
+    tmp_name << name << ".__tmp" << ::getpid() << "_" << counter.fetch_add(1);
+#endif
+    std::string tmp = tmp_name.str();
+    {
+        std::ofstream stream(tmp.c_str(), std::ios::binary | std::ios::trunc);
+        stream.write(header, header_size);
+        stream.write(data, size);
+        stream.close();
+        if(!stream)
+        {
+            std::remove(tmp.c_str());
+            throw std::runtime_error("ChunkedArrayZarr: unable to write '" + name + "'.");
+        }
+    }
+#ifdef _WIN32
+    bool moved = ::MoveFileExA(tmp.c_str(), name.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    bool moved = std::rename(tmp.c_str(), name.c_str()) == 0;
+#endif
+    if(!moved)
+    {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("ChunkedArrayZarr: unable to write '" + name + "'.");
+    }
+}
+
+} // namespace detail
+
+/** \weakgroup ParallelProcessing
+    \sa ChunkedArrayZarr
+*/
+
+/** Implement ChunkedArray as a Zarr (version 2) directory store.
+
+    <b>\#include</b> \<vigra/multi_array_chunked_zarr.hxx\> <br/>
+    Namespace: vigra
+
+    The array is a directory holding the metadata in a file <tt>.zarray</tt>,
+    and each chunk in a separate file named after the chunk's index (e.g.
+    <tt>2.0.1</tt>). Since Zarr uses C order, the axes are reversed with respect
+    to VIGRA, and multi-band element types (e.g. <tt>TinyVector<float, 3></tt>)
+    become an additional last axis. Such stores can be read and written by other
+    Zarr implementations, e.g. the Python <tt>zarr</tt> package.
+
+    Chunks are written by means of an atomic rename. Therefore, independent
+    processes (or several ChunkedArrayZarr objects in the same process) may
+    write disjoint chunks of the same array concurrently, without any locking.
+    Chunks that were not modified since they were loaded are never written back.
+    Chunks that don't exist in the store hold the fill value. The existing chunks
+    are determined when the array is opened; chunks created later by other
+    processes are only seen after reopening.
+
+    Supported compression methods (see \ref ChunkedArrayOptions::compression()) and
+    their Zarr equivalents are:
+    <ul>
+    <li>NO_COMPRESSION: no compressor.
+    <li>ZLIB_NONE, ZLIB_FAST, ZLIB, ZLIB_BEST: 'zlib' compressor at the given level.
+    <li>ZSTD_FAST ... ZSTD_BEST (or <tt>zstdCompression(level)</tt>): 'zstd' compressor.
+    <li>LZ4: 'lz4' compressor.
+    <li>SHUFFLE_LZ4, SHUFFLE_ZSTD: 'shuffle' filter followed by the respective compressor.
+    <li>DEFAULT_COMPRESSION: Same as LZ4.
+    </ul>
+    Other Zarr codecs (e.g. 'blosc' and 'gzip') are not supported.
+    Chunk shapes must be powers of 2, and the store must use the machine's
+    native byte order.
+
+    \code
+    {
+        ChunkedArrayZarr<3, float> a("volume.zarr", Shape3(1000), Shape3(64),
+                                     ChunkedArrayOptions().compression(ZSTD));
+        ... // fill the array
+    }   // all modified chunks are written when 'a' is destroyed
+
+    ChunkedArrayZarr<3, float> b("volume.zarr");  // read-only by default
+    \endcode
+*/
+template <unsigned int N, class T>
+class ChunkedArrayZarr
+: public ChunkedArray<N, T>
+{
+  public:
+
+    class Chunk
+    : public ChunkBase<N, T>
+    {
+      public:
+        typedef typename MultiArrayShape<N>::type  shape_type;
+        typedef T value_type;
+        typedef value_type * pointer;
+        typedef value_type & reference;
+
+        Chunk(shape_type const & shape, std::string const & filename)
+        : ChunkBase<N, T>(detail::defaultStride(shape))
+        , shape_(shape)
+        , filename_(filename)
+        , checksum_(0)
+        , size_(prod(shape))
+        {}
+
+        ~Chunk()
+        {
+            deallocate();
+        }
+
+        void deallocate()
+        {
+            detail::destroy_dealloc_n(this->pointer_, size_, alloc_);
+            this->pointer_ = 0;
+        }
+
+        UInt64 checksum() const
+        {
+            return detail::zarrChecksum((char const *)this->pointer_, size_*sizeof(T));
+        }
+
+        MultiArrayView<N, T> view() const
+        {
+            return MultiArrayView<N, T>(shape_, this->strides_, this->pointer_);
+        }
+
+        shape_type shape_;
+        std::string filename_;
+        UInt64 checksum_;   // of the data when last loaded or written
+        MultiArrayIndex size_;
+        std::allocator<T> alloc_;
+
+      private:
+        Chunk & operator=(Chunk const &);
+    };
+
+    typedef MultiArray<N, SharedChunkHandle<N, T> > ChunkStorage;
+    typedef typename ChunkStorage::difference_type  shape_type;
+    typedef typename NumericTraits<T>::ValueType    scalar_type;
+    typedef T value_type;
+    typedef value_type * pointer;
+    typedef value_type & reference;
+
+    enum OpenMode { ReadOnly, ReadWrite };
+
+    /** \brief Create a new array in directory 'path' with given 'shape', 'chunk_shape' and 'options'.
+
+        The directory is created if necessary. An existing array at the same
+        location is overwritten.
+    */
+    ChunkedArrayZarr(std::string const & path,
+                     shape_type const & shape,
+                     shape_type const & chunk_shape=shape_type(),
+                     ChunkedArrayOptions const & options = ChunkedArrayOptions())
+    : ChunkedArray<N, T>(shape, chunk_shape, options)
+    , path_(path)
+    , separator_('.')
+    , compression_(options.compression_method)
+    , read_only_(false)
+    {
+        vigra_precondition(this->size() > 0,
+            "ChunkedArrayZarr(): invalid shape.");
+        if(compression_ == DEFAULT_COMPRESSION)
+            compression_ = LZ4;
+        std::string metadata = metadataString();
+
+        detail::zarrMakeDirectory(path_, true);
+        // remove the chunks of a previous array at this location
+        typename ChunkStorage::iterator i   = this->handle_array_.begin(),
+                                        end = this->handle_array_.end();
+        for(; i != end; ++i)
+            std::remove(chunkFileName(i.point()).c_str());
+        detail::zarrWriteFile(path_ + "/.zarray", 0, 0, metadata.data(), metadata.size());
+    }
+
+    /** \brief Open an existing array in directory 'path'.
+
+        The array's shape, chunk shape, fill value and compression method are read
+        from the metadata, the respective entries of 'options' are ignored. The
+        element type of the store must match 'T'.
+    */
+    explicit ChunkedArrayZarr(std::string const & path,
+                              OpenMode mode = ReadOnly,
+                              ChunkedArrayOptions const & options = ChunkedArrayOptions())
+    : ChunkedArrayZarr(path, readMetadata(path), mode, options)
+    {}
+
+    ~ChunkedArrayZarr()
+    {
+        this->stopPrefetch();
+        try
+        {
+            flushToDisk();
+        }
+        catch(...)
+        {
+            // errors can only be reported by an explicit call to flushToDisk()
+        }
+        typename ChunkStorage::iterator i   = this->handle_array_.begin(),
+                                        end = this->handle_array_.end();
+        for(; i != end; ++i)
+        {
+            if(i->pointer_)
+                delete static_cast<Chunk*>(i->pointer_);
+            i->pointer_ = 0;
+        }
+    }
+
+    /** \brief Write all modified chunks in memory to the store.
+
+        It must not be called while other threads are accessing the array.
+    */
+    void flushToDisk()
+    {
+        if(read_only_)
+            return;
+        typename ChunkStorage::iterator i   = this->handle_array_.begin(),
+                                        end = this->handle_array_.end();
+        for(; i != end; ++i)
+        {
+            if(i->pointer_)
+                writeChunk(static_cast<Chunk*>(i->pointer_));
+        }
+    }
+
+    /** \brief Directory of the store.
+    */
+    std::string const & path() const
+    {
+        return path_;
+    }
+
+    /** \brief Compression method of the store.
+    */
+    CompressionMethod compression() const
+    {
+        return compression_;
+    }
+
+    virtual bool isReadOnly() const
+    {
+        return read_only_;
+    }
+
+    virtual pointer loadChunk(ChunkBase<N, T> ** p, shape_type const & index)
+    {
+        if(*p == 0)
+        {
+            *p = new Chunk(this->chunkShape(index), chunkFileName(index));
+            this->overhead_bytes_ += sizeof(Chunk);
+        }
+        Chunk * chunk = static_cast<Chunk *>(*p);
+        if(chunk->pointer_ == 0)
+            readChunk(chunk);
+        return chunk->pointer_;
+    }
+
+    virtual bool unloadChunk(ChunkBase<N, T> * chunk, bool /* destroy */)
+    {
+        writeChunk(static_cast<Chunk *>(chunk));
+        static_cast<Chunk *>(chunk)->deallocate();
+        return false; // the data remain in the store
+    }
+
+    virtual bool concurrentChunkIO() const
+    {
+        return true;
+    }
+
+    virtual std::string backend() const
+    {
+        return "ChunkedArrayZarr<'" + path_ + "'>";
+    }
+
+    virtual std::size_t dataBytes(ChunkBase<N,T> * c) const
+    {
+        return c->pointer_ == 0
+                 ? 0
+                 : static_cast<Chunk*>(c)->size_*sizeof(T);
+    }
+
+    virtual std::size_t overheadBytesPerChunk() const
+    {
+        return sizeof(Chunk) + sizeof(SharedChunkHandle<N, T>);
+    }
+
+  private:
+    struct Metadata
+    {
+        shape_type shape, chunk_shape;
+        double fill_value;
+        CompressionMethod compression;
+        char separator;
+    };
+
+    ChunkedArrayZarr(std::string const & path, Metadata const & metadata,
+                     OpenMode mode, ChunkedArrayOptions const & options)
+    : ChunkedArray<N, T>(metadata.shape, metadata.chunk_shape,
+                         options.fillValue(metadata.fill_value))
+    , path_(path)
+    , separator_(metadata.separator)
+    , compression_(metadata.compression)
+    , read_only_(mode == ReadOnly)
+    {
+        // chunks in the store are asleep, the others hold the fill value
+        typename ChunkStorage::iterator i   = this->handle_array_.begin(),
+                                        end = this->handle_array_.end();
+        for(; i != end; ++i)
+        {
+            if(detail::zarrFileExists(chunkFileName(i.point())))
+                i->chunk_state_.store(ChunkedArray<N, T>::chunk_asleep);
+        }
+    }
+
+    ChunkedArrayZarr(ChunkedArrayZarr const &);
+    ChunkedArrayZarr & operator=(ChunkedArrayZarr const &);
+
+    static int bands()
+    {
+        return sizeof(T) / sizeof(scalar_type);
+    }
+
+        // the 'lz4' codec of Zarr prepends the uncompressed size to the data
+    bool hasSizeHeader() const
+    {
+        return compression_ == LZ4 || compression_ == SHUFFLE_LZ4;
+    }
+
+    std::string chunkFileName(shape_type const & index) const
+    {
+        std::ostringstream s;
+        s << path_ << '/' << index[N-1];
+        for(int k=N-2; k>=0; --k)
+            s << separator_ << index[k];
+        if(bands() > 1)
+            s << separator_ << 0;
+        return s.str();
+    }
+
+    std::string metadataString() const
+    {
+        std::ostringstream s;
+        s.precision(17);
+        s << "{\n    \"chunks\": [";
+        for(int k=N-1; k>=0; --k)
+            s << this->chunk_shape_[k] << (k > 0 ? ", " : "");
+        if(bands() > 1)
+            s << ", " << bands();
+        s << "],\n    \"compressor\": ";
+
+        std::string filters = "null";
+        if(compression_ == SHUFFLE_LZ4 || compression_ == SHUFFLE_ZSTD)
+        {
+            std::ostringstream f;
+            f << "[{\"id\": \"shuffle\", \"elementsize\": " << sizeof(scalar_type) << "}]";
+            filters = f.str();
+        }
+        if(compression_ == NO_COMPRESSION)
+            s << "null";
+        else if(compression_ >= ZLIB_NONE && compression_ <= ZLIB_BEST)
+            s << "{\"id\": \"zlib\", \"level\": " << (int)compression_ << "}";
+        else if(compression_ == LZ4 || compression_ == SHUFFLE_LZ4)
+            s << "{\"id\": \"lz4\", \"acceleration\": 1}";
+        else if(compression_ == SHUFFLE_ZSTD)
+            s << "{\"id\": \"zstd\", \"level\": " << ZSTD - ZSTD_FAST + 1 << "}";
+        else if(compression_ >= ZSTD_FAST && compression_ < ZSTD_FAST + 22)
+            s << "{\"id\": \"zstd\", \"level\": " << compression_ - ZSTD_FAST + 1 << "}";
+        else
+            vigra_precondition(false,
+                "ChunkedArrayZarr(): compression method is not supported by Zarr.");
+
+        s << ",\n    \"dimension_separator\": \"" << separator_ << "\""
+          << ",\n    \"dtype\": \"" << detail::zarrDtype<T>() << "\""
+          << ",\n    \"fill_value\": ";
+        if(this->fill_scalar_ != this->fill_scalar_)
+            s << "\"NaN\"";
+        else if(this->fill_scalar_ == std::numeric_limits<double>::infinity())
+            s << "\"Infinity\"";
+        else if(this->fill_scalar_ == -std::numeric_limits<double>::infinity())
+            s << "\"-Infinity\"";
+        else
+            s << this->fill_scalar_;
+        s << ",\n    \"filters\": " << filters
+          << ",\n    \"order\": \"C\""
+          << ",\n    \"shape\": [";
+        for(int k=N-1; k>=0; --k)
+            s << this->shape_[k] << (k > 0 ? ", " : "");
+        if(bands() > 1)
+            s << ", " << bands();
+        s << "],\n    \"zarr_format\": 2\n}\n";
+        return s.str();
+    }
+
+    static Metadata readMetadata(std::string const & path)
+    {
+        std::string name = path + "/.zarray";
+        ArrayVector<char> text;
+        if(!detail::zarrReadFile(name, text))
+            throw std::runtime_error("ChunkedArrayZarr(): unable to read '" + name + "'.");
+        detail::ZarrJson json = detail::ZarrJson::parse(std::string(text.begin(), text.end()));
+
+        vigra_precondition(json["zarr_format"].type() == detail::ZarrJson::Number &&
+                           json["zarr_format"].number() == 2,
+            "ChunkedArrayZarr(): '" + path + "' is not a Zarr version 2 array.");
+
+        Metadata res;
+        detail::ZarrJson const & shape = json["shape"],
+                               & chunks = json["chunks"];
+        unsigned int rank = bands() > 1 ? N+1 : N;
+        vigra_precondition(shape.size() == rank && chunks.size() == rank,
+            "ChunkedArrayZarr(): array has wrong dimension.");
+        if(bands() > 1)
+            vigra_precondition(shape[N].number() == bands() && chunks[N].number() == bands(),
+                "ChunkedArrayZarr(): array has wrong number of bands.");
+        for(unsigned int k=0; k<N; ++k)
+        {
+            res.shape[k] = (MultiArrayIndex)shape[N-1-k].number();
+            res.chunk_shape[k] = (MultiArrayIndex)chunks[N-1-k].number();
+        }
+
+        std::string dtype = json["dtype"].string(),
+                    expected = detail::zarrDtype<T>();
+        vigra_precondition(dtype.size() == expected.size() &&
+                           dtype.substr(1) == expected.substr(1),
+            "ChunkedArrayZarr(): array has wrong element type.");
+        vigra_precondition(dtype[0] == expected[0] || sizeof(scalar_type) == 1,
+            "ChunkedArrayZarr(): byte order of the array differs from the machine's byte order.");
+        vigra_precondition(json["order"].string() == "C",
+            "ChunkedArrayZarr(): only arrays in C order are supported.");
+
+        detail::ZarrJson const & fill_value = json["fill_value"];
+        res.fill_value = fill_value.isNull()
+                            ? 0.0
+                            : fill_value.type() == detail::ZarrJson::String
+                                 ? std::strtod(fill_value.string().c_str(), 0)
+                                 : fill_value.number();
+
+        res.separator = json.hasKey("dimension_separator")
+                            ? json["dimension_separator"].string()[0]
+                            : '.';
+        vigra_precondition(res.separator == '.' || res.separator == '/',
+            "ChunkedArrayZarr(): invalid dimension separator.");
+
+        // filters: only 'shuffle' is supported
+        bool shuffle = false;
+        detail::ZarrJson const & filters = json["filters"];
+        for(std::size_t k=0; k<filters.size(); ++k)
+        {
+            vigra_precondition(filters.size() == 1 && filters[k]["id"].string() == "shuffle",
+                "ChunkedArrayZarr(): unsupported filter.");
+            shuffle = filters[k]["elementsize"].number() > 1;
+        }
+
+        detail::ZarrJson const & compressor = json["compressor"];
+        if(compressor.isNull())
+        {
+            vigra_precondition(!shuffle,
+                "ChunkedArrayZarr(): shuffle filter without compressor is not supported.");
+            res.compression = NO_COMPRESSION;
+        }
+        else
+        {
+            std::string id = compressor["id"].string();
+            if(id == "zlib")
+            {
+                vigra_precondition(!shuffle,
+                    "ChunkedArrayZarr(): shuffle filter with zlib compressor is not supported.");
+                int level = compressor.hasKey("level")
+                                ? (int)compressor["level"].number()
+                                : 1;
+                // map to the levels supported by compress()
+                res.compression = level <= 0
+                                     ? ZLIB_NONE
+                                     : level <= 3
+                                         ? ZLIB_FAST
+                                         : level <= 7
+                                             ? ZLIB
+                                             : ZLIB_BEST;
+            }
+            else if(id == "zstd")
+            {
+                int level = compressor.hasKey("level")
+                                ? (int)compressor["level"].number()
+                                : 3;
+                res.compression = shuffle
+                                     ? SHUFFLE_ZSTD
+                                     : zstdCompression(std::max(1, std::min(level, 22)));
+            }
+            else if(id == "lz4")
+            {
+                res.compression = shuffle
+                                     ? SHUFFLE_LZ4
+                                     : LZ4;
+            }
+            else
+            {
+                vigra_precondition(false,
+                    "ChunkedArrayZarr(): unsupported compressor '" + id + "'.");
+            }
+        }
+        return res;
+    }
+
+    // Read the chunk from its file. Zarr stores chunks at the border of the
+    // array with the full chunk shape.
+    void readChunk(Chunk * chunk)
+    {
+        ArrayVector<char> buffer;
+        if(!detail::zarrReadFile(chunk->filename_, buffer))
+        {
+            chunk->pointer_ = detail::alloc_initialize_n<T>(chunk->size_, this->fill_value_, chunk->alloc_);
+        }
+        else
+        {
+            chunk->pointer_ = chunk->alloc_.allocate((std::size_t)chunk->size_);
+            if(chunk->shape_ == this->chunk_shape_)
+            {
+                decode(buffer, (char *)chunk->pointer_, chunk->size_*sizeof(T), chunk->filename_);
+            }
+            else
+            {
+                MultiArray<N, T> full(this->chunk_shape_);
+                decode(buffer, (char *)full.data(), full.size()*sizeof(T), chunk->filename_);
+                chunk->view() = full.subarray(shape_type(), chunk->shape_);
+            }
+        }
+        chunk->checksum_ = chunk->checksum();
+    }
+
+    // Write the chunk to its file if it was modified since the last read or write.
+    void writeChunk(Chunk * chunk)
+    {
+        if(read_only_ || chunk->pointer_ == 0)
+            return;
+        UInt64 checksum = chunk->checksum();
+        if(checksum == chunk->checksum_)
+            return;
+
+        ArrayVector<char> buffer;
+        std::size_t size = prod(this->chunk_shape_)*sizeof(T);
+        if(chunk->shape_ == this->chunk_shape_)
+        {
+            compress((char const *)chunk->pointer_, size, buffer, compression_, sizeof(scalar_type));
+        }
+        else
+        {
+            MultiArray<N, T> full(this->chunk_shape_, this->fill_value_);
+            full.subarray(shape_type(), chunk->shape_) = chunk->view();
+            compress((char const *)full.data(), size, buffer, compression_, sizeof(scalar_type));
+        }
+
+        char header[4];
+        for(int k=0; k<4; ++k)
+            header[k] = (char)((size >> (8*k)) & 0xff);
+
+        if(separator_ == '/')
+            detail::zarrMakeDirectory(chunk->filename_.substr(0, chunk->filename_.rfind('/')), true);
+        detail::zarrWriteFile(chunk->filename_, header, hasSizeHeader() ? 4 : 0,
+                              buffer.data(), buffer.size());
+        chunk->checksum_ = checksum;
+    }
+
+    void decode(ArrayVector<char> const & buffer, char * dest, std::size_t size,
+                std::string const & filename) const
+    {
+        char const * data = buffer.data();
+        std::size_t data_size = buffer.size();
+        if(hasSizeHeader())
+        {
+            vigra_precondition(data_size >= 4,
+                "ChunkedArrayZarr: chunk '" + filename + "' is corrupt.");
+            std::size_t stored = 0;
+            for(int k=0; k<4; ++k)
+                stored |= (std::size_t)(UInt8)data[k] << (8*k);
+            vigra_precondition(stored == size,
+                "ChunkedArrayZarr: chunk '" + filename + "' has wrong size.");
+            data += 4;
+            data_size -= 4;
+        }
+        if(compression_ == NO_COMPRESSION)
+            vigra_precondition(data_size == size,
+                "ChunkedArrayZarr: chunk '" + filename + "' has wrong size.");
+        uncompress(data, data_size, dest, size, compression_, sizeof(scalar_type));
+    }
+
+    std::string path_;
+    char separator_;
+    CompressionMethod compression_;
+    bool read_only_;
+};
+
+} // namespace vigra
+
+#endif // VIGRA_MULTI_ARRAY_CHUNKED_ZARR_HXX
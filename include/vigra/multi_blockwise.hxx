@@ -196,7 +196,7 @@ namespace blockwise{
         auto beginIter  =  blocking.blockWithBorderBegin(borderWidth);
         auto endIter   =  blocking.blockWithBorderEnd(borderWidth);
 
-        parallel_foreach(options.getNumThreads(),
+        parallel_foreach(options,
             beginIter, endIter,
             [&](const int /*threadId*/, const BlockWithBorder bwb)
             {
@@ -248,7 +248,7 @@ namespace blockwise{
         auto beginIter  =  blocking.blockWithBorderBegin(borderWidth);
         auto endIter   =  blocking.blockWithBorderEnd(borderWidth);
 
-        parallel_foreach(options.getNumThreads(),
+        parallel_foreach(options,
             beginIter, endIter,
             [&](const int /*threadId*/, const BlockWithBorder bwb)
             {
@@ -401,11 +401,14 @@ namespace blockwise{
         vigra::TinyVector< vigra::MultiArrayIndex, N > res(vigra::SkipInitialization);
 
         if(opt.getFilterWindowSize()<=0.00001){
+            // recursive filters have infinite support, use the same margin
+            // as recursiveGaussianMultiArray() uses for subarrays
+            const double ratio = opt.getUseRecursiveFilter() ? 5.0 : 3.0;
             for(size_t d=0; d<N; ++d){
                 double stdDev =  opt.getStdDev()[d];
                 if(usesOuterScale)
                     stdDev += opt.getOuterScale()[d];
-                res[d] = static_cast<MultiArrayIndex>(3.0 * stdDev  + 0.5*static_cast<double>(order)+0.5);
+                res[d] = static_cast<MultiArrayIndex>(ratio * stdDev  + 0.5*static_cast<double>(order)+0.5);
             }
         }
         else{
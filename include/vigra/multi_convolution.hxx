@@ -39,6 +39,7 @@
 #define VIGRA_MULTI_CONVOLUTION_H
 
 #include "separableconvolution.hxx"
+#include "multi_convolution_simd.hxx"
 #include "array_vector.hxx"
 #include "multi_array.hxx"
 #include "accessor.hxx"
@@ -345,13 +346,15 @@ class ConvolutionOptions
     ParamVec outer_scale;
     double window_ratio;
     Shape from_point, to_point;
+    bool use_recursive_filter;
 
     ConvolutionOptions()
     : sigma_eff(0.0),
       sigma_d(0.0),
       step_size(1.0),
       outer_scale(0.0),
-      window_ratio(0.0)
+      window_ratio(0.0),
+      use_recursive_filter(false)
     {}
 
     typedef typename detail::WrapDoubleIteratorTriple<ParamIt, ParamIt, ParamIt>
@@ -485,6 +488,38 @@ class ConvolutionOptions
       return window_ratio;
     }
 
+        /** Use recursive (IIR) filters instead of FIR kernels.
+
+            If set, Gaussian smoothing is computed by Deriche's fourth order recursive
+            filter, whose cost per pixel does not depend on the scale (except for
+            a border margin of 5*sigma added to each line). First and second derivatives
+            are obtained by applying fourth order accurate central differences to the
+            smoothed data. This is a good choice for large scales, where FIR kernels get
+            long: the recursive filter is faster from about sigma = 5 upwards, depending
+            on the array size. For sigma &gt;= 3, the results agree with the FIR filters
+            to about 0.05% (smoothing) and 1-2% (derivatives) of the maximum response.
+            The error grows at smaller scales (about 5% for derivatives at sigma = 1.5),
+            so small scales should use the FIR filters. The option filterWindowSize()
+            is ignored in recursive mode, and each axis must have at least 4 pixels.
+
+            This option is supported by \ref gaussianSmoothMultiArray(),
+            \ref gaussianGradientMultiArray(), \ref gaussianGradientMagnitude(),
+            \ref gaussianDivergenceMultiArray(), \ref hessianOfGaussianMultiArray(),
+            \ref laplacianOfGaussianMultiArray(), \ref structureTensorMultiArray()
+            and their blockwise variants.
+
+            Default: <tt>false</tt>
+        */
+    ConvolutionOptions<dim> & useRecursiveFilter(bool v = true)
+    {
+        use_recursive_filter = v;
+        return *this;
+    }
+
+    bool getUseRecursiveFilter() const {
+      return use_recursive_filter;
+    }
+
         /** Restrict the filter to a subregion of the input array.
 
             This is useful for speeding up computations by ignoring irrelevant
@@ -559,6 +594,10 @@ internalSeparableConvolveMultiArrayTmp(
     // operate on further dimensions
     for( int d = 1; d < N; ++d, ++kit )
     {
+        // convolve several adjacent lines at once if possible
+        if(convolveLinesInPanels(di, shape, dest, d, *kit, 0, shape[d]))
+            continue;
+
         DNavigator dnav( di, shape, d );
 
         tmp.resize( shape[d] );
@@ -646,13 +685,22 @@ internalSeparableConvolveSubarray(
     // operate on further dimensions
     for( int d = 1; d < N; ++d)
     {
+        int lstart = start[axisorder[d]] - sstart[axisorder[d]];
+        int lstop  = lstart + (stop[axisorder[d]] - start[axisorder[d]]);
+
+        // convolve several adjacent lines at once if possible
+        if(convolveLinesInPanels(tmp.traverser_begin() + dstart, dstop - dstart, acc,
+                                 axisorder[d], kit[axisorder[d]], lstart, lstop))
+        {
+            dstart[axisorder[d]] = lstart;
+            dstop[axisorder[d]] = lstop;
+            continue;
+        }
+
         TNavigator tnav( tmp.traverser_begin(), dstart, dstop, axisorder[d]);
 
         ArrayVector<TmpType> tmpline(dstop[axisorder[d]] - dstart[axisorder[d]]);
 
-        int lstart = start[axisorder[d]] - sstart[axisorder[d]];
-        int lstop  = lstart + (stop[axisorder[d]] - start[axisorder[d]]);
-
         for( ; tnav.hasMore(); tnav++ )
         {
             // first copy source to tmp because convolveLine() cannot work in-place
@@ -719,6 +767,14 @@ scaleKernel(K & kernel, double a)
     interpreted relative to the end of the respective dimension
     (i.e. <tt>if(stop[k] < 0) stop[k] += source.shape(k);</tt>).
 
+    When the internal array holds <tt>float</tt> or <tt>double</tt> and one of its
+    axes is contiguous in memory, all dimensions except the first are filtered
+    in panels of adjacent lines using SSE2 or AVX instructions (selected at runtime,
+    see <tt>multi_convolution_simd.hxx</tt>). This applies to the border treatment
+    modes BORDER_TREATMENT_REFLECT, BORDER_TREATMENT_REPEAT, BORDER_TREATMENT_WRAP and
+    BORDER_TREATMENT_ZEROPAD. The kernel taps are applied in the same order and
+    precision as in \ref convolveLine(), so the results do not change.
+
     <b> Declarations:</b>
 
     pass arbitrary-dimensional array views:
@@ -1192,6 +1248,329 @@ convolveMultiArrayOneDimension(MultiArrayView<N, T1, S1> const & source,
     convolveMultiArrayOneDimension(source, dest, dim, kernel, SHAPE(), SHAPE());
 }
 
+namespace detail {
+
+/********************************************************/
+/*                                                      */
+/*             recursiveGaussianMultiArray              */
+/*                                                      */
+/********************************************************/
+
+    // Coefficients of the fourth order recursive approximation of the Gaussian from
+    //
+    //     R. Deriche: "Recursively implementing the Gaussian and its derivatives",
+    //     INRIA Research Report 1893, 1993.
+    //
+    // We use the parameter set whose impulse response is smooth at the origin
+    // (the other set has a kink there, which spoils the second derivatives).
+    // The causal part computes y[x] = sum_k n[k]*f[x-k] - sum_k d[k]*y[x-1-k], the
+    // anti-causal part z[x] = sum_k m[k]*f[x+1+k] - sum_k d[k]*z[x+1+k], and the
+    // result is y + z. The coefficients are normalized to unit DC gain.
+struct RecursiveGaussianCoefficients
+{
+    double n[4], m[4], d[4];
+    int margin;
+
+    explicit RecursiveGaussianCoefficients(double sigma)
+    {
+        const double a0 = 1.3530, a1 = 1.8151, c0 = -0.3531, c1 = 0.0902,
+                     b0 = 1.3932 / sigma, b1 = 1.3732 / sigma,
+                     w0 = 0.6681 / sigma, w1 = 2.0787 / sigma;
+        const double e0 = std::exp(-b0), e1 = std::exp(-b1),
+                     cos0 = std::cos(w0), sin0 = std::sin(w0),
+                     cos1 = std::cos(w1), sin1 = std::sin(w1);
+
+        n[0] = a0 + c0;
+        n[1] = e1*(c1*sin1 - (c0 + 2.0*a0)*cos1) + e0*(a1*sin0 - (2.0*c0 + a0)*cos0);
+        n[2] = 2.0*e0*e1*((a0 + c0)*cos1*cos0 - a1*cos1*sin0 - c1*cos0*sin1) + c0*e0*e0 + a0*e1*e1;
+        n[3] = e1*e0*e0*(c1*sin1 - c0*cos1) + e0*e1*e1*(a1*sin0 - a0*cos0);
+
+        d[0] = -2.0*cos1*e1 - 2.0*cos0*e0;
+        d[1] = 4.0*cos1*cos0*e0*e1 + e1*e1 + e0*e0;
+        d[2] = -2.0*cos0*e0*e1*e1 - 2.0*cos1*e1*e0*e0;
+        d[3] = e0*e0*e1*e1;
+
+        // the kernel is symmetric
+        for(int k=0; k<3; ++k)
+            m[k] = n[k+1] - d[k]*n[0];
+        m[3] = -d[3]*n[0];
+
+        double gain = 0.0;
+        for(int k=0; k<4; ++k)
+            gain += n[k] + m[k];
+        gain /= 1.0 + d[0] + d[1] + d[2] + d[3];
+        for(int k=0; k<4; ++k)
+        {
+            n[k] /= gain;
+            m[k] /= gain;
+        }
+
+        // beyond 5 sigma, the kernel is below 1e-5 of its maximum
+        margin = (int)std::ceil(5.0*sigma);
+    }
+};
+
+    // Run the causal and anti-causal recursions on L interleaved lines, i.e. sample p
+    // of lane l is f[p*L + l], and store the sum of both in y. f, y, and z must have
+    // 4*L zeros before and after the 'size' samples of each, so that the recursions
+    // need no boundary checks. Interleaving makes the inner loops vectorizable.
+template <int L, class U>
+inline void
+recursiveGaussianPanel(U const * f, U * y, U * z, int size,
+                       RecursiveGaussianCoefficients const & gauss)
+{
+    // local copies tell the compiler that the coefficients don't alias the data
+    const double n0 = gauss.n[0], n1 = gauss.n[1], n2 = gauss.n[2], n3 = gauss.n[3],
+                 m0 = gauss.m[0], m1 = gauss.m[1], m2 = gauss.m[2], m3 = gauss.m[3],
+                 d0 = gauss.d[0], d1 = gauss.d[1], d2 = gauss.d[2], d3 = gauss.d[3];
+
+    for(int p = 0; p < size; ++p)
+    {
+        U const * fp = f + p*L;
+        U * yp = y + p*L;
+        for(int l = 0; l < L; ++l)
+            yp[l] = n0*fp[l] + n1*fp[l-L] + n2*fp[l-2*L] + n3*fp[l-3*L]
+                    - (d0*yp[l-L] + d1*yp[l-2*L] + d2*yp[l-3*L] + d3*yp[l-4*L]);
+    }
+    for(int p = size - 1; p >= 0; --p)
+    {
+        U const * fp = f + p*L;
+        U * zp = z + p*L;
+        for(int l = 0; l < L; ++l)
+            zp[l] = m0*fp[l+L] + m1*fp[l+2*L] + m2*fp[l+3*L] + m3*fp[l+4*L]
+                    - (d0*zp[l+L] + d1*zp[l+2*L] + d2*zp[l+3*L] + d3*zp[l+4*L]);
+    }
+    for(int p = 0; p < size*L; ++p)
+        y[p] += z[p];
+}
+
+#if defined(VIGRA_CONVOLUTION_AVX)
+
+    // The same, compiled for AVX. This function must only be called when
+    // detectConvolutionSIMDLevel() reported AVX support.
+template <int L>
+VIGRA_TARGET_AVX void
+recursiveGaussianPanelAVX(double const * f, double * y, double * z, int size,
+                          RecursiveGaussianCoefficients const & gauss)
+{
+    recursiveGaussianPanel<L>(f, y, z, size, gauss);
+}
+
+template <int L>
+inline void
+recursiveGaussianPanelDispatch(double const * f, double * y, double * z, int size,
+                               RecursiveGaussianCoefficients const & gauss)
+{
+    if(convolutionSIMDLevel() >= ConvolutionPanelAVX)
+        recursiveGaussianPanelAVX<L>(f, y, z, size, gauss);
+    else
+        recursiveGaussianPanel<L>(f, y, z, size, gauss);
+}
+
+#endif // VIGRA_CONVOLUTION_AVX
+
+template <int L, class U>
+inline void
+recursiveGaussianPanelDispatch(U const * f, U * y, U * z, int size,
+                               RecursiveGaussianCoefficients const & gauss)
+{
+    recursiveGaussianPanel<L>(f, y, z, size, gauss);
+}
+
+    // Filter L lines of length w, whose samples are at lines[x*lineStride + l*laneStride]:
+    // smooth with the recursive Gaussian (if 'gauss' is not zero), apply a fourth
+    // order accurate central difference of the given order (0, 1, or 2), and multiply
+    // with 'scale'. 'index' maps the positions of the padded line onto the line,
+    // realizing reflective border treatment. The computations are done in double
+    // precision, because the recursive filter becomes ill-conditioned at large scales.
+template <int L, class T, class U>
+void
+recursiveGaussianLines(T * lines, std::ptrdiff_t lineStride, std::ptrdiff_t laneStride, int w,
+                       ArrayVector<int> const & index,
+                       RecursiveGaussianCoefficients const * gauss,
+                       int order, double scale, ArrayVector<U> & buffer)
+{
+    const int size = (int)index.size(), pad = (size - w) / 2,
+              guard = 4*L, length = size*L + 2*guard;
+    buffer.resize(3*length);
+    U * f = buffer.begin() + guard, * y = f + length, * z = y + length;
+    for(int k = 0; k < 3; ++k)
+    {
+        std::fill(f + k*length - guard, f + k*length, NumericTraits<U>::zero());
+        std::fill(f + k*length + size*L, f + k*length + size*L + guard, NumericTraits<U>::zero());
+    }
+
+    for(int p = 0; p < size; ++p)
+    {
+        T const * src = lines + index[p]*lineStride;
+        for(int l = 0; l < L; ++l)
+            f[p*L + l] = src[l*laneStride];
+    }
+
+    U const * g = f;
+    if(gauss != 0)
+    {
+        recursiveGaussianPanelDispatch<L>(f, y, z, size, *gauss);
+        g = y + pad*L;
+    }
+
+    for(int x = 0; x < w; ++x)
+    {
+        T * d = lines + x*lineStride;
+        U const * g0 = g + x*L;
+        if(order == 0)
+        {
+            for(int l = 0; l < L; ++l)
+                d[l*laneStride] = detail::RequiresExplicitCast<T>::cast(scale*g0[l]);
+            continue;
+        }
+        U const * m2 = g + (x < 2     ? 2 - x : x - 2)*L,
+                * m1 = g + (x < 1     ? 1 - x : x - 1)*L,
+                * p1 = g + (x + 1 < w ? x + 1 : 2*w - 3 - x)*L,
+                * p2 = g + (x + 2 < w ? x + 2 : 2*w - 4 - x)*L;
+        if(order == 1)
+            for(int l = 0; l < L; ++l)
+                d[l*laneStride] = detail::RequiresExplicitCast<T>::cast(
+                          (scale / 12.0)*((m2[l] - p2[l]) + 8.0*(p1[l] - m1[l])));
+        else
+            for(int l = 0; l < L; ++l)
+                d[l*laneStride] = detail::RequiresExplicitCast<T>::cast(
+                          (scale / 12.0)*(16.0*(m1[l] + p1[l]) - (m2[l] + p2[l]) - 30.0*g0[l]));
+    }
+}
+
+    // Recursive counterpart of separableConvolveMultiArray() with Gaussian kernels:
+    // along axis k, smooth at scale sigma[k], take the derivative of order order[k],
+    // and multiply with scale[k]. Since the filter has infinite support, the region
+    // processed around the ROI is extended by 5*sigma (or to the array border).
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor>
+void
+recursiveGaussianMultiArray(SrcIterator s, SrcShape const & shape, SrcAccessor src,
+                            DestIterator d, DestAccessor dest,
+                            TinyVector<double, SrcShape::static_size> const & sigma,
+                            SrcShape const & order,
+                            TinyVector<double, SrcShape::static_size> const & scale,
+                            SrcShape start = SrcShape(),
+                            SrcShape stop = SrcShape())
+{
+    enum { N = SrcShape::static_size };
+    typedef typename NumericTraits<typename DestAccessor::value_type>::RealPromote TmpType;
+    typedef typename AccessorTraits<TmpType>::default_accessor TmpAccessor;
+
+    if(stop != SrcShape())
+    {
+        detail::RelativeToAbsoluteCoordinate<N-1>::exec(shape, start);
+        detail::RelativeToAbsoluteCoordinate<N-1>::exec(shape, stop);
+
+        for(int k=0; k<N; ++k)
+            vigra_precondition(0 <= start[k] && start[k] < stop[k] && stop[k] <= shape[k],
+              "recursiveGaussianMultiArray(): invalid subarray shape.");
+    }
+    else
+    {
+        start = SrcShape();
+        stop = shape;
+    }
+
+    SrcShape sstart, sstop;
+    for(int k=0; k<N; ++k)
+    {
+        MultiArrayIndex margin = (MultiArrayIndex)std::ceil(5.0*sigma[k]) + order[k];
+        sstart[k] = std::max<MultiArrayIndex>(0, start[k] - margin);
+        sstop[k]  = std::min<MultiArrayIndex>(shape[k], stop[k] + margin);
+        vigra_precondition(sstop[k] - sstart[k] >= 4,
+            "recursiveGaussianMultiArray(): recursive filters require at least 4 pixels along each axis.");
+    }
+
+    MultiArray<N, TmpType> tmp(sstop - sstart);
+    copyMultiArray(s + sstart, sstop - sstart, src, tmp.traverser_begin(), TmpAccessor());
+
+    const int W = ConvolutionPanelWidth;
+    ArrayVector<typename PromoteTraits<TmpType, double>::Promote> buffer;
+    for(int k=0; k<N; ++k)
+    {
+        if(sigma[k] == 0.0 && order[k] == 0 && scale[k] == 1.0)
+            continue;
+        vigra_precondition(order[k] >= 0 && order[k] <= 2,
+            "recursiveGaussianMultiArray(): derivative order must be 0, 1, or 2.");
+
+        RecursiveGaussianCoefficients gauss(sigma[k] > 0.0 ? sigma[k] : 1.0);
+        const int w = tmp.shape(k), pad = sigma[k] > 0.0 ? gauss.margin : 0,
+                  period = 2*w - 2;
+        ArrayVector<int> index(w + 2*pad);
+        for(int p = 0; p < (int)index.size(); ++p)
+        {
+            int q = (p - pad) % period;
+            if(q < 0)
+                q += period;
+            index[p] = q < w ? q : period - q;
+        }
+
+        // filter panels of W neighboring lines at once, whose lanes are adjacent
+        // in memory unless k is axis 0
+        SrcShape outer(tmp.shape());
+        outer[k] = 1;
+        const int laneAxis = k > 0 ? 0 : N > 1 ? 1 : 0;
+        const int lanes = (int)outer[laneAxis];
+        outer[laneAxis] = 1;
+        const std::ptrdiff_t lineStride = tmp.stride(k), laneStride = tmp.stride(laneAxis);
+        MultiCoordinateIterator<N> i(outer), end = i.getEndIterator();
+        for(; i != end; ++i)
+        {
+            TmpType * lines = &tmp[*i];
+            int l = 0;
+            for(; l + W <= lanes; l += W)
+                recursiveGaussianLines<W>(lines + l*laneStride, lineStride, laneStride, w, index,
+                                          sigma[k] > 0.0 ? &gauss : 0,
+                                          (int)order[k], scale[k], buffer);
+            for(; l < lanes; ++l)
+                recursiveGaussianLines<1>(lines + l*laneStride, lineStride, laneStride, w, index,
+                                          sigma[k] > 0.0 ? &gauss : 0,
+                                          (int)order[k], scale[k], buffer);
+        }
+    }
+
+    copyMultiArray(tmp.traverser_begin() + (start - sstart), stop - start, TmpAccessor(), d, dest);
+}
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+inline void
+recursiveGaussianMultiArray(MultiArrayView<N, T1, S1> const & source,
+                            MultiArrayView<N, T2, S2> dest,
+                            TinyVector<double, int(N)> const & sigma,
+                            typename MultiArrayShape<N>::type const & order,
+                            TinyVector<double, int(N)> const & scale,
+                            typename MultiArrayShape<N>::type const & start = typename MultiArrayShape<N>::type(),
+                            typename MultiArrayShape<N>::type const & stop = typename MultiArrayShape<N>::type())
+{
+    recursiveGaussianMultiArray(source.traverser_begin(), source.shape(),
+                                typename AccessorTraits<T1>::default_const_accessor(),
+                                dest.traverser_begin(),
+                                typename AccessorTraits<T2>::default_accessor(),
+                                sigma, order, scale, start, stop);
+}
+
+    // Collect the effective scales and step sizes from the options.
+template <unsigned int N>
+void
+recursiveGaussianParameters(ConvolutionOptions<N> const & opt,
+                            TinyVector<double, int(N)> & sigma,
+                            TinyVector<double, int(N)> & step,
+                            const char * const function_name,
+                            bool allow_zero = false)
+{
+    typename ConvolutionOptions<N>::ScaleIterator params = opt.scaleParams();
+    for(unsigned int k = 0; k < N; ++k, ++params)
+    {
+        sigma[k] = params.sigma_scaled(function_name, allow_zero);
+        step[k] = params.step_size();
+    }
+}
+
+} // namespace detail
+
 /********************************************************/
 /*                                                      */
 /*             gaussianSmoothMultiArray                 */
@@ -1340,6 +1719,15 @@ gaussianSmoothMultiArray( SrcIterator s, SrcShape const & shape, SrcAccessor src
 {
     static const int N = SrcShape::static_size;
 
+    if(opt.use_recursive_filter)
+    {
+        TinyVector<double, N> sigma, step;
+        detail::recursiveGaussianParameters(opt, sigma, step, function_name, true);
+        detail::recursiveGaussianMultiArray(s, shape, src, d, dest, sigma, SrcShape(),
+                                            TinyVector<double, N>(1.0), opt.from_point, opt.to_point);
+        return;
+    }
+
     typename ConvolutionOptions<N>::ScaleIterator params = opt.scaleParams();
     ArrayVector<Kernel1D<double> > kernels(N);
 
@@ -1564,6 +1952,24 @@ gaussianGradientMultiArray(SrcIterator si, SrcShape const & shape, SrcAccessor s
     vigra_precondition(N == (int)dest.size(di),
         "gaussianGradientMultiArray(): Wrong number of channels in output array.");
 
+    typedef VectorElementAccessor<DestAccessor> ElementAccessor;
+
+    if(opt.use_recursive_filter)
+    {
+        TinyVector<double, N> sigma, step;
+        detail::recursiveGaussianParameters(opt, sigma, step, function_name);
+        for (int dim = 0; dim < N; ++dim)
+        {
+            SrcShape order;
+            order[dim] = 1;
+            TinyVector<double, N> scale(1.0);
+            scale[dim] = 1.0 / step[dim];
+            detail::recursiveGaussianMultiArray(si, shape, src, di, ElementAccessor(dim, dest),
+                                                sigma, order, scale, opt.from_point, opt.to_point);
+        }
+        return;
+    }
+
     ParamType params = opt.scaleParams();
     ParamType params2(params);
 
@@ -1574,8 +1980,6 @@ gaussianGradientMultiArray(SrcIterator si, SrcShape const & shape, SrcAccessor s
         plain_kernels[dim].initGaussian(sigma, 1.0, opt.window_ratio);
     }
 
-    typedef VectorElementAccessor<DestAccessor> ElementAccessor;
-
     // compute gradient components
     for (int dim = 0; dim < N; ++dim, ++params2)
     {
@@ -2085,6 +2489,39 @@ laplacianOfGaussianMultiArray(SrcIterator si, SrcShape const & shape, SrcAccesso
     static const int N = SrcShape::static_size;
     typedef typename ConvolutionOptions<N>::ScaleIterator ParamType;
 
+    SrcShape dshape(shape);
+    if(opt.to_point != SrcShape())
+        dshape = opt.to_point - opt.from_point;
+
+    MultiArray<N, KernelType> derivative(dshape);
+
+    if(opt.use_recursive_filter)
+    {
+        TinyVector<double, N> sigma, step;
+        detail::recursiveGaussianParameters(opt, sigma, step, "laplacianOfGaussianMultiArray");
+        for (int dim = 0; dim < N; ++dim)
+        {
+            SrcShape order;
+            order[dim] = 2;
+            TinyVector<double, N> scale(1.0);
+            scale[dim] = 1.0 / sq(step[dim]);
+            if (dim == 0)
+            {
+                detail::recursiveGaussianMultiArray(si, shape, src, di, dest,
+                                                    sigma, order, scale, opt.from_point, opt.to_point);
+            }
+            else
+            {
+                detail::recursiveGaussianMultiArray(si, shape, src,
+                                                    derivative.traverser_begin(), DerivativeAccessor(),
+                                                    sigma, order, scale, opt.from_point, opt.to_point);
+                combineTwoMultiArrays(di, dshape, dest, derivative.traverser_begin(), DerivativeAccessor(),
+                                      di, dest, Arg1() + Arg2() );
+            }
+        }
+        return;
+    }
+
     ParamType params = opt.scaleParams();
     ParamType params2(params);
 
@@ -2095,12 +2532,6 @@ laplacianOfGaussianMultiArray(SrcIterator si, SrcShape const & shape, SrcAccesso
         plain_kernels[dim].initGaussian(sigma, 1.0, opt.window_ratio);
     }
 
-    SrcShape dshape(shape);
-    if(opt.to_point != SrcShape())
-        dshape = opt.to_point - opt.from_point;
-
-    MultiArray<N, KernelType> derivative(dshape);
-
     // compute 2nd derivatives and sum them up
     for (int dim = 0; dim < N; ++dim, ++params2)
     {
@@ -2317,6 +2748,31 @@ gaussianDivergenceMultiArray(Iterator vectorField, Iterator vectorFieldEnd,
         "gaussianDivergenceMultiArray(): wrong number of input arrays.");
     // more checks are performed in separableConvolveMultiArray()
 
+    if(opt.use_recursive_filter)
+    {
+        typedef typename MultiArrayShape<N>::type Shape;
+        TinyVector<double, int(N)> sigma, step;
+        detail::recursiveGaussianParameters(opt, sigma, step, "gaussianDivergenceMultiArray");
+        MultiArray<N, TmpType> tmpDeriv(divergence.shape());
+        for(unsigned int k=0; k < N; ++k, ++vectorField)
+        {
+            Shape order;
+            order[k] = 1;
+            if(k == 0)
+            {
+                detail::recursiveGaussianMultiArray(*vectorField, divergence, sigma, order,
+                                                    TinyVector<double, int(N)>(1.0), opt.from_point, opt.to_point);
+            }
+            else
+            {
+                detail::recursiveGaussianMultiArray(*vectorField, tmpDeriv, sigma, order,
+                                                    TinyVector<double, int(N)>(1.0), opt.from_point, opt.to_point);
+                divergence += tmpDeriv;
+            }
+        }
+        return;
+    }
+
     typename ConvolutionOptions<N>::ScaleIterator params = opt.scaleParams();
     ArrayVector<double> sigmas(N);
     ArrayVector<Kernel> kernels(N);
@@ -2524,6 +2980,29 @@ hessianOfGaussianMultiArray(SrcIterator si, SrcShape const & shape, SrcAccessor
     vigra_precondition(M == (int)dest.size(di),
         "hessianOfGaussianMultiArray(): Wrong number of channels in output array.");
 
+    typedef VectorElementAccessor<DestAccessor> ElementAccessor;
+
+    if(opt.use_recursive_filter)
+    {
+        TinyVector<double, N> sigma, step;
+        detail::recursiveGaussianParameters(opt, sigma, step, "hessianOfGaussianMultiArray");
+        for (int b=0, i=0; i<N; ++i)
+        {
+            for (int j=i; j<N; ++j, ++b)
+            {
+                SrcShape order;
+                TinyVector<double, N> scale(1.0);
+                order[i] += 1;
+                order[j] += 1;
+                scale[i] /= step[i];
+                scale[j] /= step[j];
+                detail::recursiveGaussianMultiArray(si, shape, src, di, ElementAccessor(b, dest),
+                                                    sigma, order, scale, opt.from_point, opt.to_point);
+            }
+        }
+        return;
+    }
+
     ParamType params_init = opt.scaleParams();
 
     ArrayVector<Kernel1D<KernelType> > plain_kernels(N);
@@ -2534,8 +3013,6 @@ hessianOfGaussianMultiArray(SrcIterator si, SrcShape const & shape, SrcAccessor
         plain_kernels[dim].initGaussian(sigma, 1.0, opt.window_ratio);
     }
 
-    typedef VectorElementAccessor<DestAccessor> ElementAccessor;
-
     // compute elements of the Hessian matrix
     ParamType params_i(params_init);
     for (int b=0, i=0; i<N; ++i, ++params_i)
@@ -0,0 +1,522 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2026 by the VIGRA developers                 */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_MULTI_CONVOLUTION_SIMD_HXX
+#define VIGRA_MULTI_CONVOLUTION_SIMD_HXX
+
+#include <algorithm>
+#include <cstddef>
+#include "config.hxx"
+#include "array_vector.hxx"
+#include "accessor.hxx"
+#include "bordertreatment.hxx"
+#include "multi_iterator.hxx"
+#include "metaprogramming.hxx"
+#include "numerictraits.hxx"
+
+/* Vectorized inner loops for the separable convolution of multi-dimensional arrays.
+
+   Lines along an axis other than the contiguous one lie next to each other
+   in memory. The functions in this file therefore convolve a panel of
+   ConvolutionPanelWidth adjacent lines at once, such that each kernel tap
+   becomes a vector operation across the panel. The instruction set is chosen
+   at runtime: AVX if the CPU supports it (GCC and clang on x86 only),
+   SSE2 otherwise (always available on x86_64), and plain C++ on other
+   platforms. Define VIGRA_NO_SIMD to switch off the SIMD code entirely.
+*/
+
+#if !defined(VIGRA_NO_SIMD)
+#  if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define VIGRA_CONVOLUTION_SSE2 1
+#    include <emmintrin.h>
+#  endif
+#  if defined(VIGRA_CONVOLUTION_SSE2) && (defined(__x86_64__) || defined(__i386__)) && \
+      (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#    define VIGRA_CONVOLUTION_AVX 1
+#    define VIGRA_TARGET_AVX __attribute__((target("avx")))
+#    include <immintrin.h>
+#  endif
+#endif
+
+namespace vigra {
+
+namespace detail {
+
+enum { ConvolutionPanelWidth = 8 };
+
+enum ConvolutionSIMDLevel {
+    ConvolutionLineByLine = 0,  // don't use panels at all
+    ConvolutionPanelScalar = 1, // panels with plain C++ inner loops
+    ConvolutionPanelSSE2 = 2,
+    ConvolutionPanelAVX = 3
+};
+
+inline int detectConvolutionSIMDLevel()
+{
+#if defined(VIGRA_CONVOLUTION_AVX)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx"))
+        return ConvolutionPanelAVX;
+#endif
+#if defined(VIGRA_CONVOLUTION_SSE2)
+    return ConvolutionPanelSSE2;
+#else
+    return ConvolutionPanelScalar;
+#endif
+}
+
+    // The instruction set used by separableConvolveMultiArray(). It is initialized
+    // with the best level supported by the CPU. Setting it to ConvolutionLineByLine
+    // restores the original line-by-line algorithm (useful for testing and benchmarks).
+    // Higher levels than detected must not be set.
+inline int & convolutionSIMDLevel()
+{
+    static int level = detectConvolutionSIMDLevel();
+    return level;
+}
+
+/********************************************************/
+/*                                                      */
+/*                convolution panel kernels             */
+/*                                                      */
+/********************************************************/
+
+// Convolve 'lanes' adjacent lines at once with a kernel of 'size' taps.
+// 'in' holds the lines including the border, such that the value multiplied with
+// tap i for output position x of lane l is in[(x + i)*ConvolutionPanelWidth + l].
+// 'k' holds the taps in the order in which convolveLine() applies them (from
+// kernel.right() down to kernel.left()), so that the results are identical.
+// The results for positions start <= x < stop are written to
+// out[(x - start)*ConvolutionPanelWidth + l].
+template <class T>
+void
+convolvePanelScalar(T const * in, int lanes, int start, int stop,
+                    T const * k, int size, T * out)
+{
+    const int W = ConvolutionPanelWidth;
+    for(int x = start; x < stop; ++x)
+    {
+        T const * c = in + x*W;
+        T * o = out + (x - start)*W;
+        for(int l = 0; l < lanes; ++l)
+        {
+            T sum = k[0]*c[l];
+            for(int i = 1; i < size; ++i)
+                sum += k[i]*c[i*W + l];
+            o[l] = sum;
+        }
+    }
+}
+
+#if defined(VIGRA_CONVOLUTION_SSE2)
+
+struct SSE2Float
+{
+    typedef float value_type;
+    typedef __m128 type;
+    enum { size = 4 };
+    static type load(float const * p)       { return _mm_loadu_ps(p); }
+    static void store(float * p, type v)    { _mm_storeu_ps(p, v); }
+    static type set1(float v)               { return _mm_set1_ps(v); }
+    static type add(type a, type b)         { return _mm_add_ps(a, b); }
+    static type mul(type a, type b)         { return _mm_mul_ps(a, b); }
+};
+
+struct SSE2Double
+{
+    typedef double value_type;
+    typedef __m128d type;
+    enum { size = 2 };
+    static type load(double const * p)      { return _mm_loadu_pd(p); }
+    static void store(double * p, type v)   { _mm_storeu_pd(p, v); }
+    static type set1(double v)              { return _mm_set1_pd(v); }
+    static type add(type a, type b)         { return _mm_add_pd(a, b); }
+    static type mul(type a, type b)         { return _mm_mul_pd(a, b); }
+};
+
+// Same as convolvePanelScalar() for a full panel, using the vector type V.
+template <class V>
+void
+convolvePanelSSE2(typename V::value_type const * in, int start, int stop,
+                  typename V::value_type const * k, int size,
+                  typename V::value_type * out)
+{
+    typedef typename V::type Vec;
+    enum { W = ConvolutionPanelWidth, M = W / V::size };
+
+    for(int x = start; x < stop; ++x)
+    {
+        typename V::value_type const * c = in + x*W;
+        Vec sum[M];
+        Vec ki = V::set1(k[0]);
+        for(int m = 0; m < M; ++m)
+            sum[m] = V::mul(ki, V::load(c + m*V::size));
+        for(int i = 1; i < size; ++i)
+        {
+            ki = V::set1(k[i]);
+            for(int m = 0; m < M; ++m)
+                sum[m] = V::add(sum[m], V::mul(ki, V::load(c + i*W + m*V::size)));
+        }
+        for(int m = 0; m < M; ++m)
+            V::store(out + (x - start)*W + m*V::size, sum[m]);
+    }
+}
+
+#endif // VIGRA_CONVOLUTION_SSE2
+
+#if defined(VIGRA_CONVOLUTION_AVX)
+
+struct AVXFloat
+{
+    typedef float value_type;
+    typedef __m256 type;
+    enum { size = 8 };
+    VIGRA_TARGET_AVX static type load(float const * p)       { return _mm256_loadu_ps(p); }
+    VIGRA_TARGET_AVX static void store(float * p, type v)    { _mm256_storeu_ps(p, v); }
+    VIGRA_TARGET_AVX static type set1(float v)               { return _mm256_set1_ps(v); }
+    VIGRA_TARGET_AVX static type add(type a, type b)         { return _mm256_add_ps(a, b); }
+    VIGRA_TARGET_AVX static type mul(type a, type b)         { return _mm256_mul_ps(a, b); }
+};
+
+struct AVXDouble
+{
+    typedef double value_type;
+    typedef __m256d type;
+    enum { size = 4 };
+    VIGRA_TARGET_AVX static type load(double const * p)      { return _mm256_loadu_pd(p); }
+    VIGRA_TARGET_AVX static void store(double * p, type v)   { _mm256_storeu_pd(p, v); }
+    VIGRA_TARGET_AVX static type set1(double v)              { return _mm256_set1_pd(v); }
+    VIGRA_TARGET_AVX static type add(type a, type b)         { return _mm256_add_pd(a, b); }
+    VIGRA_TARGET_AVX static type mul(type a, type b)         { return _mm256_mul_pd(a, b); }
+};
+
+// Same as convolvePanelSSE2(), but compiled for AVX. This function must only
+// be called when detectConvolutionSIMDLevel() reported AVX support.
+template <class V>
+VIGRA_TARGET_AVX void
+convolvePanelAVX(typename V::value_type const * in, int start, int stop,
+                 typename V::value_type const * k, int size,
+                 typename V::value_type * out)
+{
+    typedef typename V::type Vec;
+    enum { W = ConvolutionPanelWidth, M = W / V::size };
+
+    for(int x = start; x < stop; ++x)
+    {
+        typename V::value_type const * c = in + x*W;
+        Vec sum[M];
+        Vec ki = V::set1(k[0]);
+        for(int m = 0; m < M; ++m)
+            sum[m] = V::mul(ki, V::load(c + m*V::size));
+        for(int i = 1; i < size; ++i)
+        {
+            ki = V::set1(k[i]);
+            for(int m = 0; m < M; ++m)
+                sum[m] = V::add(sum[m], V::mul(ki, V::load(c + i*W + m*V::size)));
+        }
+        for(int m = 0; m < M; ++m)
+            V::store(out + (x - start)*W + m*V::size, sum[m]);
+    }
+}
+
+#endif // VIGRA_CONVOLUTION_AVX
+
+template <class T>
+struct ConvolutionPanelTraits
+{
+    typedef VigraFalseType isSupported;
+};
+
+template <>
+struct ConvolutionPanelTraits<float>
+{
+    typedef VigraTrueType isSupported;
+#if defined(VIGRA_CONVOLUTION_SSE2)
+    typedef SSE2Float SSE2;
+#endif
+#if defined(VIGRA_CONVOLUTION_AVX)
+    typedef AVXFloat AVX;
+#endif
+};
+
+template <>
+struct ConvolutionPanelTraits<double>
+{
+    typedef VigraTrueType isSupported;
+#if defined(VIGRA_CONVOLUTION_SSE2)
+    typedef SSE2Double SSE2;
+#endif
+#if defined(VIGRA_CONVOLUTION_AVX)
+    typedef AVXDouble AVX;
+#endif
+};
+
+    // panels are used if both the array elements and the sums are float or double
+template <class T, class Kernel>
+struct ConvolutionPanelSupport
+{
+    typedef typename PromoteTraits<T, typename Kernel::value_type>::Promote SumType;
+    typedef typename And<typename ConvolutionPanelTraits<T>::isSupported,
+                         typename ConvolutionPanelTraits<SumType>::isSupported>::type type;
+};
+
+template <class T>
+void
+convolveFullPanel(T const * in, int start, int stop, T const * k, int size,
+                  T * out, int level)
+{
+    typedef ConvolutionPanelTraits<T> Traits;
+#if defined(VIGRA_CONVOLUTION_AVX)
+    if(level >= ConvolutionPanelAVX)
+    {
+        convolvePanelAVX<typename Traits::AVX>(in, start, stop, k, size, out);
+        return;
+    }
+#endif
+#if defined(VIGRA_CONVOLUTION_SSE2)
+    if(level >= ConvolutionPanelSSE2)
+    {
+        convolvePanelSSE2<typename Traits::SSE2>(in, start, stop, k, size, out);
+        return;
+    }
+#endif
+    ignore_argument(level);
+    convolvePanelScalar(in, (int)ConvolutionPanelWidth, start, stop, k, size, out);
+}
+
+/********************************************************/
+/*                                                      */
+/*                 convolveLinesInPanels                */
+/*                                                      */
+/********************************************************/
+
+// Map position p of a line of length w to the position whose value is used
+// according to the border treatment, or -1 if zero shall be used.
+inline int
+convolutionBorderIndex(int p, int w, BorderTreatmentMode border)
+{
+    if(p >= 0 && p < w)
+        return p;
+    switch(border)
+    {
+      case BORDER_TREATMENT_REFLECT:
+        return p < 0 ? -p : 2*w - 2 - p;
+      case BORDER_TREATMENT_REPEAT:
+        return p < 0 ? 0 : w - 1;
+      case BORDER_TREATMENT_WRAP:
+        return p < 0 ? p + w : p - w;
+      default:
+        return -1;
+    }
+}
+
+// Convolve all lines along 'axis' of the array at 'data' in place, writing
+// only positions start <= x < stop of each line. Returns false (and does nothing)
+// if the border treatment or the memory layout are not supported, so that the
+// caller must fall back to the line-by-line algorithm. Like convolveLine(),
+// the sums are computed in PromoteTraits<T, kernel value_type>::Promote.
+template <class T, class Shape, class Kernel>
+bool
+convolveLinesInPanelsImpl(T * data, Shape const & shape, Shape const & stride,
+                          int axis, Kernel const & kernel, int start, int stop,
+                          VigraTrueType /* supported element type */)
+{
+    typedef typename PromoteTraits<T, typename Kernel::value_type>::Promote SumType;
+    enum { N = Shape::static_size };
+    const int W = ConvolutionPanelWidth;
+    const int level = convolutionSIMDLevel();
+
+    if(level == ConvolutionLineByLine)
+        return false;
+
+    // the lanes of a panel must be adjacent in memory
+    int laneAxis = -1;
+    for(int k = 0; k < N; ++k)
+        if(k != axis && stride[k] == 1 && shape[k] > 1)
+            laneAxis = k;
+    if(laneAxis < 0)
+        return false;
+
+    const int kleft = kernel.left(), kright = kernel.right();
+    const int size = kright - kleft + 1;
+    const int w = shape[axis];
+    BorderTreatmentMode border = kernel.borderTreatment();
+    if(w <= std::max(kright, -kleft) ||
+       !(border == BORDER_TREATMENT_REFLECT || border == BORDER_TREATMENT_REPEAT ||
+         border == BORDER_TREATMENT_WRAP    || border == BORDER_TREATMENT_ZEROPAD))
+        return false;
+
+    ArrayVector<SumType> k(size);
+    for(int i = 0; i < size; ++i)
+        k[i] = kernel[kright - i];
+
+    const int panelLength = w + size - 1;
+    ArrayVector<int> borderIndex(panelLength);
+    for(int p = 0; p < panelLength; ++p)
+        borderIndex[p] = convolutionBorderIndex(p - kright, w, border);
+
+    ArrayVector<SumType> panel(panelLength*W), result((stop - start)*W);
+
+    // iterate over the first line of all panels
+    Shape outer(shape);
+    outer[axis] = 1;
+    outer[laneAxis] = 1;
+    const std::ptrdiff_t lineStride = stride[axis];
+    MultiCoordinateIterator<N> i(outer), end = i.getEndIterator();
+    for(; i != end; ++i)
+    {
+        T * base = data;
+        for(int k = 0; k < N; ++k)
+            base += (*i)[k]*stride[k];
+
+        for(int l0 = 0; l0 < shape[laneAxis]; l0 += W)
+        {
+            const int lanes = std::min<int>(W, shape[laneAxis] - l0);
+            T * lines = base + l0;
+
+            // copy the lines into the panel, because the convolution works in place
+            for(int p = 0; p < panelLength; ++p)
+            {
+                SumType * row = panel.begin() + p*W;
+                if(borderIndex[p] < 0)
+                {
+                    std::fill(row, row + W, SumType());
+                }
+                else
+                {
+                    T const * src = lines + borderIndex[p]*lineStride;
+                    std::copy(src, src + lanes, row);
+                    std::fill(row + lanes, row + W, SumType());
+                }
+            }
+
+            if(lanes == W)
+                convolveFullPanel(panel.begin(), start, stop, k.begin(), size,
+                                  result.begin(), level);
+            else
+                convolvePanelScalar(panel.begin(), lanes, start, stop, k.begin(), size,
+                                    result.begin());
+
+            for(int x = start; x < stop; ++x)
+            {
+                T * d = lines + x*lineStride;
+                SumType const * r = result.begin() + (x - start)*W;
+                for(int l = 0; l < lanes; ++l)
+                    d[l] = RequiresExplicitCast<T>::cast(r[l]);
+            }
+        }
+    }
+    return true;
+}
+
+template <class T, class Shape, class Kernel>
+inline bool
+convolveLinesInPanelsImpl(T *, Shape const &, Shape const &,
+                          int, Kernel const &, int, int,
+                          VigraFalseType /* unsupported element type */)
+{
+    return false;
+}
+
+// Determine the memory layout of a traverser.
+template <class Iterator, class Shape>
+Shape
+traverserStrides(Iterator i)
+{
+    Shape stride, unit;
+    for(int k = 0; k < Shape::static_size; ++k)
+    {
+        unit[k] = 1;
+        stride[k] = &i[unit] - &i[Shape()];
+        unit[k] = 0;
+    }
+    return stride;
+}
+
+// Convolve all lines along 'axis' of the array given by 'di' and 'shape' in panels
+// if possible (see convolveLinesInPanelsImpl()). The generic version doesn't support panels.
+template <class DestIterator, class Shape, class DestAccessor, class Kernel>
+inline bool
+convolveLinesInPanels(DestIterator, Shape const &, DestAccessor,
+                      int, Kernel const &, int, int)
+{
+    return false;
+}
+
+template <unsigned int N, class T, class Shape, class Kernel>
+inline bool
+convolveLinesInPanels(StridedMultiIterator<N, T, T &, T *> di, Shape const & shape,
+                      StandardValueAccessor<T>,
+                      int axis, Kernel const & kernel, int start, int stop)
+{
+    return convolveLinesInPanelsImpl(&di[Shape()], shape, traverserStrides<StridedMultiIterator<N, T, T &, T *>, Shape>(di),
+                                     axis, kernel, start, stop, typename ConvolutionPanelSupport<T, Kernel>::type());
+}
+
+template <unsigned int N, class T, class Shape, class Kernel>
+inline bool
+convolveLinesInPanels(StridedMultiIterator<N, T, T &, T *> di, Shape const & shape,
+                      StandardAccessor<T>,
+                      int axis, Kernel const & kernel, int start, int stop)
+{
+    return convolveLinesInPanelsImpl(&di[Shape()], shape, traverserStrides<StridedMultiIterator<N, T, T &, T *>, Shape>(di),
+                                     axis, kernel, start, stop, typename ConvolutionPanelSupport<T, Kernel>::type());
+}
+
+template <unsigned int N, class T, class Shape, class Kernel>
+inline bool
+convolveLinesInPanels(MultiIterator<N, T, T &, T *> di, Shape const & shape,
+                      StandardValueAccessor<T>,
+                      int axis, Kernel const & kernel, int start, int stop)
+{
+    return convolveLinesInPanelsImpl(&di[Shape()], shape, traverserStrides<MultiIterator<N, T, T &, T *>, Shape>(di),
+                                     axis, kernel, start, stop, typename ConvolutionPanelSupport<T, Kernel>::type());
+}
+
+template <unsigned int N, class T, class Shape, class Kernel>
+inline bool
+convolveLinesInPanels(MultiIterator<N, T, T &, T *> di, Shape const & shape,
+                      StandardAccessor<T>,
+                      int axis, Kernel const & kernel, int start, int stop)
+{
+    return convolveLinesInPanelsImpl(&di[Shape()], shape, traverserStrides<MultiIterator<N, T, T &, T *>, Shape>(di),
+                                     axis, kernel, start, stop, typename ConvolutionPanelSupport<T, Kernel>::type());
+}
+
+} // namespace detail
+
+} // namespace vigra
+
+#endif // VIGRA_MULTI_CONVOLUTION_SIMD_HXX
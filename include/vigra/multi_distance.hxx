@@ -47,6 +47,7 @@
 #include "metaprogramming.hxx"
 #include "multi_pointoperators.hxx"
 #include "functorexpression.hxx"
+#include "threadpool.hxx"
 
 #include "multi_gridgraph.hxx"     //for boundaryGraph & boundaryMultiDistance
 #include "union_find.hxx"        //for boundaryGraph & boundaryMultiDistance
@@ -76,10 +77,12 @@ struct DistParabolaStackEntry
 /*                                                      */
 /********************************************************/
 
+    // '_stack' is a workspace that can be reused for subsequent lines
 template <class SrcIterator, class SrcAccessor,
           class DestIterator, class DestAccessor >
 void distParabola(SrcIterator is, SrcIterator iend, SrcAccessor sa,
-                  DestIterator id, DestAccessor da, double sigma )
+                  DestIterator id, DestAccessor da, double sigma,
+                  std::vector<DistParabolaStackEntry<typename SrcAccessor::value_type> > & _stack)
 {
     // We assume that the data in the input is distance squared and treat it as such
     double w = iend - is;
@@ -91,7 +94,7 @@ void distParabola(SrcIterator is, SrcIterator iend, SrcAccessor sa,
 
     typedef typename SrcAccessor::value_type SrcType;
     typedef DistParabolaStackEntry<SrcType> Influence;
-    std::vector<Influence> _stack;
+    _stack.clear();
     _stack.push_back(Influence(sa(is), 0.0, 0.0, w));
 
     ++is;
@@ -135,6 +138,15 @@ void distParabola(SrcIterator is, SrcIterator iend, SrcAccessor sa,
     }
 }
 
+template <class SrcIterator, class SrcAccessor,
+          class DestIterator, class DestAccessor >
+inline void distParabola(SrcIterator is, SrcIterator iend, SrcAccessor sa,
+                         DestIterator id, DestAccessor da, double sigma )
+{
+    std::vector<DistParabolaStackEntry<typename SrcAccessor::value_type> > stack;
+    distParabola(is, iend, sa, id, da, sigma, stack);
+}
+
 template <class SrcIterator, class SrcAccessor,
           class DestIterator, class DestAccessor>
 inline void distParabola(triple<SrcIterator, SrcIterator, SrcAccessor> src,
@@ -216,6 +228,77 @@ void internalSeparableMultiArrayDistTmp(
     if(invert) transformMultiArray( di, shape, dest, di, dest, -Arg1());
 }
 
+/********************************************************/
+/*                                                      */
+/*              separableMultiDistParabola              */
+/*                                                      */
+/********************************************************/
+
+    // Apply distParabola() in-place to the lines [begin, end) along dimension 'd'
+    // of 'array' (lines are enumerated in scan order of the array's shape with
+    // extent 1 along 'd').
+template <unsigned int N, class T, class S>
+void distParabolaLines(MultiArrayView<N, T, S> array, unsigned int d, double sigma,
+                       MultiArrayIndex begin, MultiArrayIndex end)
+{
+    typedef typename NumericTraits<T>::RealPromote TmpType;
+    typedef typename MultiArrayShape<N>::type Shape;
+
+    Shape line_shape(array.shape());
+    line_shape[d] = 1;
+
+    ArrayVector<TmpType> tmp(array.shape(d));
+    std::vector<DistParabolaStackEntry<TmpType> > stack;
+
+    MultiCoordinateIterator<N> line(line_shape);
+    line += begin;
+    for(MultiArrayIndex k = begin; k < end; ++k, ++line)
+    {
+        MultiArrayView<1, T, StridedArrayTag> view(Shape1(array.shape(d)), Shape1(array.stride(d)),
+                                                   &array[*line]);
+        // first copy the line to temp for maximum cache efficiency
+        std::copy(view.begin(), view.end(), tmp.begin());
+        distParabola(tmp.begin(), tmp.end(), typename AccessorTraits<TmpType>::default_const_accessor(),
+                     view.begin(), typename AccessorTraits<T>::default_accessor(), sigma, stack);
+    }
+}
+
+    // Call 'f(begin, end)' for contiguous ranges of the lines along dimension 'd'
+    // of an array with the given shape (enumerated as in distParabolaLines()).
+    // The ranges are processed in parallel, so that scratch memory allocated
+    // by 'f' is reused for many lines.
+template <unsigned int N, class F>
+void parallelForEachLineRange(typename MultiArrayShape<N>::type const & shape, unsigned int d,
+                              ParallelOptions const & options, F f)
+{
+    if(prod(shape) == 0)
+        return;
+    MultiArrayIndex line_count = prod(shape) / shape[d],
+                    tasks      = std::min<MultiArrayIndex>(line_count, 8*options.getActualNumThreads()),
+                    lines      = (line_count + tasks - 1) / tasks;
+    parallel_foreach(options, tasks,
+        [&](int /*thread*/, MultiArrayIndex task)
+        {
+            f(task*lines, std::min(line_count, (task+1)*lines));
+        });
+}
+
+    // Apply distParabola() in-place along all dimensions of 'array'. The lines
+    // of each dimension are distributed over the threads in contiguous ranges.
+template <unsigned int N, class T, class S, class Array>
+void separableMultiDistParabola(MultiArrayView<N, T, S> array, Array const & sigmas,
+                                ParallelOptions const & options)
+{
+    for(unsigned int d = 0; d < N; ++d)
+    {
+        parallelForEachLineRange<N>(array.shape(), d, options,
+            [&](MultiArrayIndex begin, MultiArrayIndex end)
+            {
+                distParabolaLines(array, d, sigmas[d], begin, end);
+            });
+    }
+}
+
 template <class SrcIterator, class SrcShape, class SrcAccessor,
           class DestIterator, class DestAccessor, class Array>
 inline void internalSeparableMultiArrayDistTmp( SrcIterator si, SrcShape const & shape, SrcAccessor src,
@@ -233,6 +316,132 @@ inline void internalSeparableMultiArrayDistTmp( SrcIterator si, SrcShape const &
     internalSeparableMultiArrayDistTmp( si, shape, src, di, dest, sigmas, false );
 }
 
+    // Compute the largest possible squared distance 'dmax' in an array of the given shape.
+    // Returns true if 'DestType' cannot represent it or the pixel pitch is not integer,
+    // so that the distances must be computed in a temporary array of real type.
+template <class DestType, class Shape, class Array>
+bool distSquaredNeedsTmp(Shape const & shape, Array const & pixelPitch, double & dmax)
+{
+    dmax = 0.0;
+    bool pixelPitchIsReal = false;
+    for(int k=0; k<(int)shape.size(); ++k)
+    {
+        if(int(pixelPitch[k]) != pixelPitch[k])
+            pixelPitchIsReal = true;
+        dmax += sq(pixelPitch[k]*shape[k]);
+    }
+    return dmax > NumericTraits<DestType>::toRealPromote(NumericTraits<DestType>::max())
+           || pixelPitchIsReal;
+}
+
+    // Threshold the source so that all object points start at the largest possible
+    // squared distance and the background at zero, and let 'parabola' compute the
+    // distances in-place. This happens in a temporary array 'tmp' (passed as 'parabola(tmp)')
+    // if the destination might overflow or the pixel pitch is not integer, and
+    // directly in the destination ('parabola(d, shape, dest)') otherwise.
+template <class SrcIterator, class SrcShape, class SrcAccessor,
+          class DestIterator, class DestAccessor, class Array, class Parabola>
+void separableMultiDistSquaredImpl(SrcIterator s, SrcShape const & shape, SrcAccessor src,
+                                   DestIterator d, DestAccessor dest, bool background,
+                                   Array const & pixelPitch, Parabola const & parabola)
+{
+    typedef typename SrcAccessor::value_type SrcType;
+    typedef typename DestAccessor::value_type DestType;
+    typedef typename NumericTraits<DestType>::RealPromote Real;
+
+    SrcType zero = NumericTraits<SrcType>::zero();
+
+    double dmax = 0.0;
+
+    using namespace vigra::functor;
+
+    if(distSquaredNeedsTmp<DestType>(shape, pixelPitch, dmax)) // need a temporary array to avoid overflows
+    {
+        // Threshold the values so all objects have infinity value in the beginning
+        Real maxDist = (Real)dmax, rzero = (Real)0.0;
+        MultiArray<SrcShape::static_size, Real> tmpArray(shape);
+        if(background == true)
+            transformMultiArray( s, shape, src,
+                                 tmpArray.traverser_begin(), typename AccessorTraits<Real>::default_accessor(),
+                                 ifThenElse( Arg1() == Param(zero), Param(maxDist), Param(rzero) ));
+        else
+            transformMultiArray( s, shape, src,
+                                 tmpArray.traverser_begin(), typename AccessorTraits<Real>::default_accessor(),
+                                 ifThenElse( Arg1() != Param(zero), Param(maxDist), Param(rzero) ));
+
+        parabola(tmpArray);
+
+        copyMultiArray(srcMultiArrayRange(tmpArray), destIter(d, dest));
+    }
+    else        // work directly on the destination array
+    {
+        // Threshold the values so all objects have infinity value in the beginning
+        DestType maxDist = DestType(std::ceil(dmax)), rzero = (DestType)0;
+        if(background == true)
+            transformMultiArray( s, shape, src, d, dest,
+                                 ifThenElse( Arg1() == Param(zero), Param(maxDist), Param(rzero) ));
+        else
+            transformMultiArray( s, shape, src, d, dest,
+                                 ifThenElse( Arg1() != Param(zero), Param(maxDist), Param(rzero) ));
+
+        parabola(d, shape, dest);
+    }
+}
+
+    // compute the distances with internalSeparableMultiArrayDistTmp()
+template <class Array>
+struct SerialDistParabola
+{
+    SerialDistParabola(Array const & pixelPitch)
+    : pixelPitch_(pixelPitch)
+    {}
+
+    template <unsigned int N, class T>
+    void operator()(MultiArray<N, T> & array) const
+    {
+        typename AccessorTraits<T>::default_accessor acc;
+        internalSeparableMultiArrayDistTmp(array.traverser_begin(), array.shape(), acc,
+                                           array.traverser_begin(), acc, pixelPitch_);
+    }
+
+    template <class Iterator, class Shape, class Accessor>
+    void operator()(Iterator i, Shape const & shape, Accessor a) const
+    {
+        internalSeparableMultiArrayDistTmp(i, shape, a, i, a, pixelPitch_);
+    }
+
+    Array const & pixelPitch_;
+};
+
+    // compute the distances with separableMultiDistParabola(); 'dest' is the
+    // view behind the destination iterator passed to separableMultiDistSquaredImpl()
+template <unsigned int N, class T, class S, class Array>
+struct ParallelDistParabola
+{
+    ParallelDistParabola(MultiArrayView<N, T, S> const & dest, Array const & pixelPitch,
+                         ParallelOptions const & options)
+    : dest_(dest),
+      pixelPitch_(pixelPitch),
+      options_(options)
+    {}
+
+    template <class U>
+    void operator()(MultiArray<N, U> & array) const
+    {
+        separableMultiDistParabola(array, pixelPitch_, options_);
+    }
+
+    template <class Iterator, class Shape, class Accessor>
+    void operator()(Iterator, Shape const &, Accessor) const
+    {
+        separableMultiDistParabola(dest_, pixelPitch_, options_);
+    }
+
+    MultiArrayView<N, T, S> dest_;
+    Array const & pixelPitch_;
+    ParallelOptions const & options_;
+};
+
 } // namespace detail
 
 /** \addtogroup DistanceTransform
@@ -272,6 +481,25 @@ inline void internalSeparableMultiArrayDistTmp( SrcIterator si, SrcShape const &
         separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
                                   MultiArrayView<N, T2, S2> dest,
                                   bool background);
+
+        // process the lines of each dimension in parallel
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2,
+                  class Array>
+        void
+        separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
+                                  MultiArrayView<N, T2, S2> dest,
+                                  bool background,
+                                  Array const & pixelPitch,
+                                  ParallelOptions const & options);
+
+        template <unsigned int N, class T1, class S1,
+                                  class T2, class S2>
+        void
+        separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
+                                  MultiArrayView<N, T2, S2> dest,
+                                  bool background,
+                                  ParallelOptions const & options);
     }
     \endcode
 
@@ -343,6 +571,12 @@ inline void internalSeparableMultiArrayDistTmp( SrcIterator si, SrcShape const &
     <tt> NumericTraits<typename DestAccessor::value_type>::max() < N * M*M</tt>, where M is the
     size of the largest dimension of the array.
 
+    When \ref ParallelOptions are passed, the lines along each dimension are distributed
+    over the requested number of threads (the dimensions themselves must still be
+    processed one after the other). The result is identical to the sequential version.
+    See \ref separableMultiDistSquaredBlockwise() for a variant that works on
+    \ref ChunkedArray "ChunkedArrays" with bounded memory.
+
     <b> Usage:</b>
 
     <b>\#include</b> \<vigra/multi_distance.hxx\><br/>
@@ -356,6 +590,9 @@ inline void internalSeparableMultiArrayDistTmp( SrcIterator si, SrcShape const &
 
     // Calculate Euclidean distance squared for all background pixels
     separableMultiDistSquared(source, dest, true);
+
+    // the same, using 8 threads
+    separableMultiDistSquared(source, dest, true, ParallelOptions().numThreads(8));
     \endcode
 
     \see vigra::distanceTransform(), vigra::separableMultiDistance()
@@ -368,60 +605,8 @@ void separableMultiDistSquared( SrcIterator s, SrcShape const & shape, SrcAccess
                                 DestIterator d, DestAccessor dest, bool background,
                                 Array const & pixelPitch)
 {
-    int N = shape.size();
-
-    typedef typename SrcAccessor::value_type SrcType;
-    typedef typename DestAccessor::value_type DestType;
-    typedef typename NumericTraits<DestType>::RealPromote Real;
-
-    SrcType zero = NumericTraits<SrcType>::zero();
-
-    double dmax = 0.0;
-    bool pixelPitchIsReal = false;
-    for( int k=0; k<N; ++k)
-    {
-        if(int(pixelPitch[k]) != pixelPitch[k])
-            pixelPitchIsReal = true;
-        dmax += sq(pixelPitch[k]*shape[k]);
-    }
-
-    using namespace vigra::functor;
-
-    if(dmax > NumericTraits<DestType>::toRealPromote(NumericTraits<DestType>::max())
-       || pixelPitchIsReal) // need a temporary array to avoid overflows
-    {
-        // Threshold the values so all objects have infinity value in the beginning
-        Real maxDist = (Real)dmax, rzero = (Real)0.0;
-        MultiArray<SrcShape::static_size, Real> tmpArray(shape);
-        if(background == true)
-            transformMultiArray( s, shape, src,
-                                 tmpArray.traverser_begin(), typename AccessorTraits<Real>::default_accessor(),
-                                 ifThenElse( Arg1() == Param(zero), Param(maxDist), Param(rzero) ));
-        else
-            transformMultiArray( s, shape, src,
-                                 tmpArray.traverser_begin(), typename AccessorTraits<Real>::default_accessor(),
-                                 ifThenElse( Arg1() != Param(zero), Param(maxDist), Param(rzero) ));
-
-        detail::internalSeparableMultiArrayDistTmp( tmpArray.traverser_begin(),
-                shape, typename AccessorTraits<Real>::default_accessor(),
-                tmpArray.traverser_begin(),
-                typename AccessorTraits<Real>::default_accessor(), pixelPitch);
-
-        copyMultiArray(srcMultiArrayRange(tmpArray), destIter(d, dest));
-    }
-    else        // work directly on the destination array
-    {
-        // Threshold the values so all objects have infinity value in the beginning
-        DestType maxDist = DestType(std::ceil(dmax)), rzero = (DestType)0;
-        if(background == true)
-            transformMultiArray( s, shape, src, d, dest,
-                                 ifThenElse( Arg1() == Param(zero), Param(maxDist), Param(rzero) ));
-        else
-            transformMultiArray( s, shape, src, d, dest,
-                                 ifThenElse( Arg1() != Param(zero), Param(maxDist), Param(rzero) ));
-
-        detail::internalSeparableMultiArrayDistTmp( d, shape, dest, d, dest, pixelPitch);
-    }
+    detail::separableMultiDistSquaredImpl(s, shape, src, d, dest, background, pixelPitch,
+                                          detail::SerialDistParabola<Array>(pixelPitch));
 }
 
 template <class SrcIterator, class SrcShape, class SrcAccessor,
@@ -479,6 +664,35 @@ separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
                                destMultiArray(dest), background );
 }
 
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2,
+          class Array>
+inline void
+separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
+                          MultiArrayView<N, T2, S2> dest, bool background,
+                          Array const & pixelPitch, ParallelOptions const & options)
+{
+    vigra_precondition(source.shape() == dest.shape(),
+        "separableMultiDistSquared(): shape mismatch between input and output.");
+    detail::separableMultiDistSquaredImpl(source.traverser_begin(), source.shape(),
+                                          typename AccessorTraits<T1>::default_const_accessor(),
+                                          dest.traverser_begin(),
+                                          typename AccessorTraits<T2>::default_accessor(),
+                                          background, pixelPitch,
+                                          detail::ParallelDistParabola<N, T2, S2, Array>(dest, pixelPitch, options));
+}
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+inline void
+separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
+                          MultiArrayView<N, T2, S2> dest, bool background,
+                          ParallelOptions const & options)
+{
+    ArrayVector<double> pixelPitch(N, 1.0);
+    separableMultiDistSquared(source, dest, background, pixelPitch, options);
+}
+
 /********************************************************/
 /*                                                      */
 /*             separableMultiDistance                   */
@@ -508,6 +722,24 @@ separableMultiDistSquared(MultiArrayView<N, T1, S1> const & source,
         separableMultiDistance(MultiArrayView<N, T1, S1> const & source,
                                MultiArrayView<N, T2, S2> dest,
                                bool background);
+
+        // process the lines of each dimension in parallel
+        template <unsigned int N, class T1, class S1,
+                  class T2, class S2, class Array>
+        void
+        separableMultiDistance(MultiArrayView<N, T1, S1> const & source,
+                               MultiArrayView<N, T2, S2> dest,
+                               bool background,
+                               Array const & pixelPitch,
+                               ParallelOptions const & options);
+
+        template <unsigned int N, class T1, class S1,
+                  class T2, class S2>
+        void
+        separableMultiDistance(MultiArrayView<N, T1, S1> const & source,
+                               MultiArrayView<N, T2, S2> dest,
+                               bool background,
+                               ParallelOptions const & options);
     }
     \endcode
 
@@ -655,6 +887,37 @@ separableMultiDistance(MultiArrayView<N, T1, S1> const & source,
                             destMultiArray(dest), background );
 }
 
+template <unsigned int N, class T1, class S1,
+          class T2, class S2, class Array>
+inline void
+separableMultiDistance(MultiArrayView<N, T1, S1> const & source,
+                       MultiArrayView<N, T2, S2> dest,
+                       bool background,
+                       Array const & pixelPitch,
+                       ParallelOptions const & options)
+{
+    vigra_precondition(source.shape() == dest.shape(),
+        "separableMultiDistance(): shape mismatch between input and output.");
+    separableMultiDistSquared(source, dest, background, pixelPitch, options);
+
+    // Finally, calculate the square root of the distances
+    using namespace vigra::functor;
+
+    transformMultiArray(dest, dest, sqrt(Arg1()));
+}
+
+template <unsigned int N, class T1, class S1,
+          class T2, class S2>
+inline void
+separableMultiDistance(MultiArrayView<N, T1, S1> const & source,
+                       MultiArrayView<N, T2, S2> dest,
+                       bool background,
+                       ParallelOptions const & options)
+{
+    ArrayVector<double> pixelPitch(N, 1.0);
+    separableMultiDistance(source, dest, background, pixelPitch, options);
+}
+
 //%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%% BoundaryDistanceTransform %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 
 //rewrite labeled data and work with separableMultiDist
@@ -716,12 +979,14 @@ namespace detail
 /*                                                      */
 /********************************************************/
 
+    // '_stack' is a workspace that can be reused for subsequent lines
 template <class DestIterator, class LabelIterator>
 void
 boundaryDistParabola(DestIterator is, DestIterator iend,
                      LabelIterator ilabels,
                      double dmax,
-                     bool array_border_is_active=false)
+                     bool array_border_is_active,
+                     std::vector<DistParabolaStackEntry<typename DestIterator::value_type> > & _stack)
 {
     // We assume that the data in the input is distance squared and treat it as such
     double w = iend - is;
@@ -737,7 +1002,8 @@ boundaryDistParabola(DestIterator is, DestIterator iend,
     double apex_height = array_border_is_active
                              ? 0.0
                              : dmax;
-    Stack _stack(1, Influence(apex_height, 0.0, -1.0, w));
+    _stack.clear();
+    _stack.push_back(Influence(apex_height, 0.0, -1.0, w));
     LabelType current_label = *ilabels;
     for(double begin = 0.0, current = 0.0; current <= w; ++ilabels, ++is, ++current)
     {
@@ -786,13 +1052,25 @@ boundaryDistParabola(DestIterator is, DestIterator iend,
             begin = current;
             current_label = *ilabels;
             apex_height = *is;
-            Stack(1, Influence(0.0, begin-1.0, begin-1.0, w)).swap(_stack);
+            _stack.clear();
+            _stack.push_back(Influence(0.0, begin-1.0, begin-1.0, w));
             // don't advance to next pixel here, because the present pixel must also
             // be analysed in the context of the new segment
         }
     }
 }
 
+template <class DestIterator, class LabelIterator>
+inline void
+boundaryDistParabola(DestIterator is, DestIterator iend,
+                     LabelIterator ilabels,
+                     double dmax,
+                     bool array_border_is_active=false)
+{
+    std::vector<DistParabolaStackEntry<typename DestIterator::value_type> > stack;
+    boundaryDistParabola(is, iend, ilabels, dmax, array_border_is_active, stack);
+}
+
 /********************************************************/
 /*                                                      */
 /*           internalBoundaryMultiArrayDist             */
@@ -805,25 +1083,33 @@ void
 internalBoundaryMultiArrayDist(
                       MultiArrayView<N, T1, S1> const & labels,
                       MultiArrayView<N, T2, S2> dest,
-                      double dmax, bool array_border_is_active=false)
+                      double dmax, bool array_border_is_active,
+                      ParallelOptions const & options)
 {
-    typedef typename MultiArrayView<N, T1, S1>::const_traverser LabelIterator;
-    typedef typename MultiArrayView<N, T2, S2>::traverser DestIterator;
-    typedef MultiArrayNavigator<LabelIterator, N> LabelNavigator;
-    typedef MultiArrayNavigator<DestIterator, N> DNavigator;
+    typedef typename MultiArrayShape<N>::type Shape;
+    typedef StridedMultiIterator<1, T1, T1 const &, T1 const *> LabelIterator;
+    typedef StridedMultiIterator<1, T2, T2 &, T2 *> DestIterator;
 
     dest = dmax;
     for( unsigned d = 0; d < N; ++d )
     {
-        LabelNavigator lnav( labels.traverser_begin(), labels.shape(), d );
-        DNavigator dnav( dest.traverser_begin(), dest.shape(), d );
-
-        for( ; dnav.hasMore(); dnav++, lnav++ )
-        {
-            boundaryDistParabola(dnav.begin(), dnav.end(),
-                                 lnav.begin(),
-                                 dmax, array_border_is_active);
-        }
+        parallelForEachLineRange<N>(labels.shape(), d, options,
+            [&](MultiArrayIndex begin, MultiArrayIndex end)
+            {
+                Shape line_shape(labels.shape());
+                line_shape[d] = 1;
+                std::vector<DistParabolaStackEntry<T2> > stack;
+
+                MultiCoordinateIterator<N> line(line_shape);
+                line += begin;
+                for(MultiArrayIndex k = begin; k < end; ++k, ++line)
+                {
+                    DestIterator is(&dest[*line], dest.stride().begin() + d, dest.shape().begin() + d);
+                    LabelIterator il(&labels[*line], labels.stride().begin() + d, labels.shape().begin() + d);
+                    boundaryDistParabola(is, is + dest.shape(d), il,
+                                         dmax, array_border_is_active, stack);
+                }
+            });
     }
 }
 
@@ -859,6 +1145,16 @@ enum BoundaryDistanceTag {
                               MultiArrayView<N, T2, S2> dest,
                               bool array_border_is_active=false,
                               BoundaryDistanceTag boundary=InterpixelBoundary);
+
+        // process the lines of each dimension in parallel
+        template <unsigned int N, class T1, class S1,
+                  class T2, class S2>
+        void
+        boundaryMultiDistance(MultiArrayView<N, T1, S1> const & labels,
+                              MultiArrayView<N, T2, S2> dest,
+                              bool array_border_is_active,
+                              BoundaryDistanceTag boundary,
+                              ParallelOptions const & options);
     }
     \endcode
 
@@ -880,6 +1176,9 @@ enum BoundaryDistanceTag {
     and the infinite region) is also used. Otherwise (the default), regions
     touching the array border are treated as if they extended to infinity.
 
+    When \ref ParallelOptions are passed, the lines along each dimension are distributed
+    over the requested number of threads. The result is identical to the sequential version.
+
     <b> Usage:</b>
 
     <b>\#include</b> \<vigra/multi_distance.hxx\><br/>
@@ -897,6 +1196,9 @@ enum BoundaryDistanceTag {
 
     // Calculate Euclidean distance to interpixel boundary for all pixels
     boundaryMultiDistance(labels, dest);
+
+    // the same using 8 threads
+    boundaryMultiDistance(labels, dest, false, InterpixelBoundary, ParallelOptions().numThreads(8));
     \endcode
 
     \see vigra::distanceTransform(), vigra::separableMultiDistance()
@@ -908,8 +1210,9 @@ template <unsigned int N, class T1, class S1,
 void
 boundaryMultiDistance(MultiArrayView<N, T1, S1> const & labels,
                       MultiArrayView<N, T2, S2> dest,
-                      bool array_border_is_active=false,
-                      BoundaryDistanceTag boundary=InterpixelBoundary)
+                      bool array_border_is_active,
+                      BoundaryDistanceTag boundary,
+                      ParallelOptions const & options)
 {
     vigra_precondition(labels.shape() == dest.shape(),
         "boundaryMultiDistance(): shape mismatch between input and output.");
@@ -923,7 +1226,7 @@ boundaryMultiDistance(MultiArrayView<N, T1, S1> const & labels,
         markRegionBoundaries(labels, boundaries, IndirectNeighborhood);
         if(array_border_is_active)
             initMultiArrayBorder(boundaries, 1, 1);
-        separableMultiDistance(boundaries, dest, true);
+        separableMultiDistance(boundaries, dest, true, options);
     }
     else
     {
@@ -942,18 +1245,30 @@ boundaryMultiDistance(MultiArrayView<N, T1, S1> const & labels,
             typedef typename NumericTraits<T2>::RealPromote Real;
             MultiArray<N, Real> tmpArray(labels.shape());
             detail::internalBoundaryMultiArrayDist(labels, tmpArray,
-                                                      dmax, array_border_is_active);
+                                                   dmax, array_border_is_active, options);
             transformMultiArray(tmpArray, dest, sqrt(Arg1()) - Param(offset) );
         }
         else
         {
             // can work directly on the destination array
-            detail::internalBoundaryMultiArrayDist(labels, dest, dmax, array_border_is_active);
+            detail::internalBoundaryMultiArrayDist(labels, dest, dmax, array_border_is_active, options);
             transformMultiArray(dest, dest, sqrt(Arg1()) - Param(offset) );
         }
     }
 }
 
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+inline void
+boundaryMultiDistance(MultiArrayView<N, T1, S1> const & labels,
+                      MultiArrayView<N, T2, S2> dest,
+                      bool array_border_is_active=false,
+                      BoundaryDistanceTag boundary=InterpixelBoundary)
+{
+    boundaryMultiDistance(labels, dest, array_border_is_active, boundary,
+                          ParallelOptions().numThreads(ParallelOptions::NoThreads));
+}
+
 //@}
 
 } //-- namespace vigra
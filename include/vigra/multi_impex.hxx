@@ -50,6 +50,7 @@
 #include "multi_array.hxx"
 #include "multi_pointoperators.hxx"
 #include "sifImport.hxx"
+#include "threadpool.hxx"
 
 #ifdef _MSC_VER
 # include <direct.h>
@@ -225,6 +226,10 @@ class VolumeImportInfo
     template <class T, class Stride>
     void importImpl(MultiArrayView <3, T, Stride> &volume) const;
 
+    template <class T, class Stride>
+    void importImpl(MultiArrayView <3, T, Stride> &volume,
+                    ParallelOptions const & options) const;
+
   protected:
     void getVolumeInfoFromFirstSlice(const std::string &filename);
 
@@ -487,7 +492,14 @@ readVolumeImpl(DestIterator d, Shape const & shape, std::ifstream & s, ArrayVect
 } // namespace detail
 
 template <class T, class Stride>
-void VolumeImportInfo::importImpl(MultiArrayView <3, T, Stride> &volume) const
+inline void VolumeImportInfo::importImpl(MultiArrayView <3, T, Stride> &volume) const
+{
+    importImpl(volume, ParallelOptions().numThreads(ParallelOptions::NoThreads));
+}
+
+template <class T, class Stride>
+void VolumeImportInfo::importImpl(MultiArrayView <3, T, Stride> &volume,
+                                  ParallelOptions const & options) const
 {
     vigra_precondition(this->shape() == volume.shape(), "importVolume(): Output array must be shaped according to VolumeImportInfo.");
 
@@ -542,31 +554,33 @@ void VolumeImportInfo::importImpl(MultiArrayView <3, T, Stride> &volume) const
     }
     else if(fileType_ == "STACK")
     {
-        for (unsigned int i = 0; i < numbers_.size(); ++i)
-        {
-            // build the filename
-            std::string filename = baseName_ + numbers_[i] + extension_;
-
-            // import the image
-            ImageImportInfo info (filename.c_str ());
-
-            // generate a basic image view to the current layer
-            MultiArrayView <2, T, Stride> view (volume.bindOuter (i));
-            vigra_precondition(view.shape() == info.shape(),
-                "importVolume(): the images have inconsistent sizes.");
-
-            importImage (info, destImage(view));
-        }
+        // each slice is decoded by its own decoder straight into its layer of the volume
+        parallel_foreach(options, numbers_.size(),
+            [&](int /* thread_id */, MultiArrayIndex i)
+            {
+                // build the filename
+                std::string filename = baseName_ + numbers_[i] + extension_;
+
+                // import the image
+                ImageImportInfo info (filename.c_str ());
+
+                // generate a basic image view to the current layer
+                MultiArrayView <2, T, Stride> view (volume.bindOuter (i));
+                vigra_precondition(view.shape() == info.shape(),
+                    "importVolume(): the images have inconsistent sizes.");
+
+                importImage (info, destImage(view));
+            });
     }
     else if(fileType_ == "MULTIPAGE")
     {
-        ImageImportInfo info(baseName_.c_str());
-
-        for(int k=0; k<info.numImages(); ++k)
-        {
-            info.setImageIndex(k);
-            importImage(info, volume.bindOuter(k));
-        }
+        // every task opens the file separately and seeks to its own page
+        parallel_foreach(options, shape_[2],
+            [&](int /* thread_id */, MultiArrayIndex k)
+            {
+                ImageImportInfo info(baseName_.c_str(), (unsigned int)k);
+                importImage(info, volume.bindOuter(k));
+            });
     }
     // else if(fileType_ == "HDF5")
     // {
@@ -615,6 +629,26 @@ VIGRA_EXPORT void findImageSequence(const std::string &name_base,
         importVolume(MultiArray <3, T, Allocator> & volume,
                      const std::string &name_base,
                      const std::string &name_ext);
+
+        // variants 1 to 3 with parallel decoding of the slices
+        template <class T, class Stride>
+        void
+        importVolume(VolumeImportInfo const & info,
+                     MultiArrayView <3, T, Stride> &volume,
+                     ParallelOptions const & options);
+
+        template <class T, class Allocator>
+        void
+        importVolume(MultiArray <3, T, Allocator> & volume,
+                     const std::string &filename,
+                     ParallelOptions const & options);
+
+        template <class T, class Allocator>
+        void
+        importVolume(MultiArray <3, T, Allocator> & volume,
+                     const std::string &name_base,
+                     const std::string &name_ext,
+                     ParallelOptions const & options);
     }
     \endcode
 
@@ -661,9 +695,29 @@ VIGRA_EXPORT void findImageSequence(const std::string &name_base,
     will be interpreted according to their numerical order (i.e. "009", "010", "011"
     are read in the same order as "9", "10", "11"). The number of images
     found determines the depth of the volume.
+
+    When \ref ParallelOptions are passed, the slices of an image stack or the pages of a
+    multi-page TIFF file are decoded concurrently, each by its own decoder directly into
+    the corresponding slice of the destination array. Without options, the slices are
+    read one after another.
+    \code
+    // read a stack of 2D tiff-images using 8 threads
+    VolumeImportInfo info("my_data", ".tif");
+    MultiArray<3, UInt16> volume(info.shape());
+    importVolume(info, volume, ParallelOptions().numThreads(8));
+    \endcode
 */
 doxygen_overloaded_function(template <...> void importVolume)
 
+template <class T, class Stride>
+void
+importVolume(VolumeImportInfo const & info,
+             MultiArrayView <3, T, Stride> &volume,
+             ParallelOptions const & options)
+{
+    info.importImpl(volume, options);
+}
+
 template <class T, class Stride>
 void
 importVolume(VolumeImportInfo const & info,
@@ -672,6 +726,18 @@ importVolume(VolumeImportInfo const & info,
     info.importImpl(volume);
 }
 
+template <class T, class Allocator>
+void
+importVolume(MultiArray <3, T, Allocator> &volume,
+             const std::string &filename,
+             ParallelOptions const & options)
+{
+    VolumeImportInfo info(filename);
+    volume.reshape(info.shape());
+
+    info.importImpl(volume, options);
+}
+
 template <class T, class Allocator>
 void
 importVolume(MultiArray <3, T, Allocator> &volume,
@@ -694,6 +760,18 @@ void importVolume (MultiArray <3, T, Allocator> & volume,
     info.importImpl(volume);
 }
 
+template <class T, class Allocator>
+void importVolume (MultiArray <3, T, Allocator> & volume,
+                   const std::string &name_base,
+                   const std::string &name_ext,
+                   ParallelOptions const & options)
+{
+    VolumeImportInfo info(name_base, name_ext);
+    volume.reshape(info.shape());
+
+    info.importImpl(volume, options);
+}
+
 namespace detail {
 
 template <class T>
@@ -796,6 +874,26 @@ void setRangeMapping(MultiArrayView <3, T, Tag> const & volume,
         exportVolume (MultiArrayView <3, T, Tag> const & volume,
                       const std::string &name_base,
                       const std::string &name_ext);
+
+        // variants 1 to 3 with parallel encoding of the slices
+        template <class T, class Tag>
+        void
+        exportVolume (MultiArrayView <3, T, Tag> const & volume,
+                      const VolumeExportInfo & info,
+                      ParallelOptions const & options);
+
+        template <class T, class Tag>
+        void
+        exportVolume (MultiArrayView <3, T, Tag> const & volume,
+                      const std::string &filename,
+                      ParallelOptions const & options);
+
+        template <class T, class Tag>
+        void
+        exportVolume (MultiArrayView <3, T, Tag> const & volume,
+                      const std::string &name_base,
+                      const std::string &name_ext,
+                      ParallelOptions const & options);
     }
     \endcode
 
@@ -809,6 +907,11 @@ void setRangeMapping(MultiArrayView <3, T, Tag> const & volume,
     an already constructed \ref vigra::VolumeExportInfo object. The other two are just abbreviations
     that construct the VolumeExportInfo object internally.
 
+    When \ref ParallelOptions are passed, the slices of an image stack are encoded concurrently,
+    each into its own file. The range mapping is still determined once for the entire volume.
+    The pages of a multi-page TIFF file are always written sequentially, because they
+    are appended to the same file.
+
     <b> Usage:</b>
 
     <b>\#include</b> \<vigra/multi_impex.hxx\> <br/>
@@ -822,6 +925,9 @@ void setRangeMapping(MultiArrayView <3, T, Tag> const & volume,
     VolumeExportInfo info("my_data", ".jpg");
     info.setCompression("JPEG QUALITY=95");
     exportVolume(volume, info);
+
+    // likewise, but encode the slices using 8 threads
+    exportVolume(volume, info, ParallelOptions().numThreads(8));
     \endcode
 */
 doxygen_overloaded_function(template <...> void exportVolume)
@@ -829,7 +935,8 @@ doxygen_overloaded_function(template <...> void exportVolume)
 template <class T, class Tag>
 void
 exportVolume (MultiArrayView <3, T, Tag> const & volume,
-              const VolumeExportInfo & volinfo)
+              const VolumeExportInfo & volinfo,
+              ParallelOptions const & options)
 {
     if(volinfo.getFileType() == std::string("MULTIPAGE"))
     {
@@ -859,27 +966,37 @@ exportVolume (MultiArrayView <3, T, Tag> const & volume,
 
         const unsigned int depth = volume.shape (2);
         int numlen = static_cast <int> (std::ceil (std::log10 ((double)depth)));
-        for (unsigned int i = 0; i < depth; ++i)
-        {
-            // build the filename
-            std::stringstream stream;
-            stream << std::setfill ('0') << std::setw (numlen) << i;
-            std::string name_num;
-            stream >> name_num;
-            std::string sliceFilename =
-                std::string(volinfo.getFileNameBase()) +
-                name_num +
-                std::string(volinfo.getFileNameExt());
-
-            MultiArrayView <2, T, Tag> view (volume.bindOuter (i));
-
-            // export the image
-            info.setFileName(sliceFilename.c_str ());
-            exportImage(srcImageRange(view), info);
-        }
+        parallel_foreach(options, depth,
+            [&](int /* thread_id */, MultiArrayIndex i)
+            {
+                // build the filename
+                std::stringstream stream;
+                stream << std::setfill ('0') << std::setw (numlen) << i;
+                std::string name_num;
+                stream >> name_num;
+                std::string sliceFilename =
+                    std::string(volinfo.getFileNameBase()) +
+                    name_num +
+                    std::string(volinfo.getFileNameExt());
+
+                MultiArrayView <2, T, Tag> view (volume.bindOuter (i));
+
+                // export the image, using a private copy of the shared settings
+                ImageExportInfo sliceInfo(info);
+                sliceInfo.setFileName(sliceFilename.c_str ());
+                exportImage(srcImageRange(view), sliceInfo);
+            });
     }
 }
 
+template <class T, class Tag>
+inline void
+exportVolume (MultiArrayView <3, T, Tag> const & volume,
+              const VolumeExportInfo & volinfo)
+{
+    exportVolume(volume, volinfo, ParallelOptions().numThreads(ParallelOptions::NoThreads));
+}
+
 template <class T, class Tag>
 inline void
 exportVolume (MultiArrayView <3, T, Tag> const & volume,
@@ -889,6 +1006,16 @@ exportVolume (MultiArrayView <3, T, Tag> const & volume,
     exportVolume(volume, volinfo);
 }
 
+template <class T, class Tag>
+inline void
+exportVolume (MultiArrayView <3, T, Tag> const & volume,
+              const std::string &filename,
+              ParallelOptions const & options)
+{
+    VolumeExportInfo volinfo(filename.c_str());
+    exportVolume(volume, volinfo, options);
+}
+
 template <class T, class Tag>
 inline void
 exportVolume (MultiArrayView <3, T, Tag> const & volume,
@@ -899,6 +1026,17 @@ exportVolume (MultiArrayView <3, T, Tag> const & volume,
     exportVolume(volume, volinfo);
 }
 
+template <class T, class Tag>
+inline void
+exportVolume (MultiArrayView <3, T, Tag> const & volume,
+              const std::string &name_base,
+              const std::string &name_ext,
+              ParallelOptions const & options)
+{
+    VolumeExportInfo volinfo(name_base.c_str(), name_ext.c_str());
+    exportVolume(volume, volinfo, options);
+}
+
 //@}
 
 } // namespace vigra
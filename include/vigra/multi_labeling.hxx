@@ -36,6 +36,10 @@
 #ifndef VIGRA_MULTI_LABELING_HXX
 #define VIGRA_MULTI_LABELING_HXX
 
+#include <vector>
+#include <functional>
+#include <type_traits>
+
 #include "multi_array.hxx"
 #include "multi_gridgraph.hxx"
 #include "union_find.hxx"
@@ -304,6 +308,221 @@ labelGraphWithBackground(GridGraph<N, DirectedTag> const & g,
 
 } // namespace lemon_graph
 
+namespace detail {
+
+// A maximal run of equal values along the first axis.
+template <class T, class Label>
+struct LabelRun
+{
+    MultiArrayIndex begin, end;
+    T value;
+    Label label;
+};
+
+// Merge the run [begin, end) with the runs of a neighboring row that touch it (with
+// 'ext' = 1, diagonal contacts count as well). Since the runs of the current row are
+// processed from left to right, 'pos' remembers the first run that can still touch.
+template <class T, class Label>
+inline Label
+mergeLabelRuns(std::vector<LabelRun<T, Label> > const & row, std::size_t & pos,
+               MultiArrayIndex begin, MultiArrayIndex end, T const & value, MultiArrayIndex ext,
+               UnionFindArray<Label> & regions, Label current)
+{
+    while(pos < row.size() && row[pos].end + ext <= begin)
+        ++pos;
+    for(std::size_t k = pos; k < row.size() && row[k].begin < end + ext; ++k)
+    {
+        if(row[k].value == value)
+            current = regions.makeUnion(row[k].label, current);
+    }
+    return current;
+}
+
+// Connected components of 2D and 3D arrays via run-length encoding: every row is
+// split into runs of equal values, and only runs are merged with the overlapping runs
+// of the preceding rows in the same slice and in the previous slice. This produces
+// the same labels as lemon_graph::labelGraph() (regions are numbered in scan order
+// of their first pixel), but needs far fewer union-find operations.
+template <unsigned int N, class T, class S1,
+                          class Label, class S2>
+Label
+labelMultiArrayRuns(MultiArrayView<N, T, S1> const & data,
+                    MultiArrayView<N, Label, S2> labels,
+                    NeighborhoodType neighborhood,
+                    bool hasBackground,
+                    T const & backgroundValue)
+{
+    static_assert(N == 2 || N == 3, "labelMultiArrayRuns(): only 2D and 3D arrays are supported.");
+    typedef LabelRun<T, Label> Run;
+    typedef std::vector<Run>   RunRow;
+
+    MultiArrayIndex const width  = data.shape(0),
+                          height = data.shape(1),
+                          depth  = N == 3 ? data.shape(N-1) : 1;
+    MultiArrayIndex const ext = neighborhood == DirectNeighborhood ? 0 : 1;
+
+    UnionFindArray<Label> regions;
+    std::vector<RunRow> slice(height), previous_slice(depth > 1 ? height : 0);
+    // a single slice keeps the runs of all rows, so that the final labels can be
+    // written per run instead of reading back every pixel
+    bool const relabel_runs = depth == 1;
+
+    // pass 1: find the runs and connect them with the runs of the preceding rows
+    for(MultiArrayIndex z = 0; z < depth; ++z)
+    {
+        if(z > 0)
+            std::swap(slice, previous_slice);
+        for(MultiArrayIndex y = 0; y < height; ++y)
+        {
+            T const * in = data.data() + y*data.stride(1) + z*data.stride(N-1);
+            Label * out  = labels.data() + y*labels.stride(1) + z*labels.stride(N-1);
+            MultiArrayIndex const in_stride = data.stride(0), out_stride = labels.stride(0);
+
+            RunRow & row = slice[y];
+            row.clear();
+            std::size_t above = 0, back[3] = { 0, 0, 0 };
+            for(MultiArrayIndex x = 0; x < width; )
+            {
+                T const value = in[x*in_stride];
+                MultiArrayIndex end = x + 1;
+                if(hasBackground && value == backgroundValue)
+                {
+                    // background runs are written while scanning
+                    out[x*out_stride] = 0;
+                    for(; end < width && in[end*in_stride] == value; ++end)
+                        out[end*out_stride] = 0;
+                    x = end;
+                    continue;
+                }
+                while(end < width && in[end*in_stride] == value)
+                    ++end;
+
+                // define tentative label for the current run
+                Label current = regions.nextFreeIndex();
+                if(y > 0)
+                    current = mergeLabelRuns(slice[y-1], above, x, end, value, ext, regions, current);
+                if(z > 0)
+                {
+                    for(MultiArrayIndex dy = -ext; dy <= ext; ++dy)
+                    {
+                        if(y + dy >= 0 && y + dy < height)
+                            current = mergeLabelRuns(previous_slice[y+dy], back[dy+1], x, end, value, ext,
+                                                     regions, current);
+                    }
+                }
+                current = regions.finalizeIndex(current);
+                Run run = { x, end, value, current };
+                row.push_back(run);
+                if(relabel_runs)
+                    x = end;
+                else
+                    for(; x < end; ++x)
+                        out[x*out_stride] = current;
+            }
+        }
+    }
+
+    Label count = regions.makeContiguous();
+
+    // pass 2: make component labels contiguous via a lookup table, which is
+    // cheaper than branching on label changes along the rows
+    std::vector<Label> final_labels(regions.nextFreeIndex());
+    for(std::size_t k = 0; k < final_labels.size(); ++k)
+        final_labels[k] = regions.findLabel(Label(k));
+    if(relabel_runs)
+    {
+        // background pixels were already written in pass 1
+        for(MultiArrayIndex y = 0; y < height; ++y)
+        {
+            Label * out = labels.data() + y*labels.stride(1);
+            MultiArrayIndex const out_stride = labels.stride(0);
+            for(Run const & run : slice[y])
+            {
+                Label const label = final_labels[run.label];
+                for(MultiArrayIndex x = run.begin; x < run.end; ++x)
+                    out[x*out_stride] = label;
+            }
+        }
+        return count;
+    }
+    for(MultiArrayIndex z = 0; z < depth; ++z)
+    {
+        for(MultiArrayIndex y = 0; y < height; ++y)
+        {
+            Label * out = labels.data() + y*labels.stride(1) + z*labels.stride(N-1);
+            MultiArrayIndex const out_stride = labels.stride(0);
+            for(MultiArrayIndex x = 0; x < width; ++x, out += out_stride)
+                *out = final_labels[*out];
+        }
+    }
+    return count;
+}
+
+// Use the run-based algorithm for 2D and 3D arrays with the default equality,
+// the graph-based one otherwise.
+template <unsigned int N, class T, class Equal>
+struct UseLabelRuns
+: public std::integral_constant<bool, (N == 2 || N == 3) && std::is_same<Equal, std::equal_to<T> >::value>
+{};
+
+template <unsigned int N, class T, class S1,
+                          class Label, class S2,
+          class Equal>
+inline Label
+labelMultiArrayImpl(MultiArrayView<N, T, S1> const & data,
+                    MultiArrayView<N, Label, S2> labels,
+                    NeighborhoodType neighborhood,
+                    Equal const &,
+                    std::true_type)
+{
+    return labelMultiArrayRuns(data, labels, neighborhood, false, T());
+}
+
+template <unsigned int N, class T, class S1,
+                          class Label, class S2,
+          class Equal>
+inline Label
+labelMultiArrayImpl(MultiArrayView<N, T, S1> const & data,
+                    MultiArrayView<N, Label, S2> labels,
+                    NeighborhoodType neighborhood,
+                    Equal const & equal,
+                    std::false_type)
+{
+    GridGraph<N, undirected_tag> graph(data.shape(), neighborhood);
+    return lemon_graph::labelGraph(graph, data, labels, equal);
+}
+
+template <unsigned int N, class T, class S1,
+                          class Label, class S2,
+          class Equal>
+inline Label
+labelMultiArrayWithBackgroundImpl(MultiArrayView<N, T, S1> const & data,
+                                  MultiArrayView<N, Label, S2> labels,
+                                  NeighborhoodType neighborhood,
+                                  T backgroundValue,
+                                  Equal const &,
+                                  std::true_type)
+{
+    return labelMultiArrayRuns(data, labels, neighborhood, true, backgroundValue);
+}
+
+template <unsigned int N, class T, class S1,
+                          class Label, class S2,
+          class Equal>
+inline Label
+labelMultiArrayWithBackgroundImpl(MultiArrayView<N, T, S1> const & data,
+                                  MultiArrayView<N, Label, S2> labels,
+                                  NeighborhoodType neighborhood,
+                                  T backgroundValue,
+                                  Equal const & equal,
+                                  std::false_type)
+{
+    GridGraph<N, undirected_tag> graph(data.shape(), neighborhood);
+    return lemon_graph::labelGraphWithBackground(graph, data, labels, backgroundValue, equal);
+}
+
+} // namespace detail
+
     /** \brief Option object for labelMultiArray().
     */
 class LabelOptions
@@ -433,6 +652,10 @@ class LabelOptions
     <tt>IndirectNeighborhood</tt> (which corresponds to
     8-neighborhood in 2D and 26-neighborhood in 3D).
 
+    For 2D and 3D arrays with the default equality predicate, the function
+    merges runs of equal values along the first axis instead of individual
+    pixels, which is considerably faster. The result is identical.
+
     Return:  the highest region label used
 
     <b> Usage:</b>
@@ -481,8 +704,8 @@ labelMultiArray(MultiArrayView<N, T, S1> const & data,
     vigra_precondition(data.shape() == labels.shape(),
         "labelMultiArray(): shape mismatch between input and output.");
 
-    GridGraph<N, undirected_tag> graph(data.shape(), neighborhood);
-    return lemon_graph::labelGraph(graph, data, labels, equal);
+    return detail::labelMultiArrayImpl(data, labels, neighborhood, equal,
+                                       detail::UseLabelRuns<N, T, Equal>());
 }
 
 template <unsigned int N, class T, class S1,
@@ -611,8 +834,8 @@ labelMultiArrayWithBackground(MultiArrayView<N, T, S1> const & data,
     vigra_precondition(data.shape() == labels.shape(),
         "labelMultiArrayWithBackground(): shape mismatch between input and output.");
 
-    GridGraph<N, undirected_tag> graph(data.shape(), neighborhood);
-    return lemon_graph::labelGraphWithBackground(graph, data, labels, backgroundValue, equal);
+    return detail::labelMultiArrayWithBackgroundImpl(data, labels, neighborhood, backgroundValue, equal,
+                                                     detail::UseLabelRuns<N, T, Equal>());
 }
 
 template <unsigned int N, class T, class S1,
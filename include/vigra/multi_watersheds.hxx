@@ -38,6 +38,7 @@
 
 #include <functional>
 #include <limits>
+#include <type_traits>
 #include "mathutil.hxx"
 #include "multi_array.hxx"
 #include "multi_math.hxx"
@@ -219,17 +220,36 @@ generateWatershedSeeds(Graph const & g,
     return labelGraphWithBackground(g, minima, seeds, MarkerType(0), std::equal_to<MarkerType>());
 }
 
+    // Seeded watersheds push priorities that never fall below the priority of the node
+    // being processed, so that the monotone RadixHeap can be used for scalar costs.
+    // (8- and 16-bit costs are handled faster by the BucketQueue behind PriorityQueue.)
+template <class Node, class CostType,
+          bool UseRadixHeap = (std::is_floating_point<CostType>::value ||
+                               (std::is_integral<CostType>::value && sizeof(CostType) > 2))>
+struct WatershedQueue
+{
+    typedef PriorityQueue<Node, CostType, true> type;
+};
+
+template <class Node, class CostType>
+struct WatershedQueue<Node, CostType, true>
+{
+    typedef RadixHeap<Node, CostType> type;
+};
+
 #ifdef __GNUC__
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wsign-compare"
 #endif
 
-template <class Graph, class T1Map, class T2Map>
+    // 'pqueue' must be an empty ascending queue in the API of PriorityQueue
+template <class Graph, class T1Map, class T2Map, class Queue>
 typename T2Map::value_type
 seededWatersheds(Graph const & g,
                  T1Map const & data,
                  T2Map & labels,
-                 WatershedOptions const & options)
+                 WatershedOptions const & options,
+                 Queue & pqueue)
 {
     typedef typename Graph::Node        Node;
     typedef typename Graph::NodeIt      graph_scanner;
@@ -237,8 +257,6 @@ seededWatersheds(Graph const & g,
     typedef typename T1Map::value_type  CostType;
     typedef typename T2Map::value_type  LabelType;
 
-    PriorityQueue<Node, CostType, true> pqueue;
-
     bool keepContours = ((options.terminate & KeepContours) != 0);
     LabelType maxRegionLabel = 0;
 
@@ -327,6 +345,17 @@ seededWatersheds(Graph const & g,
     return maxRegionLabel;
 }
 
+template <class Graph, class T1Map, class T2Map>
+typename T2Map::value_type
+seededWatersheds(Graph const & g,
+                 T1Map const & data,
+                 T2Map & labels,
+                 WatershedOptions const & options)
+{
+    typename WatershedQueue<typename Graph::Node, typename T1Map::value_type>::type pqueue;
+    return seededWatersheds(g, data, labels, options, pqueue);
+}
+
 #ifdef __GNUC__
 #pragma GCC diagnostic pop
 #endif
@@ -405,8 +434,8 @@ generateWatershedSeeds(MultiArrayView<N, T, S1> const & data,
 
 /** \brief Watershed segmentation of an arbitrary-dimensional array.
 
-    See also \ref unionFindWatershedsBlockwise() for a parallel version of the
-    watershed algorithm.
+    See also \ref unionFindWatershedsBlockwise() and \ref seededWatershedsBlockwise()
+    for parallel versions of the watershed algorithm.
 
     This function implements variants of the watershed algorithms
     described in
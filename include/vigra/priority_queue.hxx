@@ -41,6 +41,9 @@
 #include "error.hxx"
 #include "array_vector.hxx"
 #include <queue>
+#include <vector>
+#include <cstring>
+#include <type_traits>
 
 namespace vigra {
 
@@ -401,6 +404,227 @@ class PriorityQueue<ValueType, unsigned short, Ascending>
 
 
 
+namespace detail {
+
+    // Map priorities to unsigned integers of the same size such that the order is preserved.
+template <class T,
+          bool IsFloat = std::is_floating_point<T>::value,
+          bool IsSigned = std::is_signed<T>::value>
+struct RadixHeapKey
+{
+    typedef typename std::make_unsigned<T>::type type;
+
+    static type toKey(T p)
+    {
+        return (type)p;
+    }
+
+    static T fromKey(type k)
+    {
+        return (T)k;
+    }
+};
+
+template <class T>
+struct RadixHeapKey<T, false, true>
+{
+    typedef typename std::make_unsigned<T>::type type;
+    static const type sign = (type)1 << (sizeof(T)*8 - 1);
+
+    static type toKey(T p)
+    {
+        return (type)p ^ sign;
+    }
+
+    static T fromKey(type k)
+    {
+        return (T)(k ^ sign);
+    }
+};
+
+    // Floating point numbers are ordered like their bit patterns, except
+    // that negative numbers are stored as sign and magnitude.
+template <class T>
+struct RadixHeapKey<T, true, true>
+{
+    typedef typename IfBool<sizeof(T) == 4, UInt32, UInt64>::type type;
+    static const type sign = (type)1 << (sizeof(T)*8 - 1);
+
+    static type toKey(T p)
+    {
+        if(p == T())
+            p = T(); // map -0.0 to 0.0
+        type k;
+        std::memcpy(&k, &p, sizeof(T));
+        return (k & sign) ? ~k : (k | sign);
+    }
+
+    static T fromKey(type k)
+    {
+        k = (k & sign) ? (k & ~sign) : ~k;
+        T p;
+        std::memcpy(&p, &k, sizeof(T));
+        return p;
+    }
+};
+
+    // Number of significant bits of k.
+inline unsigned int radixHeapBitLength(UInt64 k)
+{
+#if defined(__GNUC__)
+    return k == 0 ? 0 : 64 - __builtin_clzll(k);
+#else
+    unsigned int n = 0;
+    for(; k != 0; k >>= 1)
+        ++n;
+    return n;
+#endif
+}
+
+} // namespace detail
+
+/** \brief Monotone priority queue implemented as a radix heap.
+
+    This template is compatible to \ref vigra::PriorityQueue with <tt>Ascending = true</tt>,
+    but requires monotone use: the priority of a new element must not be smaller than
+    the priority of the most recently removed (or inspected) top element. This is the
+    case for watersheds, region growing with non-decreasing costs, and Dijkstra's algorithm.
+    Under this condition, <tt>push()</tt> is O(1) and <tt>pop()</tt> is amortized
+    O(number of bits of the priority type), independently of the number of elements.
+
+    <tt>PriorityType</tt> can be any integral or floating-point type. Internally, priorities are
+    mapped to unsigned integers of the same size in an order-preserving way (floats via their
+    bit patterns), so that no precision is lost. Elements with equal priorities
+    are returned in a first-in first-out fashion, like in \ref vigra::BucketQueue.
+    Elements are stored in one vector per bit of the priority type, so that the queue doesn't
+    allocate memory once these vectors have grown to their maximum size. When the queue
+    runs empty, arbitrary priorities may be pushed again.
+
+    <b>\#include</b> \<vigra/priority_queue.hxx\><br>
+    Namespace: vigra
+*/
+template <class ValueType,
+          class PriorityType>
+class RadixHeap
+{
+    typedef detail::RadixHeapKey<PriorityType> KeyTraits;
+    typedef typename KeyTraits::type Key;
+    typedef std::pair<Key, ValueType> ElementType;
+
+    enum { BucketCount = sizeof(Key)*8 + 1 };
+
+        // bucket k > 0 contains elements whose key differs from last_ first in bit k-1,
+        // bucket 0 contains the elements whose key equals last_, starting at front_
+    mutable std::vector<ElementType> buckets_[BucketCount];
+    mutable std::size_t front_;
+    mutable Key last_;
+    std::size_t size_;
+
+    void refill() const
+    {
+        if(front_ < buckets_[0].size())
+            return;
+        buckets_[0].clear();
+        front_ = 0;
+
+        int k = 1;
+        while(buckets_[k].empty())
+            ++k;
+        std::vector<ElementType> & bucket = buckets_[k];
+        Key last = bucket[0].first;
+        for(std::size_t i = 1; i < bucket.size(); ++i)
+            if(bucket[i].first < last)
+                last = bucket[i].first;
+        last_ = last;
+        // elements are moved in order, so that equal priorities remain first-in first-out
+        for(std::size_t i = 0; i < bucket.size(); ++i)
+            buckets_[detail::radixHeapBitLength(bucket[i].first ^ last)].push_back(bucket[i]);
+        bucket.clear();
+    }
+
+  public:
+
+    typedef ValueType value_type;
+    typedef ValueType & reference;
+    typedef ValueType const & const_reference;
+    typedef std::size_t size_type;
+    typedef PriorityType priority_type;
+
+        /** \brief Create empty queue.
+        */
+    RadixHeap()
+    : front_(0),
+      last_(0),
+      size_(0)
+    {}
+
+        /** \brief Number of elements in this queue.
+        */
+    size_type size() const
+    {
+        return size_;
+    }
+
+        /** \brief Queue contains no elements.
+             Equivalent to <tt>size() == 0</tt>.
+        */
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+        /** \brief Maximum priority allowed in this queue.
+        */
+    priority_type maxIndex() const
+    {
+        return NumericTraits<priority_type>::max();
+    }
+
+        /** \brief Priority of the current top element.
+        */
+    priority_type topPriority() const
+    {
+        refill();
+        return KeyTraits::fromKey(last_);
+    }
+
+        /** \brief The current top element.
+        */
+    const_reference top() const
+    {
+        refill();
+        return buckets_[0][front_].second;
+    }
+
+        /** \brief Remove the current top element.
+        */
+    void pop()
+    {
+        refill();
+        ++front_;
+        if(--size_ == 0)
+        {
+            // start over, such that arbitrary priorities are allowed again
+            buckets_[0].clear();
+            front_ = 0;
+            last_ = 0;
+        }
+    }
+
+        /** \brief Insert new element \arg v with given \arg priority.
+            The priority must not be smaller than the priority of the
+            last element removed or inspected via <tt>top()</tt>.
+        */
+    void push(value_type const & v, priority_type priority)
+    {
+        Key key = KeyTraits::toKey(priority);
+        vigra_precondition(key >= last_,
+            "RadixHeap::push(): priority must not be smaller than the current top priority.");
+        ++size_;
+        buckets_[detail::radixHeapBitLength(key ^ last_)].push_back(ElementType(key, v));
+    }
+};
+
 /** \brief Heap-based changable priority queue with a maximum number of elemements.
 
     This pq allows to change the priorities of elements in the queue
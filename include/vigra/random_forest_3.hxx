@@ -39,6 +39,7 @@
 #include <set>
 #include <map>
 #include <stack>
+#include <memory>
 #include <algorithm>
 
 #include "multi_array.hxx"
@@ -47,6 +48,7 @@
 #include "threadpool.hxx"
 #include "random_forest_3/random_forest.hxx"
 #include "random_forest_3/random_forest_common.hxx"
+#include "random_forest_3/random_forest_binning.hxx"
 #include "random_forest_3/random_forest_visitors.hxx"
 
 namespace vigra
@@ -154,7 +156,8 @@ void random_forest_single_tree(
         VISITOR & visitor,
         STOP stop,
         RF & tree,
-        RANDENGINE const & randengine
+        RANDENGINE const & randengine,
+        FeatureBins<typename RF::Features::value_type> const * feature_bins = 0
 ){
     typedef typename RF::Features Features;
     typedef typename Features::value_type FeatureType;
@@ -208,6 +211,11 @@ void random_forest_single_tree(
     auto const mtry = spec.actual_mtry_;
     Sampler<MersenneTwister> dim_sampler(num_features, SamplerOptions().withoutReplacement().sampleSize(mtry), &randengine);
 
+    // The histogram-based split search, if the features have been binned.
+    std::unique_ptr<HistogramSplitSearch<FeatureType> > histograms;
+    if (feature_bins != 0)
+        histograms.reset(new HistogramSplitSearch<FeatureType>(*feature_bins, spec.num_classes_));
+
     // Create the node stack and place the root node inside.
     std::stack<Node> node_stack;
     typedef std::pair<InstanceIter, InstanceIter> IterPair;
@@ -226,6 +234,9 @@ void random_forest_single_tree(
         node_distributions.insert(rootnode, priors);
 
         node_depths.insert(rootnode, 0);
+
+        if (histograms)
+            histograms->add_root(rootnode.id());
     }
 
     // Call the visitor.
@@ -255,14 +266,25 @@ void random_forest_single_tree(
         if (options.resample_count_ == 0 || used_instances.size() <= options.resample_count_)
         {
             // Find the split using all instances.
-            detail::split_score(
-                features,
-                labels,
-                instance_weights,
-                used_instances,
-                dim_sampler,
-                score
-            );
+            if (histograms)
+                histograms->split_score(
+                    node.id(),
+                    labels,
+                    instance_weights,
+                    used_instances,
+                    false,
+                    dim_sampler,
+                    score
+                );
+            else
+                detail::split_score(
+                    features,
+                    labels,
+                    instance_weights,
+                    used_instances,
+                    dim_sampler,
+                    score
+                );
         }
         else
         {
@@ -274,19 +296,32 @@ void random_forest_single_tree(
                 indices[i] = used_instances[resampler[i]];
 
             // Find the split using the subset.
-            detail::split_score(
-                features,
-                labels,
-                instance_weights,
-                indices,
-                dim_sampler,
-                score
-            );
+            if (histograms)
+                histograms->split_score(
+                    node.id(),
+                    labels,
+                    instance_weights,
+                    indices,
+                    true,
+                    dim_sampler,
+                    score
+                );
+            else
+                detail::split_score(
+                    features,
+                    labels,
+                    instance_weights,
+                    indices,
+                    dim_sampler,
+                    score
+                );
         }
 
         // If no split was found, the node is terminal.
         if (!score.split_found_)
         {
+            if (histograms)
+                histograms->remove(node.id());
             tree.node_responses_.insert(node, ACCInputType());
             node_map_updater(tree.node_responses_.at(node), node_distributions.at(node));
             continue;
@@ -309,6 +344,12 @@ void random_forest_single_tree(
         // Call the visitor.
         visitor.visit_after_split(tree, features, labels, instance_weights, score, begin, split_iter, end);
 
+        if (histograms)
+        {
+            histograms->add_children(node.id(), n_left.id(), n_right.id(), begin, split_iter, end);
+            histograms->remove(node.id());
+        }
+
         instance_range.insert(n_left, IterPair(begin, split_iter));
         instance_range.insert(n_right, IterPair(split_iter, end));
         tree.split_tests_.insert(node, SplitTests(best_dim, best_split));
@@ -324,6 +365,8 @@ void random_forest_single_tree(
         // Check if the left child is terminal.
         if (stop(labels, RFNodeDescription<decltype(priors_left)>(depth+1, priors_left)))
         {
+            if (histograms)
+                histograms->remove(n_left.id());
             tree.node_responses_.insert(n_left, ACCInputType());
             node_map_updater(tree.node_responses_.at(n_left), node_distributions.at(n_left));
         }
@@ -341,6 +384,8 @@ void random_forest_single_tree(
         // Check if the right child is terminal.
         if (stop(labels, RFNodeDescription<decltype(priors_right)>(depth+1, priors_right)))
         {
+            if (histograms)
+                histograms->remove(n_right.id());
             tree.node_responses_.insert(n_right, ACCInputType());
             node_map_updater(tree.node_responses_.at(n_right), node_distributions.at(n_right));
         }
@@ -356,6 +401,67 @@ void random_forest_single_tree(
 
 
 
+/// \brief Transform the labels to 0, 1, 2, ... and store the distinct labels in the problem spec.
+template <typename LABELS, typename LabelType, typename TRANSFORMED>
+void transform_labels(
+        LABELS const & labels,
+        ProblemSpec<LabelType> & pspec,
+        TRANSFORMED & transformed_labels
+){
+    std::set<LabelType> const dlabels(labels.begin(), labels.end());
+    std::vector<LabelType> const distinct_labels(dlabels.begin(), dlabels.end());
+    pspec.distinct_classes(distinct_labels);
+    std::map<LabelType, size_t> label_map;
+    for (size_t i = 0; i < distinct_labels.size(); ++i)
+    {
+        label_map[distinct_labels[i]] = i;
+    }
+
+    transformed_labels.reshape(Shape1(labels.size()));
+    for (size_t i = 0; i < (size_t)labels.size(); ++i)
+    {
+        transformed_labels(i) = label_map[labels(i)];
+    }
+}
+
+
+
+/// \brief Get the number of training threads from the options.
+inline size_t training_threads(RandomForestOptions const & options)
+{
+    size_t n_threads = 1;
+    if (options.n_threads_ >= 1)
+        n_threads = options.n_threads_;
+    else if (options.n_threads_ == -1)
+        n_threads = std::thread::hardware_concurrency();
+    return n_threads;
+}
+
+
+
+/// \brief Use the global random engine to create the random engines that run in the threads.
+template <typename RANDENGINE>
+std::vector<RANDENGINE> thread_rand_engines(RANDENGINE & randengine, size_t n_threads)
+{
+    // Create seeds for the random engines that run in the threads.
+    UniformIntRandomFunctor<RANDENGINE> rand_functor(randengine);
+    std::set<UInt32> seeds;
+    while (seeds.size() < n_threads)
+    {
+        seeds.insert(rand_functor());
+    }
+    vigra_assert(seeds.size() == n_threads, "random_forest_impl(): Could not create random seeds.");
+
+    std::vector<RANDENGINE> rand_engines;
+    for (auto seed : seeds)
+    {
+        rand_engines.push_back(RANDENGINE(seed));
+    }
+    return rand_engines;
+}
+
+
+
 /// \brief Preprocess the labels and call the train functions on the single trees.
 template <typename FEATURES,
           typename LABELS,
@@ -390,23 +496,11 @@ random_forest_impl(
     std::vector<RF> trees(tree_count);
 
     // Transform the labels to 0, 1, 2, ...
-    std::set<LabelType> const dlabels(labels.begin(), labels.end());
-    std::vector<LabelType> const distinct_labels(dlabels.begin(), dlabels.end());
-    pspec.distinct_classes(distinct_labels);
-    std::map<LabelType, size_t> label_map;
-    for (size_t i = 0; i < distinct_labels.size(); ++i)
-    {
-        label_map[distinct_labels[i]] = i;
-    }
-    
-    MultiArray<1, LabelType> transformed_labels(Shape1(labels.size()));
-    for (size_t i = 0; i < (size_t)labels.size(); ++i)
-    {
-        transformed_labels(i) = label_map[labels(i)];
-    }
+    MultiArray<1, LabelType> transformed_labels;
+    transform_labels(labels, pspec, transformed_labels);
 
     // Check the vector with the class weights.
-    vigra_precondition(options.class_weights_.size() == 0 || options.class_weights_.size() == distinct_labels.size(),
+    vigra_precondition(options.class_weights_.size() == 0 || options.class_weights_.size() == pspec.num_classes_,
                        "random_forest_impl(): The number of class weights must be 0 or equal to the number of classes.");
 
     // Write the problem specification into the trees.
@@ -414,27 +508,10 @@ random_forest_impl(
         t.problem_spec_ = pspec;
 
     // Find the correct number of threads.
-    size_t n_threads = 1;
-    if (options.n_threads_ >= 1)
-        n_threads = options.n_threads_;
-    else if (options.n_threads_ == -1)
-        n_threads = std::thread::hardware_concurrency();
-
-    // Use the global random engine to create seeds for the random engines that run in the threads.
-    UniformIntRandomFunctor<RANDENGINE> rand_functor(randengine);
-    std::set<UInt32> seeds;
-    while (seeds.size() < n_threads)
-    {
-        seeds.insert(rand_functor());
-    }
-    vigra_assert(seeds.size() == n_threads, "random_forest_impl(): Could not create random seeds.");
+    size_t const n_threads = training_threads(options);
 
     // Create the random engines that run in the threads.
-    std::vector<RANDENGINE> rand_engines;
-    for (auto seed : seeds)
-    {
-        rand_engines.push_back(RANDENGINE(seed));
-    }
+    std::vector<RANDENGINE> rand_engines = thread_rand_engines(randengine, n_threads);
 
     // Call the visitor.
     visitor.visit_before_training();
@@ -448,15 +525,21 @@ random_forest_impl(
         tree_visitors.emplace_back(visitor);
     }
 
+    // Quantize the features for the histogram-based split search.
+    typedef typename FEATURES::value_type FeatureType;
+    std::unique_ptr<FeatureBins<FeatureType> > feature_bins;
+    if (options.max_bins_ > 0)
+        feature_bins.reset(new FeatureBins<FeatureType>(features, options.max_bins_));
+
     // Train the trees.
     ThreadPool pool((size_t)n_threads);
     std::vector<threading::future<void> > futures;
     for (size_t i = 0; i < tree_count; ++i)
     {
         futures.emplace_back(
-            pool.enqueue([&features, &transformed_labels, &options, &tree_visitors, &stop, &trees, i, &rand_engines](size_t thread_id)
+            pool.enqueue([&features, &transformed_labels, &options, &tree_visitors, &stop, &trees, i, &rand_engines, &feature_bins](size_t thread_id)
                 {
-                    random_forest_single_tree<RF, SCORER, VisitorCopyType, STOP>(features, transformed_labels, options, tree_visitors[i], stop, trees[i], rand_engines[thread_id]);
+                    random_forest_single_tree<RF, SCORER, VisitorCopyType, STOP>(features, transformed_labels, options, tree_visitors[i], stop, trees[i], rand_engines[thread_id], feature_bins.get());
                 }
             )
         );
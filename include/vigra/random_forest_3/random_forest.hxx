@@ -42,6 +42,7 @@
 #include "../binary_forest.hxx"
 #include "../threadpool.hxx"
 #include "random_forest_common.hxx"
+#include "random_forest_compiled.hxx"
 
 
 
@@ -78,6 +79,7 @@ public:
     typedef typename ACC::input_type AccInputType;
     typedef BinaryForest Graph;
     typedef Graph::Node Node;
+    typedef CompiledForest<typename detail::CompiledSplitTraits<SplitTests>::threshold_type> Compiled;
 
     static ContainerTag const container_tag = VectorTag;
 
@@ -118,6 +120,15 @@ public:
         const std::vector<size_t> & tree_indices = std::vector<size_t>()
     ) const;
 
+    /// \brief Predict the given data, using the threads or the thread pool selected in options.
+    /// \note labels must be a 1-D array with size <tt>features.shape(0)</tt>.
+    void predict(
+        FEATURES const & features,
+        LABELS & labels,
+        ParallelOptions const & options,
+        const std::vector<size_t> & tree_indices = std::vector<size_t>()
+    ) const;
+
     /// \brief Predict the probabilities of the given data and return the average number of split comparisons.
     /// \note probs should have the shape (features.shape()[0], num_classes).
     template <typename PROBS>
@@ -128,6 +139,25 @@ public:
         const std::vector<size_t> & tree_indices = std::vector<size_t>()
     ) const;
 
+    /// \brief Predict the probabilities of the given data, using the threads or the thread pool selected in options.
+    /// \note probs should have the shape (features.shape()[0], num_classes).
+    template <typename PROBS>
+    void predict_probabilities(
+        FEATURES const & features,
+        PROBS & probs,
+        ParallelOptions const & options,
+        const std::vector<size_t> & tree_indices = std::vector<size_t>()
+    ) const;
+
+    /// \brief Create a flat copy of this forest that is optimized for prediction.
+    /// \note predict_probabilities() compiles the forest on the fly when the number of
+    /// samples is large compared to the size of the forest. Applications that predict 
+    /// small batches repeatedly should compile once and use Compiled::predict_probabilities().
+    Compiled compile() const
+    {
+        return Compiled(*this);
+    }
+
     /// \brief For each data point in features, compute the corresponding leaf ids and return the average number of split comparisons.
     /// \note ids should have the shape (features.shape()[0], num_trees).
     template <typename IDS>
@@ -189,6 +219,29 @@ private:
         INDICES const & tree_indices
     ) const;
 
+    template <typename PROBS>
+    bool predict_probabilities_compiled(
+        FEATURES const & features,
+        PROBS & probs,
+        ParallelOptions const & options,
+        const std::vector<size_t> & tree_indices,
+        std::true_type) const
+    {
+        Compiled(*this).predict_probabilities(features, probs, options, tree_indices);
+        return true;
+    }
+
+    template <typename PROBS>
+    bool predict_probabilities_compiled(
+        FEATURES const &,
+        PROBS &,
+        ParallelOptions const &,
+        const std::vector<size_t> &,
+        std::false_type) const
+    {
+        return false;
+    }
+
     template<typename PROBS>
     void predict_probabilities_impl(
         FEATURES const & features,
@@ -249,6 +302,19 @@ void RandomForest<FEATURES, LABELS, SPLITTESTS, ACC>::predict(
     LABELS & labels,
     int n_threads,
     const std::vector<size_t> & tree_indices
+) const {
+    // -1 means ParallelOptions::Auto, other values below one mean a single thread
+    if (n_threads < 1 && n_threads != ParallelOptions::Auto)
+        n_threads = 1;
+    predict(features, labels, ParallelOptions().numThreads(n_threads), tree_indices);
+}
+
+template <typename FEATURES, typename LABELS, typename SPLITTESTS, typename ACC>
+void RandomForest<FEATURES, LABELS, SPLITTESTS, ACC>::predict(
+    FEATURES const & features,
+    LABELS & labels,
+    ParallelOptions const & options,
+    const std::vector<size_t> & tree_indices
 ) const {
     vigra_precondition(features.shape()[0] == labels.shape()[0],
                        "RandomForest::predict(): Shape mismatch between features and labels.");
@@ -256,7 +322,7 @@ void RandomForest<FEATURES, LABELS, SPLITTESTS, ACC>::predict(
                        "RandomForest::predict(): Number of features in prediction differs from training.");
 
     MultiArray<2, double> probs(Shape2(features.shape()[0], problem_spec_.num_classes_));
-    predict_probabilities(features, probs, n_threads, tree_indices);
+    predict_probabilities(features, probs, options, tree_indices);
     for (size_t i = 0; i < (size_t)features.shape()[0]; ++i)
     {
         auto const sub_probs = probs.template bind<0>(i);
@@ -276,6 +342,20 @@ void RandomForest<FEATURES, LABELS, SPLITTESTS, ACC>::predict_probabilities(
     PROBS & probs,
     int n_threads,
     const std::vector<size_t> & tree_indices
+) const {
+    // -1 means ParallelOptions::Auto, other values below one mean a single thread
+    if (n_threads < 1 && n_threads != ParallelOptions::Auto)
+        n_threads = 1;
+    predict_probabilities(features, probs, ParallelOptions().numThreads(n_threads), tree_indices);
+}
+
+template <typename FEATURES, typename LABELS, typename SPLITTESTS, typename ACC>
+template <typename PROBS>
+void RandomForest<FEATURES, LABELS, SPLITTESTS, ACC>::predict_probabilities(
+    FEATURES const & features,
+    PROBS & probs,
+    ParallelOptions const & options,
+    const std::vector<size_t> & tree_indices
 ) const {
     vigra_precondition(features.shape()[0] == probs.shape()[0],
                        "RandomForest::predict_probabilities(): Shape mismatch between features and probabilities.");
@@ -301,14 +381,17 @@ void RandomForest<FEATURES, LABELS, SPLITTESTS, ACC>::predict_probabilities(
     }
     
     size_t const num_instances = features.shape()[0];
-    
-    if (n_threads == -1)
-        n_threads = std::thread::hardware_concurrency();
-    if (n_threads < 1)
-        n_threads = 1;
-    
+
+    // For large batches, compiling the forest into a flat array pays off, since 
+    // the compiled forest evaluates blocks of instances tree by tree.
+    typedef std::integral_constant<bool, detail::CompiledSplitTraits<SplitTests>::supported &&
+                                         detail::CompiledLeafTraits<ACC>::supported> Compilable;
+    if (num_instances * tree_indices_cpy.size() >= num_nodes() &&
+        predict_probabilities_compiled(features, probs, options, tree_indices_cpy, Compilable()))
+        return;
+
     parallel_foreach(
-        n_threads,
+        options,
         num_instances,
         [&features,&probs,&tree_indices_cpy,this](size_t, size_t i) {
             this->predict_probabilities_impl(features, probs, i, tree_indices_cpy);
@@ -0,0 +1,340 @@
+/************************************************************************/
+/*                                                                      */
+/*        Copyright 2014-2015 by Ullrich Koethe and Philip Schill       */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+#ifndef VIGRA_RF3_RANDOM_FOREST_BINNING_HXX
+#define VIGRA_RF3_RANDOM_FOREST_BINNING_HXX
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <algorithm>
+
+#include "../multi_array.hxx"
+#include "../sized_int.hxx"
+#include "random_forest_common.hxx"
+
+namespace vigra
+{
+
+namespace rf3
+{
+
+namespace detail
+{
+
+/** \brief Features of the training set, quantized into at most 256 bins per feature.
+
+    The bins of each feature are chosen such that they hold roughly the same number
+    of instances. Bin <tt>b</tt> of feature <tt>d</tt> contains the training values
+    in the range <tt>[bin_min(d)[b], bin_max(d)[b]]</tt>. Splits are only placed 
+    between bins, so that a split test with a threshold between the bins partitions
+    the instances exactly like their bin indices. When a feature has at most 
+    <tt>max_bins</tt> distinct values, each value gets its own bin and the
+    histogram-based training finds the same splits as the exact one.
+*/
+template <typename T>
+class FeatureBins
+{
+public:
+
+    typedef T FeatureType;
+
+    template <typename FEATURES>
+    FeatureBins(FEATURES const & features, size_t max_bins)
+    :   bins_(Shape2(features.shape()[0], features.shape()[1])),
+        bin_min_(features.shape()[1]),
+        bin_max_(features.shape()[1])
+    {
+        vigra_precondition(max_bins >= 2 && max_bins <= 256,
+            "FeatureBins(): max_bins must be in [2, 256].");
+
+        size_t const num_instances = features.shape()[0];
+        std::vector<FeatureType> values(num_instances);
+        for (size_t d = 0; d < bin_max_.size(); ++d)
+        {
+            for (size_t i = 0; i < num_instances; ++i)
+                values[i] = features(i, d);
+            std::sort(values.begin(), values.end());
+
+            std::vector<FeatureType> & bin_min = bin_min_[d];
+            std::vector<FeatureType> & bin_max = bin_max_[d];
+            size_t num_distinct = num_instances > 0 ? 1 : 0;
+            for (size_t i = 1; i < num_instances; ++i)
+                if (values[i-1] != values[i])
+                    ++num_distinct;
+            if (num_distinct <= max_bins)
+            {
+                // One bin per value.
+                for (size_t i = 0; i < num_instances; ++i)
+                {
+                    if (i == 0 || values[i-1] != values[i])
+                    {
+                        bin_min.push_back(values[i]);
+                        bin_max.push_back(values[i]);
+                    }
+                }
+            }
+            else
+            {
+                // Place the bin boundaries between distinct values, such that 
+                // each bin receives about num_instances / max_bins instances.
+                double const bin_size = num_instances / static_cast<double>(max_bins);
+                size_t begin = 0;
+                while (begin < num_instances)
+                {
+                    size_t end = num_instances;
+                    if (bin_max.size() + 1 < max_bins)
+                    {
+                        end = std::max(begin+1, static_cast<size_t>((bin_max.size() + 1) * bin_size));
+                        // advance to the end of the current run of equal values
+                        end = std::upper_bound(values.begin() + end - 1, values.end(), values[end-1]) - values.begin();
+                    }
+                    bin_min.push_back(values[begin]);
+                    bin_max.push_back(values[end-1]);
+                    begin = end;
+                }
+            }
+
+            // Assign the bins.
+            MultiArrayView<1, UInt8> bins = bins_.bindOuter(d);
+            for (size_t i = 0; i < num_instances; ++i)
+                bins(i) = static_cast<UInt8>(std::lower_bound(bin_max.begin(), bin_max.end(),
+                                                               static_cast<FeatureType>(features(i, d))) - bin_max.begin());
+        }
+    }
+
+    /// The bin indices with shape <tt>num_instances x num_features</tt>.
+    MultiArray<2, UInt8> const & bins() const
+    {
+        return bins_;
+    }
+
+    /// Number of bins of the given feature.
+    size_t num_bins(size_t d) const
+    {
+        return bin_max_[d].size();
+    }
+
+    /// Smallest training value in each bin of the given feature.
+    std::vector<FeatureType> const & bin_min(size_t d) const
+    {
+        return bin_min_[d];
+    }
+
+    /// Largest training value in each bin of the given feature.
+    std::vector<FeatureType> const & bin_max(size_t d) const
+    {
+        return bin_max_[d];
+    }
+
+private:
+
+    MultiArray<2, UInt8> bins_;
+    std::vector<std::vector<FeatureType> > bin_min_, bin_max_;
+};
+
+/** \brief Split search on per-node class histograms of binned features.
+
+    For every sampled feature, the weighted class counts per bin are accumulated
+    over the instances of the node and scanned for the best split. The histograms
+    are kept while the children of a node are trained: whenever a child samples a
+    feature whose histogram is known in the parent, the histogram is obtained by
+    subtracting the histogram of the sibling from that of the parent. If the
+    sibling's histogram does not exist yet, it is computed instead of the own one
+    when the sibling is the smaller node and reused when the sibling is trained.
+*/
+template <typename T>
+class HistogramSplitSearch
+{
+public:
+
+    typedef FeatureBins<T> Bins;
+    typedef std::vector<double> Histogram;  // num_bins x num_classes, class index is fastest
+    typedef std::map<size_t, Histogram> HistogramMap;
+    typedef std::vector<size_t>::iterator InstanceIter;
+
+    HistogramSplitSearch(Bins const & bins, size_t num_classes)
+    :   bins_(bins),
+        num_classes_(num_classes)
+    {}
+
+    /// Register the root node of a tree.
+    void add_root(size_t node)
+    {
+        nodes_[node].own = std::make_shared<HistogramMap>();
+    }
+
+    /// Register the children of a node after it has been split.
+    void add_children(size_t node, size_t left, size_t right,
+                      InstanceIter begin, InstanceIter split, InstanceIter end)
+    {
+        NodeData & parent = nodes_.at(node);
+        NodeData & l = nodes_[left];
+        NodeData & r = nodes_[right];
+        l.own = std::make_shared<HistogramMap>();
+        r.own = std::make_shared<HistogramMap>();
+        l.parent = r.parent = parent.own;
+        l.sibling = r.own;
+        r.sibling = l.own;
+        l.sibling_begin = r.begin = split;
+        l.sibling_end = r.end = end;
+        r.sibling_begin = l.begin = begin;
+        r.sibling_end = l.end = split;
+        l.larger = (split - begin) >= (end - split);
+        r.larger = !l.larger;
+    }
+
+    /// Release the data of a node, once it has been split or made a leaf.
+    void remove(size_t node)
+    {
+        nodes_.erase(node);
+    }
+
+    /// Find the best split of the node among the features selected by dim_sampler.
+    /// If <tt>subset</tt> is true, <tt>instances</tt> is a random subset of the node, 
+    /// and the histograms are neither cached nor derived from the parent.
+    template <typename LABELS, typename SAMPLER, typename SCORER>
+    void split_score(
+        size_t node,
+        LABELS const & labels,
+        std::vector<double> const & instance_weights,
+        std::vector<size_t> const & instances,
+        bool subset,
+        SAMPLER const & dim_sampler,
+        SCORER & score
+    ){
+        NodeData & data = nodes_.at(node);
+        Histogram tmp;
+        for (int k = 0; k < dim_sampler.sampleSize(); ++k)
+        {
+            size_t const d = dim_sampler[k];
+            if (bins_.num_bins(d) < 2)
+                continue;
+
+            Histogram * hist = &tmp;
+            if (subset)
+            {
+                compute(d, labels, instance_weights, instances.begin(), instances.end(), tmp);
+            }
+            else
+            {
+                hist = &(*data.own)[d];
+                if (hist->empty())
+                    get(data, d, labels, instance_weights, instances, *hist);
+            }
+            score.scan_histogram(*hist, bins_.bin_min(d), bins_.bin_max(d), d);
+        }
+    }
+
+private:
+
+    struct NodeData
+    {
+        std::shared_ptr<HistogramMap> own, parent, sibling;
+        InstanceIter begin, end, sibling_begin, sibling_end;
+        bool larger;
+    };
+
+    template <typename LABELS>
+    void get(
+        NodeData & data,
+        size_t d,
+        LABELS const & labels,
+        std::vector<double> const & instance_weights,
+        std::vector<size_t> const & instances,
+        Histogram & hist
+    ){
+        Histogram const * parent = find(data.parent, d);
+        if (parent != 0)
+        {
+            Histogram * sibling = find(data.sibling, d);
+            if (sibling == 0 && data.larger)
+            {
+                // compute the histogram of the smaller sibling, it will be reused there
+                sibling = &(*data.sibling)[d];
+                compute(d, labels, instance_weights, data.sibling_begin, data.sibling_end, *sibling);
+            }
+            if (sibling != 0)
+            {
+                hist.resize(parent->size());
+                for (size_t j = 0; j < hist.size(); ++j)
+                {
+                    double const v = (*parent)[j] - (*sibling)[j];
+                    // remove rounding errors of non-integral weights
+                    hist[j] = (v < 1e-10 * (*parent)[j] || v < 1e-10) ? 0.0 : v;
+                }
+                return;
+            }
+        }
+        compute(d, labels, instance_weights, instances.begin(), instances.end(), hist);
+    }
+
+    template <typename LABELS, typename ITER>
+    void compute(
+        size_t d,
+        LABELS const & labels,
+        std::vector<double> const & instance_weights,
+        ITER begin,
+        ITER end,
+        Histogram & hist
+    ) const {
+        hist.assign(bins_.num_bins(d) * num_classes_, 0.0);
+        UInt8 const * bins = &bins_.bins()(0, d);
+        for (; begin != end; ++begin)
+        {
+            size_t const i = *begin;
+            hist[bins[i] * num_classes_ + static_cast<size_t>(labels(i))] += instance_weights[i];
+        }
+    }
+
+    static Histogram * find(std::shared_ptr<HistogramMap> const & m, size_t d)
+    {
+        if (!m)
+            return 0;
+        auto it = m->find(d);
+        return (it == m->end() || it->second.empty()) ? 0 : &it->second;
+    }
+
+    Bins const & bins_;
+    size_t num_classes_;
+    std::map<size_t, NodeData> nodes_;
+};
+
+} // namespace detail
+
+} // namespace rf3
+
+} // namespace vigra
+
+#endif
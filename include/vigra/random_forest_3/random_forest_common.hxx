@@ -276,6 +276,55 @@ namespace detail
             }
         }
 
+        /// Find the best split in a histogram of the class counts of binned features
+        /// (see \ref HistogramSplitSearch). The split threshold is placed in the middle
+        /// between the largest value of the last non-empty bin on the left side and
+        /// the smallest value of the first non-empty bin on the right side.
+        template <typename VALUES>
+        void scan_histogram(
+            std::vector<double> const & hist,
+            VALUES const & bin_min,
+            VALUES const & bin_max,
+            size_t dim
+        ){
+            Functor score;
+
+            size_t const num_classes = priors_.size();
+            std::vector<double> counts(num_classes, 0.0);
+            double n_left = 0;
+            bool left_found = false;
+            size_t left_bin = 0;
+            for (size_t b = 0; b < bin_max.size(); ++b)
+            {
+                double const * h = &hist[b*num_classes];
+                double n_bin = 0;
+                for (size_t c = 0; c < num_classes; ++c)
+                    n_bin += h[c];
+                if (n_bin <= 0)
+                    continue;
+
+                if (left_found)
+                {
+                    // Update the score.
+                    split_found_ = true;
+                    double const s = score(priors_, counts, n_total_, n_left);
+                    if (s < best_score_)
+                    {
+                        best_score_ = s;
+                        best_split_ = 0.5*(bin_max[left_bin]+bin_min[b]);
+                        best_dim_ = dim;
+                    }
+                }
+
+                // Move the bin from the right side to the left side.
+                for (size_t c = 0; c < num_classes; ++c)
+                    counts[c] += h[c];
+                n_left += n_bin;
+                left_found = true;
+                left_bin = b;
+            }
+        }
+
         bool split_found_; // whether a split was found at all
         double best_split_; // the threshold of the best split
         size_t best_dim_; // the dimension of the best split
@@ -596,7 +645,9 @@ public:
         min_num_instances_(1),
         use_stratification_(false),
         n_threads_(-1),
-        class_weights_()
+        class_weights_(),
+        max_bins_(0),
+        memory_budget_(0)
     {}
 
     /**
@@ -762,6 +813,42 @@ public:
         return *this;
     }
 
+    /**
+     * @brief Quantize the features into at most \a n bins before training.
+     *
+     * When \a n is in <tt>[2, 256]</tt>, each feature is binned once into at most \a n 
+     * bins of roughly equal population, and the splits are searched on per-node class 
+     * histograms instead of sorting the feature values in every node. This reduces 
+     * the training time considerably for large training sets, at the price of 
+     * restricting the split thresholds to the bin boundaries. Features with 
+     * at most \a n distinct values give the same splits as the exact search.
+     *
+     * Default: \a n = 0 (exact split search)
+     */
+    RandomForestOptions & max_bins(size_t n)
+    {
+        vigra_precondition(n == 0 || (n >= 2 && n <= 256),
+                           "RandomForestOptions::max_bins(): Input must be 0 or in [2, 256].");
+        max_bins_ = n;
+        return *this;
+    }
+
+    /**
+     * @brief Limit the memory used for the training data to \a bytes.
+     *
+     * Only used when the features are given as a \ref vigra::ChunkedArray (see 
+     * \ref vigra::rf3::random_forest_chunked()). Each tree is then trained on a random 
+     * subset of the instances (a bag) which is loaded into memory. The bag size is 
+     * chosen such that one bag per training thread fits into the budget.
+     *
+     * Default: \a bytes = 0 (no limit, all instances are loaded into memory)
+     */
+    RandomForestOptions & memory_budget(size_t bytes)
+    {
+        memory_budget_ = bytes;
+        return *this;
+    }
+
     /**
      * @brief Get the actual number of features per node.
      *
@@ -795,6 +882,8 @@ public:
     bool use_stratification_;
     int n_threads_;
     std::vector<double> class_weights_;
+    size_t max_bins_;
+    size_t memory_budget_;
 
 };
 
@@ -0,0 +1,414 @@
+/************************************************************************/
+/*                                                                      */
+/*        Copyright 2014-2015 by Ullrich Koethe and Philip Schill       */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+#ifndef VIGRA_RF3_RANDOM_FOREST_COMPILED_HXX
+#define VIGRA_RF3_RANDOM_FOREST_COMPILED_HXX
+
+#include <vector>
+#include <string>
+#include <numeric>
+#include <algorithm>
+#include <type_traits>
+
+#include "../sized_int.hxx"
+#include "../threadpool.hxx"
+#include "random_forest_common.hxx"
+
+namespace vigra
+{
+
+namespace rf3
+{
+
+namespace detail
+{
+
+// Split tests that can be translated into the flat node representation
+// of CompiledForest.
+template <typename SPLITTESTS>
+struct CompiledSplitTraits
+{
+    static const bool supported = false;
+    typedef double threshold_type;
+};
+
+template <typename T>
+struct CompiledSplitTraits<LessEqualSplitTest<T> >
+{
+    static const bool supported = true;
+    typedef T threshold_type;
+};
+
+// Accumulators whose result can be computed by summing per-leaf
+// class probability vectors over the trees (and optionally dividing by
+// the number of trees).
+template <typename ACC>
+struct CompiledLeafTraits
+{
+    static const bool supported = false;
+};
+
+template <typename T>
+struct CompiledLeafTraits<ArgMaxVectorAcc<T> >
+{
+    static const bool supported = true;
+
+    static void leafValues(std::vector<T> const & response, double * out, size_t num_classes)
+    {
+        vigra_precondition(response.size() <= num_classes,
+            "CompiledForest(): leaf response has more entries than classes.");
+        T const n = std::accumulate(response.begin(), response.end(), static_cast<T>(0));
+        for (size_t c = 0; c < response.size(); ++c)
+            out[c] = response[c] / static_cast<double>(n);
+    }
+
+    // the probability vectors are summed, but not averaged over the trees
+    static const bool average = false;
+};
+
+template <>
+struct CompiledLeafTraits<ArgMaxAcc>
+{
+    static const bool supported = true;
+
+    static void leafValues(size_t response, double * out, size_t num_classes)
+    {
+        vigra_precondition(response < num_classes,
+            "CompiledForest(): leaf response is not a valid class index.");
+        out[response] = 1.0;
+    }
+
+    // the votes are divided by the number of trees
+    static const bool average = true;
+};
+
+// The indices of the trees to be used in prediction, sorted and without duplicates.
+inline std::vector<size_t>
+flatForestTrees(std::vector<size_t> const & tree_indices, size_t num_trees, char const * function)
+{
+    std::vector<size_t> trees(tree_indices);
+    if (trees.size() == 0)
+    {
+        trees.resize(num_trees);
+        std::iota(trees.begin(), trees.end(), 0);
+    }
+    else
+    {
+        std::sort(trees.begin(), trees.end());
+        trees.erase(std::unique(trees.begin(), trees.end()), trees.end());
+        for (auto k : trees)
+            vigra_precondition(k < num_trees, std::string(function) + ": Tree index out of range.");
+    }
+    return trees;
+}
+
+// Prediction on the flat node representation: Each node provides 'feature' and 'child'
+// (the left child relative to the tree's root if >= 0, ~leaf_index otherwise), the
+// functor 'threshold' returns the split threshold of a node. Blocks of instances are
+// pushed through one tree after the other, so that each tree stays in the cache.
+template <typename NODE, typename OFFSET, typename LEAF, typename THRESHOLD,
+          typename FEATURES, typename PROBS>
+void predictFlatForestBlock(
+    NODE const * nodes,
+    OFFSET const * tree_offsets,
+    LEAF const * leaf_values,
+    size_t num_classes,
+    THRESHOLD const & threshold,
+    FEATURES const & features,
+    PROBS & probs,
+    size_t from,
+    size_t to,
+    std::vector<size_t> const & tree_indices,
+    double divisor
+){
+    size_t const n = to - from;
+    std::vector<double> acc(n*num_classes, 0.0);
+
+    for (auto k : tree_indices)
+    {
+        NODE const * tree = nodes + tree_offsets[k];
+        for (size_t i = 0; i < n; ++i)
+        {
+            Int32 node = 0;
+            while (tree[node].child >= 0)
+            {
+                NODE const & split = tree[node];
+                node = split.child + (features(from+i, split.feature) <= threshold(split) ? 0 : 1);
+            }
+            LEAF const * leaf = leaf_values + (size_t)(~tree[node].child)*num_classes;
+            double * a = &acc[i*num_classes];
+            for (size_t c = 0; c < num_classes; ++c)
+                a[c] += leaf[c];
+        }
+    }
+
+    for (size_t i = 0; i < n; ++i)
+        for (size_t c = 0; c < num_classes; ++c)
+            probs(from+i, c) = acc[i*num_classes + c] / divisor;
+}
+
+template <typename NODE, typename OFFSET, typename LEAF, typename THRESHOLD,
+          typename FEATURES, typename PROBS>
+void predictFlatForest(
+    NODE const * nodes,
+    OFFSET const * tree_offsets,
+    LEAF const * leaf_values,
+    size_t num_classes,
+    THRESHOLD const & threshold,
+    FEATURES const & features,
+    PROBS & probs,
+    ParallelOptions const & options,
+    std::vector<size_t> const & tree_indices,
+    double divisor
+){
+    static const size_t block_size = 256;
+    size_t const num_instances = features.shape()[0];
+    size_t const num_blocks = (num_instances + block_size - 1) / block_size;
+    parallel_foreach(
+        options,
+        num_blocks,
+        [&](size_t, size_t b) {
+            predictFlatForestBlock(nodes, tree_offsets, leaf_values, num_classes, threshold,
+                                   features, probs, b*block_size, std::min(num_instances, (b+1)*block_size),
+                                   tree_indices, divisor);
+        }
+    );
+}
+
+} // namespace detail
+
+/** \addtogroup MachineLearning
+**/
+//@{
+
+/********************************************************/
+/*                                                      */
+/*                   rf3::CompiledForest                */
+/*                                                      */
+/********************************************************/
+
+/** \brief Flat, read-only representation of a \ref vigra::rf3::RandomForest for fast prediction.
+
+    The nodes of each tree are stored in breadth-first order in a single array.
+    Each node holds the split feature, the threshold, and the index of its left 
+    child (the right child follows immediately). Leaves hold an index into a 
+    table of class probability vectors. Prediction processes blocks of samples 
+    tree by tree, so that each tree stays in the cache while it is used.
+
+    Compiling a forest takes time proportional to the number of nodes. 
+    RandomForest::predict_probabilities() uses a temporary CompiledForest automatically 
+    when the workload is large enough. Applications that call the prediction many 
+    times with few samples should create the CompiledForest once via 
+    RandomForest::compile() and reuse it.
+
+    Supported forests use the <tt>LessEqualSplitTest</tt> and either the
+    <tt>ArgMaxVectorAcc</tt> or the <tt>ArgMaxAcc</tt> accumulator. The results are
+    identical to those of RandomForest::predict_probabilities().
+
+    <b>\#include</b> \<vigra/random_forest_3.hxx\><br>
+    Namespace: vigra::rf3
+*/
+template <typename T>
+class CompiledForest
+{
+public:
+
+    typedef T ThresholdType;
+
+    struct Node
+    {
+        ThresholdType threshold;
+        UInt32 feature;
+        Int32 child;  // left child (relative to the tree's root) if >= 0, ~leaf_index otherwise
+    };
+
+    CompiledForest()
+    :   num_classes_(0),
+        num_features_(0),
+        average_(false)
+    {}
+
+    /// \brief Compile the given forest.
+    template <typename RF>
+    explicit CompiledForest(RF const & rf);
+
+    /// \brief Predict the probabilities of the given data (see RandomForest::predict_probabilities()).
+    /// \note probs should have the shape (features.shape()[0], num_classes).
+    template <typename FEATURES, typename PROBS>
+    void predict_probabilities(
+        FEATURES const & features,
+        PROBS & probs,
+        ParallelOptions const & options = ParallelOptions(),
+        std::vector<size_t> const & tree_indices = std::vector<size_t>()
+    ) const;
+
+    /// \brief Return the number of trees.
+    size_t num_trees() const
+    {
+        return tree_offsets_.size();
+    }
+
+    /// \brief Return the number of nodes.
+    size_t num_nodes() const
+    {
+        return nodes_.size();
+    }
+
+    /// \brief Return the number of classes.
+    size_t num_classes() const
+    {
+        return num_classes_;
+    }
+
+    /// \brief Return the number of features.
+    size_t num_features() const
+    {
+        return num_features_;
+    }
+
+    /// \brief The nodes of all trees.
+    std::vector<Node> const & nodes() const
+    {
+        return nodes_;
+    }
+
+    /// \brief The index of each tree's root in nodes().
+    std::vector<size_t> const & tree_offsets() const
+    {
+        return tree_offsets_;
+    }
+
+    /// \brief The class probabilities of the leaves (num_leaves x num_classes, class index is fastest).
+    std::vector<double> const & leaf_values() const
+    {
+        return leaf_values_;
+    }
+
+    /// \brief Whether the summed leaf values are divided by the number of trees.
+    bool average() const
+    {
+        return average_;
+    }
+
+private:
+
+    std::vector<Node> nodes_;
+    std::vector<size_t> tree_offsets_;
+    std::vector<double> leaf_values_;
+    size_t num_classes_;
+    size_t num_features_;
+    bool average_;
+};
+
+template <typename T>
+template <typename RF>
+CompiledForest<T>::CompiledForest(RF const & rf)
+    :
+    num_classes_(rf.num_classes()),
+    num_features_(rf.num_features()),
+    average_(detail::CompiledLeafTraits<typename RF::ACC>::average)
+{
+    typedef typename RF::Node RFNode;
+    typedef detail::CompiledLeafTraits<typename RF::ACC> LeafTraits;
+    static_assert(detail::CompiledSplitTraits<typename RF::SplitTests>::supported,
+                  "CompiledForest(): unsupported split test.");
+    static_assert(LeafTraits::supported,
+                  "CompiledForest(): unsupported accumulator.");
+
+    nodes_.reserve(rf.num_nodes());
+    std::vector<RFNode> order;
+    for (size_t k = 0; k < rf.num_trees(); ++k)
+    {
+        tree_offsets_.push_back(nodes_.size());
+
+        // breadth-first traversal, so that the children of a node are adjacent
+        order.clear();
+        order.push_back(rf.graph_.getRoot(k));
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            RFNode const n = order[i];
+            Node node;
+            if (rf.graph_.outDegree(n) > 0)
+            {
+                vigra_precondition(rf.graph_.outDegree(n) == 2,
+                    "CompiledForest(): inner nodes must have two children.");
+                auto const & test = rf.split_tests_.at(n);
+                node.threshold = test.val_;
+                node.feature = static_cast<UInt32>(test.dim_);
+                node.child = static_cast<Int32>(order.size());
+                order.push_back(rf.graph_.getChild(n, 0));
+                order.push_back(rf.graph_.getChild(n, 1));
+            }
+            else
+            {
+                size_t const leaf = leaf_values_.size() / num_classes_;
+                leaf_values_.resize(leaf_values_.size() + num_classes_, 0.0);
+                LeafTraits::leafValues(rf.node_responses_.at(n), &leaf_values_[leaf*num_classes_], num_classes_);
+                node.threshold = ThresholdType();
+                node.feature = 0;
+                node.child = ~static_cast<Int32>(leaf);
+            }
+            nodes_.push_back(node);
+        }
+    }
+}
+
+template <typename T>
+template <typename FEATURES, typename PROBS>
+void CompiledForest<T>::predict_probabilities(
+    FEATURES const & features,
+    PROBS & probs,
+    ParallelOptions const & options,
+    std::vector<size_t> const & tree_indices
+) const {
+    vigra_precondition(features.shape()[0] == probs.shape()[0],
+                       "CompiledForest::predict_probabilities(): Shape mismatch between features and probabilities.");
+    vigra_precondition((size_t)features.shape()[1] == num_features_,
+                       "CompiledForest::predict_probabilities(): Number of features in prediction differs from training.");
+    vigra_precondition((size_t)probs.shape()[1] == num_classes_,
+                       "CompiledForest::predict_probabilities(): Number of labels in probabilities differs from training.");
+
+    std::vector<size_t> const trees = detail::flatForestTrees(tree_indices, num_trees(), "CompiledForest::predict_probabilities()");
+    double const divisor = average_ ? static_cast<double>(trees.size()) : 1.0;
+    detail::predictFlatForest(nodes_.data(), tree_offsets_.data(), leaf_values_.data(), num_classes_,
+                              [](Node const & n) { return n.threshold; },
+                              features, probs, options, trees, divisor);
+}
+
+//@}
+
+} // namespace rf3
+} // namespace vigra
+
+#endif
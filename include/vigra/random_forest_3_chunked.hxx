@@ -0,0 +1,342 @@
+/************************************************************************/
+/*                                                                      */
+/*        Copyright 2014-2015 by Ullrich Koethe and Philip Schill       */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_RF3_CHUNKED_HXX
+#define VIGRA_RF3_CHUNKED_HXX
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "multi_array.hxx"
+#include "multi_array_chunked.hxx"
+#include "sampling.hxx"
+#include "threadpool.hxx"
+#include "random_forest_3.hxx"
+
+namespace vigra
+{
+
+namespace rf3
+{
+
+namespace detail
+{
+
+/// \brief Train the trees on bags of instances that are streamed from the chunked feature array.
+template <typename T,
+          typename LABELS,
+          typename SCORER,
+          typename STOP,
+          typename RANDENGINE>
+RandomForest<MultiArray<2, T>, LABELS>
+random_forest_chunked_impl(
+        ChunkedArray<2, T> const & features,
+        LABELS const & labels,
+        RandomForestOptions const & options,
+        STOP const & stop,
+        RANDENGINE & randengine
+){
+    typedef MultiArray<2, T> Features;
+    typedef typename LABELS::value_type LabelType;
+    typedef RandomForest<Features, LABELS> RF;
+
+    size_t const num_instances = features.shape(0);
+    size_t const num_features = features.shape(1);
+    vigra_precondition(num_instances == (size_t)labels.size(),
+                       "random_forest_chunked(): Shape mismatch between features and labels.");
+
+    // Check the number of trees.
+    size_t const tree_count = options.tree_count_;
+    vigra_precondition(tree_count > 0, "random_forest_chunked(): tree_count must not be zero.");
+    std::vector<RF> trees(tree_count);
+
+    // Transform the labels to 0, 1, 2, ...
+    ProblemSpec<LabelType> pspec;
+    MultiArray<1, size_t> transformed_labels;
+    transform_labels(labels, pspec, transformed_labels);
+    vigra_precondition(options.class_weights_.size() == 0 || options.class_weights_.size() == pspec.num_classes_,
+                       "random_forest_chunked(): The number of class weights must be 0 or equal to the number of classes.");
+
+    size_t const n_threads = training_threads(options);
+    std::vector<RANDENGINE> rand_engines = thread_rand_engines(randengine, n_threads);
+
+    // Find the bag size: The budget must hold the block of rows that is read from
+    // the chunked array, and one bag per thread with its features, bins, labels and
+    // the bookkeeping of the tree training.
+    size_t const block_rows = std::min<size_t>(num_instances, features.chunkShape()[0]);
+    size_t const block_bytes = block_rows * num_features * sizeof(T);
+    size_t const row_bytes = num_features * (sizeof(T) + (options.max_bins_ > 0 ? 1 : 0)) 
+                                + 4*sizeof(size_t) + 2*sizeof(double);
+    size_t bag_size = num_instances;
+    size_t trees_per_pass = tree_count;
+    if (options.memory_budget_ > 0)
+    {
+        vigra_precondition(options.memory_budget_ >= block_bytes + 2*row_bytes,
+                           "random_forest_chunked(): Memory budget is too small.");
+        size_t const budget_rows = (options.memory_budget_ - block_bytes) / row_bytes;
+        if (budget_rows < num_instances)
+        {
+            trees_per_pass = std::min(n_threads, tree_count);
+            bag_size = std::max<size_t>(2, budget_rows / trees_per_pass);
+            trees_per_pass = std::max<size_t>(1, std::min(trees_per_pass, budget_rows / bag_size));
+        }
+    }
+    // If the bag contains all instances, the trees share a single bag.
+    bool const shared_bag = (bag_size == num_instances);
+
+    pspec.num_instances(num_instances)
+         .num_features(num_features)
+         .actual_mtry(options.get_features_per_node(num_features))
+         .actual_msample(bag_size);
+    for (auto & t : trees)
+        t.problem_spec_ = pspec;
+
+    ThreadPool pool((size_t)n_threads);
+    for (size_t first_tree = 0; first_tree < tree_count; first_tree += trees_per_pass)
+    {
+        size_t const pass_trees = std::min(trees_per_pass, tree_count - first_tree);
+        size_t const num_bags = shared_bag ? 1 : pass_trees;
+
+        // Draw the bags.
+        std::vector<std::vector<size_t> > bag_indices(num_bags);
+        for (auto & indices : bag_indices)
+        {
+            if (shared_bag)
+            {
+                indices.resize(num_instances);
+                std::iota(indices.begin(), indices.end(), 0);
+            }
+            else
+            {
+                Sampler<RANDENGINE> sampler(num_instances, 
+                                            SamplerOptions().withoutReplacement().sampleSize(bag_size), 
+                                            &randengine);
+                sampler.sample();
+                indices.assign(sampler.sampledIndices().begin(), sampler.sampledIndices().end());
+                std::sort(indices.begin(), indices.end());
+            }
+        }
+
+        // Stream the features through memory, one block of rows at a time, 
+        // and copy the rows of each bag.
+        std::vector<Features> bag_features(num_bags, Features(Shape2(bag_size, num_features)));
+        std::vector<MultiArray<1, size_t> > bag_labels(num_bags, MultiArray<1, size_t>(Shape1(bag_size)));
+        std::vector<size_t> bag_pos(num_bags, 0);
+        {
+            Features block;
+            for (size_t row = 0; row < num_instances; row += block_rows)
+            {
+                size_t const row_end = std::min(num_instances, row + block_rows);
+                bool needed = false;
+                for (size_t b = 0; b < num_bags; ++b)
+                    needed = needed || (bag_pos[b] < bag_size && bag_indices[b][bag_pos[b]] < row_end);
+                if (!needed)
+                    continue;
+
+                if (block.shape(0) != MultiArrayIndex(row_end - row))
+                    block.reshape(Shape2(row_end - row, num_features));
+                features.checkoutSubarray(Shape2(row, 0), block);
+
+                for (size_t b = 0; b < num_bags; ++b)
+                {
+                    size_t & pos = bag_pos[b];
+                    for (; pos < bag_size && bag_indices[b][pos] < row_end; ++pos)
+                    {
+                        size_t const i = bag_indices[b][pos];
+                        bag_features[b].template bind<0>(pos) = block.template bind<0>(i - row);
+                        bag_labels[b](pos) = transformed_labels(i);
+                    }
+                }
+            }
+        }
+
+        // Quantize the features for the histogram-based split search.
+        std::vector<std::unique_ptr<FeatureBins<T> > > bag_bins(num_bags);
+        if (options.max_bins_ > 0)
+            for (size_t b = 0; b < num_bags; ++b)
+                bag_bins[b].reset(new FeatureBins<T>(bag_features[b], options.max_bins_));
+
+        // Train the trees.
+        std::vector<threading::future<void> > futures;
+        for (size_t k = 0; k < pass_trees; ++k)
+        {
+            size_t const b = shared_bag ? 0 : k;
+            futures.emplace_back(
+                pool.enqueue([&, b, k](size_t thread_id)
+                    {
+                        RFStopVisiting tree_visitor;
+                        random_forest_single_tree<RF, SCORER, RFStopVisiting, STOP>(
+                                bag_features[b], bag_labels[b], options, tree_visitor, stop, 
+                                trees[first_tree + k], rand_engines[thread_id], bag_bins[b].get());
+                    }
+                )
+            );
+        }
+        for (auto & fut : futures)
+            fut.get();
+    }
+
+    // Merge the trees together.
+    RF rf(trees[0]);
+    rf.options_ = options;
+    for (size_t i = 1; i < trees.size(); ++i)
+    {
+        rf.merge(trees[i]);
+    }
+    return rf;
+}
+
+/// \brief Get the stop criterion from the option object and pass it as template argument.
+template <typename T, typename LABELS, typename SCORER, typename RANDENGINE>
+inline
+RandomForest<MultiArray<2, T>, LABELS>
+random_forest_chunked_impl0(
+        ChunkedArray<2, T> const & features,
+        LABELS const & labels,
+        RandomForestOptions const & options,
+        RANDENGINE & randengine
+){
+    if (options.max_depth_ > 0)
+        return random_forest_chunked_impl<T, LABELS, SCORER, DepthStop, RANDENGINE>(features, labels, options, DepthStop(options.max_depth_), randengine);
+    else if (options.min_num_instances_ > 1)
+        return random_forest_chunked_impl<T, LABELS, SCORER, NumInstancesStop, RANDENGINE>(features, labels, options, NumInstancesStop(options.min_num_instances_), randengine);
+    else if (options.node_complexity_tau_ > 0)
+        return random_forest_chunked_impl<T, LABELS, SCORER, NodeComplexityStop, RANDENGINE>(features, labels, options, NodeComplexityStop(options.node_complexity_tau_), randengine);
+    else
+        return random_forest_chunked_impl<T, LABELS, SCORER, PurityStop, RANDENGINE>(features, labels, options, PurityStop(), randengine);
+}
+
+} // namespace detail
+
+/********************************************************/
+/*                                                      */
+/*                 random_forest_chunked                */
+/*                                                      */
+/********************************************************/
+
+/** \brief Train a \ref vigra::rf3::RandomForest classifier on features that don't fit into memory.
+
+    This function works like \ref vigra::rf3::random_forest(), but the features are given
+    as a \ref vigra::ChunkedArray of shape <tt>num_instances x num_features</tt>, for example
+    a \ref vigra::ChunkedArrayHDF5 or a \ref vigra::ChunkedArrayCompressed. The labels must 
+    still fit into memory.
+
+    When a memory budget is set via \ref vigra::rf3::RandomForestOptions::memory_budget(), 
+    each tree is trained on a random subset of the instances (a bag), whose size is chosen
+    such that one bag per training thread fits into the budget. The bags of the trees that
+    are trained concurrently are filled in a single pass over the chunked array. Within
+    the bag, the usual bootstrap sampling is applied when enabled in the options.
+    Without a memory budget, all instances are loaded into memory once and shared by 
+    all trees, which gives the same forest as \ref vigra::rf3::random_forest().
+
+    Visitors are not supported, since they need access to the full feature matrix.
+
+    <b> Declaration:</b>
+
+    \code
+    namespace vigra { namespace rf3 {
+        template <typename T,
+                  typename LABELS,
+                  typename RANDENGINE = vigra::MersenneTwister>
+        vigra::rf3::RandomForest<vigra::MultiArray<2, T>, LABELS>
+        random_forest_chunked(
+                vigra::ChunkedArray<2, T> const & features,
+                LABELS const & labels,
+                vigra::rf3::RandomForestOptions const & options = vigra::rf3::RandomForestOptions(),
+                RANDENGINE & randengine = vigra::MersenneTwister::global()
+        );
+    }}
+    \endcode
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/random_forest_3_chunked.hxx\><br>
+    Namespace: vigra::rf3
+
+    \code
+    using namespace vigra;
+
+    ChunkedArrayHDF5<2, float> train_features(HDF5File("features.h5", HDF5File::OpenReadOnly), "features");
+    MultiArray<1, int>         train_labels(Shape1(train_features.shape(0)));
+    ... // fill labels
+
+    // use at most 2 GB for the training data
+    auto rf = rf3::random_forest_chunked(train_features, train_labels,
+                                         rf3::RandomForestOptions().tree_count(100)
+                                                                   .memory_budget(size_t(2) << 30));
+    \endcode
+*/
+doxygen_overloaded_function(template <...> void random_forest_chunked)
+
+template <typename T, typename LABELS, typename RANDENGINE>
+inline
+RandomForest<MultiArray<2, T>, LABELS>
+random_forest_chunked(
+        ChunkedArray<2, T> const & features,
+        LABELS const & labels,
+        RandomForestOptions const & options,
+        RANDENGINE & randengine
+){
+    typedef detail::GeneralScorer<GiniScore> GiniScorer;
+    typedef detail::GeneralScorer<EntropyScore> EntropyScorer;
+    typedef detail::GeneralScorer<KolmogorovSmirnovScore> KSDScorer;
+    if (options.split_ == RF_GINI)
+        return detail::random_forest_chunked_impl0<T, LABELS, GiniScorer, RANDENGINE>(features, labels, options, randengine);
+    else if (options.split_ == RF_ENTROPY)
+        return detail::random_forest_chunked_impl0<T, LABELS, EntropyScorer, RANDENGINE>(features, labels, options, randengine);
+    else if (options.split_ == RF_KSD)
+        return detail::random_forest_chunked_impl0<T, LABELS, KSDScorer, RANDENGINE>(features, labels, options, randengine);
+    else
+        throw std::runtime_error("random_forest_chunked(): Unknown split criterion.");
+}
+
+template <typename T, typename LABELS>
+inline
+RandomForest<MultiArray<2, T>, LABELS>
+random_forest_chunked(
+        ChunkedArray<2, T> const & features,
+        LABELS const & labels,
+        RandomForestOptions const & options = RandomForestOptions()
+){
+    auto randengine = MersenneTwister::global();
+    return random_forest_chunked(features, labels, options, randengine);
+}
+
+} // namespace rf3
+
+} // namespace vigra
+
+#endif
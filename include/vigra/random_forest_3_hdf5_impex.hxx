@@ -47,6 +47,7 @@
 #include "random_forest_3/random_forest_common.hxx"
 #include "random_forest_3/random_forest_visitors.hxx"
 #include "hdf5impex.hxx"
+#include "random_forest_3_model.hxx"
 
 namespace vigra 
 {
@@ -417,6 +418,36 @@ void random_forest_export_HDF5(
 }
 
 
+/** \brief Convert a forest stored in HDF5 into a flat model file.
+
+    Equivalent to \ref vigra::rf3::random_forest_import_HDF5() followed by
+    \ref vigra::rf3::random_forest_export_model().
+*/
+template <typename FEATURES, typename LABELS>
+void random_forest_model_from_HDF5(
+        HDF5File & h5ctx,
+        std::string const & model_filename,
+        ModelThresholds thresholds = RF_THRESHOLD_FLOAT32,
+        std::string const & pathname = ""
+){
+    auto const rf = random_forest_import_HDF5<FEATURES, LABELS>(h5ctx, pathname);
+    random_forest_export_model(rf, model_filename, thresholds);
+}
+
+/** \brief Convert a flat model file into the HDF5 layout.
+
+    Equivalent to \ref vigra::rf3::random_forest_import_model() followed by
+    \ref vigra::rf3::random_forest_export_HDF5().
+*/
+template <typename FEATURES, typename LABELS>
+void random_forest_model_to_HDF5(
+        std::string const & model_filename,
+        HDF5File & h5ctx,
+        std::string const & pathname = ""
+){
+    auto const rf = random_forest_import_model<FEATURES, LABELS>(model_filename);
+    random_forest_export_HDF5(rf, h5ctx, pathname);
+}
 
 } // namespace rf3
 } // namespace vigra
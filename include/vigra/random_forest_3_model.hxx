@@ -0,0 +1,807 @@
+/************************************************************************/
+/*                                                                      */
+/*        Copyright 2014-2015 by Ullrich Koethe and Philip Schill       */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_RF3_MODEL_HXX
+#define VIGRA_RF3_MODEL_HXX
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+
+#include "config.hxx"
+#include "sized_int.hxx"
+#include "threadpool.hxx"
+#include "random_forest_3.hxx"
+#include "random_forest_3/random_forest_compiled.hxx"
+
+#ifdef _WIN32
+# include "windows.h"
+#else
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/stat.h>
+# include <sys/mman.h>
+#endif
+
+namespace vigra
+{
+
+namespace rf3
+{
+
+/** \addtogroup MachineLearning
+**/
+//@{
+
+/** \brief Representation of the split thresholds in a forest model file.
+
+    See \ref vigra::rf3::random_forest_export_model().
+*/
+enum ModelThresholds
+{
+    RF_THRESHOLD_FLOAT32 = 0,  ///< single precision (lossless for forests trained on float features)
+    RF_THRESHOLD_FLOAT16 = 1,  ///< half precision
+    RF_THRESHOLD_UINT8   = 2   ///< index into a table of at most 256 thresholds per feature
+};
+
+namespace detail
+{
+
+static const char rf_model_magic[8] = { 'V', 'I', 'G', 'R', 'A', 'R', 'F', '3' };
+static const UInt32 rf_model_version = 1;
+static const UInt32 rf_model_byte_order = 0x01020304;
+static const std::size_t rf_model_alignment = 64;
+
+// The header at the beginning of a model file. All positions are byte offsets
+// from the start of the file and are aligned to rf_model_alignment.
+struct ModelHeader
+{
+    char magic[8];
+    UInt32 version;
+    UInt32 byte_order;
+    UInt32 thresholds;         // a ModelThresholds value
+    UInt32 average;            // divide the summed leaf values by the number of trees
+    UInt64 num_trees;
+    UInt64 num_nodes;
+    UInt64 num_leaves;
+    UInt64 num_classes;
+    UInt64 num_features;
+    UInt64 num_instances;      // remaining fields of the ProblemSpec
+    UInt64 actual_mtry;
+    UInt64 actual_msample;
+    UInt64 tree_offsets_pos;   // UInt64[num_trees]
+    UInt64 nodes_pos;          // ModelNode32[num_nodes] or ModelNode16[num_nodes]
+    UInt64 leaves_pos;         // float[num_leaves * num_classes]
+    UInt64 codebook_pos;       // float[num_features * 256] (RF_THRESHOLD_UINT8 only)
+    UInt64 classes_pos;        // double[num_classes], the distinct labels
+    UInt64 file_size;
+};
+
+// node for RF_THRESHOLD_FLOAT32
+struct ModelNode32
+{
+    float threshold;
+    UInt32 feature;
+    Int32 child;   // left child (relative to the tree's root) if >= 0, ~leaf_index otherwise
+};
+
+// node for RF_THRESHOLD_FLOAT16 and RF_THRESHOLD_UINT8
+struct ModelNode16
+{
+    UInt16 threshold;  // half precision float or index into the feature's codebook
+    UInt16 feature;
+    Int32 child;
+};
+
+/// Convert a float to half precision (round to nearest even).
+inline UInt16 floatToHalf(float f)
+{
+    UInt32 x;
+    std::memcpy(&x, &f, sizeof(x));
+    UInt32 const sign = (x >> 16) & 0x8000;
+    UInt32 mant = x & 0x7fffff;
+    if ((x & 0x7fffffff) >= 0x7f800000)                // inf or nan
+        return static_cast<UInt16>(sign | 0x7c00 | (mant ? 0x200 : 0));
+    int const exp = static_cast<int>((x >> 23) & 0xff) - 127 + 15;
+    if (exp >= 31)                                      // overflow
+        return static_cast<UInt16>(sign | 0x7c00);
+    if (exp <= 0)                                       // subnormal or zero
+    {
+        if (exp < -10)
+            return static_cast<UInt16>(sign);
+        mant |= 0x800000;
+        UInt32 const shift = 14 - exp;
+        UInt32 h = mant >> shift;
+        UInt32 const rem = mant & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+        if (rem > halfway || (rem == halfway && (h & 1)))
+            ++h;
+        return static_cast<UInt16>(sign | h);
+    }
+    UInt32 h = sign | (static_cast<UInt32>(exp) << 10) | (mant >> 13);
+    UInt32 const rem = mant & 0x1fff;
+    if (rem > 0x1000 || (rem == 0x1000 && (h & 1)))
+        ++h;                                            // a carry correctly rounds up to the next exponent
+    return static_cast<UInt16>(h);
+}
+
+/// Convert a half precision float to float.
+inline float halfToFloat(UInt16 h)
+{
+    UInt32 const sign = static_cast<UInt32>(h & 0x8000) << 16;
+    UInt32 exp = (h >> 10) & 0x1f;
+    UInt32 mant = h & 0x3ff;
+    UInt32 x;
+    if (exp == 0)
+    {
+        if (mant == 0)
+        {
+            x = sign;
+        }
+        else
+        {
+            // normalize the subnormal number
+            exp = 127 - 15 + 1;
+            while ((mant & 0x400) == 0)
+            {
+                mant <<= 1;
+                --exp;
+            }
+            x = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+        }
+    }
+    else if (exp == 31)
+    {
+        x = sign | 0x7f800000 | (mant << 13);
+    }
+    else
+    {
+        x = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+    }
+    float f;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+inline UInt64 alignModelPos(UInt64 pos)
+{
+    return (pos + rf_model_alignment - 1) / rf_model_alignment * rf_model_alignment;
+}
+
+// Choose at most 256 thresholds per feature for RF_THRESHOLD_UINT8. If a feature
+// has more distinct thresholds, the codebook contains equally spaced quantiles of 
+// them, and each threshold is replaced by the nearest codebook entry.
+template <typename NODE>
+std::vector<float> modelCodebook(std::vector<NODE> const & nodes, size_t num_features)
+{
+    std::vector<std::vector<float> > values(num_features);
+    for (auto const & n : nodes)
+        if (n.child >= 0)
+            values[n.feature].push_back(static_cast<float>(n.threshold));
+
+    std::vector<float> codebook(num_features*256, std::numeric_limits<float>::infinity());
+    for (size_t d = 0; d < num_features; ++d)
+    {
+        std::vector<float> & v = values[d];
+        std::sort(v.begin(), v.end());
+        v.erase(std::unique(v.begin(), v.end()), v.end());
+        float * c = &codebook[d*256];
+        if (v.size() <= 256)
+        {
+            std::copy(v.begin(), v.end(), c);
+        }
+        else
+        {
+            for (size_t k = 0; k < 256; ++k)
+                c[k] = v[(k * (v.size() - 1)) / 255];
+        }
+    }
+    return codebook;
+}
+
+inline UInt16 modelCodebookIndex(float const * codebook, float t)
+{
+    float const * end = std::find(codebook, codebook + 256, std::numeric_limits<float>::infinity());
+    float const * p = std::lower_bound(codebook, end, t);
+    if (p == end)
+        --p;
+    else if (p != codebook && t - *(p-1) < *p - t)
+        --p;
+    return static_cast<UInt16>(p - codebook);
+}
+
+} // namespace detail
+
+/********************************************************/
+/*                                                      */
+/*               random_forest_export_model             */
+/*                                                      */
+/********************************************************/
+
+/** \brief Write a \ref vigra::rf3::RandomForest to a flat binary model file.
+
+    The model file contains the compiled representation of the forest (see 
+    \ref vigra::rf3::CompiledForest), with the leaf probabilities in single precision 
+    and the split thresholds represented as selected by \a thresholds:
+
+    <ul>
+    <li> <tt>RF_THRESHOLD_FLOAT32</tt>: 12 bytes per node. The model gives the same 
+         decisions as the forest if it was trained on <tt>float</tt> features.
+    <li> <tt>RF_THRESHOLD_FLOAT16</tt>: 8 bytes per node, thresholds rounded to half precision.
+    <li> <tt>RF_THRESHOLD_UINT8</tt>: 8 bytes per node, and a table of up to 256 
+         thresholds per feature. Lossless (up to single precision) if no feature is used 
+         with more than 256 distinct thresholds, otherwise each threshold is replaced by 
+         the nearest of 256 quantiles.
+    </ul>
+
+    The file is used for prediction without deserialization by \ref vigra::rf3::ForestModel.
+    Supported forests are those that can be compiled (see \ref vigra::rf3::CompiledForest).
+    The file is written in the byte order of the machine.
+
+    <b>\#include</b> \<vigra/random_forest_3_model.hxx\><br>
+    Namespace: vigra::rf3
+*/
+template <typename RF>
+void random_forest_export_model(
+        RF const & rf,
+        std::string const & filename,
+        ModelThresholds thresholds = RF_THRESHOLD_FLOAT32
+){
+    typedef typename RF::Compiled Compiled;
+
+    Compiled const compiled = rf.compile();
+    auto const & nodes = compiled.nodes();
+    auto const & spec = rf.problem_spec_;
+    size_t const num_classes = compiled.num_classes();
+    size_t const num_leaves = compiled.leaf_values().size() / std::max<size_t>(num_classes, 1);
+    vigra_precondition(thresholds == RF_THRESHOLD_FLOAT32 || compiled.num_features() <= 0x10000,
+        "random_forest_export_model(): Quantized thresholds require at most 65536 features.");
+
+    detail::ModelHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, detail::rf_model_magic, sizeof(header.magic));
+    header.version = detail::rf_model_version;
+    header.byte_order = detail::rf_model_byte_order;
+    header.thresholds = thresholds;
+    header.average = compiled.average() ? 1 : 0;
+    header.num_trees = compiled.num_trees();
+    header.num_nodes = nodes.size();
+    header.num_leaves = num_leaves;
+    header.num_classes = num_classes;
+    header.num_features = compiled.num_features();
+    header.num_instances = spec.num_instances_;
+    header.actual_mtry = spec.actual_mtry_;
+    header.actual_msample = spec.actual_msample_;
+
+    size_t const node_size = thresholds == RF_THRESHOLD_FLOAT32
+                                 ? sizeof(detail::ModelNode32)
+                                 : sizeof(detail::ModelNode16);
+    UInt64 pos = detail::alignModelPos(sizeof(header));
+    header.tree_offsets_pos = pos;
+    pos = detail::alignModelPos(pos + header.num_trees*sizeof(UInt64));
+    header.nodes_pos = pos;
+    pos = detail::alignModelPos(pos + header.num_nodes*node_size);
+    header.leaves_pos = pos;
+    pos = detail::alignModelPos(pos + num_leaves*num_classes*sizeof(float));
+    header.codebook_pos = pos;
+    if (thresholds == RF_THRESHOLD_UINT8)
+        pos = detail::alignModelPos(pos + header.num_features*256*sizeof(float));
+    header.classes_pos = pos;
+    pos = detail::alignModelPos(pos + num_classes*sizeof(double));
+    header.file_size = pos;
+
+    std::vector<char> buffer(pos, 0);
+    std::memcpy(&buffer[0], &header, sizeof(header));
+
+    UInt64 * offsets = reinterpret_cast<UInt64 *>(&buffer[header.tree_offsets_pos]);
+    std::copy(compiled.tree_offsets().begin(), compiled.tree_offsets().end(), offsets);
+
+    if (thresholds == RF_THRESHOLD_FLOAT32)
+    {
+        detail::ModelNode32 * out = reinterpret_cast<detail::ModelNode32 *>(&buffer[header.nodes_pos]);
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            out[i].threshold = static_cast<float>(nodes[i].threshold);
+            out[i].feature = nodes[i].feature;
+            out[i].child = nodes[i].child;
+        }
+    }
+    else
+    {
+        std::vector<float> codebook;
+        if (thresholds == RF_THRESHOLD_UINT8)
+        {
+            codebook = detail::modelCodebook(nodes, compiled.num_features());
+            std::copy(codebook.begin(), codebook.end(), reinterpret_cast<float *>(&buffer[header.codebook_pos]));
+        }
+        detail::ModelNode16 * out = reinterpret_cast<detail::ModelNode16 *>(&buffer[header.nodes_pos]);
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            out[i].feature = static_cast<UInt16>(nodes[i].feature);
+            out[i].child = nodes[i].child;
+            out[i].threshold = 0;
+            if (nodes[i].child < 0)
+                continue;
+            float const t = static_cast<float>(nodes[i].threshold);
+            out[i].threshold = thresholds == RF_THRESHOLD_FLOAT16
+                                   ? detail::floatToHalf(t)
+                                   : detail::modelCodebookIndex(&codebook[nodes[i].feature*256], t);
+        }
+    }
+
+    float * leaves = reinterpret_cast<float *>(&buffer[header.leaves_pos]);
+    for (size_t i = 0; i < compiled.leaf_values().size(); ++i)
+        leaves[i] = static_cast<float>(compiled.leaf_values()[i]);
+
+    double * classes = reinterpret_cast<double *>(&buffer[header.classes_pos]);
+    for (size_t i = 0; i < spec.distinct_classes_.size(); ++i)
+        classes[i] = static_cast<double>(spec.distinct_classes_[i]);
+
+    std::ofstream file(filename.c_str(), std::ios::binary | std::ios::trunc);
+    vigra_precondition(file.good(), "random_forest_export_model(): unable to open file '" + filename + "'.");
+    file.write(&buffer[0], buffer.size());
+    vigra_postcondition(file.good(), "random_forest_export_model(): write error.");
+}
+
+/********************************************************/
+/*                                                      */
+/*                    rf3::ForestModel                  */
+/*                                                      */
+/********************************************************/
+
+/** \brief Memory-mapped forest model for fast loading and prediction.
+
+    A ForestModel maps a file written by \ref vigra::rf3::random_forest_export_model()
+    into memory and predicts directly on the mapped data, so that opening even large 
+    forests is fast. The pages of the file are shared by all processes that use the 
+    same model. The constructor validates the file (a single pass over the nodes) and 
+    throws a <tt>PreconditionViolation</tt> if it is truncated or corrupt.
+
+    <b> Usage:</b>
+
+    <b>\#include</b> \<vigra/random_forest_3_model.hxx\><br>
+    Namespace: vigra::rf3
+
+    \code
+    auto rf = rf3::random_forest(train_features, train_labels);
+    rf3::random_forest_export_model(rf, "forest.vrf", rf3::RF_THRESHOLD_FLOAT16);
+    ...
+    rf3::ForestModel model("forest.vrf");
+    MultiArray<2, double> probs(Shape2(test_features.shape(0), model.num_classes()));
+    model.predict_probabilities(test_features, probs);
+    \endcode
+*/
+class ForestModel
+{
+public:
+
+    /// \brief Open and map the given model file.
+    explicit ForestModel(std::string const & filename)
+    :   data_(0),
+        size_(0)
+    {
+    #ifdef _WIN32
+        file_ = ::CreateFile(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file_ == INVALID_HANDLE_VALUE)
+            throw std::runtime_error("ForestModel(): unable to open file '" + filename + "'.");
+        LARGE_INTEGER file_size;
+        if (!::GetFileSizeEx(file_, &file_size))
+        {
+            ::CloseHandle(file_);
+            throw std::runtime_error("ForestModel(): unable to determine the file size.");
+        }
+        size_ = (std::size_t)file_size.QuadPart;
+        mapping_ = CreateFileMapping(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping_)
+        {
+            ::CloseHandle(file_);
+            throw std::runtime_error("ForestModel(): unable to map file '" + filename + "'.");
+        }
+        data_ = (char const *)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+        if (data_ == 0)
+        {
+            ::CloseHandle(mapping_);
+            ::CloseHandle(file_);
+            throw std::runtime_error("ForestModel(): unable to map file '" + filename + "'.");
+        }
+    #else
+        int file = ::open(filename.c_str(), O_RDONLY);
+        if (file == -1)
+            throw std::runtime_error("ForestModel(): unable to open file '" + filename + "'.");
+        struct stat info;
+        if (fstat(file, &info) == -1)
+        {
+            ::close(file);
+            throw std::runtime_error("ForestModel(): unable to determine the file size.");
+        }
+        size_ = (std::size_t)info.st_size;
+        void * data = size_ > 0
+                         ? mmap(0, size_, PROT_READ, MAP_SHARED, file, 0)
+                         : MAP_FAILED;
+        ::close(file);
+        if (data == MAP_FAILED)
+            throw std::runtime_error("ForestModel(): unable to map file '" + filename + "'.");
+        data_ = (char const *)data;
+    #endif
+        try
+        {
+            check();
+        }
+        catch (...)
+        {
+            unmap();
+            throw;
+        }
+    }
+
+    ~ForestModel()
+    {
+        unmap();
+    }
+
+    /// \brief Predict the probabilities of the given data (see RandomForest::predict_probabilities()).
+    /// \note probs should have the shape (features.shape()[0], num_classes).
+    template <typename FEATURES, typename PROBS>
+    void predict_probabilities(
+        FEATURES const & features,
+        PROBS & probs,
+        ParallelOptions const & options = ParallelOptions(),
+        std::vector<size_t> const & tree_indices = std::vector<size_t>()
+    ) const {
+        vigra_precondition(features.shape()[0] == probs.shape()[0],
+                           "ForestModel::predict_probabilities(): Shape mismatch between features and probabilities.");
+        vigra_precondition((size_t)features.shape()[1] == num_features(),
+                           "ForestModel::predict_probabilities(): Number of features in prediction differs from training.");
+        vigra_precondition((size_t)probs.shape()[1] == num_classes(),
+                           "ForestModel::predict_probabilities(): Number of labels in probabilities differs from training.");
+
+        std::vector<size_t> const trees = detail::flatForestTrees(tree_indices, num_trees(), "ForestModel::predict_probabilities()");
+        double const divisor = header().average ? static_cast<double>(trees.size()) : 1.0;
+        UInt64 const * offsets = section<UInt64>(header().tree_offsets_pos);
+        float const * leaves = section<float>(header().leaves_pos);
+        switch (thresholds())
+        {
+          case RF_THRESHOLD_FLOAT32:
+            detail::predictFlatForest(section<detail::ModelNode32>(header().nodes_pos), offsets, leaves, num_classes(),
+                                      [](detail::ModelNode32 const & n) { return n.threshold; },
+                                      features, probs, options, trees, divisor);
+            break;
+          case RF_THRESHOLD_FLOAT16:
+            detail::predictFlatForest(section<detail::ModelNode16>(header().nodes_pos), offsets, leaves, num_classes(),
+                                      [](detail::ModelNode16 const & n) { return detail::halfToFloat(n.threshold); },
+                                      features, probs, options, trees, divisor);
+            break;
+          case RF_THRESHOLD_UINT8:
+          {
+            float const * codebook = section<float>(header().codebook_pos);
+            detail::predictFlatForest(section<detail::ModelNode16>(header().nodes_pos), offsets, leaves, num_classes(),
+                                      [codebook](detail::ModelNode16 const & n) { return codebook[n.feature*256 + n.threshold]; },
+                                      features, probs, options, trees, divisor);
+            break;
+          }
+        }
+    }
+
+    /// \brief Predict the labels of the given data (see RandomForest::predict()).
+    /// \note labels must be a 1-D array with size <tt>features.shape(0)</tt>.
+    template <typename FEATURES, typename LABELS>
+    void predict(
+        FEATURES const & features,
+        LABELS & labels,
+        ParallelOptions const & options = ParallelOptions(),
+        std::vector<size_t> const & tree_indices = std::vector<size_t>()
+    ) const {
+        typedef typename LABELS::value_type LabelType;
+        vigra_precondition(features.shape()[0] == labels.shape()[0],
+                           "ForestModel::predict(): Shape mismatch between features and labels.");
+        MultiArray<2, double> probs(Shape2(features.shape()[0], num_classes()));
+        predict_probabilities(features, probs, options, tree_indices);
+        double const * classes = section<double>(header().classes_pos);
+        for (MultiArrayIndex i = 0; i < features.shape()[0]; ++i)
+        {
+            auto const sub_probs = probs.template bind<0>(i);
+            auto it = std::max_element(sub_probs.begin(), sub_probs.end());
+            labels(i) = static_cast<LabelType>(classes[std::distance(sub_probs.begin(), it)]);
+        }
+    }
+
+    /// \brief Convert the model back into a \ref vigra::rf3::RandomForest.
+    /// \note Quantized thresholds are not restored, the forest uses the rounded ones.
+    template <typename RF>
+    void to_random_forest(RF & rf) const
+    {
+        switch (thresholds())
+        {
+          case RF_THRESHOLD_FLOAT32:
+            to_random_forest_impl(rf, section<detail::ModelNode32>(header().nodes_pos),
+                                  [](detail::ModelNode32 const & n) { return n.threshold; });
+            break;
+          case RF_THRESHOLD_FLOAT16:
+            to_random_forest_impl(rf, section<detail::ModelNode16>(header().nodes_pos),
+                                  [](detail::ModelNode16 const & n) { return detail::halfToFloat(n.threshold); });
+            break;
+          case RF_THRESHOLD_UINT8:
+          {
+            float const * codebook = section<float>(header().codebook_pos);
+            to_random_forest_impl(rf, section<detail::ModelNode16>(header().nodes_pos),
+                                  [codebook](detail::ModelNode16 const & n) { return codebook[n.feature*256 + n.threshold]; });
+            break;
+          }
+        }
+    }
+
+    /// \brief Return the number of trees.
+    size_t num_trees() const
+    {
+        return header().num_trees;
+    }
+
+    /// \brief Return the number of nodes.
+    size_t num_nodes() const
+    {
+        return header().num_nodes;
+    }
+
+    /// \brief Return the number of classes.
+    size_t num_classes() const
+    {
+        return header().num_classes;
+    }
+
+    /// \brief Return the number of features.
+    size_t num_features() const
+    {
+        return header().num_features;
+    }
+
+    /// \brief Return the representation of the thresholds.
+    ModelThresholds thresholds() const
+    {
+        return static_cast<ModelThresholds>(header().thresholds);
+    }
+
+    /// \brief Return the size of the model file in bytes.
+    size_t file_size() const
+    {
+        return size_;
+    }
+
+private:
+
+    ForestModel(ForestModel const &);             // forbidden
+    ForestModel & operator=(ForestModel const &); // forbidden
+
+    detail::ModelHeader const & header() const
+    {
+        return *reinterpret_cast<detail::ModelHeader const *>(data_);
+    }
+
+    template <typename T>
+    T const * section(UInt64 pos) const
+    {
+        return reinterpret_cast<T const *>(data_ + pos);
+    }
+
+    void check() const
+    {
+        vigra_precondition(size_ >= sizeof(detail::ModelHeader) &&
+                           std::memcmp(header().magic, detail::rf_model_magic, sizeof(header().magic)) == 0,
+                           "ForestModel(): not a forest model file.");
+        vigra_precondition(header().byte_order == detail::rf_model_byte_order,
+                           "ForestModel(): the model was written on a machine with different byte order.");
+        vigra_precondition(header().version <= detail::rf_model_version,
+                           "ForestModel(): unsupported file format version.");
+        vigra_precondition(header().thresholds <= RF_THRESHOLD_UINT8,
+                           "ForestModel(): unknown threshold representation.");
+        vigra_precondition(header().file_size <= size_,
+                           "ForestModel(): file is truncated.");
+
+        // All sections must lie within the file, so that section() never reads
+        // outside the mapping. Check the number of classes first, it is a factor
+        // of the size of the leaves.
+        detail::ModelHeader const & h = header();
+        size_t const node_size = thresholds() == RF_THRESHOLD_FLOAT32
+                                     ? sizeof(detail::ModelNode32)
+                                     : sizeof(detail::ModelNode16);
+        vigra_precondition(fits(h.classes_pos, h.num_classes, sizeof(double)) &&
+                           fits(h.tree_offsets_pos, h.num_trees, sizeof(UInt64)) &&
+                           fits(h.nodes_pos, h.num_nodes, node_size) &&
+                           fits(h.leaves_pos, h.num_leaves, h.num_classes*sizeof(float)) &&
+                           (thresholds() != RF_THRESHOLD_UINT8 ||
+                            fits(h.codebook_pos, h.num_features, 256*sizeof(float))),
+                           "ForestModel(): file is corrupt (section out of range).");
+
+        switch (thresholds())
+        {
+          case RF_THRESHOLD_FLOAT32:
+            check_trees(section<detail::ModelNode32>(h.nodes_pos));
+            break;
+          default:
+            check_trees(section<detail::ModelNode16>(h.nodes_pos));
+        }
+    }
+
+    // true if 'count' elements of 'size' bytes at 'pos' lie within the file
+    bool fits(UInt64 pos, UInt64 count, UInt64 size) const
+    {
+        UInt64 const end = header().file_size;
+        return pos % detail::rf_model_alignment == 0 &&
+               pos >= sizeof(detail::ModelHeader) && pos <= end &&
+               (size == 0 || count <= (end - pos) / size);
+    }
+
+    // Every tree must be non-empty, and the children of a split must follow
+    // their parent within the same tree (so that prediction terminates).
+    // Features, leaves, and codebook entries must be in range.
+    template <typename NODE>
+    void check_trees(NODE const * nodes) const
+    {
+        detail::ModelHeader const & h = header();
+        UInt64 const * offsets = section<UInt64>(h.tree_offsets_pos);
+        for (size_t k = 0; k < num_trees(); ++k)
+        {
+            UInt64 const begin = offsets[k];
+            UInt64 const end = (k + 1 < num_trees()) ? offsets[k+1] : h.num_nodes;
+            vigra_precondition(begin < end && end <= h.num_nodes,
+                               "ForestModel(): file is corrupt (invalid tree offsets).");
+            for (UInt64 i = begin; i < end; ++i)
+            {
+                NODE const & n = nodes[i];
+                if (n.child >= 0)
+                {
+                    vigra_precondition(i - begin < (UInt64)n.child && (UInt64)n.child + 1 < end - begin,
+                                       "ForestModel(): file is corrupt (child index out of range).");
+                    vigra_precondition(n.feature < h.num_features &&
+                                       (thresholds() != RF_THRESHOLD_UINT8 || n.threshold < 256),
+                                       "ForestModel(): file is corrupt (feature or threshold out of range).");
+                }
+                else
+                {
+                    vigra_precondition(static_cast<UInt64>(~n.child) < h.num_leaves,
+                                       "ForestModel(): file is corrupt (leaf index out of range).");
+                }
+            }
+        }
+    }
+
+    void unmap()
+    {
+        if (data_ == 0)
+            return;
+    #ifdef _WIN32
+        ::UnmapViewOfFile(data_);
+        ::CloseHandle(mapping_);
+        ::CloseHandle(file_);
+    #else
+        munmap(const_cast<char *>(data_), size_);
+    #endif
+        data_ = 0;
+    }
+
+    template <typename RF, typename NODE, typename THRESHOLD>
+    void to_random_forest_impl(RF & rf, NODE const * nodes, THRESHOLD const & threshold) const
+    {
+        typedef typename RF::Node Node;
+        typedef typename RF::SplitTests SplitTests;
+        typedef typename RF::LabelType LabelType;
+        typedef typename RF::FeatureType FeatureType;
+
+        rf = RF();
+        size_t const C = num_classes();
+        UInt64 const * offsets = section<UInt64>(header().tree_offsets_pos);
+        float const * leaves = section<float>(header().leaves_pos);
+        double const * classes = section<double>(header().classes_pos);
+
+        std::vector<Node> tree_nodes;
+        detail::RFMapUpdater<typename RF::ACC> node_map_updater;
+        for (size_t k = 0; k < num_trees(); ++k)
+        {
+            size_t const begin = offsets[k];
+            size_t const end = (k + 1 < num_trees()) ? offsets[k+1] : num_nodes();
+            tree_nodes.clear();
+            for (size_t i = begin; i < end; ++i)
+                tree_nodes.push_back(rf.graph_.addNode());
+            for (size_t i = begin; i < end; ++i)
+            {
+                NODE const & n = nodes[i];
+                Node const node = tree_nodes[i - begin];
+                if (n.child >= 0)
+                {
+                    rf.graph_.addArc(node, tree_nodes[n.child]);
+                    rf.graph_.addArc(node, tree_nodes[n.child + 1]);
+                    rf.split_tests_.insert(node, SplitTests(n.feature, static_cast<FeatureType>(threshold(n))));
+                }
+                else
+                {
+                    float const * leaf = leaves + (size_t)(~n.child)*C;
+                    std::vector<double> distribution(leaf, leaf + C);
+                    rf.node_responses_.insert(node, typename RF::AccInputType());
+                    node_map_updater(rf.node_responses_.at(node), distribution);
+                }
+            }
+        }
+
+        std::vector<LabelType> distinct_classes;
+        for (size_t c = 0; c < C; ++c)
+            distinct_classes.push_back(static_cast<LabelType>(classes[c]));
+        rf.problem_spec_.num_features(num_features())
+                        .num_instances(header().num_instances)
+                        .actual_mtry(header().actual_mtry)
+                        .actual_msample(header().actual_msample)
+                        .distinct_classes(distinct_classes);
+    }
+
+    char const * data_;
+    std::size_t size_;
+#ifdef _WIN32
+    HANDLE file_, mapping_;
+#endif
+};
+
+/********************************************************/
+/*                                                      */
+/*               random_forest_import_model             */
+/*                                                      */
+/********************************************************/
+
+/** \brief Read a model file into a \ref vigra::rf3::RandomForest.
+
+    This is the inverse of \ref vigra::rf3::random_forest_export_model(). Use it to 
+    convert the model into the HDF5 layout (see \ref vigra::rf3::random_forest_export_HDF5()) 
+    or to continue working with the forest. For prediction, \ref vigra::rf3::ForestModel 
+    is much faster to load.
+
+    <b>\#include</b> \<vigra/random_forest_3_model.hxx\><br>
+    Namespace: vigra::rf3
+*/
+template <typename FEATURES, typename LABELS>
+typename DefaultRF<FEATURES, LABELS>::type
+random_forest_import_model(std::string const & filename)
+{
+    typename DefaultRF<FEATURES, LABELS>::type rf;
+    ForestModel(filename).to_random_forest(rf);
+    return rf;
+}
+
+//@}
+
+} // namespace rf3
+
+} // namespace vigra
+
+#endif
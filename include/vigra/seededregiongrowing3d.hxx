@@ -343,10 +343,11 @@ seededRegionGrowing3D(SrcImageIterator srcul, Diff_type shape, SrcAccessor as,
     typedef typename PromoteTraits<typename RegionStatistics::cost_type, double>::Promote CostType;
     typedef detail::SeedRgVoxel<CostType, Diff_type> Voxel;
 
-    typename Voxel::Allocator allocator;
-
-    typedef std::priority_queue< Voxel *,
-                                 std::vector<Voxel *>,
+    // The voxels are stored by value, so that the heap doesn't allocate memory per voxel.
+    // (A RadixHeap cannot be used here because the costs are not monotone: a newly
+    // reached voxel may be cheaper than the one just assigned.)
+    typedef std::priority_queue< Voxel,
+                                 std::vector<Voxel>,
                                  typename Voxel::Compare >  SeedRgVoxelHeap;
     typedef MultiArray<3, int> IVolume;
     typedef IVolume::traverser Traverser;
@@ -400,9 +401,7 @@ seededRegionGrowing3D(SrcImageIterator srcul, Diff_type shape, SrcAccessor as,
                         {
                             CostType cost = stats[cneighbor].cost(as(isx));
 
-                            Voxel * voxel =
-                                allocator.create(pos, pos+Neighborhood::diff((Direction)i), cost, count++, cneighbor);
-                            pheap.push(voxel);
+                            pheap.push(Voxel(pos, pos+Neighborhood::diff((Direction)i), cost, count++, cneighbor));
                         }
                     }
                 }
@@ -413,16 +412,13 @@ seededRegionGrowing3D(SrcImageIterator srcul, Diff_type shape, SrcAccessor as,
     // perform region growing
     while(pheap.size() != 0)
     {
-        Voxel * voxel = pheap.top();
+        Voxel const & voxel = pheap.top();
+        Diff_type pos = voxel.location_;
+        Diff_type nearest = voxel.nearest_;
+        int lab = voxel.label_;
+        CostType cost = voxel.cost_;
         pheap.pop();
 
-        Diff_type pos = voxel->location_;
-        Diff_type nearest = voxel->nearest_;
-        int lab = voxel->label_;
-        CostType cost = voxel->cost_;
-
-        allocator.dismiss(voxel);
-
         if((srgType & StopAtThreshold) != 0 && cost > max_cost)
             break;
 
@@ -460,21 +456,12 @@ seededRegionGrowing3D(SrcImageIterator srcul, Diff_type shape, SrcAccessor as,
                 {
                     CostType cost = stats[lab].cost(as(isx, Neighborhood::diff((Direction)i)));
 
-                    Voxel * new_voxel =
-                        allocator.create(pos+Neighborhood::diff((Direction)i), nearest, cost, count++, lab);
-                    pheap.push(new_voxel);
+                    pheap.push(Voxel(pos+Neighborhood::diff((Direction)i), nearest, cost, count++, lab));
                 }
             }
         }
     }
 
-    // free temporary memory
-    while(pheap.size() != 0)
-    {
-        allocator.dismiss(pheap.top());
-        pheap.pop();
-    }
-
     // write result
     transformMultiArray(ir, Diff_type(w,h,d), AccessorTraits<int>::default_accessor(),
                         destul, ad, detail::UnlabelWatersheds());
@@ -38,6 +38,9 @@
 
 #include <vector>
 #include <queue>
+#include <deque>
+#include <memory>
+#include <exception>
 #include <stdexcept>
 #include <cmath>
 #include "mathutil.hxx"
@@ -53,6 +56,8 @@ namespace vigra
 
 //@{
 
+class ThreadPool;
+
     /**\brief Option base class for parallel algorithms.
 
         <b>\#include</b> \<vigra/threadpool.hxx\><br>
@@ -71,7 +76,10 @@ class ParallelOptions
     };
 
     ParallelOptions()
-    :   numThreads_(actualNumThreads(Auto))
+    :   numThreads_(actualNumThreads(Auto)),
+        workStealing_(false),
+        pool_(0),
+        useDefaultPool_(false)
     {}
 
         /** \brief Get desired number of threads.
@@ -81,11 +89,11 @@ class ParallelOptions
             it should revert to a sequential implementation. In contrast, if
             <tt>numThread() == 1</tt>, the parallel algorithm version shall be
             executed with a single thread.
+
+            If a thread pool has been selected (see <tt>threadPool()</tt> and
+            <tt>useDefaultPool()</tt>), the pool's number of workers is returned.
         */
-    int getNumThreads() const
-    {
-        return numThreads_;
-    }
+    int getNumThreads() const;
 
         /** \brief Get desired number of threads.
 
@@ -93,7 +101,7 @@ class ParallelOptions
         */
     int getActualNumThreads() const
     {
-        return std::max(1,numThreads_);
+        return std::max(1,getNumThreads());
     }
 
         /** \brief Set the number of threads or one of the constants <tt>Auto</tt>,
@@ -107,13 +115,80 @@ class ParallelOptions
             by passing <tt>n = 0</tt> to this function. In contrast, passing <tt>n = 1</tt>
             causes the parallel algorithm versions to be executed with a single thread.
             Both possibilities are mainly useful for debugging.
+
+            Calling this function cancels a preceding <tt>threadPool()</tt> or
+            <tt>useDefaultPool()</tt>.
         */
     ParallelOptions & numThreads(const int n)
     {
         numThreads_ = actualNumThreads(n);
+        pool_ = 0;
+        useDefaultPool_ = false;
         return *this;
     }
 
+        /** \brief Check if the work-stealing scheduler is requested.
+
+            If a thread pool has been selected, the pool's scheduler is reported.
+        */
+    bool getWorkStealing() const;
+
+        /** \brief Switch the work-stealing scheduler on or off.
+
+            Default: <tt>false</tt> (all workers share a single task queue)
+
+            When work-stealing is on, every worker of a \ref ThreadPool owns a private
+            task deque. Idle workers steal tasks from the other workers' deques,
+            and <tt>parallel_foreach()</tt> splits random access ranges dynamically
+            instead of cutting them into a fixed number of chunks up front.
+            This pays off when the cost of the individual items varies considerably,
+            e.g. for blockwise algorithms on sparse data.
+        */
+    ParallelOptions & workStealing(bool v = true)
+    {
+        workStealing_ = v;
+        return *this;
+    }
+
+        /** \brief Execute parallel algorithms on an existing thread pool.
+
+            Default: no pool, i.e. every algorithm creates a pool of its own with
+            <tt>getNumThreads()</tt> workers.
+
+            Reusing a pool avoids the thread startup costs in sequences of many small
+            parallel calls. The pool must outlive all algorithm calls that use these
+            options. Its number of workers and its scheduler take precedence over
+            <tt>numThreads()</tt> and <tt>workStealing()</tt>. Calling <tt>numThreads()</tt>
+            afterwards switches back to a private pool.
+        */
+    ParallelOptions & threadPool(ThreadPool & pool)
+    {
+        pool_ = &pool;
+        useDefaultPool_ = false;
+        return *this;
+    }
+
+        /** \brief Execute parallel algorithms on the process-wide default pool.
+
+            Default: <tt>false</tt>
+
+            The default pool is created on first use, see <tt>ThreadPool::defaultPool()</tt>.
+            Otherwise, this behaves like <tt>threadPool(ThreadPool::defaultPool())</tt>.
+        */
+    ParallelOptions & useDefaultPool(bool v = true)
+    {
+        pool_ = 0;
+        useDefaultPool_ = v;
+        return *this;
+    }
+
+        /** \brief Get the selected thread pool.
+
+            Returns <tt>0</tt> if no pool has been selected, i.e. if algorithms
+            shall create their own pool.
+        */
+    ThreadPool * getThreadPool() const;
+
 
   private:
         // helper function to compute the actual number of threads
@@ -131,6 +206,9 @@ class ParallelOptions
     }
 
     int numThreads_;
+    bool workStealing_;
+    ThreadPool * pool_;
+    bool useDefaultPool_;
 };
 
 /********************************************************/
@@ -141,6 +219,22 @@ class ParallelOptions
 
     /**\brief Thread pool class to manage a set of parallel workers.
 
+        By default, all workers take their tasks from a single shared queue.
+        If the pool is constructed from <tt>ParallelOptions().workStealing()</tt>,
+        each worker owns a task deque instead: tasks enqueued by a worker go to
+        the back of its own deque and are processed in LIFO order, whereas idle
+        workers steal from the front of the other workers' deques.
+        Tasks enqueued from outside the pool are distributed round-robin.
+
+        Tasks can be enqueued as members of a group (identified by an arbitrary
+        address, e.g. of the data structure shared by the group's tasks). A worker
+        that has to wait for the tasks of a group can help executing them via
+        runPendingTask(), but will never pick up unrelated tasks in the meantime.
+
+        Instead of creating a new pool for every call, parallel algorithms can share
+        an existing pool or the process-wide <tt>ThreadPool::defaultPool()</tt>
+        via <tt>ParallelOptions::threadPool()</tt> and <tt>ParallelOptions::useDefaultPool()</tt>.
+
         <b>\#include</b> \<vigra/threadpool.hxx\><br>
         Namespace: vigra
     */
@@ -192,9 +286,10 @@ class ThreadPool
      * Enqueue function for tasks without return value.
      * This is a special case of the enqueueReturning template function, but
      * some compilers fail on <tt>std::result_of<F(int)>::type</tt> for void(int) functions.
+     * If \arg group is not null, the task belongs to this group (see runPendingTask()).
      */
     template<class F>
-    threading::future<void> enqueue(F&& f) ;
+    threading::future<void> enqueue(F&& f, void const * group = nullptr) ;
 
     /**
      * Block until all tasks are finished.
@@ -202,7 +297,7 @@ class ThreadPool
     void waitFinished()
     {
         threading::unique_lock<threading::mutex> lock(queue_mutex);
-        finish_condition.wait(lock, [this](){ return tasks.empty() && (busy == 0); });
+        finish_condition.wait(lock, [this](){ return tasks.empty() && (pending == 0) && (busy == 0); });
     }
 
     /**
@@ -213,16 +308,99 @@ class ThreadPool
         return workers.size();
     }
 
+    /**
+     * Return true if the pool uses the work-stealing scheduler.
+     */
+    bool workStealing() const
+    {
+        return !worker_queues.empty();
+    }
+
+    /**
+     * If the calling thread is one of this pool's workers, return its index.
+     * Otherwise, return -1.
+     */
+    int workerIndex() const
+    {
+        return currentWorker().first == this
+                   ? (int)currentWorker().second
+                   : -1;
+    }
+
+    /**
+     * Return true if the calling thread is a worker of any ThreadPool.
+     */
+    static bool insideWorker()
+    {
+        return currentWorker().first != nullptr;
+    }
+
+    /**
+     * Let one of this pool's workers execute a pending task of the given group
+     * (if any) instead of blocking while it waits for the group to finish.
+     * Tasks of other groups and tasks enqueued without a group are never
+     * executed, so that a waiting worker is not re-entered by unrelated work
+     * (e.g. further iterations of an enclosing loop that would run under the
+     * same thread index). Returns false if no task of the group was available
+     * or the calling thread is not a worker of this pool.
+     */
+    bool runPendingTask(void const * group);
+
+    /**
+     * Return the process-wide default pool. It is created on first use with
+     * <tt>ParallelOptions::Auto</tt> threads and the work-stealing scheduler,
+     * and is shared by all algorithms whose ParallelOptions request
+     * <tt>useDefaultPool()</tt>.
+     */
+    static ThreadPool & defaultPool()
+    {
+        static ThreadPool pool(ParallelOptions().workStealing());
+        return pool;
+    }
+
 private:
 
+    struct Task
+    {
+        std::function<void(int)> run;
+        void const * group;
+    };
+
+    struct WorkerQueue
+    {
+        threading::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
     // helper function to init the thread pool
     void init(const ParallelOptions & options);
 
+    // put a wrapped task into the appropriate queue
+    void push(std::function<void(int)> && task, void const * group);
+
+    // take a task from worker ti's own deque or steal one from another worker
+    // (only tasks of 'group' unless 'anyGroup' is true)
+    bool popOrSteal(size_t ti, std::function<void(int)> & task,
+                    bool anyGroup, void const * group);
+
+    // bookkeeping after a task taken by popOrSteal() has been executed
+    void finishTask();
+
+    // the pool (if any) the calling thread works for, and its index in that pool
+    static std::pair<ThreadPool const *, size_t> & currentWorker()
+    {
+        static thread_local std::pair<ThreadPool const *, size_t> worker(nullptr, 0);
+        return worker;
+    }
+
     // need to keep track of threads so we can join them
     std::vector<threading::thread> workers;
 
     // the task queue
-    std::queue<std::function<void(int)> > tasks;
+    std::deque<Task> tasks;
+
+    // the per-worker task deques (work-stealing mode only)
+    std::vector<std::unique_ptr<WorkerQueue> > worker_queues;
 
     // synchronization
     threading::mutex queue_mutex;
@@ -230,19 +408,58 @@ private:
     threading::condition_variable finish_condition;
     bool stop;
     threading::atomic_long busy, processed;
+    threading::atomic_long pending, next_queue;
 };
 
 inline void ThreadPool::init(const ParallelOptions & options)
 {
     busy.store(0);
     processed.store(0);
+    pending.store(0);
+    next_queue.store(0);
 
     const size_t actualNThreads = options.getNumThreads();
+    if(options.getWorkStealing() && actualNThreads > 0)
+    {
+        for(size_t ti = 0; ti<actualNThreads; ++ti)
+            worker_queues.emplace_back(new WorkerQueue);
+        for(size_t ti = 0; ti<actualNThreads; ++ti)
+        {
+            workers.emplace_back(
+                [ti,this]
+                {
+                    currentWorker() = std::make_pair(this, ti);
+                    for(;;)
+                    {
+                        std::function<void(int)> task;
+                        if(this->popOrSteal(ti, task, true, nullptr))
+                        {
+                            task(ti);
+                            this->finishTask();
+                            continue;
+                        }
+
+                        threading::unique_lock<threading::mutex> lock(this->queue_mutex);
+                        this->worker_condition.wait(lock, [this]{ return this->stop || this->pending > 0; });
+                        if(this->pending == 0)
+                            return;   // stop was requested and all tasks are done
+                        // 'pending' is already incremented when a task is about to be pushed,
+                        // so we may have to try several times until we get it
+                        lock.unlock();
+                        threading::this_thread::yield();
+                    }
+                }
+            );
+        }
+        return;
+    }
+
     for(size_t ti = 0; ti<actualNThreads; ++ti)
     {
         workers.emplace_back(
             [ti,this]
             {
+                currentWorker() = std::make_pair(this, ti);
                 for(;;)
                 {
                     std::function<void(int)> task;
@@ -258,8 +475,8 @@ inline void ThreadPool::init(const ParallelOptions & options)
                         if(!this->tasks.empty())
                         {
                             ++busy;
-                            task = std::move(this->tasks.front());
-                            this->tasks.pop();
+                            task = std::move(this->tasks.front().run);
+                            this->tasks.pop_front();
                             lock.unlock();
                             task(ti);
                             ++processed;
@@ -277,6 +494,120 @@ inline void ThreadPool::init(const ParallelOptions & options)
     }
 }
 
+inline bool ThreadPool::popOrSteal(size_t ti, std::function<void(int)> & task,
+                                   bool anyGroup, void const * group)
+{
+    const size_t n = worker_queues.size();
+    for(size_t k = 0; k < n; ++k)
+    {
+        WorkerQueue & queue = *worker_queues[(ti + k) % n];
+        threading::lock_guard<threading::mutex> lock(queue.mutex);
+        if(k == 0)
+        {
+            // own deque: most recently pushed (and smallest) task first
+            auto t = queue.tasks.rbegin();
+            while(t != queue.tasks.rend() && !anyGroup && t->group != group)
+                ++t;
+            if(t == queue.tasks.rend())
+                continue;
+            task = std::move(t->run);
+            queue.tasks.erase(std::next(t).base());
+        }
+        else
+        {
+            // steal the oldest (and usually largest) task
+            auto t = queue.tasks.begin();
+            while(t != queue.tasks.end() && !anyGroup && t->group != group)
+                ++t;
+            if(t == queue.tasks.end())
+                continue;
+            task = std::move(t->run);
+            queue.tasks.erase(t);
+        }
+        ++busy;
+        --pending;
+        return true;
+    }
+    return false;
+}
+
+inline void ThreadPool::finishTask()
+{
+    ++processed;
+    --busy;
+    {
+        // make sure that waitFinished() doesn't miss the notification
+        threading::lock_guard<threading::mutex> lock(queue_mutex);
+    }
+    finish_condition.notify_all();
+}
+
+inline bool ThreadPool::runPendingTask(void const * group)
+{
+    const int ti = workerIndex();
+    if(ti < 0)
+        return false;
+
+    std::function<void(int)> task;
+    if(workStealing())
+    {
+        if(!popOrSteal(ti, task, false, group))
+            return false;
+    }
+    else
+    {
+        threading::unique_lock<threading::mutex> lock(queue_mutex);
+        auto t = tasks.begin();
+        while(t != tasks.end() && t->group != group)
+            ++t;
+        if(t == tasks.end())
+            return false;
+        ++busy;
+        task = std::move(t->run);
+        tasks.erase(t);
+    }
+    task(ti);
+    finishTask();
+    return true;
+}
+
+inline void ThreadPool::push(std::function<void(int)> && task, void const * group)
+{
+    if(worker_queues.empty())
+    {
+        {
+            threading::unique_lock<threading::mutex> lock(queue_mutex);
+
+            // don't allow enqueueing after stopping the pool
+            if(stop)
+                throw std::runtime_error("enqueue on stopped ThreadPool");
+
+            tasks.push_back(Task{std::move(task), group});
+        }
+        worker_condition.notify_one();
+        return;
+    }
+
+    // our own workers push to their own deque, everybody else uses round-robin
+    size_t q = currentWorker().first == this
+                   ? currentWorker().second
+                   : (size_t)(next_queue++) % worker_queues.size();
+    {
+        threading::unique_lock<threading::mutex> lock(queue_mutex);
+
+        // don't allow enqueueing after stopping the pool
+        if(stop)
+            throw std::runtime_error("enqueue on stopped ThreadPool");
+
+        ++pending;
+    }
+    {
+        threading::lock_guard<threading::mutex> lock(worker_queues[q]->mutex);
+        worker_queues[q]->tasks.push_back(Task{std::move(task), group});
+    }
+    worker_condition.notify_one();
+}
+
 inline ThreadPool::~ThreadPool()
 {
     {
@@ -299,21 +630,13 @@ ThreadPool::enqueueReturning(F&& f) -> threading::future<decltype(f(0))>
     auto res = task->get_future();
 
     if(workers.size()>0){
-        {
-            threading::unique_lock<threading::mutex> lock(queue_mutex);
-
-            // don't allow enqueueing after stopping the pool
-            if(stop)
-                throw std::runtime_error("enqueue on stopped ThreadPool");
-
-            tasks.emplace(
-                [task](int tid)
-                {
-                    (*task)(std::move(tid));
-                }
-            );
-        }
-        worker_condition.notify_one();
+        push(
+            [task](int tid)
+            {
+                (*task)(std::move(tid));
+            },
+            nullptr
+        );
     }
     else{
         (*task)(0);
@@ -324,7 +647,7 @@ ThreadPool::enqueueReturning(F&& f) -> threading::future<decltype(f(0))>
 
 template<class F>
 inline threading::future<void>
-ThreadPool::enqueue(F&& f)
+ThreadPool::enqueue(F&& f, void const * group)
 {
 #if defined(USE_BOOST_THREAD) && \
     !defined(BOOST_THREAD_PROVIDES_VARIADIC_THREAD)
@@ -343,26 +666,18 @@ ThreadPool::enqueue(F&& f)
 
     auto res = task->get_future();
     if(workers.size()>0){
-        {
-            threading::unique_lock<threading::mutex> lock(queue_mutex);
-
-            // don't allow enqueueing after stopping the pool
-            if(stop)
-                throw std::runtime_error("enqueue on stopped ThreadPool");
-
-            tasks.emplace(
-               [task](int tid)
-               {
+        push(
+           [task](int tid)
+           {
 #if defined(USE_BOOST_THREAD) && \
     !defined(BOOST_THREAD_PROVIDES_VARIADIC_THREAD)
-                    (*task)();
+                (*task)();
 #else
-                    (*task)(std::move(tid));
+                (*task)(std::move(tid));
 #endif
-               }
-            );
-        }
-        worker_condition.notify_one();
+           },
+           group
+        );
     }
     else{
 #if defined(USE_BOOST_THREAD) && \
@@ -375,12 +690,176 @@ ThreadPool::enqueue(F&& f)
     return res;
 }
 
+inline int ParallelOptions::getNumThreads() const
+{
+    ThreadPool * pool = getThreadPool();
+    return pool
+              ? (int)pool->nThreads()
+              : numThreads_;
+}
+
+inline bool ParallelOptions::getWorkStealing() const
+{
+    ThreadPool * pool = getThreadPool();
+    return pool
+              ? pool->workStealing()
+              : workStealing_;
+}
+
+inline ThreadPool * ParallelOptions::getThreadPool() const
+{
+    return useDefaultPool_
+              ? &ThreadPool::defaultPool()
+              : pool_;
+}
+
 /********************************************************/
 /*                                                      */
 /*                   parallel_foreach                   */
 /*                                                      */
 /********************************************************/
 
+namespace detail {
+
+// Bookkeeping shared by all tasks of a work-stealing parallel_foreach.
+struct ParallelForeachState
+{
+    ParallelForeachState(std::ptrdiff_t workload)
+    :   remaining(workload),
+        failed(false),
+        finished(false)
+    {}
+
+    // called by a task when it has handled n items
+    void done(std::ptrdiff_t n)
+    {
+        if(remaining.fetch_sub(n) == n)
+        {
+            // notify while holding the lock, because the waiting thread
+            // destroys this object as soon as it wakes up
+            threading::lock_guard<threading::mutex> lock(mutex);
+            finished = true;
+            condition.notify_all();
+        }
+    }
+
+    void setError(std::exception_ptr e)
+    {
+        threading::lock_guard<threading::mutex> lock(mutex);
+        if(!failed)
+            error = e;
+        failed = true;
+    }
+
+    // A worker of 'pool' that waits for the results of a nested call
+    // executes pending tasks of this call (the tasks of the group 'this')
+    // instead of blocking. It never runs unrelated tasks, because these
+    // would re-enter the waiting worker under the same thread index.
+    void wait(ThreadPool & pool)
+    {
+        if(pool.workerIndex() >= 0)
+        {
+            for(;;)
+            {
+                {
+                    threading::lock_guard<threading::mutex> lock(mutex);
+                    if(finished)
+                        break;
+                }
+                if(!pool.runPendingTask(this))
+                    threading::this_thread::yield();
+            }
+        }
+        threading::unique_lock<threading::mutex> lock(mutex);
+        condition.wait(lock, [this]{ return finished; });
+        if(error)
+            std::rethrow_exception(error);
+    }
+
+    threading::atomic<std::ptrdiff_t> remaining;
+    threading::atomic<bool> failed;
+    bool finished;
+    std::exception_ptr error;
+    threading::mutex mutex;
+    threading::condition_variable condition;
+};
+
+// A task of the work-stealing parallel_foreach: as long as its range is
+// larger than 'grain', it pushes the upper half as a new task (which other
+// workers may steal) and continues with the lower half.
+template<class ITER, class F>
+struct ParallelForeachSplitTask
+{
+    void operator()(int id) const
+    {
+        std::ptrdiff_t b = begin, e = end;
+        while(e - b > grain)
+        {
+            ParallelForeachSplitTask upper(*this);
+            upper.begin = b + (e - b) / 2;
+            upper.end = e;
+            pool->enqueue(upper, state);
+            e = upper.begin;
+        }
+        if(!state->failed)
+        {
+            try
+            {
+                for(std::ptrdiff_t i=b; i<e; ++i)
+                    (*f)(id, iter[i]);
+            }
+            catch(...)
+            {
+                state->setError(std::current_exception());
+            }
+        }
+        state->done(e - b);
+    }
+
+    ThreadPool * pool;
+    ParallelForeachState * state;
+    F * f;
+    ITER iter;
+    std::ptrdiff_t begin, end, grain;
+};
+
+} // namespace detail
+
+// Work-stealing version for random access iterators: each worker starts with an equal
+// share of the range and splits it dynamically, so that idle workers can steal
+// the remaining halves of expensive shares.
+template<class ITER, class F>
+inline void parallel_foreach_stealing(
+    ThreadPool & pool,
+    ITER iter,
+    const std::ptrdiff_t workload,
+    F & f)
+{
+    if(workload == 0)
+        return;
+
+    typedef typename std::remove_reference<F>::type Functor;
+    const std::ptrdiff_t nThreads = pool.nThreads();
+    const std::ptrdiff_t grain = std::max<std::ptrdiff_t>((workload + 16*nThreads - 1) / (16*nThreads), 1);
+
+    detail::ParallelForeachState state(workload);
+    detail::ParallelForeachSplitTask<ITER, Functor> task;
+    task.pool = &pool;
+    task.state = &state;
+    task.f = &f;
+    task.iter = iter;
+    task.grain = grain;
+
+    const std::ptrdiff_t nShares = std::min(nThreads, workload);
+    for(std::ptrdiff_t k=0; k<nShares; ++k)
+    {
+        task.begin = k*workload / nShares;
+        task.end = (k+1)*workload / nShares;
+        pool.enqueue(task, &state);
+    }
+    state.wait(pool);
+}
+
 // nItems must be either zero or std::distance(iter, end).
 // NOTE: the redundancy of nItems and iter,end here is due to the fact that, for forward iterators,
 // computing the distance from iterators is costly, and, for input iterators, we might not know in advance
@@ -396,6 +875,11 @@ inline void parallel_foreach_impl(
 ){
     std::ptrdiff_t workload = std::distance(iter, end);
     vigra_precondition(workload == nItems || nItems == 0, "parallel_foreach(): Mismatch between num items and begin/end.");
+    if(pool.workStealing())
+    {
+        parallel_foreach_stealing(pool, iter, workload, f);
+        return;
+    }
     const float workPerThread = float(workload)/pool.nThreads();
     const std::ptrdiff_t chunkedWorkPerThread = std::max<std::ptrdiff_t>(roundi(workPerThread/3.0), 1);
 
@@ -506,18 +990,20 @@ inline void parallel_foreach_impl(
 }
 
 // Runs foreach on a single thread.
-// Used for API compatibility when the numbe of threads is 0.
+// Used for API compatibility when the numbe of threads is 0, and for nested calls
+// (where threadId is the index of the calling worker).
 template<class ITER, class F>
 inline void parallel_foreach_single_thread(
     ITER begin,
     ITER end,
     F && f,
-    const std::ptrdiff_t nItems = 0
+    const std::ptrdiff_t nItems = 0,
+    const int threadId = 0
 ){
     std::ptrdiff_t n = 0;
     for (; begin != end; ++begin)
     {
-        f(0, *begin);
+        f(threadId, *begin);
         ++n;
     }
     vigra_postcondition(n == nItems || nItems == 0, "parallel_foreach(): Mismatch between num items and begin/end.");
@@ -544,6 +1030,13 @@ inline void parallel_foreach_single_thread(
                               F && f,
                               const uint64_t nItems = 0);
 
+        // create an internal thread pool according to the given options
+        template<class ITER, class F>
+        void parallel_foreach(ParallelOptions const & options,
+                              ITER begin, ITER end,
+                              F && f,
+                              const uint64_t nItems = 0);
+
         // pass the integers from 0 ... (nItems-1) to the functor f,
         // using the given number of threads or ParallelOptions::Auto
         template<class F>
@@ -556,6 +1049,12 @@ inline void parallel_foreach_single_thread(
         void parallel_foreach(ThreadPool & threadpool,
                               uint64_t nItems,
                               F && f);
+
+        // likewise with ParallelOptions
+        template<class F>
+        void parallel_foreach(ParallelOptions const & options,
+                              uint64_t nItems,
+                              F && f);
     }
     \endcode
 
@@ -574,6 +1073,30 @@ inline void parallel_foreach_single_thread(
     If <tt>nThreads = ParallelOptions::Auto</tt>, the number of threads is set to
     the machine default (<tt>std::thread::hardware_concurrency()</tt>).
 
+    If the thread pool uses the work-stealing scheduler (see
+    <tt>ParallelOptions::workStealing()</tt>) and the iterators are random access
+    iterators, the range is instead split dynamically: every worker starts with an
+    equal share, recursively splits off halves of its share, and idle workers
+    steal these halves. This balances the load when the items' cost varies a lot.
+
+    Instead of creating a new thread pool, <tt>parallel_foreach</tt> uses an
+    existing one when it is called with a <tt>ThreadPool</tt> or with ParallelOptions
+    that select a pool via <tt>ParallelOptions::threadPool()</tt> or
+    <tt>ParallelOptions::useDefaultPool()</tt>.
+
+    Nested calls, i.e. calls from within a functor that is already executed by a
+    thread pool, never start additional threads. If the nested call uses the same
+    pool as the enclosing call and this pool uses work-stealing, the calling
+    worker cooperates with the other workers: it splits the range as usual and
+    executes pending items of the nested call while it waits for completion.
+    Otherwise, the nested call runs sequentially in the calling thread. In both cases,
+    the thread index passed to \arg f is valid for the pool in question. A waiting
+    worker never picks up other work (e.g. further items of the enclosing call), so
+    while an item of the enclosing call is suspended in a nested call, its thread
+    index is only reused by items of that nested call, exactly as in the sequential
+    case. Per-thread scratch space indexed by the thread index must therefore not be
+    shared between the enclosing functor and the nested one.
+
     If <tt>nThreads = 0</tt>, the function will not use threads,
     but will call the functor sequentially. This can also be enforced by setting the
     preprocessor flag <tt>VIGRA_SINGLE_THREADED</tt>, ignoring the value of
@@ -632,14 +1155,22 @@ inline void parallel_foreach(
     F && f,
     const std::ptrdiff_t nItems = 0)
 {
-    if(pool.nThreads()>1)
+    typedef typename std::iterator_traits<ITER>::iterator_category Category;
+
+    const int worker = pool.workerIndex();
+    if(pool.nThreads() <= 1)
+    {
+        parallel_foreach_single_thread(begin, end, f, nItems);
+    }
+    else if(worker >= 0 &&
+            !(pool.workStealing() && std::is_base_of<std::random_access_iterator_tag, Category>::value))
     {
-        parallel_foreach_impl(pool,nItems, begin, end, f,
-            typename std::iterator_traits<ITER>::iterator_category());
+        // nested call that cannot cooperate: waiting for the futures would block this worker
+        parallel_foreach_single_thread(begin, end, f, nItems, worker);
     }
     else
     {
-        parallel_foreach_single_thread(begin, end, f, nItems);
+        parallel_foreach_impl(pool,nItems, begin, end, f, Category());
     }
 }
 
@@ -651,11 +1182,40 @@ inline void parallel_foreach(
     F && f,
     const std::ptrdiff_t nItems = 0)
 {
-
+    if(ThreadPool::insideWorker())
+    {
+        // nested call: don't start additional threads
+        parallel_foreach_single_thread(begin, end, f, nItems);
+        return;
+    }
     ThreadPool pool(nThreads);
     parallel_foreach(pool, begin, end, f, nItems);
 }
 
+template<class ITER, class F>
+inline void parallel_foreach(
+    ParallelOptions const & options,
+    ITER begin,
+    ITER end,
+    F && f,
+    const std::ptrdiff_t nItems = 0)
+{
+    if(ThreadPool * pool = options.getThreadPool())
+    {
+        parallel_foreach(*pool, begin, end, f, nItems);
+    }
+    else if(ThreadPool::insideWorker())
+    {
+        // nested call: don't start additional threads
+        parallel_foreach_single_thread(begin, end, f, nItems);
+    }
+    else
+    {
+        ThreadPool pool(options);
+        parallel_foreach(pool, begin, end, f, nItems);
+    }
+}
+
 template<class F>
 inline void parallel_foreach(
     int64_t nThreads,
@@ -677,6 +1237,16 @@ inline void parallel_foreach(
     parallel_foreach(threadpool, iter, iter.end(), f, nItems);
 }
 
+template<class F>
+inline void parallel_foreach(
+    ParallelOptions const & options,
+    std::ptrdiff_t nItems,
+    F && f)
+{
+    auto iter = range(nItems);
+    parallel_foreach(options, iter, iter.end(), f, nItems);
+}
+
 //@}
 
 } // namespace vigra
@@ -40,6 +40,11 @@
 #include "numerictraits.hxx"
 #include "rgbvalue.hxx"
 #include "multi_shape.hxx"
+#include "multi_array.hxx"
+#include "array_vector.hxx"
+#include "threadpool.hxx"
+#include <string>
+#include <vector>
 
 extern "C"
 {
@@ -88,6 +93,13 @@ typedef TIFF TiffImage;
         template <class T, class S>
         void
         importTiffImage(TiffImage * tiff, MultiArrayView<2, T, S> dest);
+
+        // decode the strips or tiles covering the region of interest
+        // [roi_start, roi_start + dest.shape()) in parallel
+        template <class T, class S>
+        void
+        importTiffImage(TiffImage * tiff, MultiArrayView<2, T, S> dest,
+                        Shape2 const & roi_start, ParallelOptions const & options);
     }
     \endcode
     
@@ -128,6 +140,24 @@ typedef TIFF TiffImage;
     TIFFClose(tiff);
     \endcode
     
+    The overload accepting a region of interest and \ref ParallelOptions
+    decodes the strips or tiles of the current directory directly into
+    <tt>dest</tt>, without going through scanlines. Only the strips or tiles
+    intersecting the region <tt>[roi_start, roi_start + dest.shape())</tt> are
+    decoded, and independent strips or tiles are decoded concurrently.
+    To this end, the file is reopened once per worker thread
+    (via <tt>TIFFFileName()</tt>). If this is impossible, the blocks are decoded
+    sequentially with the given handle. The pixel type <tt>T</tt> may be a scalar
+    or a vector type (e.g. \ref RGBValue or \ref TinyVector) whose bands receive
+    the first samples of each pixel. Samples are converted like in \ref importImage().
+    
+    \code
+    MultiArray<2, RGBValue<UInt8> > roi(512, 512);
+    
+    // read a 512x512 window at (1024, 2048) of a large tiled image with 4 threads
+    importTiffImage(tiff, roi, Shape2(1024, 2048), ParallelOptions().numThreads(4));
+    \endcode
+    
     <b> Required Interface:</b>
     
     see \ref tiffToScalarImage() and \ref tiffToRGBImage()
@@ -136,6 +166,12 @@ typedef TIFF TiffImage;
     
     see \ref tiffToScalarImage() and \ref tiffToRGBImage()
     
+    For the strip/tile based overload: the samples must have 8, 16, 32, or 64 bits
+    (bilevel, palette, LogLuv and uncompressed YCbCr images must be read by
+    \ref importImage()), the region of interest must be inside the image, and the image
+    must have at least as many samples per pixel as <tt>T</tt> has bands.
+    JPEG compressed YCbCr images are converted to RGB by libtiff, which
+    sets <tt>TIFFTAG_JPEGCOLORMODE</tt> on the given handle.
 */
 doxygen_overloaded_function(template <...> void importTiffImage)
 
@@ -177,6 +213,413 @@ importTiffImage(TiffImage * tiff, ImageIterator iter, Accessor a, VigraFalseType
     tiffToRGBImage(tiff, iter, a);
 }
 
+namespace detail {
+
+// Geometry and sample layout of the strips or tiles of the current TIFF directory.
+struct TiffBlockLayout
+{
+    uint32_t width, height, block_width, block_height;
+    uint16_t samples_per_pixel, bits_per_sample, sample_format,
+             planar_config, photometric;
+    bool tiled, ycbcr_as_rgb;
+
+    explicit TiffBlockLayout(TiffImage * tiff)
+    : width(0), height(0), block_width(0), block_height(0),
+      samples_per_pixel(1), bits_per_sample(1), sample_format(SAMPLEFORMAT_UINT),
+      planar_config(PLANARCONFIG_CONTIG), photometric(PHOTOMETRIC_MINISBLACK),
+      tiled(TIFFIsTiled(tiff) != 0), ycbcr_as_rgb(false)
+    {
+        uint16_t compression = COMPRESSION_NONE;
+        TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &width);
+        TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &height);
+        TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLESPERPIXEL, &samples_per_pixel);
+        TIFFGetFieldDefaulted(tiff, TIFFTAG_BITSPERSAMPLE, &bits_per_sample);
+        TIFFGetFieldDefaulted(tiff, TIFFTAG_SAMPLEFORMAT, &sample_format);
+        TIFFGetFieldDefaulted(tiff, TIFFTAG_PLANARCONFIG, &planar_config);
+        TIFFGetFieldDefaulted(tiff, TIFFTAG_COMPRESSION, &compression);
+        TIFFGetField(tiff, TIFFTAG_PHOTOMETRIC, &photometric);
+        if(tiled)
+        {
+            TIFFGetField(tiff, TIFFTAG_TILEWIDTH, &block_width);
+            TIFFGetField(tiff, TIFFTAG_TILELENGTH, &block_height);
+        }
+        else
+        {
+            block_width = width;
+            block_height = height;
+            TIFFGetFieldDefaulted(tiff, TIFFTAG_ROWSPERSTRIP, &block_height);
+            block_height = std::min(block_height, height);
+        }
+        ycbcr_as_rgb = photometric == PHOTOMETRIC_YCBCR && compression == COMPRESSION_JPEG;
+
+        vigra_precondition(width > 0 && height > 0 && block_width > 0 && block_height > 0,
+            "importTiffImage(): invalid image or strip/tile size.");
+        vigra_precondition(photometric == PHOTOMETRIC_MINISBLACK ||
+                           photometric == PHOTOMETRIC_MINISWHITE ||
+                           photometric == PHOTOMETRIC_RGB ||
+                           photometric == PHOTOMETRIC_SEPARATED ||
+                           ycbcr_as_rgb,
+            "importTiffImage(): unsupported photometric interpretation, use importImage().");
+        vigra_precondition(bits_per_sample == 8 || bits_per_sample == 16 ||
+                           bits_per_sample == 32 || bits_per_sample == 64,
+            "importTiffImage(): unsupported number of bits per sample, use importImage().");
+        vigra_precondition(sample_format == SAMPLEFORMAT_UINT ||
+                           sample_format == SAMPLEFORMAT_INT ||
+                           sample_format == SAMPLEFORMAT_VOID ||
+                           (sample_format == SAMPLEFORMAT_IEEEFP && bits_per_sample >= 32),
+            "importTiffImage(): unsupported sample format.");
+    }
+
+        // samples per pixel within a single strip or tile
+    unsigned int blockSamples() const
+    {
+        return planar_config == PLANARCONFIG_SEPARATE
+                   ? 1
+                   : samples_per_pixel;
+    }
+
+        // make a handle decode blocks in the format expected by tiffCopyBlock()
+    void prepare(TiffImage * tiff) const
+    {
+        if(ycbcr_as_rgb)
+            TIFFSetField(tiff, TIFFTAG_JPEGCOLORMODE, JPEGCOLORMODE_RGB);
+    }
+
+    tsize_t blockSize(TiffImage * tiff) const
+    {
+        return tiled
+                   ? TIFFTileSize(tiff)
+                   : TIFFStripSize(tiff);
+    }
+};
+
+// Hands out TIFF handles and decoding buffers to concurrent tasks.
+// The first handle is the caller's; further handles are created on demand
+// by reopening the file, and closed upon destruction.
+class TiffHandlePool
+{
+  public:
+    struct Entry
+    {
+        TiffImage * tiff;
+        ArrayVector<char> buffer;
+    };
+
+    TiffHandlePool(TiffImage * tiff, TiffBlockLayout const & layout)
+    : layout_(layout),
+      directory_(TIFFCurrentDirectory(tiff)),
+      filename_(TIFFFileName(tiff) ? TIFFFileName(tiff) : "")
+    {
+        layout_.prepare(tiff);
+        add(tiff);
+    }
+
+    ~TiffHandlePool()
+    {
+        for(std::size_t k = 1; k < entries_.size(); ++k)
+            TIFFClose(entries_[k]->tiff);
+    }
+
+        // open another handle in advance, return false if the file cannot be reopened
+    bool reopen()
+    {
+        TiffImage * tiff = open();
+        if(tiff == 0)
+            return false;
+        std::lock_guard<std::mutex> lock(mutex_);
+        add(tiff);
+        return true;
+    }
+
+    Entry * acquire()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if(!free_.empty())
+            {
+                Entry * entry = free_.back();
+                free_.pop_back();
+                return entry;
+            }
+        }
+        TiffImage * tiff = open();
+        vigra_postcondition(tiff != 0,
+            "importTiffImage(): unable to reopen TIFF file.");
+        std::lock_guard<std::mutex> lock(mutex_);
+        add(tiff);
+        Entry * entry = free_.back();
+        free_.pop_back();
+        return entry;
+    }
+
+    void release(Entry * entry)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(entry);
+    }
+
+  private:
+    TiffImage * open() const
+    {
+        if(filename_.empty())
+            return 0;
+        TiffImage * tiff = TIFFOpen(filename_.c_str(), "r");
+        if(tiff == 0)
+            return 0;
+        uint32_t w = 0, h = 0;
+        if(!TIFFSetDirectory(tiff, directory_) ||
+           !TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &w) || w != layout_.width ||
+           !TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &h) || h != layout_.height)
+        {
+            TIFFClose(tiff);
+            return 0;
+        }
+        layout_.prepare(tiff);
+        return tiff;
+    }
+
+        // requires mutex_ to be held (or no concurrent access)
+    void add(TiffImage * tiff)
+    {
+        entries_.emplace_back(new Entry);
+        entries_.back()->tiff = tiff;
+        entries_.back()->buffer.resize(layout_.blockSize(tiff));
+        free_.push_back(entries_.back().get());
+    }
+
+    TiffBlockLayout const & layout_;
+    tdir_t directory_;
+    std::string filename_;
+    std::vector<std::unique_ptr<Entry> > entries_;
+    std::vector<Entry *> free_;
+    std::mutex mutex_;
+};
+
+class TiffHandleGuard
+{
+  public:
+    explicit TiffHandleGuard(TiffHandlePool & pool)
+    : pool_(pool),
+      entry_(pool.acquire())
+    {}
+
+    ~TiffHandleGuard()
+    {
+        pool_.release(entry_);
+    }
+
+    TiffHandlePool::Entry * operator->() const
+    {
+        return entry_;
+    }
+
+  private:
+    TiffHandleGuard(TiffHandleGuard const &);
+    TiffHandleGuard & operator=(TiffHandleGuard const &);
+
+    TiffHandlePool & pool_;
+    TiffHandlePool::Entry * entry_;
+};
+
+// Access to the bands of scalar and vector-valued pixels.
+template <class T, bool IsScalar = NumericTraits<T>::isScalar::value>
+struct TiffPixelBands
+{
+    typedef T value_type;
+    enum { size = 1 };
+
+    static value_type & band(T & v, unsigned int)
+    {
+        return v;
+    }
+};
+
+template <class T>
+struct TiffPixelBands<T, false>
+{
+    typedef typename T::value_type value_type;
+    enum { size = T::static_size };
+
+    static value_type & band(T & v, unsigned int b)
+    {
+        return v[b];
+    }
+};
+
+// PHOTOMETRIC_MINISWHITE: only unsigned samples are inverted
+template <class T>
+inline T tiffInvertSample(T v)
+{
+    return v;
+}
+
+inline UInt8  tiffInvertSample(UInt8 v)  { return static_cast<UInt8>(~v); }
+inline UInt16 tiffInvertSample(UInt16 v) { return static_cast<UInt16>(~v); }
+inline UInt32 tiffInvertSample(UInt32 v) { return ~v; }
+inline UInt64 tiffInvertSample(UInt64 v) { return ~v; }
+
+// Copy the part of a decoded strip or tile starting at 'block_start'
+// that overlaps the region of interest into 'dest'.
+template <class Sample, class T, class S>
+void
+tiffCopyBlockImpl(char const * data, TiffBlockLayout const & layout,
+                  Shape2 const & block_start, unsigned int plane,
+                  MultiArrayView<2, T, S> & dest, Shape2 const & roi_start)
+{
+    typedef TiffPixelBands<T> Bands;
+    typedef typename Bands::value_type Component;
+
+    Sample const * samples = reinterpret_cast<Sample const *>(data);
+    const unsigned int spp = layout.blockSamples();
+    const MultiArrayIndex pitch = (MultiArrayIndex)layout.block_width * spp;
+    const bool invert = layout.photometric == PHOTOMETRIC_MINISWHITE;
+
+    // with separate planes, every block holds a single band
+    const unsigned int first_band = layout.planar_config == PLANARCONFIG_SEPARATE
+                                        ? plane
+                                        : 0;
+    const unsigned int bands = std::min<unsigned int>(spp, Bands::size - first_band);
+
+    const MultiArrayIndex x0 = std::max(block_start[0], roi_start[0]),
+                          x1 = std::min(block_start[0] + (MultiArrayIndex)layout.block_width,
+                                        roi_start[0] + dest.shape(0)),
+                          y0 = std::max(block_start[1], roi_start[1]),
+                          y1 = std::min(block_start[1] + (MultiArrayIndex)layout.block_height,
+                                        roi_start[1] + dest.shape(1));
+
+    for(MultiArrayIndex y = y0; y < y1; ++y)
+    {
+        Sample const * pixel = samples + (y - block_start[1]) * pitch + (x0 - block_start[0]) * spp;
+        for(MultiArrayIndex x = x0; x < x1; ++x, pixel += spp)
+        {
+            T & d = dest(x - roi_start[0], y - roi_start[1]);
+            for(unsigned int b = 0; b < bands; ++b)
+            {
+                Sample v = invert
+                               ? tiffInvertSample(pixel[b])
+                               : pixel[b];
+                Bands::band(d, first_band + b) = RequiresExplicitCast<Component>::cast(v);
+            }
+        }
+    }
+}
+
+template <class T, class S>
+void
+tiffCopyBlock(char const * data, TiffBlockLayout const & layout,
+              Shape2 const & block_start, unsigned int plane,
+              MultiArrayView<2, T, S> & dest, Shape2 const & roi_start)
+{
+    if(layout.sample_format == SAMPLEFORMAT_IEEEFP)
+    {
+        if(layout.bits_per_sample == 32)
+            tiffCopyBlockImpl<float>(data, layout, block_start, plane, dest, roi_start);
+        else
+            tiffCopyBlockImpl<double>(data, layout, block_start, plane, dest, roi_start);
+    }
+    else if(layout.sample_format == SAMPLEFORMAT_INT)
+    {
+        switch(layout.bits_per_sample)
+        {
+          case 8:
+            tiffCopyBlockImpl<Int8>(data, layout, block_start, plane, dest, roi_start);
+            break;
+          case 16:
+            tiffCopyBlockImpl<Int16>(data, layout, block_start, plane, dest, roi_start);
+            break;
+          case 32:
+            tiffCopyBlockImpl<Int32>(data, layout, block_start, plane, dest, roi_start);
+            break;
+          default:
+            tiffCopyBlockImpl<Int64>(data, layout, block_start, plane, dest, roi_start);
+        }
+    }
+    else
+    {
+        switch(layout.bits_per_sample)
+        {
+          case 8:
+            tiffCopyBlockImpl<UInt8>(data, layout, block_start, plane, dest, roi_start);
+            break;
+          case 16:
+            tiffCopyBlockImpl<UInt16>(data, layout, block_start, plane, dest, roi_start);
+            break;
+          case 32:
+            tiffCopyBlockImpl<UInt32>(data, layout, block_start, plane, dest, roi_start);
+            break;
+          default:
+            tiffCopyBlockImpl<UInt64>(data, layout, block_start, plane, dest, roi_start);
+        }
+    }
+}
+
+} // namespace detail
+
+template <class T, class S>
+void
+importTiffImage(TiffImage * tiff, MultiArrayView<2, T, S> dest,
+                Shape2 const & roi_start, ParallelOptions const & options)
+{
+    typedef detail::TiffPixelBands<T> Bands;
+
+    vigra_precondition(tiff != 0,
+        "importTiffImage(): NULL pointer to input data.");
+
+    detail::TiffBlockLayout layout(tiff);
+    Shape2 roi_end = roi_start + dest.shape();
+    vigra_precondition(allLessEqual(Shape2(), roi_start) &&
+                       allLessEqual(roi_end, Shape2(layout.width, layout.height)),
+        "importTiffImage(): region of interest is outside the image.");
+    vigra_precondition(layout.samples_per_pixel >= (unsigned int)Bands::size,
+        "importTiffImage(): destination has more bands than the image.");
+
+    if(dest.size() == 0)
+        return;
+
+    // the strips or tiles intersecting the region of interest, and the planes
+    // (= bands, if PLANARCONFIG_SEPARATE) needed to fill the destination
+    const MultiArrayIndex bx0 = roi_start[0] / layout.block_width,
+                          by0 = roi_start[1] / layout.block_height,
+                          across = (roi_end[0] - 1) / layout.block_width - bx0 + 1,
+                          down   = (roi_end[1] - 1) / layout.block_height - by0 + 1,
+                          planes = layout.planar_config == PLANARCONFIG_SEPARATE
+                                       ? (MultiArrayIndex)Bands::size
+                                       : 1,
+                          count = across * down * planes;
+
+    detail::TiffHandlePool handles(tiff, layout);
+
+    auto decode = [&](int /* thread_id */, MultiArrayIndex k)
+    {
+        const MultiArrayIndex bx = bx0 + k % across,
+                              by = by0 + (k / across) % down;
+        const unsigned int plane = (unsigned int)(k / (across * down));
+        const Shape2 block_start(bx * layout.block_width, by * layout.block_height);
+
+        detail::TiffHandleGuard handle(handles);
+        TiffImage * t = handle->tiff;
+        tdata_t buffer = handle->buffer.data();
+        tsize_t res = layout.tiled
+            ? TIFFReadEncodedTile(t, TIFFComputeTile(t, (uint32_t)block_start[0], (uint32_t)block_start[1], 0, (tsample_t)plane),
+                                  buffer, (tsize_t)handle->buffer.size())
+            : TIFFReadEncodedStrip(t, TIFFComputeStrip(t, (uint32_t)block_start[1], (tsample_t)plane),
+                                   buffer, (tsize_t)handle->buffer.size());
+        vigra_postcondition(res >= 0,
+            "importTiffImage(): unable to decode TIFF strip or tile.");
+        detail::tiffCopyBlock(handle->buffer.data(), layout, block_start, plane, dest, roi_start);
+    };
+
+    if(count > 1 && options.getActualNumThreads() > 1 && handles.reopen())
+    {
+        parallel_foreach(options, count, decode);
+    }
+    else
+    {
+        for(MultiArrayIndex k = 0; k < count; ++k)
+            decode(0, k);
+    }
+}
+
 /********************************************************/
 /*                                                      */
 /*                    tiffToScalarImage                 */
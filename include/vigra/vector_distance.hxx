@@ -97,12 +97,14 @@ partialSquaredMagnitude(const VEC& vec, MultiArrayIndex dim, ARRAY const & pixel
     return sqMag;
 }
 
+    // '_stack' is a workspace that can be reused for subsequent lines
 template <class SrcIterator,
           class Array>
 void
 vectorialDistParabola(MultiArrayIndex dimension,
                       SrcIterator is, SrcIterator iend,
-                      Array const & pixel_pitch )
+                      Array const & pixel_pitch,
+                      std::vector<VectorialDistParabolaStackEntry<typename SrcIterator::value_type, double> > & _stack)
 {
     typedef typename SrcIterator::value_type SrcType;
     typedef VectorialDistParabolaStackEntry<SrcType, double> Influence;
@@ -113,7 +115,7 @@ vectorialDistParabola(MultiArrayIndex dimension,
 
     SrcIterator id = is;
 
-    std::vector<Influence> _stack; //stack of influence parabolas
+    _stack.clear(); //stack of influence parabolas
     double apex_height = partialSquaredMagnitude(*is, dimension, pixel_pitch);
     _stack.push_back(Influence(*is, apex_height, 0.0, 0.0, w));
     ++is;
@@ -156,6 +158,18 @@ vectorialDistParabola(MultiArrayIndex dimension,
     }
 }
 
+template <class SrcIterator,
+          class Array>
+inline void
+vectorialDistParabola(MultiArrayIndex dimension,
+                      SrcIterator is, SrcIterator iend,
+                      Array const & pixel_pitch )
+{
+    std::vector<VectorialDistParabolaStackEntry<typename SrcIterator::value_type, double> > stack;
+    vectorialDistParabola(dimension, is, iend, pixel_pitch, stack);
+}
+
+    // '_stack' is a workspace that can be reused for subsequent lines
 template <class DestIterator,
           class LabelIterator,
           class Array1, class Array2>
@@ -165,7 +179,8 @@ boundaryVectorDistParabola(MultiArrayIndex dimension,
                            LabelIterator ilabels,
                            Array1 const & pixel_pitch,
                            Array2 const & dmax,
-                           bool array_border_is_active=false)
+                           bool array_border_is_active,
+                           std::vector<VectorialDistParabolaStackEntry<typename DestIterator::value_type, double> > & _stack)
 {
     double w = iend - is;
     if(w <= 0)
@@ -181,7 +196,8 @@ boundaryVectorDistParabola(MultiArrayIndex dimension,
                                 ? DestType(0)
                                 : dmax;
     double apex_height = partialSquaredMagnitude(border_point, dimension, pixel_pitch);
-    Stack _stack(1, Influence(border_point, apex_height, 0.0, -1.0, w));
+    _stack.clear();
+    _stack.push_back(Influence(border_point, apex_height, 0.0, -1.0, w));
     LabelType current_label = *ilabels;
     for(double begin = 0.0, current = 0.0; current <= w; ++ilabels, ++is, ++current)
     {
@@ -231,79 +247,136 @@ boundaryVectorDistParabola(MultiArrayIndex dimension,
             current_label = *ilabels;
             point = *is;
             apex_height = partialSquaredMagnitude(point, dimension, pixel_pitch);
-            Stack(1, Influence(DestType(0), 0.0, begin-1.0, begin-1.0, w)).swap(_stack);
+            _stack.clear();
+            _stack.push_back(Influence(DestType(0), 0.0, begin-1.0, begin-1.0, w));
             // don't advance to next pixel here, because the present pixel must also
             // be analysed in the context of the new segment
         }
     }
 }
 
+template <class DestIterator,
+          class LabelIterator,
+          class Array1, class Array2>
+inline void
+boundaryVectorDistParabola(MultiArrayIndex dimension,
+                           DestIterator is, DestIterator iend,
+                           LabelIterator ilabels,
+                           Array1 const & pixel_pitch,
+                           Array2 const & dmax,
+                           bool array_border_is_active=false)
+{
+    std::vector<VectorialDistParabolaStackEntry<typename DestIterator::value_type, double> > stack;
+    boundaryVectorDistParabola(dimension, is, iend, ilabels, pixel_pitch, dmax,
+                               array_border_is_active, stack);
+}
+
+    // Apply 'f(line_begin, line_end, stack)' to all lines of 'dest' along dimension 'd',
+    // where 'stack' is a workspace that is reused for many lines. The lines are
+    // processed in parallel.
+template <unsigned int N, class T, class S, class F>
+void
+vectorialDistLines(MultiArrayView<N, T, S> dest, unsigned int d,
+                   ParallelOptions const & options, F f)
+{
+    typedef typename MultiArrayShape<N>::type Shape;
+    typedef StridedMultiIterator<1, T, T &, T *> LineIterator;
+
+    parallelForEachLineRange<N>(dest.shape(), d, options,
+        [&](MultiArrayIndex begin, MultiArrayIndex end)
+        {
+            Shape line_shape(dest.shape());
+            line_shape[d] = 1;
+            std::vector<VectorialDistParabolaStackEntry<T, double> > stack;
+
+            MultiCoordinateIterator<N> line(line_shape);
+            line += begin;
+            for(MultiArrayIndex k = begin; k < end; ++k, ++line)
+            {
+                LineIterator is(&dest[*line], dest.stride().begin() + d, dest.shape().begin() + d);
+                f(*line, is, is + dest.shape(d), stack);
+            }
+        });
+}
+
 template <unsigned int N, class T1, class S1,
                           class T2, class S2,
           class Array>
 void
 interpixelBoundaryVectorDistance(MultiArrayView<N, T1, S1> const & labels,
                                  MultiArrayView<N, T2, S2> dest,
-                                 Array const & pixelPitch)
+                                 Array const & pixelPitch,
+                                 ParallelOptions const & options)
 {
     typedef typename MultiArrayShape<N>::type  Shape;
     typedef GridGraph<N>                       Graph;
     typedef typename Graph::Node               Node;
-    typedef typename Graph::NodeIt             graph_scanner;
     typedef typename Graph::OutArcIt           neighbor_iterator;
 
     Graph g(labels.shape());
-    for (graph_scanner node(g); node != lemon_graph::INVALID; ++node)
-    {
-        T1 label = labels[*node];
-        double min_dist = NumericTraits<double>::max();
-        Node point    = *node,
-             boundary = point + Node(dest[point]),
-             min_pos  = lemon::INVALID;
-        T2 min_diff;
-
-        //go to adjacent neighbour with same label as origin pixel with smallest distance
-        if(labels.isInside(boundary))
+
+    // every pixel only reads and writes its own result, so we process
+    // contiguous ranges of pixels in parallel
+    MultiArrayIndex size  = labels.size(),
+                    tasks = std::min<MultiArrayIndex>(size, 8*options.getActualNumThreads()),
+                    count = tasks > 0 ? (size + tasks - 1) / tasks : 0;
+    parallel_foreach(options, tasks,
+        [&](int /*thread*/, MultiArrayIndex task)
         {
-            for (neighbor_iterator arc(g, boundary); arc != lemon_graph::INVALID; ++arc)
+            MultiCoordinateIterator<N> node(labels.shape());
+            node += task*count;
+            for (MultiArrayIndex k = task*count; k < std::min(size, (task+1)*count); ++k, ++node)
             {
-                if(label == labels[g.target(*arc)])
+                T1 label = labels[*node];
+                double min_dist = NumericTraits<double>::max();
+                Node point    = *node,
+                     boundary = point + Node(dest[point]),
+                     min_pos  = lemon::INVALID;
+                T2 min_diff;
+
+                //go to adjacent neighbour with same label as origin pixel with smallest distance
+                if(labels.isInside(boundary))
                 {
-                    double dist = squaredNorm(pixelPitch*(g.target(*arc) - point));
-                    if (dist < min_dist)
+                    for (neighbor_iterator arc(g, boundary); arc != lemon_graph::INVALID; ++arc)
                     {
-                        min_dist = dist;
-                        min_pos = g.target(*arc);
+                        if(label == labels[g.target(*arc)])
+                        {
+                            double dist = squaredNorm(pixelPitch*(g.target(*arc) - point));
+                            if (dist < min_dist)
+                            {
+                                min_dist = dist;
+                                min_pos = g.target(*arc);
+                            }
+                        }
                     }
+                    if(min_pos == lemon::INVALID)
+                        continue;
+                    min_dist = NumericTraits<double>::max();
+                }
+                else
+                {
+                    min_pos = clip(boundary, Shape(0), labels.shape()-Shape(1));
+                    min_diff = 0.5*(boundary + min_pos) - point;
+                    min_dist = squaredNorm(pixelPitch*min_diff);
                 }
-            }
-            if(min_pos == lemon::INVALID)
-                continue;
-            min_dist = NumericTraits<double>::max();
-        }
-        else
-        {
-            min_pos = clip(boundary, Shape(0), labels.shape()-Shape(1));
-            min_diff = 0.5*(boundary + min_pos) - point;
-            min_dist = squaredNorm(pixelPitch*min_diff);
-        }
 
-        //from this pixel look for the vector which points to the nearest interpixel between two label
-        for (neighbor_iterator arc(g, min_pos); arc != lemon_graph::INVALID; ++arc)
-        {
-            if(label != labels[g.target(*arc)])
-            {
-                T2 diff = 0.5*(g.target(*arc) + min_pos) - point;
-                double dist = squaredNorm(pixelPitch*diff);
-                if (dist < min_dist)
+                //from this pixel look for the vector which points to the nearest interpixel between two label
+                for (neighbor_iterator arc(g, min_pos); arc != lemon_graph::INVALID; ++arc)
                 {
-                    min_dist = dist;
-                    min_diff = diff;
+                    if(label != labels[g.target(*arc)])
+                    {
+                        T2 diff = 0.5*(g.target(*arc) + min_pos) - point;
+                        double dist = squaredNorm(pixelPitch*diff);
+                        if (dist < min_dist)
+                        {
+                            min_dist = dist;
+                            min_diff = diff;
+                        }
+                    }
                 }
+                dest[point] = min_diff;
             }
-        }
-        dest[point] = min_diff;
-    }
+        });
 }
 
 } // namespace detail
@@ -335,6 +408,24 @@ struct Error_output_pixel_type_must_be_TinyVector_of_appropriate_length
                                     MultiArrayView<N, T2, S2> dest,
                                     bool background,
                                     Array const & pixelPitch=TinyVector<double, N>(1));
+
+            // process the lines of each dimension in parallel
+            template <unsigned int N, class T1, class S1,
+                      class T2, class S2, class Array>
+            void
+            separableVectorDistance(MultiArrayView<N, T1, S1> const & source,
+                                    MultiArrayView<N, T2, S2> dest,
+                                    bool background,
+                                    Array const & pixelPitch,
+                                    ParallelOptions const & options);
+
+            template <unsigned int N, class T1, class S1,
+                      class T2, class S2>
+            void
+            separableVectorDistance(MultiArrayView<N, T1, S1> const & source,
+                                    MultiArrayView<N, T2, S2> dest,
+                                    bool background,
+                                    ParallelOptions const & options);
         }
         \endcode
 
@@ -342,6 +433,16 @@ struct Error_output_pixel_type_must_be_TinyVector_of_appropriate_length
         but returns in each pixel the <i>vector</i> to the nearest background pixel
         rather than the scalar distance. This enables much more powerful applications.
 
+        When \ref ParallelOptions are passed, the lines along each dimension are
+        distributed over the requested number of threads. The result is identical to
+        the sequential version.
+
+        The vector components are integers (or, in case of \ref boundaryVectorDistance()
+        with <tt>InterpixelBoundary</tt>, half-integers), so they are represented exactly by
+        <tt>TinyVector<float, N></tt> for arrays with less than 2<sup>24</sup> pixels along
+        each axis. This output type needs half the memory of <tt>TinyVector<double, N></tt>
+        or <tt>Shape3</tt>.
+
         <b> Usage:</b>
 
         <b>\#include</b> \<vigra/vector_distance.hxx\><br/>
@@ -355,6 +456,10 @@ struct Error_output_pixel_type_must_be_TinyVector_of_appropriate_length
 
         // For each background pixel, find the vector to the nearest foreground pixel.
         separableVectorDistance(source, dest, true);
+
+        // the same using 8 threads and single precision output
+        MultiArray<3, TinyVector<float, 3> > fdest(shape);
+        separableVectorDistance(source, fdest, true, ParallelOptions().numThreads(8));
         \endcode
 
         \see vigra::separableMultiDistance(), vigra::boundaryVectorDistance()
@@ -367,11 +472,12 @@ void
 separableVectorDistance(MultiArrayView<N, T1, S1> const & source,
                         MultiArrayView<N, T2, S2> dest,
                         bool background,
-                        Array const & pixelPitch)
+                        Array const & pixelPitch,
+                        ParallelOptions const & options)
 {
     using namespace vigra::functor;
-    typedef typename MultiArrayView<N, T2, S2>::traverser Traverser;
-    typedef MultiArrayNavigator<Traverser, N> Navigator;
+    typedef StridedMultiIterator<1, T2, T2 &, T2 *> LineIterator;
+    typedef detail::VectorialDistParabolaStackEntry<T2, double> Influence;
 
     VIGRA_STATIC_ASSERT((Error_output_pixel_type_must_be_TinyVector_of_appropriate_length<N == T2::static_size>));
     vigra_precondition(source.shape() == dest.shape(),
@@ -389,14 +495,39 @@ separableVectorDistance(MultiArrayView<N, T1, S1> const & source,
 
     for(unsigned d = 0; d < N; ++d )
     {
-        Navigator nav( dest.traverser_begin(), dest.shape(), d);
-        for( ; nav.hasMore(); nav++ )
-        {
-             detail::vectorialDistParabola(d, nav.begin(), nav.end(), pixelPitch);
-        }
+        detail::vectorialDistLines(dest, d, options,
+            [&](typename MultiArrayShape<N>::type const &,
+                LineIterator is, LineIterator iend, std::vector<Influence> & stack)
+            {
+                detail::vectorialDistParabola(d, is, iend, pixelPitch, stack);
+            });
     }
 }
 
+template <unsigned int N, class T1, class S1,
+          class T2, class S2>
+inline void
+separableVectorDistance(MultiArrayView<N, T1, S1> const & source,
+                        MultiArrayView<N, T2, S2> dest,
+                        bool background,
+                        ParallelOptions const & options)
+{
+    TinyVector<double, N> pixelPitch(1.0);
+    separableVectorDistance(source, dest, background, pixelPitch, options);
+}
+
+template <unsigned int N, class T1, class S1,
+          class T2, class S2, class Array>
+inline void
+separableVectorDistance(MultiArrayView<N, T1, S1> const & source,
+                        MultiArrayView<N, T2, S2> dest,
+                        bool background,
+                        Array const & pixelPitch)
+{
+    separableVectorDistance(source, dest, background, pixelPitch,
+                            ParallelOptions().numThreads(ParallelOptions::NoThreads));
+}
+
 template <unsigned int N, class T1, class S1,
           class T2, class S2>
 inline void
@@ -425,6 +556,27 @@ separableVectorDistance(MultiArrayView<N, T1, S1> const & source,
                                    bool array_border_is_active=false,
                                    BoundaryDistanceTag boundary=OuterBoundary,
                                    Array const & pixelPitch=TinyVector<double, N>(1));
+
+            // process the lines of each dimension in parallel
+            template <unsigned int N, class T1, class S1,
+                                      class T2, class S2,
+                      class Array>
+            void
+            boundaryVectorDistance(MultiArrayView<N, T1, S1> const & labels,
+                                   MultiArrayView<N, T2, S2> dest,
+                                   bool array_border_is_active,
+                                   BoundaryDistanceTag boundary,
+                                   Array const & pixelPitch,
+                                   ParallelOptions const & options);
+
+            template <unsigned int N, class T1, class S1,
+                                      class T2, class S2>
+            void
+            boundaryVectorDistance(MultiArrayView<N, T1, S1> const & labels,
+                                   MultiArrayView<N, T2, S2> dest,
+                                   bool array_border_is_active,
+                                   BoundaryDistanceTag boundary,
+                                   ParallelOptions const & options);
         }
         \endcode
 
@@ -432,7 +584,8 @@ separableVectorDistance(MultiArrayView<N, T1, S1> const & source,
         but returns in each pixel the <i>vector</i> to the nearest boundary pixel
         rather than the scalar distance. This enables much more powerful applications.
         Additionally, it support a <tt>pixelPitch</tt> parameter which allows to adjust
-        the distance calculations for anisotropic grid resolution.
+        the distance calculations for anisotropic grid resolution. Parallel execution
+        and single precision output work as in \ref separableVectorDistance().
 
         <b> Usage:</b>
 
@@ -462,7 +615,8 @@ boundaryVectorDistance(MultiArrayView<N, T1, S1> const & labels,
                        MultiArrayView<N, T2, S2> dest,
                        bool array_border_is_active,
                        BoundaryDistanceTag boundary,
-                       Array const & pixelPitch)
+                       Array const & pixelPitch,
+                       ParallelOptions const & options)
 {
     VIGRA_STATIC_ASSERT((Error_output_pixel_type_must_be_TinyVector_of_appropriate_length<N == T2::static_size>));
     vigra_precondition(labels.shape() == dest.shape(),
@@ -479,7 +633,7 @@ boundaryVectorDistance(MultiArrayView<N, T1, S1> const & labels,
         markRegionBoundaries(labels, boundaries, IndirectNeighborhood);
         if(array_border_is_active)
             initMultiArrayBorder(boundaries, 1, 1);
-        separableVectorDistance(boundaries, dest, true, pixelPitch);
+        separableVectorDistance(boundaries, dest, true, pixelPitch, options);
     }
     else
     {
@@ -489,32 +643,58 @@ boundaryVectorDistance(MultiArrayView<N, T1, S1> const & labels,
                 "boundaryVectorDistance(..., InterpixelBoundary): output pixel type must be float or double.");
         }
 
-        typedef typename MultiArrayView<N, T1, S1>::const_traverser LabelIterator;
-        typedef typename MultiArrayView<N, T2, S2>::traverser DestIterator;
-        typedef MultiArrayNavigator<LabelIterator, N> LabelNavigator;
-        typedef MultiArrayNavigator<DestIterator, N> DNavigator;
+        typedef typename MultiArrayShape<N>::type Shape;
+        typedef StridedMultiIterator<1, T2, T2 &, T2 *> DestIterator;
+        typedef StridedMultiIterator<1, T1, T1 const &, T1 const *> LabelIterator;
+        typedef detail::VectorialDistParabolaStackEntry<T2, double> Influence;
 
         T2 maxDist(2*sum(labels.shape()*pixelPitch));
         dest = maxDist;
         for( unsigned d = 0; d < N; ++d )
         {
-            LabelNavigator lnav( labels.traverser_begin(), labels.shape(), d );
-            DNavigator dnav( dest.traverser_begin(), dest.shape(), d );
-
-            for( ; dnav.hasMore(); dnav++, lnav++ )
-            {
-                detail::boundaryVectorDistParabola(d, dnav.begin(), dnav.end(), lnav.begin(),
-                                                   pixelPitch, maxDist, array_border_is_active);
-            }
+            detail::vectorialDistLines(dest, d, options,
+                [&](Shape const & line, DestIterator is, DestIterator iend, std::vector<Influence> & stack)
+                {
+                    LabelIterator il(&labels[line], labels.stride().begin() + d, labels.shape().begin() + d);
+                    detail::boundaryVectorDistParabola(d, is, iend, il,
+                                                       pixelPitch, maxDist, array_border_is_active, stack);
+                });
         }
 
         if(boundary == InterpixelBoundary)
         {
-           detail::interpixelBoundaryVectorDistance(labels, dest, pixelPitch);
+           detail::interpixelBoundaryVectorDistance(labels, dest, pixelPitch, options);
         }
     }
 }
 
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2,
+          class Array>
+inline void
+boundaryVectorDistance(MultiArrayView<N, T1, S1> const & labels,
+                       MultiArrayView<N, T2, S2> dest,
+                       bool array_border_is_active,
+                       BoundaryDistanceTag boundary,
+                       Array const & pixelPitch)
+{
+    boundaryVectorDistance(labels, dest, array_border_is_active, boundary, pixelPitch,
+                           ParallelOptions().numThreads(ParallelOptions::NoThreads));
+}
+
+template <unsigned int N, class T1, class S1,
+                          class T2, class S2>
+inline void
+boundaryVectorDistance(MultiArrayView<N, T1, S1> const & labels,
+                       MultiArrayView<N, T2, S2> dest,
+                       bool array_border_is_active,
+                       BoundaryDistanceTag boundary,
+                       ParallelOptions const & options)
+{
+    TinyVector<double, N> pixelPitch(1.0);
+    boundaryVectorDistance(labels, dest, array_border_is_active, boundary, pixelPitch, options);
+}
+
 template <unsigned int N, class T1, class S1,
                           class T2, class S2>
 void
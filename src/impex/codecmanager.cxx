@@ -303,6 +303,142 @@ namespace vigra
         return codecManager().getDecoder( filename, filetype, imageindex );
     }
 
+    // Fallback for codecs that cannot decode a region natively: read the full
+    // image and hand out only the rows and columns of the region. Columns are
+    // skipped without copying by offsetting the scanline pointer and
+    // enlarging the pixel offset.
+    class RegionDecoder : public Decoder
+    {
+        VIGRA_UNIQUE_PTR<Decoder> decoder;
+        Diff2D upperLeft;
+        Size2D size;
+        unsigned int step, rows, pixelsize;
+
+    public:
+
+        RegionDecoder( Decoder * dec, const Diff2D & ul,
+                       const Size2D & sz, unsigned int st )
+            : decoder(dec), upperLeft(ul), size(sz), step(st), rows(0)
+        {
+            const std::string pixeltype = decoder->getPixelType();
+            if ( pixeltype == "UINT8" || pixeltype == "INT8" )
+                pixelsize = 1;
+            else if ( pixeltype == "UINT16" || pixeltype == "INT16" )
+                pixelsize = 2;
+            else if ( pixeltype == "DOUBLE" )
+                pixelsize = 8;
+            else
+                pixelsize = 4;
+            iccProfile_ = decoder->getICCProfile();
+        }
+
+        void init( const std::string & )
+        {
+            vigra_fail( "RegionDecoder::init(): decoder is already initialized." );
+        }
+
+        void close()
+        {
+            decoder->close();
+        }
+
+        void abort()
+        {
+            decoder->abort();
+        }
+
+        std::string getFileType() const
+        {
+            return decoder->getFileType();
+        }
+
+        std::string getPixelType() const
+        {
+            return decoder->getPixelType();
+        }
+
+        unsigned int getNumImages() const
+        {
+            return decoder->getNumImages();
+        }
+
+        unsigned int getImageIndex() const
+        {
+            return decoder->getImageIndex();
+        }
+
+        unsigned int getWidth() const
+        {
+            return ( size.x + step - 1 ) / step;
+        }
+
+        unsigned int getHeight() const
+        {
+            return ( size.y + step - 1 ) / step;
+        }
+
+        unsigned int getNumBands() const
+        {
+            return decoder->getNumBands();
+        }
+
+        unsigned int getNumExtraBands() const
+        {
+            return decoder->getNumExtraBands();
+        }
+
+        Diff2D getPosition() const
+        {
+            return decoder->getPosition() + upperLeft;
+        }
+
+        float getXResolution() const
+        {
+            return decoder->getXResolution();
+        }
+
+        float getYResolution() const
+        {
+            return decoder->getYResolution();
+        }
+
+        unsigned int getOffset() const
+        {
+            return decoder->getOffset() * step;
+        }
+
+        const void * currentScanlineOfBand( unsigned int band ) const
+        {
+            return static_cast< const char * >(decoder->currentScanlineOfBand(band))
+                + upperLeft.x * decoder->getOffset() * pixelsize;
+        }
+
+        void nextScanline()
+        {
+            // the first call skips the rows above the region
+            const int n = rows++ == 0 ? upperLeft.y + 1 : step;
+            for ( int i = 0; i < n; ++i )
+                decoder->nextScanline();
+        }
+    };
+
+    VIGRA_UNIQUE_PTR<Decoder>
+    getDecoder( const std::string & filename, const std::string & filetype,
+                unsigned int imageindex, const Diff2D & upperLeft,
+                const Size2D & size, unsigned int step )
+    {
+        VIGRA_UNIQUE_PTR<Decoder> dec
+            = codecManager().getDecoder( filename, filetype, imageindex );
+        vigra_precondition( step > 0 && upperLeft.x >= 0 && upperLeft.y >= 0 &&
+                            size.x > 0 && size.y > 0 &&
+                            upperLeft.x + size.x <= (int)dec->getWidth() &&
+                            upperLeft.y + size.y <= (int)dec->getHeight(),
+                            "getDecoder(): region of interest is outside the image." );
+        if ( dec->setRegion( upperLeft, size, step ) )
+            return dec;
+        return VIGRA_UNIQUE_PTR<Decoder>( new RegionDecoder( dec.release(), upperLeft, size, step ) );
+    }
+
     // get an encoder type
     std::string
     getEncoderType( const std::string & filename, const std::string & filetype )
@@ -35,18 +35,161 @@
 
 #include <algorithm>
 #include "vigra/compression.hxx"
+#include "vigra/sized_int.hxx"
 #include "lz4.h"
 
 #ifdef HasZLIB
 #include <zlib.h>
 #endif
 
+#ifdef HasZSTD
+#include <zstd.h>
+#endif
+
 namespace vigra {
 
+namespace {
+
+inline bool isZstd(int method)
+{
+    return method >= ZSTD_FAST && method <= ZSTD_FAST + 21;
+}
+
+    // the codec that does the actual work after a shuffle filter
+inline CompressionMethod shuffleCodec(CompressionMethod method)
+{
+    return method == SHUFFLE_ZSTD
+               ? ZSTD
+               : LZ4;
+}
+
+    // Blosc-style byte shuffle: byte b of element i goes to b*n + i.
+    // Trailing bytes that don't form a complete element are copied verbatim.
+template <std::size_t TYPESIZE>
+void byteShuffleImpl(char const * source, char * dest, std::size_t n, std::size_t typesize)
+{
+    std::size_t const ts = TYPESIZE ? TYPESIZE : typesize;
+    for(std::size_t i = 0; i < n; ++i, source += ts)
+        for(std::size_t b = 0; b < ts; ++b)
+            dest[b*n + i] = source[b];
+}
+
+template <std::size_t TYPESIZE>
+void byteUnshuffleImpl(char const * source, char * dest, std::size_t n, std::size_t typesize)
+{
+    std::size_t const ts = TYPESIZE ? TYPESIZE : typesize;
+    for(std::size_t i = 0; i < n; ++i, dest += ts)
+        for(std::size_t b = 0; b < ts; ++b)
+            dest[b] = source[b*n + i];
+}
+
+void byteShuffle(char const * source, std::size_t size, char * dest, std::size_t typesize, bool inverse)
+{
+    std::size_t n = size / typesize;
+    switch(typesize)
+    {
+      case 2:
+        inverse ? byteUnshuffleImpl<2>(source, dest, n, 2)
+                : byteShuffleImpl<2>(source, dest, n, 2);
+        break;
+      case 4:
+        inverse ? byteUnshuffleImpl<4>(source, dest, n, 4)
+                : byteShuffleImpl<4>(source, dest, n, 4);
+        break;
+      case 8:
+        inverse ? byteUnshuffleImpl<8>(source, dest, n, 8)
+                : byteShuffleImpl<8>(source, dest, n, 8);
+        break;
+      default:
+        inverse ? byteUnshuffleImpl<0>(source, dest, n, typesize)
+                : byteShuffleImpl<0>(source, dest, n, typesize);
+    }
+    std::copy(source + n*typesize, source + size, dest + n*typesize);
+}
+
+    // transpose an 8x8 bit matrix whose rows are the bytes of 'x'
+    // (Hacker's Delight, section 7-3)
+inline UInt64 transposeBits(UInt64 x)
+{
+    UInt64 t;
+    t = (x ^ (x >> 7))  & 0x00AA00AA00AA00AAULL;  x = x ^ t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;  x = x ^ t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;  x = x ^ t ^ (t << 28);
+    return x;
+}
+
+    // Transpose the bits in each byte plane of n bytes, such that bit j of 
+    // all bytes is stored contiguously in n/8 bytes. The n % 8 remaining 
+    // bytes of each plane are copied unchanged.
+void transposeBitPlanes(char const * source, std::size_t size, char * dest, 
+                        std::size_t typesize, bool inverse)
+{
+    std::size_t n = size / typesize,
+                groups = n / 8;
+    for(std::size_t p = 0; p < typesize; ++p)
+    {
+        UInt8 const * src = (UInt8 const *)source + p*n;
+        UInt8 * dst = (UInt8 *)dest + p*n;
+        for(std::size_t g = 0; g < groups; ++g)
+        {
+            UInt64 x = 0;
+            for(int k = 0; k < 8; ++k)
+                x |= UInt64(inverse ? src[k*groups + g] : src[8*g + k]) << (8*k);
+            x = transposeBits(x);
+            for(int k = 0; k < 8; ++k)
+                (inverse ? dst[8*g + k] : dst[k*groups + g]) = UInt8(x >> (8*k));
+        }
+        std::copy(src + 8*groups, src + n, dst + 8*groups);
+    }
+    std::copy(source + n*typesize, source + size, dest + n*typesize);
+}
+
+    // Bit shuffle (as in the 'bitshuffle' filter): a byte shuffle followed by
+    // a bit transpose of each byte plane.
+void bitShuffle(char const * source, std::size_t size, char * dest, 
+                std::size_t typesize, bool inverse)
+{
+    ArrayVector<char> tmp(size);
+    if(inverse)
+    {
+        transposeBitPlanes(source, size, tmp.data(), typesize, true);
+        byteShuffle(tmp.data(), size, dest, typesize, true);
+    }
+    else
+    {
+        byteShuffle(source, size, tmp.data(), typesize, false);
+        transposeBitPlanes(tmp.data(), size, dest, typesize, false);
+    }
+}
+
+void shuffle(char const * source, std::size_t size, char * dest, 
+             std::size_t typesize, CompressionMethod method, bool inverse)
+{
+    if(method == BITSHUFFLE_LZ4)
+        bitShuffle(source, size, dest, typesize, inverse);
+    else
+        byteShuffle(source, size, dest, typesize, inverse);
+}
+
+} // anonymous namespace
+
 std::size_t compressImpl(char const * source, std::size_t srcSize, 
                          ArrayVector<char> & buffer,
-                         CompressionMethod method)
+                         CompressionMethod method, std::size_t typesize = 1)
 {
+    if(isZstd(method))
+    {
+    #ifdef HasZSTD
+        std::size_t destSize = ::ZSTD_compressBound(srcSize);
+        buffer.resize(destSize);
+        destSize = ::ZSTD_compress(buffer.data(), destSize, source, srcSize, method - ZSTD_FAST + 1);
+        vigra_postcondition(!::ZSTD_isError(destSize), "compress(): zstd compression failed.");
+        return destSize;
+    #else
+        vigra_precondition(false, "compress(): VIGRA was compiled without ZSTD compression.");
+        return 0;
+    #endif
+    }
     switch(method)
     {
       case NO_COMPRESSION:
@@ -79,6 +222,17 @@ std::size_t compressImpl(char const * source, std::size_t srcSize,
         vigra_postcondition(destSize > 0, "compress(): lz4 compression failed.");
         return destSize;
       }
+      case SHUFFLE_LZ4:
+      case BITSHUFFLE_LZ4:
+      case SHUFFLE_ZSTD:
+      {
+        vigra_precondition(typesize > 0, "compress(): typesize must be positive.");
+        if(typesize == 1 && method != BITSHUFFLE_LZ4)
+            return compressImpl(source, srcSize, buffer, shuffleCodec(method));
+        ArrayVector<char> shuffled(srcSize);
+        shuffle(source, srcSize, shuffled.data(), typesize, method, false);
+        return compressImpl(shuffled.data(), srcSize, buffer, shuffleCodec(method));
+      }
 
 #if 0  // currently unsupported
       case SNAPPY:
@@ -118,24 +272,38 @@ std::size_t compressImpl(char const * source, std::size_t srcSize,
     return 0;
 }
 
-void compress(char const * source, std::size_t size, ArrayVector<char> & dest, CompressionMethod method)
+void compress(char const * source, std::size_t size, ArrayVector<char> & dest, 
+              CompressionMethod method, std::size_t typesize)
 {
     ArrayVector<char> buffer;
-    std::size_t destSize = compressImpl(source, size, buffer, method);
+    std::size_t destSize = compressImpl(source, size, buffer, method, typesize);
     dest.resize(destSize);
     std::copy(buffer.data(), buffer.data() + destSize, dest.begin());
 }
 
-void compress(char const * source, std::size_t size, std::vector<char> & dest, CompressionMethod method)
+void compress(char const * source, std::size_t size, std::vector<char> & dest, 
+              CompressionMethod method, std::size_t typesize)
 {
     ArrayVector<char> buffer;
-    std::size_t destSize = compressImpl(source, size, buffer, method);
+    std::size_t destSize = compressImpl(source, size, buffer, method, typesize);
     dest.insert(dest.begin(), buffer.data(), buffer.data() + destSize);
 }
 
 void uncompress(char const * source, std::size_t srcSize, 
-                char * dest, std::size_t destSize, CompressionMethod method)
+                char * dest, std::size_t destSize, CompressionMethod method,
+                std::size_t typesize)
 {
+    if(isZstd(method))
+    {
+    #ifdef HasZSTD
+        std::size_t res = ::ZSTD_decompress(dest, destSize, source, srcSize);
+        vigra_postcondition(!::ZSTD_isError(res) && res == destSize, 
+                            "uncompress(): zstd decompression failed.");
+    #else
+        vigra_precondition(false, "uncompress(): VIGRA was compiled without ZSTD compression.");
+    #endif
+        return;
+    }
     switch(method)
     {
       case NO_COMPRESSION:
@@ -164,6 +332,21 @@ void uncompress(char const * source, std::size_t srcSize,
         vigra_postcondition(sourceLen >= 0 && static_cast<unsigned>(sourceLen) == srcSize, "uncompress(): lz4 decompression failed.");
         break;
       }
+      case SHUFFLE_LZ4:
+      case BITSHUFFLE_LZ4:
+      case SHUFFLE_ZSTD:
+      {
+        vigra_precondition(typesize > 0, "uncompress(): typesize must be positive.");
+        if(typesize == 1 && method != BITSHUFFLE_LZ4)
+        {
+            uncompress(source, srcSize, dest, destSize, shuffleCodec(method));
+            break;
+        }
+        ArrayVector<char> shuffled(destSize);
+        uncompress(source, srcSize, shuffled.data(), destSize, shuffleCodec(method));
+        shuffle(shuffled.data(), destSize, dest, typesize, method, true);
+        break;
+      }
       
 #if 0 // currently unsupported
       case SNAPPY:
@@ -716,6 +716,16 @@ VIGRA_UNIQUE_PTR<Decoder> decoder( const ImageImportInfo & info )
     return getDecoder( std::string( info.getFileName() ), filetype, info.getImageIndex() );
 }
 
+// return a decoder for a region of interest
+VIGRA_UNIQUE_PTR<Decoder> decoder( const ImageImportInfo & info,
+                                   const Rect2D & roi, unsigned int step )
+{
+    std::string filetype = info.getFileType();
+    validate_filetype(filetype);
+    return getDecoder( std::string( info.getFileName() ), filetype, info.getImageIndex(),
+                       roi.upperLeft(), roi.size(), step );
+}
+
 // class VolumeExportInfo
 
 VolumeExportInfo::VolumeExportInfo( const char * filename ) :
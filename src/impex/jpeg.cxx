@@ -41,6 +41,7 @@
 #ifdef HasJPEG
 
 #include <stdexcept>
+#include <algorithm>
 #include <csetjmp>
 #include "vigra/config.hxx"
 #include "void_vector.hxx"
@@ -55,6 +56,11 @@ extern "C" {
 
 } // extern "C"
 
+// libjpeg-turbo can skip rows and crop columns without decoding them
+#if defined(LIBJPEG_TURBO_VERSION_NUMBER)
+# define VIGRA_JPEG_CROP_AND_SKIP
+#endif
+
 namespace {
 
 struct JPEGCodecErrorManager
@@ -187,6 +193,11 @@ namespace vigra
         UInt32 iccProfileLength;
         const unsigned char *iccProfilePtr;
 
+        // region of interest: columns to skip in each scanline and rows
+        // to skip before the first one (in possibly scaled coordinates)
+        unsigned int xoffset, yoffset;
+        bool started;
+
         // ctor, dtor
         JPEGDecoderImpl( const std::string & filename );
         ~JPEGDecoderImpl();
@@ -194,6 +205,7 @@ namespace vigra
         // methods
 
         void init();
+        void start();
     };
 
     JPEGDecoderImpl::JPEGDecoderImpl( const std::string & filename )
@@ -202,7 +214,8 @@ namespace vigra
 #else
         : file( filename.c_str(), "r" ),
 #endif
-          bands(0), scanline(0), iccProfileLength(0), iccProfilePtr(NULL)
+          bands(0), scanline(0), iccProfileLength(0), iccProfilePtr(NULL),
+          xoffset(0), yoffset(0), started(false)
     {
         // setup setjmp() error handling
         info.err = jpeg_std_error( ( jpeg_error_mgr * ) &err );
@@ -232,18 +245,54 @@ namespace vigra
             iccProfilePtr = iccBuf;
         }
 
-        // start the decompression
+        // compute the output size, but start the decompression only when
+        // the first scanline is requested, so that setRegion() can still
+        // choose a scale
         if (setjmp(err.buf))
-            vigra_fail( "error in jpeg_start_decompress()" );
-        jpeg_start_decompress(&info);
+            vigra_fail( "error in jpeg_calc_output_dimensions()" );
+        jpeg_calc_output_dimensions(&info);
 
         // transfer interesting header information
         width = info.output_width;
         height = info.output_height;
         components = info.output_components;
+    }
+
+    void JPEGDecoderImpl::start()
+    {
+        // start the decompression
+        if (setjmp(err.buf))
+            vigra_fail( "error in jpeg_start_decompress()" );
+        jpeg_start_decompress(&info);
+        started = true;
+
+#ifdef VIGRA_JPEG_CROP_AND_SKIP
+        if ( xoffset > 0 || width < info.output_width ) {
+            // the crop is extended to iMCU boundaries
+            JDIMENSION x = xoffset, w = width;
+            if (setjmp(err.buf))
+                vigra_fail( "error in jpeg_crop_scanline()" );
+            jpeg_crop_scanline( &info, &x, &w );
+            xoffset -= x;
+        }
+        if ( yoffset > 0 ) {
+            if (setjmp(err.buf))
+                vigra_fail( "error in jpeg_skip_scanlines()" );
+            jpeg_skip_scanlines( &info, yoffset );
+        }
+#endif
 
         // alloc memory for a single scanline
-        bands.resize( width * components );
+        bands.resize( info.output_width * components );
+
+#ifndef VIGRA_JPEG_CROP_AND_SKIP
+        JSAMPLE * band = bands.data();
+        for ( unsigned int y = 0; y < yoffset; ++y ) {
+            if (setjmp(err.buf))
+                vigra_fail( "error in jpeg_read_scanlines()" );
+            jpeg_read_scanlines( &info, &band, 1 );
+        }
+#endif
 
         // set colorspace
         info.jpeg_color_space = components == 1 ? JCS_GRAYSCALE : JCS_RGB;
@@ -305,11 +354,37 @@ namespace vigra
 
     const void * JPEGDecoder::currentScanlineOfBand( unsigned int band ) const
     {
-        return pimpl->bands.data() + band;
+        return pimpl->bands.data() + pimpl->xoffset * pimpl->components + band;
+    }
+
+    bool JPEGDecoder::setRegion( const Diff2D & ul, const Size2D & size, unsigned int step )
+    {
+        // libjpeg scales by 1/2, 1/4, and 1/8 in the DCT domain, which requires
+        // the region to start on a multiple of the scale
+        if ( pimpl->started || ( step != 1 && step != 2 && step != 4 && step != 8 ) ||
+             ul.x % step != 0 || ul.y % step != 0 )
+            return false;
+
+        pimpl->info.scale_num = 1;
+        pimpl->info.scale_denom = step;
+        if (setjmp(pimpl->err.buf))
+            vigra_fail( "error in jpeg_calc_output_dimensions()" );
+        jpeg_calc_output_dimensions(&pimpl->info);
+
+        pimpl->xoffset = ul.x / step;
+        pimpl->yoffset = ul.y / step;
+        pimpl->width = std::min< unsigned int >( ( size.x + step - 1 ) / step,
+                                                 pimpl->info.output_width - pimpl->xoffset );
+        pimpl->height = std::min< unsigned int >( ( size.y + step - 1 ) / step,
+                                                  pimpl->info.output_height - pimpl->yoffset );
+        return true;
     }
 
     void JPEGDecoder::nextScanline()
     {
+        if ( !pimpl->started )
+            pimpl->start();
+
         // check if there are scanlines left at all, eventually read one
         JSAMPLE * band = pimpl->bands.data();
         if ( pimpl->info.output_scanline < pimpl->info.output_height ) {
@@ -321,6 +396,13 @@ namespace vigra
 
     void JPEGDecoder::close()
     {
+        // region decoding stops before the last scanline
+        if ( !pimpl->started ||
+             pimpl->info.output_scanline < pimpl->info.output_height ) {
+            jpeg_abort_decompress(&pimpl->info);
+            return;
+        }
+
         // finish any pending decompression
         if (setjmp(pimpl->err.buf))
             vigra_fail( "error in jpeg_finish_decompress()" );
@@ -72,6 +72,8 @@ namespace vigra {
         std::string getPixelType() const;
         unsigned int getOffset() const;
 
+        bool setRegion( const Diff2D &, const Size2D &, unsigned int );
+
         void init( const std::string & );
         void close();
         void abort();
@@ -65,16 +65,15 @@ extern "C"
 
 // TODO: per-scanline reading/writing
 
-namespace {
-    std::string png_error_message;
-}
-
 extern "C" {
 
-// called on fatal errors
+// called on fatal errors, the error pointer is the error_message of the
+// decoder or encoder (so that several files can be processed concurrently)
 static void PngError( png_structp png_ptr, png_const_charp error_msg )
 {
-    png_error_message = std::string(error_msg);
+    std::string * error_message = static_cast<std::string *>(png_get_error_ptr(png_ptr));
+    if(error_message)
+        *error_message = std::string(error_msg);
     longjmp( png_jmpbuf(png_ptr), 1 );
 }
 
@@ -147,6 +146,9 @@ namespace vigra {
         png_structp png;
         png_infop info;
 
+        // text of the last fatal libpng error
+        std::string error_message;
+
         // image header fields
         png_uint_32 width, height, components;
         png_uint_32 extra_components;
@@ -173,6 +175,11 @@ namespace vigra {
         int rowsize;
         void_vector<unsigned char> row_data;
 
+        // region of interest, rows outside are decoded but not stored
+        Diff2D region_ul;
+        Size2D region_size;
+        unsigned int region_step;
+
         // ctor, dtor
         PngDecoderImpl( const std::string & filename );
         ~PngDecoderImpl();
@@ -191,9 +198,8 @@ namespace vigra {
 #endif
           bands(0), iccProfileLength(0), iccProfilePtr(0),
           scanline(-1), x_resolution(0), y_resolution(0),
-          n_interlace_passes(0), n_channels(0)
+          n_interlace_passes(0), n_channels(0), region_step(1)
     {
-        png_error_message = "";
         // check if the file is a png file
         const unsigned int sig_size = 8;
         png_byte sig[sig_size];
@@ -202,14 +208,14 @@ namespace vigra {
         vigra_precondition( (readCount == 1) && !no_png, "given file is not a png file.");
 
         // create png read struct with user defined handlers
-        png = png_create_read_struct( PNG_LIBPNG_VER_STRING, NULL,
+        png = png_create_read_struct( PNG_LIBPNG_VER_STRING, &error_message,
                                       &PngError, &PngWarning );
         vigra_postcondition( png != 0, "could not create the read struct." );
 
         // create info struct
         if (setjmp(png_jmpbuf(png))) {
             png_destroy_read_struct( &png, &info, NULL );
-            vigra_postcondition( false, png_error_message.insert(0, "error in png_create_info_struct(): ").c_str() );
+            vigra_postcondition( false, error_message.insert(0, "error in png_create_info_struct(): ").c_str() );
         }
         info = png_create_info_struct(png);
         vigra_postcondition( info != 0, "could not create the info struct." );
@@ -217,14 +223,14 @@ namespace vigra {
         // init png i/o
         if (setjmp(png_jmpbuf(png))) {
             png_destroy_read_struct( &png, &info, NULL );
-            vigra_postcondition( false, png_error_message.insert(0, "error in png_init_io(): ").c_str() );
+            vigra_postcondition( false, error_message.insert(0, "error in png_init_io(): ").c_str() );
         }
         png_init_io( png, file.get() );
 
         // specify that the signature was already read
         if (setjmp(png_jmpbuf(png))) {
             png_destroy_read_struct( &png, &info, NULL );
-            vigra_postcondition( false, png_error_message.insert(0, "error in png_set_sig_bytes(): ").c_str() );
+            vigra_postcondition( false, error_message.insert(0, "error in png_set_sig_bytes(): ").c_str() );
         }
         png_set_sig_bytes( png, sig_size );
 
@@ -239,13 +245,13 @@ namespace vigra {
     {
         // read all chunks up to the image data
         if (setjmp(png_jmpbuf(png)))
-            vigra_postcondition( false, png_error_message.insert(0, "error in png_read_info(): ").c_str() );
+            vigra_postcondition( false, error_message.insert(0, "error in png_read_info(): ").c_str() );
         png_read_info( png, info );
 
         // pull over the header fields
         int interlace_method, compression_method, filter_method;
         if (setjmp(png_jmpbuf(png)))
-            vigra_postcondition( false, png_error_message.insert(0, "error in png_get_IHDR(): ").c_str() );
+            vigra_postcondition( false, error_message.insert(0, "error in png_get_IHDR(): ").c_str() );
         png_get_IHDR( png, info, &width, &height, &bit_depth, &color_type,
                       &interlace_method, &compression_method, &filter_method );
 
@@ -259,7 +265,7 @@ namespace vigra {
         // transform palette to rgb
         if ( color_type == PNG_COLOR_TYPE_PALETTE) {
             if (setjmp(png_jmpbuf(png)))
-                vigra_postcondition( false, png_error_message.insert(0, "error in png_palette_to_rgb(): ").c_str() );
+                vigra_postcondition( false, error_message.insert(0, "error in png_palette_to_rgb(): ").c_str() );
             png_set_palette_to_rgb(png);
             color_type = PNG_COLOR_TYPE_RGB;
             bit_depth = 8;
@@ -269,7 +275,7 @@ namespace vigra {
         if ( color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8 ) {
             if (setjmp(png_jmpbuf(png)))
                 vigra_postcondition(false,
-                                    png_error_message.insert(0, "error in png_set_expand_gray_1_2_4_to_8(): ").c_str());
+                                    error_message.insert(0, "error in png_set_expand_gray_1_2_4_to_8(): ").c_str());
             png_set_expand_gray_1_2_4_to_8(png);
             bit_depth = 8;
         }
@@ -279,7 +285,7 @@ namespace vigra {
         // strip alpha channel
         if ( color_type & PNG_COLOR_MASK_ALPHA ) {
             if (setjmp(png_jmpbuf(png)))
-                vigra_postcondition( false, png_error_message.insert(0, "error in png_set_strip_alpha(): ").c_str() );
+                vigra_postcondition( false, error_message.insert(0, "error in png_set_strip_alpha(): ").c_str() );
             png_set_strip_alpha(png);
             color_type ^= PNG_COLOR_MASK_ALPHA;
         }
@@ -340,7 +346,7 @@ namespace vigra {
         double image_gamma = 0.45455;
         if ( png_get_valid( png, info, PNG_INFO_gAMA ) ) {
             if (setjmp(png_jmpbuf(png)))
-                vigra_postcondition( false, png_error_message.insert(0, "error in png_get_gAMA(): ").c_str() );
+                vigra_postcondition( false, error_message.insert(0, "error in png_get_gAMA(): ").c_str() );
             png_get_gAMA( png, info, &image_gamma );
         }
 
@@ -349,40 +355,53 @@ namespace vigra {
 
         // set gamma correction
         if (setjmp(png_jmpbuf(png)))
-            vigra_postcondition( false, png_error_message.insert(0, "error in png_set_gamma(): ").c_str() );
+            vigra_postcondition( false, error_message.insert(0, "error in png_set_gamma(): ").c_str() );
         png_set_gamma( png, screen_gamma, image_gamma );
 #endif
 
         // interlace handling, get number of read passes needed
         if (setjmp(png_jmpbuf(png)))
-            vigra_postcondition( false,png_error_message.insert(0, "error in png_set_interlace_handling(): ").c_str());
+            vigra_postcondition( false,error_message.insert(0, "error in png_set_interlace_handling(): ").c_str());
         n_interlace_passes = png_set_interlace_handling(png);
 
         // update png library state to reflect any changes that were made
         if (setjmp(png_jmpbuf(png)))
-            vigra_postcondition( false, png_error_message.insert(0, "error in png_read_update_info(): ").c_str() );
+            vigra_postcondition( false, error_message.insert(0, "error in png_read_update_info(): ").c_str() );
         png_read_update_info( png, info );
 
         if (setjmp(png_jmpbuf(png)))
-            vigra_postcondition( false,png_error_message.insert(0, "error in png_get_channels(): ").c_str());
+            vigra_postcondition( false,error_message.insert(0, "error in png_get_channels(): ").c_str());
         n_channels = png_get_channels(png, info);
 
         if (setjmp(png_jmpbuf(png)))
-            vigra_postcondition( false,png_error_message.insert(0, "error in png_get_rowbytes(): ").c_str());
+            vigra_postcondition( false,error_message.insert(0, "error in png_get_rowbytes(): ").c_str());
         rowsize = png_get_rowbytes(png, info);
 
         // allocate data buffers
         row_data.resize(rowsize);
+
+        region_size = Size2D(width, height);
     }
 
     void PngDecoderImpl::nextScanline()
     {
         if (setjmp(png_jmpbuf(png)))
-            vigra_postcondition( false,png_error_message.insert(0, "error in png_read_row(): ").c_str());        
+            vigra_postcondition( false,error_message.insert(0, "error in png_read_row(): ").c_str());        
+        if (region_step > 1 || region_ul.y > 0)
+        {
+            // skip the rows above the region and between the delivered rows
+            const int n = scanline < 0 ? region_ul.y + 1 : region_step;
+            for (int i=0; i < n - 1; i++)
+                png_read_row(png, NULL, NULL);
+            png_read_row(png, row_data.begin(), NULL);
+            scanline += n;
+            return;
+        }
         for (int i=0; i < n_interlace_passes; i++) 
         {
             png_read_row(png, row_data.begin(), NULL);
         }
+        ++scanline;
     }
 
     void PngDecoder::init( const std::string & filename )
@@ -410,12 +429,12 @@ namespace vigra {
 
     unsigned int PngDecoder::getWidth() const
     {
-        return pimpl->width;
+        return (pimpl->region_size.x + pimpl->region_step - 1) / pimpl->region_step;
     }
 
     unsigned int PngDecoder::getHeight() const
     {
-        return pimpl->height;
+        return (pimpl->region_size.y + pimpl->region_step - 1) / pimpl->region_step;
     }
 
     unsigned int PngDecoder::getNumBands() const
@@ -440,7 +459,7 @@ namespace vigra {
 
     Diff2D PngDecoder::getPosition() const
     {
-        return pimpl->position;
+        return pimpl->position + pimpl->region_ul;
     }
 
     std::string PngDecoder::getPixelType() const
@@ -458,19 +477,20 @@ namespace vigra {
 
     unsigned int PngDecoder::getOffset() const
     {
-        return pimpl->components;
+        return pimpl->components * pimpl->region_step;
     }
 
     const void * PngDecoder::currentScanlineOfBand( unsigned int band ) const
     {
+        const unsigned int start = pimpl->region_ul.x * pimpl->components + band;
         switch (pimpl->bit_depth) {
         case 8:
             {
-                return pimpl->row_data.begin() + band;
+                return pimpl->row_data.begin() + start;
             }
         case 16:
             {
-                return pimpl->row_data.begin() + 2*band;
+                return pimpl->row_data.begin() + 2*start;
             }
         default:
             vigra_fail( "internal error: illegal bit depth." );
@@ -483,6 +503,17 @@ namespace vigra {
         pimpl->nextScanline();
     }
 
+    bool PngDecoder::setRegion( const Diff2D & ul, const Size2D & size, unsigned int step )
+    {
+        // interlaced images deliver all passes of a row at once
+        if (pimpl->n_interlace_passes > 1 || pimpl->scanline >= 0)
+            return false;
+        pimpl->region_ul = ul;
+        pimpl->region_size = size;
+        pimpl->region_step = step;
+        return true;
+    }
+
     void PngDecoder::close() {}
 
     void PngDecoder::abort() {}
@@ -499,6 +530,9 @@ namespace vigra {
         png_structp png;
         png_infop info;
 
+        // text of the last fatal libpng error
+        std::string error_message;
+
         // image header fields
         png_uint_32 width, height, components;
         png_uint_32 extra_components;
@@ -538,27 +572,26 @@ namespace vigra {
           scanline(0), finalized(false),
           x_resolution(0), y_resolution(0)
     {
-        png_error_message = "";
         // create png struct with user defined handlers
-        png = png_create_write_struct( PNG_LIBPNG_VER_STRING, NULL,
+        png = png_create_write_struct( PNG_LIBPNG_VER_STRING, &error_message,
                                        &PngError, &PngWarning );
         vigra_postcondition( png != 0, "could not create the write struct." );
 
         // create info struct
         if (setjmp(png_jmpbuf(png))) {
             png_destroy_write_struct( &png, &info );
-            vigra_postcondition( false, png_error_message.insert(0, "error in png_info_struct(): ").c_str() );
+            vigra_postcondition( false, error_message.insert(0, "error in png_info_struct(): ").c_str() );
         }
         info = png_create_info_struct(png);
         if ( !info ) {
             png_destroy_write_struct( &png, &info );
-            vigra_postcondition( false, png_error_message.insert(0, "could not create the info struct.: ").c_str() );
+            vigra_postcondition( false, error_message.insert(0, "could not create the info struct.: ").c_str() );
         }
 
         // init png i/o
         if (setjmp(png_jmpbuf(png))) {
             png_destroy_write_struct( &png, &info );
-            vigra_postcondition( false, png_error_message.insert(0, "error in png_init_io(): ").c_str() );
+            vigra_postcondition( false, error_message.insert(0, "error in png_init_io(): ").c_str() );
         }
         png_init_io( png, file.get() );
     }
@@ -572,7 +605,7 @@ namespace vigra {
     {
         // write the IHDR
         if (setjmp(png_jmpbuf(png)))
-            vigra_postcondition( false, png_error_message.insert(0, "error in png_set_IHDR(): ").c_str() );
+            vigra_postcondition( false, error_message.insert(0, "error in png_set_IHDR(): ").c_str() );
         png_set_IHDR( png, info, width, height, bit_depth, color_type,
                       PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
                       PNG_FILTER_TYPE_DEFAULT );
@@ -580,7 +613,7 @@ namespace vigra {
         // set resolution
         if (x_resolution > 0 && y_resolution > 0) {
             if (setjmp(png_jmpbuf(png)))
-                vigra_postcondition( false, png_error_message.insert(0, "error in png_set_pHYs(): ").c_str() );
+                vigra_postcondition( false, error_message.insert(0, "error in png_set_pHYs(): ").c_str() );
             png_set_pHYs(png, info, (png_uint_32) (x_resolution / 0.0254 + 0.5),
                          (png_uint_32) (y_resolution / 0.0254 + 0.5),
                          PNG_RESOLUTION_METER);
@@ -589,7 +622,7 @@ namespace vigra {
         // set offset
         if (position.x != 0 || position.y != 0) {
             if (setjmp(png_jmpbuf(png)))
-                vigra_postcondition( false, png_error_message.insert(0, "error in png_set_oFFs(): ").c_str() );
+                vigra_postcondition( false, error_message.insert(0, "error in png_set_oFFs(): ").c_str() );
             png_set_oFFs(png, info, position.x, position.y, PNG_OFFSET_PIXEL);
         }
 
@@ -607,7 +640,7 @@ namespace vigra {
 
         // write the info struct
         if (setjmp(png_jmpbuf(png)))
-            vigra_postcondition( false, png_error_message.insert(0, "error in png_write_info(): ").c_str() );
+            vigra_postcondition( false, error_message.insert(0, "error in png_write_info(): ").c_str() );
         png_write_info( png, info );
 
         // prepare the bands
@@ -639,10 +672,10 @@ namespace vigra {
 
         // write the whole image
         if (setjmp(png_jmpbuf(png)))
-            vigra_postcondition( false, png_error_message.insert(0, "error in png_write_image(): ").c_str() );
+            vigra_postcondition( false, error_message.insert(0, "error in png_write_image(): ").c_str() );
         png_write_image( png, row_pointers.begin() );
         if (setjmp(png_jmpbuf(png)))
-            vigra_postcondition( false, png_error_message.insert(0, "error in png_write_end(): ").c_str() );
+            vigra_postcondition( false, error_message.insert(0, "error in png_write_end(): ").c_str() );
         png_write_end(png, info);
     }
 
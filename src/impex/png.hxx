@@ -91,6 +91,8 @@ namespace vigra {
 
         const void * currentScanlineOfBand( unsigned int ) const;
         void nextScanline();
+
+        bool setRegion( const Diff2D &, const Size2D &, unsigned int );
     };
 
     class PngEncoder : public Encoder
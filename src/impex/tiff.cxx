@@ -64,6 +64,8 @@
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <algorithm>
+#include <cstring>
 
 extern "C"
 {
@@ -241,14 +243,25 @@ namespace vigra {
     {
         friend class TIFFDecoder;
 
-        unsigned int scanline;
+        // tiled images are decoded one row of tiles at a time
+        bool tiled;
+        uint32_t tile_width;
+        tdata_t tilebuffer;
+
+        // region of interest (the whole image by default), the next
+        // row to deliver, and the first image row in the strip buffer
+        uint32_t region_x, region_y, region_width, region_height, region_step;
+        uint32_t next_row, buffer_row;
 
         std::string get_pixeltype_by_sampleformat() const;
         std::string get_pixeltype_by_datatype() const;
 
+        void readTileRow();
+
     public:
 
         TIFFDecoderImpl( const std::string & filename );
+        ~TIFFDecoderImpl();
 
         void init( unsigned int imageIndex );
 
@@ -271,7 +284,15 @@ namespace vigra {
             vigra_precondition(0, msg.c_str());
         }
 
-        scanline = 0;
+        tiled = false;
+        tile_width = 0;
+        tilebuffer = 0;
+    }
+
+    TIFFDecoderImpl::~TIFFDecoderImpl()
+    {
+        if ( tilebuffer != 0 )
+            _TIFFfree(tilebuffer);
     }
 
     std::string TIFFDecoderImpl::get_pixeltype_by_sampleformat() const
@@ -361,15 +382,14 @@ namespace vigra {
         TIFFGetField( tiff, TIFFTAG_IMAGELENGTH, &height );
 
         // check for tiled TIFFs
-        uint32_t tileWidth, tileHeight;
-        if( TIFFGetField( tiff, TIFFTAG_TILEWIDTH, &tileWidth ) &&
-            TIFFGetField( tiff, TIFFTAG_TILELENGTH, &tileHeight ) )
-            vigra_precondition( (tileWidth == width) && (tileHeight == height),
-                                "TIFFDecoder: "
-                                "Cannot read tiled TIFFs (not implemented)." );
-
-        // find out strip heights
-        stripheight = 1; // now using scanline interface instead of strip interface
+        uint32_t tile_height = 0;
+        tiled = TIFFIsTiled( tiff ) != 0;
+        if ( tiled ) {
+            if ( !TIFFGetField( tiff, TIFFTAG_TILEWIDTH, &tile_width ) ||
+                 !TIFFGetField( tiff, TIFFTAG_TILELENGTH, &tile_height ) ||
+                 tile_width == 0 || tile_height == 0 )
+                vigra_fail( "TIFFDecoder: Invalid tile size." );
+        }
 
         // get samples_per_pixel
         samples_per_pixel = 0;
@@ -596,8 +616,37 @@ namespace vigra {
             iccProfile.swap(iccData);
         }
 
+        // find out strip heights: tiled images are decoded one row of tiles
+        // at a time, stripped images one strip at a time. The scanline
+        // interface is only used for bilevel and subsampled images and when
+        // the strips are so large that decoding them at once hogs memory.
+        const tsize_t maxStripSize = 1 << 24;
+        tsize_t scanlinesize = TIFFScanlineSize(tiff);
+        if ( tiled ) {
+            vigra_precondition( bits_per_sample % 8 == 0,
+                                "TIFFDecoder: "
+                                "Cannot read tiled bilevel TIFFs (not implemented)." );
+            scanlinesize = (tsize_t)width * (bits_per_sample / 8) *
+                ( planarconfig == PLANARCONFIG_SEPARATE ? 1 : samples_per_pixel );
+            stripheight = tile_height;
+
+            if ( tilebuffer != 0 )
+                _TIFFfree(tilebuffer);
+            tilebuffer = _TIFFmalloc(TIFFTileSize(tiff));
+            if(tilebuffer == 0)
+                throw std::bad_alloc();
+        } else {
+            uint32_t rowsperstrip = height;
+            TIFFGetFieldDefaulted( tiff, TIFFTAG_ROWSPERSTRIP, &rowsperstrip );
+            stripheight = std::min(rowsperstrip, height);
+            if ( stripheight == 0 || bits_per_sample % 8 != 0 ||
+                 photometric == PHOTOMETRIC_YCBCR ||
+                 TIFFStripSize(tiff) > maxStripSize )
+                stripheight = 1;
+        }
+
         // allocate data buffers
-        const unsigned int stripsize = TIFFScanlineSize(tiff);
+        const unsigned int stripsize = scanlinesize * stripheight;
         if ( planarconfig == PLANARCONFIG_SEPARATE ) {
             stripbuffer = new tdata_t[samples_per_pixel];
             for( unsigned int i = 0; i < samples_per_pixel; ++i ) {
@@ -616,8 +665,14 @@ namespace vigra {
                 throw std::bad_alloc();
         }
 
-        // let the codec read a new strip
-        stripindex = stripheight;
+        // decode the whole image, nothing is buffered yet
+        region_x = region_y = 0;
+        region_width = width;
+        region_height = height;
+        region_step = 1;
+        next_row = 0;
+        buffer_row = height;
+        stripindex = 0;
     }
 
     const void *
@@ -654,43 +709,87 @@ namespace vigra {
             if ( planarconfig == PLANARCONFIG_SEPARATE ) {
                 UInt8 * const buf
                     = static_cast< UInt8 * >(stripbuffer[band]);
-                return buf + ( stripindex * width ) * ( bits_per_sample / 8 );
+                return buf + ( stripindex * width + region_x ) * ( bits_per_sample / 8 );
             } else {
                 UInt8 * const buf
                     = static_cast< UInt8 * >(stripbuffer[0]);
-                return buf + ( band + stripindex * width * samples_per_pixel )
+                return buf + ( band + ( stripindex * width + region_x ) * samples_per_pixel )
                     * ( bits_per_sample / 8 );
             }
         }
     }
 
+    void TIFFDecoderImpl::readTileRow()
+    {
+        const unsigned int planes =
+            planarconfig == PLANARCONFIG_SEPARATE ? samples_per_pixel : 1;
+        const tsize_t pixelsize = (bits_per_sample / 8) *
+            ( planarconfig == PLANARCONFIG_SEPARATE ? 1 : samples_per_pixel );
+        const tsize_t tilerowsize = tile_width * pixelsize;
+        const tsize_t rowsize = width * pixelsize;
+        const uint32_t rows = std::min(stripheight, height - buffer_row);
+        const uint32_t xbegin = region_x - region_x % tile_width,
+                       xend = region_x + region_width;
+
+        // decode the tiles of the current row that intersect the region
+        // and copy them side by side
+        for( unsigned int i = 0; i < planes; ++i ) {
+            UInt8 * const buf = static_cast< UInt8 * >(stripbuffer[i]);
+            const UInt8 * const tile = static_cast< const UInt8 * >(tilebuffer);
+            for( uint32_t x = xbegin; x < xend; x += tile_width ) {
+                if ( TIFFReadTile( tiff, tilebuffer, x, buffer_row, 0, (tsample_t)i ) < 0 )
+                    vigra_fail( "TIFFDecoder: Unable to read tile." );
+                const tsize_t n = std::min(tile_width, width - x) * pixelsize;
+                for( uint32_t y = 0; y < rows; ++y )
+                    std::memcpy( buf + y * rowsize + x * pixelsize,
+                                 tile + y * tilerowsize, n );
+            }
+        }
+    }
+
     void TIFFDecoderImpl::nextScanline()
     {
-        // eventually read a new strip
-        if ( ++stripindex >= stripheight ) {
-            stripindex = 0;
+        // advance to the next row of the region
+        const uint32_t row = next_row;
+        next_row += region_step;
+        if ( buffer_row <= row && row < buffer_row + stripheight ) {
+            stripindex = row - buffer_row;
+            return;
+        }
 
-            if ( planarconfig == PLANARCONFIG_SEPARATE ) {
-                const tsize_t size = TIFFScanlineSize(tiff);
-                for( unsigned int i = 0; i < samples_per_pixel; ++i )
-                    TIFFReadScanline(tiff, stripbuffer[i], scanline++, size);
-            } else {
-                TIFFReadScanline( tiff, stripbuffer[0], scanline++, 0);
-            }
+        // eventually read a new strip
+        buffer_row = row - row % stripheight;
+        stripindex = row - buffer_row;
+
+        if ( tiled ) {
+            readTileRow();
+        } else if ( stripheight > 1 ) {
+            const unsigned int planes =
+                planarconfig == PLANARCONFIG_SEPARATE ? samples_per_pixel : 1;
+            for( unsigned int i = 0; i < planes; ++i )
+                if ( TIFFReadEncodedStrip( tiff,
+                         TIFFComputeStrip( tiff, buffer_row, (tsample_t)i ),
+                         stripbuffer[i], (tsize_t)-1 ) < 0 )
+                    vigra_fail( "TIFFDecoder: Unable to read strip." );
+        } else if ( planarconfig == PLANARCONFIG_SEPARATE ) {
+            for( unsigned int i = 0; i < samples_per_pixel; ++i )
+                TIFFReadScanline(tiff, stripbuffer[i], row, (tsample_t)i);
+        } else {
+            TIFFReadScanline( tiff, stripbuffer[0], row, 0);
+        }
 
-            // XXX handle bilevel images
+        // XXX handle bilevel images
 
-            // invert grayscale images that interpret 0 as white
-            if ( photometric == PHOTOMETRIC_MINISWHITE &&
-                 samples_per_pixel == 1 && pixeltype == "UINT8" ) {
+        // invert grayscale images that interpret 0 as white
+        if ( photometric == PHOTOMETRIC_MINISWHITE &&
+             samples_per_pixel == 1 && pixeltype == "UINT8" ) {
 
-                UInt8 * buf = static_cast< UInt8 * >(stripbuffer[0]);
-                const unsigned int n = TIFFScanlineSize(tiff);
+            UInt8 * buf = static_cast< UInt8 * >(stripbuffer[0]);
+            const unsigned int n = width * stripheight;
 
-                // invert every pixel
-                for ( unsigned int i = 0; i < n; ++i, ++buf )
-                    *buf = 0xff - *buf;
-            }
+            // invert every pixel
+            for ( unsigned int i = 0; i < n; ++i, ++buf )
+                *buf = 0xff - *buf;
         }
     }
 
@@ -713,12 +812,12 @@ namespace vigra {
 
     unsigned int TIFFDecoder::getWidth() const
     {
-        return pimpl->width;
+        return ( pimpl->region_width + pimpl->region_step - 1 ) / pimpl->region_step;
     }
 
     unsigned int TIFFDecoder::getHeight() const
     {
-        return pimpl->height;
+        return ( pimpl->region_height + pimpl->region_step - 1 ) / pimpl->region_step;
     }
 
     unsigned int TIFFDecoder::getNumBands() const
@@ -748,7 +847,7 @@ namespace vigra {
 
     vigra::Diff2D TIFFDecoder::getPosition() const
     {
-        return pimpl->position;
+        return pimpl->position + Diff2D( pimpl->region_x, pimpl->region_y );
     }
 
     vigra::Size2D TIFFDecoder::getCanvasSize() const
@@ -773,8 +872,23 @@ namespace vigra {
 
     unsigned int TIFFDecoder::getOffset() const
     {
-        return pimpl->planarconfig == PLANARCONFIG_SEPARATE ?
-            1 : pimpl->samples_per_pixel;
+        return ( pimpl->planarconfig == PLANARCONFIG_SEPARATE ?
+                 1 : pimpl->samples_per_pixel ) * pimpl->region_step;
+    }
+
+    bool TIFFDecoder::setRegion( const Diff2D & ul, const Size2D & size, unsigned int step )
+    {
+        // only the strips (or tiles) intersecting the region are decoded,
+        // bilevel images are unpacked on the fly and don't support this
+        if ( pimpl->bits_per_sample % 8 != 0 || pimpl->buffer_row != pimpl->height )
+            return false;
+        pimpl->region_x = ul.x;
+        pimpl->region_y = ul.y;
+        pimpl->region_width = size.x;
+        pimpl->region_height = size.y;
+        pimpl->region_step = step;
+        pimpl->next_row = ul.y;
+        return true;
     }
 
     unsigned int
@@ -92,6 +92,8 @@ namespace vigra {
         const void * currentScanlineOfBand( unsigned int ) const;
         void nextScanline();
 
+        bool setRegion( const Diff2D &, const Size2D &, unsigned int );
+
         std::string getPixelType() const;
         unsigned int getOffset() const;
 
@@ -104,6 +104,42 @@ struct BlockwiseConvolutionTest
         );
 
     }
+
+    void testRecursive()
+    {
+        double sigma = 5.0;
+        BlockwiseConvolutionOptions<2>   opt;
+
+        opt.setStdDev(TinyVector<double, 2>(sigma, sigma));
+        opt.blockShape(TinyVector<int, 2>(40,50));
+        opt.useRecursiveFilter();
+        opt.numThreads(ParallelOptions::Nice);
+
+        typedef MultiArray<2, double> Array;
+        typedef Array::difference_type Shape;
+
+        Shape shape(200,200);
+        Array data(shape);
+        fillRandom(data.begin(), data.end(), 2000);
+
+        // blockwise
+        Array resB(shape);
+        gaussianSmoothMultiArray(data, resB, opt);
+
+        // sequential
+        Array res(shape);
+        gaussianSmoothMultiArray(data, res, sigma, ConvolutionOptions<2>().useRecursiveFilter());
+
+        // the recursion is truncated at the block borders, but the larger
+        // halo keeps the difference well below the approximation error
+        double maxDiff = 0.0, maxRes = 0.0;
+        for(int i = 0; i != res.size(); ++i)
+        {
+            maxDiff = std::max(maxDiff, std::abs(res[i] - resB[i]));
+            maxRes = std::max(maxRes, std::abs(res[i]));
+        }
+        should(maxDiff < 2e-4*maxRes);
+    }
 };
 
 struct BlockwiseConvolutionTestSuite
@@ -115,6 +151,7 @@ struct BlockwiseConvolutionTestSuite
         add(testCase(&BlockwiseConvolutionTest::simpleTest));
         add(testCase(&BlockwiseConvolutionTest::chunkedTest));
         add(testCase(&BlockwiseConvolutionTest::testParallel));
+        add(testCase(&BlockwiseConvolutionTest::testRecursive));
     }
 };
 
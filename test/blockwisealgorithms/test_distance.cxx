@@ -0,0 +1,189 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2026 by the VIGRA developers                 */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#define VIGRA_CHECK_BOUNDS
+
+#include <vigra/blockwise_distance.hxx>
+
+#include <vigra/multi_array.hxx>
+#include <vigra/multi_array_chunked.hxx>
+#include <vigra/multi_distance.hxx>
+#include <vigra/random.hxx>
+#include <vigra/unittest.hxx>
+
+#include <iostream>
+
+using namespace std;
+using namespace vigra;
+
+struct BlockwiseDistanceTest
+{
+    template <unsigned int N>
+    static MultiArray<N, UInt8> makeMask(typename MultiArrayShape<N>::type const & shape, double density)
+    {
+        MultiArray<N, UInt8> mask(shape);
+        RandomMT19937 random;
+        for(auto & m: mask)
+            m = random.uniform() < density ? 1 : 0;
+        return mask;
+    }
+
+    template <unsigned int N, class T, class Array>
+    void checkDistance(MultiArray<N, UInt8> const & mask,
+                       typename MultiArrayShape<N>::type const & chunk_shape,
+                       Array const & pixelPitch)
+    {
+        ParallelOptions options = ParallelOptions().numThreads(4);
+
+        ChunkedArrayLazy<N, UInt8> chunked_mask(mask.shape(), chunk_shape);
+        chunked_mask.commitSubarray(typename MultiArrayShape<N>::type(), mask);
+
+        for(int background = 0; background < 2; ++background)
+        {
+            MultiArray<N, T> desired(mask.shape()), result(mask.shape());
+            ChunkedArrayLazy<N, T> dist(mask.shape(), chunk_shape);
+
+            separableMultiDistSquared(mask, desired, background == 1, pixelPitch);
+            separableMultiDistSquaredBlockwise(chunked_mask, dist, background == 1, pixelPitch, options);
+            dist.checkoutSubarray(typename MultiArrayShape<N>::type(), result);
+            should(result == desired);
+
+            separableMultiDistance(mask, desired, background == 1, pixelPitch);
+            separableMultiDistanceBlockwise(chunked_mask, dist, background == 1, pixelPitch, options);
+            dist.checkoutSubarray(typename MultiArrayShape<N>::type(), result);
+            should(result == desired);
+        }
+    }
+
+    void distance2DTest()
+    {
+        MultiArray<2, UInt8> mask = makeMask<2>(Shape2(131, 97), 0.01);
+        TinyVector<double, 2> unit(1.0), pitch(1.5, 0.75);
+
+        for(int c : {1, 8, 32, 256})
+        {
+            checkDistance<2, UInt32>(mask, Shape2(c), unit);
+            checkDistance<2, float>(mask, Shape2(c), unit);
+            checkDistance<2, UInt32>(mask, Shape2(c), pitch);
+            checkDistance<2, double>(mask, Shape2(c), pitch);
+        }
+        checkDistance<2, float>(mask, Shape2(16, 4), pitch);
+    }
+
+    void distance3DTest()
+    {
+        MultiArray<3, UInt8> mask = makeMask<3>(Shape3(45, 38, 27), 0.002);
+        TinyVector<double, 3> unit(1.0), pitch(1.2, 1.0, 2.4);
+
+        for(int c : {4, 16, 64})
+        {
+            checkDistance<3, UInt16>(mask, Shape3(c), unit);
+            checkDistance<3, float>(mask, Shape3(c), unit);
+            checkDistance<3, UInt16>(mask, Shape3(c), pitch);
+            checkDistance<3, float>(mask, Shape3(c), pitch);
+        }
+        checkDistance<3, float>(mask, Shape3(8, 32, 4), pitch);
+    }
+
+    void defaultPitchTest()
+    {
+        MultiArray<3, UInt8> mask = makeMask<3>(Shape3(30, 20, 10), 0.01);
+        ChunkedArrayLazy<3, UInt8> chunked_mask(mask.shape(), Shape3(8));
+        chunked_mask.commitSubarray(Shape3(), mask);
+
+        MultiArray<3, float> desired(mask.shape()), result(mask.shape());
+        ChunkedArrayLazy<3, float> dist(mask.shape(), Shape3(8));
+
+        separableMultiDistance(mask, desired, true);
+        separableMultiDistanceBlockwise(chunked_mask, dist, true);
+        dist.checkoutSubarray(Shape3(), result);
+        should(result == desired);
+
+        separableMultiDistSquared(mask, desired, false);
+        separableMultiDistSquaredBlockwise(chunked_mask, dist, false, ParallelOptions().numThreads(4));
+        dist.checkoutSubarray(Shape3(), result);
+        should(result == desired);
+    }
+
+    void temporaryStorageTest()
+    {
+        MultiArray<3, UInt8> mask = makeMask<3>(Shape3(30, 20, 10), 0.01);
+        TinyVector<double, 3> pitch(0.5, 1.5, 2.0);
+        ChunkedArrayLazy<3, UInt8> chunked_mask(mask.shape(), Shape3(8));
+        chunked_mask.commitSubarray(Shape3(), mask);
+
+        MultiArray<3, UInt16> desired(mask.shape()), result(mask.shape());
+        ChunkedArrayLazy<3, UInt16> dist(mask.shape(), Shape3(8));
+        ChunkedArrayLazy<3, float> tmp(mask.shape(), Shape3(8));
+
+        separableMultiDistSquared(mask, desired, true, pitch);
+        separableMultiDistSquaredBlockwise(chunked_mask, dist, true, pitch, tmp,
+                                           ParallelOptions().numThreads(4));
+        dist.checkoutSubarray(Shape3(), result);
+        should(result == desired);
+
+        ChunkedArrayLazy<3, float> wrong(mask.shape(), Shape3(4));
+        try
+        {
+            separableMultiDistSquaredBlockwise(chunked_mask, dist, true, pitch, wrong);
+            failTest("no exception thrown");
+        }
+        catch(PreconditionViolation &)
+        {}
+    }
+};
+
+struct BlockwiseDistanceTestSuite
+  : public test_suite
+{
+    BlockwiseDistanceTestSuite()
+      : test_suite("blockwise distance transform test")
+    {
+        add(testCase(&BlockwiseDistanceTest::distance2DTest));
+        add(testCase(&BlockwiseDistanceTest::distance3DTest));
+        add(testCase(&BlockwiseDistanceTest::defaultPitchTest));
+        add(testCase(&BlockwiseDistanceTest::temporaryStorageTest));
+    }
+};
+
+int main(int argc, char** argv)
+{
+    BlockwiseDistanceTestSuite test;
+    int failed = test.run(testsToBeExecuted(argc, argv));
+
+    cout << test.report() << endl;
+
+    return failed != 0;
+}
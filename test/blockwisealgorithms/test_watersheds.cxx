@@ -44,6 +44,9 @@
 
 #include <iostream>
 #include <sstream>
+#include <algorithm>
+#include <random>
+#include <set>
 
 #include "utils.hxx"
 
@@ -202,6 +205,194 @@ struct BlockwiseWatershedTest
                                      correct_labels.begin(), correct_labels.end()),
                     true);
     }
+
+    template <unsigned int N, class T>
+    void fillUnique(MultiArray<N, T> & data, unsigned int seed)
+    {
+        // distinct values avoid ties, where serial and blockwise results may legally differ
+        for(int i = 0; i != data.size(); ++i)
+            data[i] = T(i);
+        std::shuffle(data.begin(), data.end(), std::mt19937(seed));
+    }
+
+    template <unsigned int N, class Label>
+    Label placeSeeds(MultiArray<N, Label> & seeds, int step)
+    {
+        Label label = 0;
+        MultiCoordinateIterator<N> i(seeds.shape()), end(i.getEndIterator());
+        for(; i != end; ++i)
+        {
+            if(i.scanOrderIndex() % step == 0)
+                seeds[*i] = ++label;
+        }
+        return label;
+    }
+
+    template <unsigned int N>
+    void checkSeeded(typename MultiArrayShape<N>::type shape, int seed_step)
+    {
+        typedef typename MultiArrayShape<N>::type Shape;
+        MultiArray<N, float> data(shape);
+        fillUnique(data, 42);
+        MultiArray<N, UInt32> seeds(shape);
+        UInt32 max_label = placeSeeds(seeds, seed_step);
+
+        vector<Shape> block_shapes;
+        block_shapes.push_back(Shape(3));
+        block_shapes.push_back(Shape(7));
+        Shape odd_block(5);
+        odd_block[0] = 16;
+        block_shapes.push_back(odd_block);
+        block_shapes.push_back(Shape(1000));
+
+        NeighborhoodType neighborhoods[] = { DirectNeighborhood, IndirectNeighborhood };
+        for(int n = 0; n < 2; ++n)
+        {
+            MultiArray<N, UInt32> correct_labels(seeds);
+            watershedsMultiArray(data, correct_labels, neighborhoods[n], WatershedOptions().regionGrowing());
+
+            for(std::size_t b = 0; b < block_shapes.size(); ++b)
+            {
+                for(int threads = 1; threads <= 4; threads += 3)
+                {
+                    MultiArray<N, UInt32> tested_labels(seeds);
+                    UInt32 label_number = seededWatershedsBlockwise(data, tested_labels,
+                                                  BlockwiseLabelOptions().neighborhood(neighborhoods[n])
+                                                                         .blockShape(block_shapes[b])
+                                                                         .numThreads(threads));
+                    shouldEqual(label_number, max_label);
+                    should(tested_labels == correct_labels);
+                }
+            }
+        }
+    }
+
+    void seededTest()
+    {
+        checkSeeded<2>(Shape2(97, 83), 97);
+        checkSeeded<3>(Shape3(23, 31, 17), 211);
+    }
+
+    void seededPlateauTest()
+    {
+        // with plateaus, only the tie breaking may differ from the serial algorithm,
+        // and the result must not depend on the block shape or number of threads
+        Shape3 shape(40, 30, 20);
+        MultiArray<3, int> data(shape);
+        fillRandom(data.begin(), data.end(), 3);
+        MultiArray<3, UInt32> seeds(shape);
+        placeSeeds(seeds, 97);
+
+        MultiArray<3, UInt32> reference(seeds);
+        seededWatershedsBlockwise(data, reference, BlockwiseLabelOptions().blockShape(shape));
+        should(reference.all());
+        for(int i = 0; i != seeds.size(); ++i)
+        {
+            if(seeds[i] != 0)
+                shouldEqual(reference[i], seeds[i]);
+        }
+
+        Shape3 block_shapes[] = { Shape3(4), Shape3(7, 5, 3), Shape3(16) };
+        for(int b = 0; b < 3; ++b)
+        {
+            MultiArray<3, UInt32> tested_labels(seeds);
+            seededWatershedsBlockwise(data, tested_labels,
+                                      BlockwiseLabelOptions().blockShape(block_shapes[b]).numThreads(4));
+            should(tested_labels == reference);
+        }
+
+        // compare with the serial algorithm: every point must carry a label of one of its
+        // neighbors with minimal flooding key (cost, dist), and the labels may only differ
+        // where several such neighbors carry different labels (genuine ties), or where
+        // a different label was propagated from such a tie
+        MultiArray<3, UInt32> serial(seeds);
+        watershedsMultiArray(data, serial, DirectNeighborhood, WatershedOptions().regionGrowing());
+
+        MultiArray<3, int>    cost(shape);
+        MultiArray<3, UInt32> dist(shape), keyed_labels(seeds);
+        blockwise_watersheds_detail::seededWatershedsBlockwiseImpl<3>(data, cost, dist, keyed_labels,
+                                                                      shape, BlockwiseLabelOptions());
+        should(keyed_labels == reference);
+
+        typedef GridGraph<3, undirected_tag> Graph;
+        Graph graph(shape, DirectNeighborhood);
+        int differences = 0, ties = 0;
+        for(Graph::NodeIt node(graph); node != lemon::INVALID; ++node)
+        {
+            if(dist[*node] == 0)
+            {
+                shouldEqual(serial[*node], seeds[*node]);
+                continue;
+            }
+
+            int min_cost = 0;
+            UInt32 min_dist = blockwise_watersheds_detail::unreachedWatershedNode;
+            for(Graph::OutArcIt arc(graph, *node); arc != lemon::INVALID; ++arc)
+            {
+                Shape3 target = graph.target(*arc);
+                if(blockwise_watersheds_detail::watershedKeyLess(cost[target], dist[target], min_cost, min_dist))
+                {
+                    min_cost = cost[target];
+                    min_dist = dist[target];
+                }
+            }
+
+            std::set<UInt32> serial_choices;
+            UInt32 smallest_choice = 0;
+            bool inherited = false;
+            for(Graph::OutArcIt arc(graph, *node); arc != lemon::INVALID; ++arc)
+            {
+                Shape3 target = graph.target(*arc);
+                if(cost[target] != min_cost || dist[target] != min_dist)
+                    continue;
+                serial_choices.insert(serial[target]);
+                if(smallest_choice == 0 || reference[target] < smallest_choice)
+                    smallest_choice = reference[target];
+                inherited = inherited || reference[target] != serial[target];
+            }
+            should(serial_choices.count(serial[*node]) == 1);
+            shouldEqual(reference[*node], smallest_choice);
+
+            if(serial_choices.size() > 1)
+                ++ties;
+            if(reference[*node] != serial[*node])
+            {
+                ++differences;
+                should(serial_choices.size() > 1 || inherited);
+            }
+        }
+        should(ties > 0);
+
+        // unreachable regions remain unlabeled
+        MultiArray<3, UInt32> no_seeds(shape);
+        seededWatershedsBlockwise(data, no_seeds, BlockwiseLabelOptions().blockShape(Shape3(8)));
+        should(!no_seeds.any());
+    }
+
+    void seededChunkedTest()
+    {
+        Shape3 shape(30, 20, 25), chunk_shape(8);
+        MultiArray<3, float> data(shape);
+        fillUnique(data, 17);
+        MultiArray<3, UInt32> seeds(shape);
+        UInt32 max_label = placeSeeds(seeds, 151);
+
+        MultiArray<3, UInt32> correct_labels(seeds);
+        watershedsMultiArray(data, correct_labels, IndirectNeighborhood, WatershedOptions().regionGrowing());
+
+        ChunkedArrayLazy<3, float> chunked_data(shape, chunk_shape);
+        chunked_data.commitSubarray(Shape3(0), data);
+        ChunkedArrayLazy<3, UInt32> chunked_labels(shape, chunk_shape);
+        chunked_labels.commitSubarray(Shape3(0), seeds);
+
+        UInt32 label_number = seededWatershedsBlockwise(chunked_data, chunked_labels,
+                                     BlockwiseLabelOptions().neighborhood(IndirectNeighborhood).numThreads(4));
+        shouldEqual(label_number, max_label);
+
+        MultiArray<3, UInt32> tested_labels(shape);
+        chunked_labels.checkoutSubarray(Shape3(0), tested_labels);
+        should(tested_labels == correct_labels);
+    }
 };
 
 struct BlockwiseWatershedTestSuite
@@ -213,6 +404,9 @@ struct BlockwiseWatershedTestSuite
         add(testCase(&BlockwiseWatershedTest::fourDimensionalRandomTest));
         add(testCase(&BlockwiseWatershedTest::oneDimensionalTest));
         add(testCase(&BlockwiseWatershedTest::chunkedTest));
+        add(testCase(&BlockwiseWatershedTest::seededTest));
+        add(testCase(&BlockwiseWatershedTest::seededPlateauTest));
+        add(testCase(&BlockwiseWatershedTest::seededChunkedTest));
     }
 };
 
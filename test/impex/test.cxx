@@ -299,6 +299,63 @@ public:
 #endif
     }
 
+    void testTIFFTiles()
+    {
+#if defined(HasTIFF)
+        View view(Shape2(img.width(), img.height()), img.data());
+
+        // the encoder only writes strips, so create a tiled file by hand
+        const int tw = 32, th = 16;
+        TiffImage * tiff = TIFFOpen("res_tiled.tif", "w");
+        TIFFSetField(tiff, TIFFTAG_IMAGEWIDTH, (uint32_t)view.shape(0));
+        TIFFSetField(tiff, TIFFTAG_IMAGELENGTH, (uint32_t)view.shape(1));
+        TIFFSetField(tiff, TIFFTAG_BITSPERSAMPLE, 8);
+        TIFFSetField(tiff, TIFFTAG_SAMPLESPERPIXEL, 1);
+        TIFFSetField(tiff, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
+        TIFFSetField(tiff, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+        TIFFSetField(tiff, TIFFTAG_COMPRESSION, COMPRESSION_LZW);
+        TIFFSetField(tiff, TIFFTAG_TILEWIDTH, tw);
+        TIFFSetField(tiff, TIFFTAG_TILELENGTH, th);
+        MultiArray<2, unsigned char> tile(Shape2(tw, th));
+        for (int y = 0; y < view.shape(1); y += th)
+        {
+            for (int x = 0; x < view.shape(0); x += tw)
+            {
+                Shape2 start(x, y), stop = min(start + tile.shape(), view.shape());
+                tile.init(0);
+                tile.subarray(Shape2(), stop - start) = view.subarray(start, stop);
+                TIFFWriteTile(tiff, tile.data(), x, y, 0, 0);
+            }
+        }
+        TIFFClose(tiff);
+
+        // scanline interface of the decoder
+        MultiArray<2, unsigned char> res;
+        importImage("res_tiled.tif", res);
+        should(res == view);
+
+        // direct strip/tile decoding, with and without region of interest
+        Shape2 roi_start(5, 9), roi_stop(view.shape(0) - 3, 70);
+        MultiArray<2, unsigned char> all(view.shape()), roi(roi_stop - roi_start);
+        tiff = TIFFOpen("res_tiled.tif", "r");
+        importTiffImage(tiff, all, Shape2(), ParallelOptions().numThreads(4));
+        should(all == view);
+        importTiffImage(tiff, roi, roi_start, ParallelOptions().numThreads(4));
+        should(roi == view.subarray(roi_start, roi_stop));
+        TIFFClose(tiff);
+
+        exportImage(view, ImageExportInfo("res_strips.tif"));
+        all.init(0);
+        roi.init(0);
+        tiff = TIFFOpen("res_strips.tif", "r");
+        importTiffImage(tiff, all, Shape2(), ParallelOptions().numThreads(4));
+        should(all == view);
+        importTiffImage(tiff, roi, roi_start, ParallelOptions().numThreads(0));
+        should(roi == view.subarray(roi_start, roi_stop));
+        TIFFClose(tiff);
+#endif
+    }
+
     void testBMP ()
     {
         testFile ("res.bmp");
@@ -590,6 +647,76 @@ public:
 #endif
     }
 
+    void testRegionOfInterest ()
+    {
+        typedef MultiArray<2, RGBValue<UInt8> > Array;
+
+        // neither the position nor the size is a multiple of 8
+        Rect2D roi(Point2D(18, 28), Size2D(45, 37));
+        Shape2 start(roi.left(), roi.top()), stop(roi.right(), roi.bottom());
+
+        std::vector<std::string> files;
+        files.push_back("resroi.xv"); // no native support
+#if defined(HasPNG)
+        files.push_back("resroi.png");
+#endif
+#if defined(HasTIFF)
+        files.push_back("resroi.tif");
+#endif
+#if defined(HasJPEG)
+        files.push_back("resroi.jpg");
+#endif
+        for (unsigned int k = 0; k < files.size(); ++k)
+        {
+            exportImage (srcImageRange (img), vigra::ImageExportInfo (files[k].c_str()));
+            vigra::ImageImportInfo info (files[k].c_str());
+            Array full(info.shape());
+            importImage(info, full);
+
+            for (unsigned int step = 1; step < 4; step += 2)
+            {
+                Array res(Shape2((roi.width() + step - 1) / step, (roi.height() + step - 1) / step));
+                importImage(info, res, roi, step);
+                should(res == full.subarray(start, stop).stridearray(Shape2(step, step)));
+            }
+        }
+
+#if defined(HasJPEG)
+        {
+            // JPEG averages 2x2 blocks in the DCT domain
+            vigra::ImageImportInfo info ("resroi.jpg");
+            Array full(info.shape()),
+                  res(Shape2((roi.width() + 1) / 2, (roi.height() + 1) / 2));
+            importImage(info, full);
+            importImage(info, res, roi, 2);
+
+            double diff = 0.0;
+            for (int y = 0; y < res.shape(1) - 1; ++y)
+                for (int x = 0; x < res.shape(0) - 1; ++x)
+                {
+                    Shape2 p = start + Shape2(2*x, 2*y);
+                    RGBValue<double> mean = (RGBValue<double>(full[p]) + full[p + Shape2(1,0)] +
+                                             full[p + Shape2(0,1)] + full[p + Shape2(1,1)]) / 4.0;
+                    diff += norm(mean - RGBValue<double>(res(x, y)));
+                }
+            should(diff / ((res.shape(0) - 1) * (res.shape(1) - 1)) < 4.0);
+        }
+#endif
+
+        try
+        {
+            Array res(Shape2(10, 10));
+            importImage(vigra::ImageImportInfo ("resroi.xv"), res,
+                        Rect2D(Point2D(img.width() - 5, 0), Size2D(10, 10)));
+            failTest("importImage() failed to throw exception.");
+        }
+        catch(vigra::PreconditionViolation & e)
+        {
+            std::string expected("\nPrecondition violation!\nimportImage(): region of interest is outside the image.");
+            should(std::string(e.what()).substr(0, expected.size()) == expected);
+        }
+    }
+
     void testSUN ()
     {
         testFile ("res.ras");
@@ -727,6 +854,225 @@ class PositionTest
     }
 };
 
+class TIFFLayoutTest
+{
+  public:
+#if defined(HasTIFF)
+    // write one page of 'data' (x, y, band) with the given layout, bypassing
+    // the TIFF encoder (which only writes contiguous strips)
+    template <class T>
+    static void writePage(TiffImage * tiff, MultiArrayView<3, T, StridedArrayTag> const & data,
+                          bool tiled, uint16_t planar, uint16_t compression, uint32_t blockHeight)
+    {
+        const uint32_t w = (uint32_t)data.shape(0), h = (uint32_t)data.shape(1);
+        const uint16_t bands = (uint16_t)data.shape(2);
+        const uint32_t blockWidth = tiled ? 32 : w;
+        const uint16_t format = !NumericTraits<T>::isIntegral::value
+                                    ? SAMPLEFORMAT_IEEEFP
+                                    : NumericTraits<T>::isSigned::value
+                                         ? SAMPLEFORMAT_INT
+                                         : SAMPLEFORMAT_UINT;
+
+        TIFFSetField(tiff, TIFFTAG_IMAGEWIDTH, w);
+        TIFFSetField(tiff, TIFFTAG_IMAGELENGTH, h);
+        TIFFSetField(tiff, TIFFTAG_BITSPERSAMPLE, (uint16_t)(8 * sizeof(T)));
+        TIFFSetField(tiff, TIFFTAG_SAMPLESPERPIXEL, bands);
+        TIFFSetField(tiff, TIFFTAG_SAMPLEFORMAT, format);
+        TIFFSetField(tiff, TIFFTAG_PHOTOMETRIC, bands == 1 ? PHOTOMETRIC_MINISBLACK : PHOTOMETRIC_RGB);
+        TIFFSetField(tiff, TIFFTAG_PLANARCONFIG, planar);
+        TIFFSetField(tiff, TIFFTAG_COMPRESSION, compression);
+        if (tiled)
+        {
+            TIFFSetField(tiff, TIFFTAG_TILEWIDTH, blockWidth);
+            TIFFSetField(tiff, TIFFTAG_TILELENGTH, blockHeight);
+        }
+        else
+        {
+            TIFFSetField(tiff, TIFFTAG_ROWSPERSTRIP, blockHeight);
+        }
+
+        const unsigned int planes = planar == PLANARCONFIG_SEPARATE ? bands : 1,
+                           spp = planar == PLANARCONFIG_SEPARATE ? 1 : bands;
+        std::vector<T> block(blockWidth * blockHeight * spp);
+        for (unsigned int p = 0; p < planes; ++p)
+        {
+            for (uint32_t y0 = 0; y0 < h; y0 += blockHeight)
+            {
+                for (uint32_t x0 = 0; x0 < w; x0 += blockWidth)
+                {
+                    // tiles are padded, the last strip is truncated
+                    const uint32_t rows = tiled ? blockHeight : std::min(blockHeight, h - y0);
+                    std::fill(block.begin(), block.end(), T());
+                    for (uint32_t y = y0; y < std::min(y0 + blockHeight, h); ++y)
+                        for (uint32_t x = x0; x < std::min(x0 + blockWidth, w); ++x)
+                            for (unsigned int b = 0; b < spp; ++b)
+                                block[((y - y0) * blockWidth + x - x0) * spp + b] = data(x, y, p + b);
+                    tsize_t size = rows * blockWidth * spp * sizeof(T);
+                    if (tiled)
+                        should(TIFFWriteEncodedTile(tiff, TIFFComputeTile(tiff, x0, y0, 0, (tsample_t)p),
+                                                    &block[0], size) == size);
+                    else
+                        should(TIFFWriteEncodedStrip(tiff, TIFFComputeStrip(tiff, y0, (tsample_t)p),
+                                                     &block[0], size) == size);
+                }
+            }
+        }
+        should(TIFFWriteDirectory(tiff) != 0);
+    }
+
+    // a 3D view (x, y, band) to the pixels of scalar and vector images
+    template <class T>
+    static MultiArrayView<3, T, StridedArrayTag> bands(MultiArrayView<2, T> a)
+    {
+        return a.insertSingletonDimension(2);
+    }
+
+    template <class T, int N>
+    static MultiArrayView<3, T, StridedArrayTag> bands(MultiArrayView<2, TinyVector<T, N> > a)
+    {
+        return a.expandElements(2);
+    }
+
+    template <class Pixel>
+    static void fill(MultiArray<2, Pixel> & image, unsigned int seed)
+    {
+        typedef typename detail::TiffPixelBands<Pixel>::value_type T;
+        MultiArrayView<3, T, StridedArrayTag> b = bands(MultiArrayView<2, Pixel>(image));
+        for (MultiArrayIndex k = 0; k < b.size(); ++k)
+        {
+            // use all bytes of the samples
+            UInt32 v = (UInt32)(k + seed) * 2654435761u;
+            b[b.scanOrderIndexToCoordinate(k)] = NumericTraits<T>::isIntegral::value
+                                                     ? static_cast<T>(v)
+                                                     : static_cast<T>(v % 100000) / 8;
+        }
+    }
+
+    // read 'name' (page 'page' of it) through all TIFF code paths and compare with 'expected'
+    template <class Pixel>
+    static void checkFile(const char * name, unsigned int page, MultiArray<2, Pixel> const & expected)
+    {
+        typedef MultiArray<2, Pixel> Array;
+
+        ImageImportInfo info(name, page);
+        shouldEqual(info.shape(), expected.shape());
+        shouldEqual(info.numBands(), (int)detail::TiffPixelBands<Pixel>::size);
+        shouldEqual(std::string(info.getPixelType()),
+                    std::string(TypeAsString<typename detail::TiffPixelBands<Pixel>::value_type>::result()));
+
+        // decoder, entire image
+        Array full(info.shape());
+        importImage(info, full);
+        should(full == expected);
+
+        // decoder, regions of interest crossing strip and tile boundaries
+        // and ending in the partial tiles (or last strip) at the image border
+        Rect2D rois[] = { Rect2D(Point2D(21, 11), Size2D(60, 50)),
+                          Rect2D(Point2D(70, 60), Size2D(27, 15)) };
+        for (int k = 0; k < 2; ++k)
+        {
+            Shape2 start(rois[k].left(), rois[k].top()), stop(rois[k].right(), rois[k].bottom());
+            for (unsigned int step = 1; step < 4; step += 2)
+            {
+                Array res(Shape2((rois[k].width() + step - 1) / step, (rois[k].height() + step - 1) / step));
+                importImage(info, res, rois[k], step);
+                should(res == full.subarray(start, stop).stridearray(Shape2(step, step)));
+            }
+        }
+
+        // direct strip/tile decoding, sequential and parallel, with a
+        // region of interest crossing strip and tile boundaries
+        Shape2 start(21, 11), stop(81, 61);
+        TiffImage * tiff = TIFFOpen(name, "r");
+        should(TIFFSetDirectory(tiff, page) != 0);
+        for (int threads = 0; threads <= 4; threads += 4)
+        {
+            Array all(info.shape()), part(stop - start);
+            importTiffImage(tiff, all, Shape2(), ParallelOptions().numThreads(threads));
+            should(all == expected);
+            importTiffImage(tiff, part, start, ParallelOptions().numThreads(threads));
+            should(part == expected.subarray(start, stop));
+        }
+        TIFFClose(tiff);
+    }
+
+    template <class Pixel>
+    static void testLayouts()
+    {
+        // not a multiple of the strip height or the tile size
+        MultiArray<2, Pixel> expected(Shape2(97, 75));
+        fill(expected, 0);
+
+        uint16_t planars[] = { PLANARCONFIG_CONTIG, PLANARCONFIG_SEPARATE };
+        uint16_t compressions[] = { COMPRESSION_NONE, COMPRESSION_LZW };
+        for (int tiled = 0; tiled < 2; ++tiled)
+        for (int p = 0; p < (detail::TiffPixelBands<Pixel>::size > 1 ? 2 : 1); ++p)
+        for (int c = 0; c < 2; ++c)
+        {
+            // strips of a single row are decoded with the scanline interface
+            uint32_t heights[] = { 16, 1, 7, 75 };
+            for (int k = tiled ? 0 : 1; k < (tiled ? 1 : 4); ++k)
+            {
+                TiffImage * tiff = TIFFOpen("res_layout.tif", "w");
+                writePage(tiff, bands(MultiArrayView<2, Pixel>(expected)), tiled != 0,
+                          planars[p], compressions[c], heights[k]);
+                TIFFClose(tiff);
+                checkFile("res_layout.tif", 0, expected);
+            }
+        }
+    }
+#endif
+
+    void testUInt8()
+    {
+#if defined(HasTIFF)
+        testLayouts<UInt8>();
+        testLayouts<TinyVector<UInt8, 3> >();
+#endif
+    }
+
+    void testUInt16()
+    {
+#if defined(HasTIFF)
+        testLayouts<UInt16>();
+        testLayouts<TinyVector<UInt16, 3> >();
+#endif
+    }
+
+    void test32Bit()
+    {
+#if defined(HasTIFF)
+        testLayouts<UInt32>();
+        testLayouts<Int32>();
+        testLayouts<float>();
+        testLayouts<TinyVector<float, 3> >();
+#endif
+    }
+
+    void testMultipage()
+    {
+#if defined(HasTIFF)
+        // every page has a different layout
+        typedef MultiArray<2, TinyVector<UInt16, 3> > Array;
+        Array pages[3] = { Array(Shape2(97, 75)), Array(Shape2(97, 75)), Array(Shape2(97, 75)) };
+        TiffImage * tiff = TIFFOpen("res_multipage.tif", "w");
+        for (int k = 0; k < 3; ++k)
+        {
+            fill(pages[k], 1000 * k);
+            writePage(tiff, bands(MultiArrayView<2, TinyVector<UInt16, 3> >(pages[k])), k == 1,
+                      k == 2 ? PLANARCONFIG_SEPARATE : PLANARCONFIG_CONTIG,
+                      k == 0 ? COMPRESSION_NONE : COMPRESSION_LZW, 16);
+        }
+        TIFFClose(tiff);
+
+        ImageImportInfo info("res_multipage.tif");
+        shouldEqual(info.numImages(), 3);
+        for (int k = 2; k >= 0; --k)
+            checkFile("res_multipage.tif", k, pages[k]);
+#endif
+    }
+};
+
 class PNGInt16Test
 {
   public:
@@ -1824,6 +2170,7 @@ struct ImageImportExportTestSuite : public vigra::test_suite
         add(testCase(&ByteImageExportImportTest::testJPEG));
         add(testCase(&ByteImageExportImportTest::testTIFF));
         add(testCase(&ByteImageExportImportTest::testTIFFSequence));
+        add(testCase(&ByteImageExportImportTest::testTIFFTiles));
         add(testCase(&ByteImageExportImportTest::testBMP));
         add(testCase(&ByteImageExportImportTest::testPGM));
         add(testCase(&ByteImageExportImportTest::testPNM));
@@ -1843,6 +2190,7 @@ struct ImageImportExportTestSuite : public vigra::test_suite
         add(testCase(&ByteRGBImageExportImportTest::testPNM));
         add(testCase(&ByteRGBImageExportImportTest::testPNM2));
         add(testCase(&ByteRGBImageExportImportTest::testPNG));
+        add(testCase(&ByteRGBImageExportImportTest::testRegionOfInterest));
         add(testCase(&ByteRGBImageExportImportTest::testSUN));
         add(testCase(&ByteRGBImageExportImportTest::testVIFF1));
         add(testCase(&ByteRGBImageExportImportTest::testVIFF2));
@@ -1854,6 +2202,12 @@ struct ImageImportExportTestSuite : public vigra::test_suite
 
         add(testCase(&CanvasSizeTest::testTIFFCanvasSize));
 
+        // strip and tile layouts of TIFF files
+        add(testCase(&TIFFLayoutTest::testUInt8));
+        add(testCase(&TIFFLayoutTest::testUInt16));
+        add(testCase(&TIFFLayoutTest::test32Bit));
+        add(testCase(&TIFFLayoutTest::testMultipage));
+
         add(testCase(&PositionTest::testEXRPosition));
         add(testCase(&PositionTest::testTIFFPosition));
         add(testCase(&PositionTest::testPNGPosition));
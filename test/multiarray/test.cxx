@@ -1708,6 +1708,55 @@ struct MultiImpexTest
 #endif // _MSC_VER
     }
 
+    void testParallelImpex()
+    {
+#if defined(HasPNG)
+        const char * ext = ".png";
+#else
+        const char * ext = ".pnm";
+#endif
+        Array big(Shape(17,13,23));
+        linearSequence(big.begin(), big.end());
+
+        exportVolume(big, VolumeExportInfo("impex/parallel", ext),
+                     ParallelOptions().numThreads(4));
+
+        VolumeImportInfo info("impex/parallel", ext);
+        shouldEqual(info.shape(), big.shape());
+
+        Array result(info.shape());
+        importVolume(info, result, ParallelOptions().numThreads(4));
+        should(result == big);
+
+        // read into a strided view
+        MultiArray<3, unsigned char> transposed(Shape(big.shape(2), big.shape(1), big.shape(0)));
+        MultiArrayView<3, unsigned char, StridedArrayTag> view(transposed.transpose());
+        importVolume(info, view, ParallelOptions().numThreads(4));
+        should(view == big);
+
+#if defined(HasTIFF)
+        exportVolume(big, VolumeExportInfo("multipage_parallel.tif"));
+
+        VolumeImportInfo tiffInfo("multipage_parallel.tif");
+        shouldEqual(tiffInfo.shape(), big.shape());
+
+        result.init(0);
+        importVolume(tiffInfo, result, ParallelOptions().numThreads(4));
+        should(result == big);
+
+        MultiArray<3, UInt16> big16(big.shape());
+        linearSequence(big16.begin(), big16.end(), 0, 97);
+        exportVolume(big16, VolumeExportInfo("multipage_parallel16.tif"));
+
+        VolumeImportInfo tiffInfo16("multipage_parallel16.tif");
+        shouldEqual(std::string(tiffInfo16.getPixelType()), std::string("UINT16"));
+
+        MultiArray<3, UInt16> result16(tiffInfo16.shape());
+        importVolume(tiffInfo16, result16, ParallelOptions().numThreads(4));
+        should(result16 == big16);
+#endif
+    }
+
 #if defined(HasTIFF)
     void testMultipageTIFF()
     {
@@ -3077,6 +3126,7 @@ struct MultiArrayTestSuite
         add( testCase( &MultiArrayTest::test_expandElements ) );
 
         add( testCase( &MultiImpexTest::testImpex ) );
+        add( testCase( &MultiImpexTest::testParallelImpex ) );
 #if defined(HasTIFF)
         add( testCase( &MultiImpexTest::testMultipageTIFF ) );
 #endif
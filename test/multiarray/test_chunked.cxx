@@ -34,11 +34,14 @@
 /************************************************************************/
 
 #include <functional>
+#include <iomanip>
+#include <cmath>
 #include <stdio.h>
 
 #include "vigra/unittest.hxx"
 #include "vigra/multi_array.hxx"
 #include "vigra/multi_array_chunked.hxx"
+#include "vigra/multi_array_chunked_zarr.hxx"
 #ifdef HasHDF5
 #include "vigra/multi_array_chunked_hdf5.hxx"
 #endif
@@ -143,6 +146,24 @@ public:
                                                       ChunkedArrayOptions().fillValue(fill_value), ""));
     }
 
+    static ArrayPtr createArray(Shape3 const & shape,
+                                Shape3 const & chunk_shape,
+                                ChunkedArrayMmap<3, T> *,
+                                std::string const & name = "chunked_test.h5")
+    {
+        return ArrayPtr(new ChunkedArrayMmap<3, T>(name + ".vmm", shape, chunk_shape,
+                                                   ChunkedArrayOptions().fillValue(fill_value)));
+    }
+
+    static ArrayPtr createArray(Shape3 const & shape,
+                                Shape3 const & chunk_shape,
+                                ChunkedArrayZarr<3, T> *,
+                                std::string const & name = "chunked_test.h5")
+    {
+        return ArrayPtr(new ChunkedArrayZarr<3, T>(name + ".zarr", shape, chunk_shape,
+                                                   ChunkedArrayOptions().fillValue(fill_value)));
+    }
+
     void test_construction ()
     {
         bool isFullArray = IsSameType<Array, ChunkedArrayFull<3, T> >::value;
@@ -784,6 +805,105 @@ public:
         shouldEqualSequence(a->begin(), a->end(), ref.begin());
     }
 
+    static void testMultiThreadedReadRun(BaseArray * v, int startIndex, int d,
+                                         threading::atomic_long * errors)
+    {
+        Shape3 s = v->shape();
+        Iterator bi(v->begin());
+        for(bi.setDim(2,startIndex); bi.coord(2) < s[2]; bi.addDim(2, d))
+            for(bi.setDim(1,0); bi.coord(1) < s[1]; bi.incDim(1))
+                for(bi.setDim(0,0); bi.coord(0) < s[0]; bi.incDim(0))
+                    if(*bi != T(bi.scanOrderIndex()))
+                        ++*errors;
+    }
+
+    void testMultiThreadedSmallCache()
+    {
+        // all threads compete for very few cache slots
+        array.reset(0); // close the file if backend is HDF5
+        ArrayPtr a = createArray(Shape3(100, 101, 102), Shape3(16), (Array *)0);
+        a->setCacheMaxSize(3);
+
+        threading::atomic_long go, errors;
+        go.store(0);
+        errors.store(0);
+        {
+            threading::thread t1(std::bind(testMultiThreadedRun,a.get(),0,4,&go));
+            threading::thread t2(std::bind(testMultiThreadedRun,a.get(),1,4,&go));
+            threading::thread t3(std::bind(testMultiThreadedRun,a.get(),2,4,&go));
+            threading::thread t4(std::bind(testMultiThreadedRun,a.get(),3,4,&go));
+            go.store(1);
+            t4.join();
+            t3.join();
+            t2.join();
+            t1.join();
+        }
+        {
+            threading::thread t1(std::bind(testMultiThreadedReadRun,a.get(),0,4,&errors));
+            threading::thread t2(std::bind(testMultiThreadedReadRun,a.get(),1,4,&errors));
+            threading::thread t3(std::bind(testMultiThreadedReadRun,a.get(),2,4,&errors));
+            threading::thread t4(std::bind(testMultiThreadedReadRun,a.get(),3,4,&errors));
+            t4.join();
+            t3.join();
+            t2.join();
+            t1.join();
+        }
+        shouldEqual(errors.load(), 0);
+
+        // all chunks are inactive now, so that the cache can shrink to the limit
+        a->setCacheMaxSize(2);
+        should(a->cacheSize() <= 2);
+
+        PlainArray ref(a->shape());
+        linearSequence(ref.begin(), ref.end());
+        shouldEqualSequence(a->begin(), a->end(), ref.begin());
+    }
+
+    void testCacheReplacement()
+    {
+        // A chunk that is used frequently stays in the cache, whereas
+        // chunks used only once are evicted.
+        Shape3 hot(0), cs(array->chunkShape());
+        array->setCacheMaxSize(4);
+        MultiArray<3, T> pixel(Shape3(1));
+        MultiCoordinateIterator<3> c(array->chunkArrayShape()),
+                                   end = c.getEndIterator();
+        for(; c != end; ++c)
+        {
+            array->checkoutSubarray(hot, pixel);
+            shouldEqual(pixel[0], ref[hot]);
+            array->checkoutSubarray(*c*cs, pixel);
+            shouldEqual(pixel[0], ref[*c*cs]);
+        }
+        if(array->backend() != "ChunkedArrayFull")
+            should(array->lookupHandle(hot)->chunk_state_.load() >= 0);
+    }
+
+    void testPrefetch()
+    {
+        // send all chunks asleep, then load some of them in the background
+        Shape3 cs(array->chunkShape());
+        array->releaseChunks(Shape3(), shape);
+        array->prefetch(Shape3(), min(2*cs, shape));
+        array->waitForPrefetch();
+        if(array->backend() != "ChunkedArrayFull")
+        {
+            should(array->lookupHandle(Shape3(0,0,0))->chunk_state_.load() >= 0);
+            should(array->lookupHandle(Shape3(1,1,1))->chunk_state_.load() >= 0);
+        }
+        shouldEqualSequence(array->cbegin(), array->cend(), ref.begin());
+
+        // chunk iterator with lookahead
+        array->releaseChunks(Shape3(), shape);
+        typename Array::chunk_iterator i = array->chunk_begin(Shape3(), shape),
+                                       end = i.getEndIterator();
+        i.setPrefetchWindow(3);
+        for(; i != end; ++i)
+            should(*i == ref.subarray(i.chunkStart(), i.chunkStop()));
+        array->waitForPrefetch();
+        shouldEqualSequence(array->cbegin(), array->cend(), ref.begin());
+    }
+
     // void testIsUnstrided()
     // {
         // typedef difference3_type Shape;
@@ -1349,6 +1469,554 @@ public:
     // }
 // };
 
+struct ChunkedArrayMmapTest
+{
+    typedef ChunkedArrayMmap<3, float> Array;
+
+    Shape3 shape, chunk_shape;
+    MultiArray<3, float> ref;
+
+    ChunkedArrayMmapTest()
+    : shape(20,21,22),
+      chunk_shape(8),
+      ref(shape)
+    {
+        linearSequence(ref.begin(), ref.end());
+    }
+
+    void testReopen()
+    {
+        std::string name("chunked_test_reopen.vmm");
+        Shape3 start(8), stop(16);
+        {
+            Array a(name, shape, chunk_shape, ChunkedArrayOptions().fillValue(42));
+            a.commitSubarray(start, ref.subarray(start, stop));
+            should(!a.isReadOnly());
+        }
+
+        // only the chunk we wrote holds data, the others return the fill value
+        MultiArray<3, float> expected(shape, 42.0f);
+        expected.subarray(start, stop) = ref.subarray(start, stop);
+        {
+            Array a(name);
+            should(a.isReadOnly());
+            shouldEqual(a.shape(), shape);
+            shouldEqual(a.chunkShape(), chunk_shape);
+            shouldEqualSequence(a.cbegin(), a.cend(), expected.begin());
+
+            // a second reader maps the same file
+            Array b(name);
+            shouldEqualSequence(b.cbegin(), b.cend(), expected.begin());
+        }
+
+        // read-write access
+        {
+            Array a(name, Array::ReadWrite);
+            should(!a.isReadOnly());
+            a.commitSubarray(Shape3(), ref);
+            a.flushToDisk();
+        }
+        {
+            Array a(name);
+            shouldEqualSequence(a.cbegin(), a.cend(), ref.begin());
+
+            // writes to a read-only array are not written back
+            Array::iterator i = a.begin();
+            *i = -1.0f;
+            shouldEqual(a.getItem(Shape3()), -1.0f);
+        }
+        {
+            Array a(name);
+            shouldEqual(a.getItem(Shape3()), ref[0]);
+        }
+
+        // type and dimension are checked
+        try
+        {
+            ChunkedArrayMmap<3, int> a(name);
+            failTest("opening file with wrong element type failed to throw exception");
+        }
+        catch(PreconditionViolation & e)
+        {
+            std::string expected("\nPrecondition violation!\nChunkedArrayMmap(): file has wrong element type."),
+                        actual(e.what());
+            shouldEqual(actual.substr(0, expected.size()), expected);
+        }
+        try
+        {
+            ChunkedArrayMmap<2, float> a(name);
+            failTest("opening file with wrong dimension failed to throw exception");
+        }
+        catch(PreconditionViolation & e)
+        {
+            std::string expected("\nPrecondition violation!\nChunkedArrayMmap(): file has wrong dimension."),
+                        actual(e.what());
+            shouldEqual(actual.substr(0, expected.size()), expected);
+        }
+        remove(name.c_str());
+    }
+};
+
+struct ChunkedArrayZarrTest
+{
+    typedef ChunkedArrayZarr<3, float> Array;
+
+    Shape3 shape, chunk_shape;
+    MultiArray<3, float> ref;
+
+    ChunkedArrayZarrTest()
+    : shape(20,21,22),
+      chunk_shape(8),
+      ref(shape)
+    {
+        linearSequence(ref.begin(), ref.end());
+    }
+
+    static std::string readText(std::string const & name)
+    {
+        std::ifstream stream(name.c_str());
+        std::ostringstream text;
+        text << stream.rdbuf();
+        return text.str();
+    }
+
+    void testReopen()
+    {
+        std::string path("chunked_test_reopen.zarr");
+        Shape3 start(8), stop(16);
+        {
+            Array a(path, shape, chunk_shape,
+                    ChunkedArrayOptions().fillValue(42).compression(NO_COMPRESSION));
+            a.commitSubarray(start, ref.subarray(start, stop));
+            should(!a.isReadOnly());
+        }
+
+        // Zarr uses C order
+        std::string metadata = readText(path + "/.zarray");
+        should(metadata.find("\"shape\": [22, 21, 20]") != std::string::npos);
+        should(metadata.find("\"chunks\": [8, 8, 8]") != std::string::npos);
+        should(metadata.find("\"fill_value\": 42") != std::string::npos);
+        should(metadata.find("\"compressor\": null") != std::string::npos);
+        should(metadata.find(detail::zarrDtype<float>()) != std::string::npos);
+
+        // only the chunk we wrote exists
+        {
+            MultiArray<3, float> chunk(chunk_shape);
+            std::ifstream stream((path + "/1.1.1").c_str(), std::ios::binary);
+            stream.read((char *)chunk.data(), chunk.size()*sizeof(float));
+            should(bool(stream));
+            should(chunk == ref.subarray(start, stop));
+            should(!bool(std::ifstream((path + "/0.0.0").c_str())));
+        }
+
+        MultiArray<3, float> expected(shape, 42.0f);
+        expected.subarray(start, stop) = ref.subarray(start, stop);
+        {
+            Array a(path);
+            should(a.isReadOnly());
+            shouldEqual(a.shape(), shape);
+            shouldEqual(a.chunkShape(), chunk_shape);
+            shouldEqual(a.compression(), NO_COMPRESSION);
+            shouldEqualSequence(a.cbegin(), a.cend(), expected.begin());
+        }
+
+        // two writers of disjoint chunks: 'b' reads all chunks, but must
+        // not write back the chunks it didn't modify
+        {
+            Array a(path, Array::ReadWrite), b(path, Array::ReadWrite);
+            MultiArray<3, float> tmp(shape);
+            b.checkoutSubarray(Shape3(), tmp);
+
+            Shape3 split(20, 21, 16);
+            ThreadPool pool(2);
+            pool.enqueue([&](int) { a.commitSubarray(Shape3(), ref.subarray(Shape3(), split)); a.flushToDisk(); });
+            pool.enqueue([&](int) { b.commitSubarray(Shape3(0, 0, 16), ref.subarray(Shape3(0, 0, 16), shape)); b.flushToDisk(); });
+            pool.waitFinished();
+        }
+        {
+            Array a(path);
+            shouldEqualSequence(a.cbegin(), a.cend(), ref.begin());
+        }
+
+        // type and dimension are checked
+        try
+        {
+            ChunkedArrayZarr<3, int> a(path);
+            failTest("opening array with wrong element type failed to throw exception");
+        }
+        catch(PreconditionViolation & e)
+        {
+            std::string expected("\nPrecondition violation!\nChunkedArrayZarr(): array has wrong element type."),
+                        actual(e.what());
+            shouldEqual(actual.substr(0, expected.size()), expected);
+        }
+        try
+        {
+            ChunkedArrayZarr<2, float> a(path);
+            failTest("opening array with wrong dimension failed to throw exception");
+        }
+        catch(PreconditionViolation & e)
+        {
+            std::string expected("\nPrecondition violation!\nChunkedArrayZarr(): array has wrong dimension."),
+                        actual(e.what());
+            shouldEqual(actual.substr(0, expected.size()), expected);
+        }
+    }
+
+    void testCodecs()
+    {
+        typedef TinyVector<UInt16, 3> Pixel;
+        Shape3 shape(40, 33, 20), chunk_shape(16);
+        MultiArray<3, Pixel> ref(shape), res(shape);
+        for(MultiCoordinateIterator<3> c(shape), end = c.getEndIterator(); c != end; ++c)
+            ref[*c] = Pixel((*c)[0], (*c)[1], (*c)[2]);
+
+        std::string path("chunked_test_codecs.zarr");
+        CompressionMethod methods[] = { NO_COMPRESSION, LZ4, SHUFFLE_LZ4, ZLIB_FAST, ZSTD, SHUFFLE_ZSTD };
+        for(int m = 0; m < 6; ++m)
+        {
+            try
+            {
+                ChunkedArrayZarr<3, Pixel> a(path, shape, chunk_shape,
+                                             ChunkedArrayOptions().cacheMax(2).compression(methods[m]));
+                a.commitSubarray(Shape3(), ref, ParallelOptions().numThreads(4));
+            }
+            catch(PreconditionViolation & e)
+            {
+                // the codec is not available in this build
+                should(std::string(e.what()).find("compiled without") != std::string::npos);
+                continue;
+            }
+            // the band axis is the last axis of the store
+            should(bool(std::ifstream((path + "/1.2.0.0").c_str())));
+            should(readText(path + "/.zarray").find("\"shape\": [20, 33, 40, 3]") != std::string::npos);
+
+            ChunkedArrayZarr<3, Pixel> a(path);
+            shouldEqual(a.compression(), methods[m]);
+            res = Pixel();
+            a.checkoutSubarray(Shape3(), res, ParallelOptions().numThreads(4));
+            should(res == ref);
+        }
+
+        try
+        {
+            ChunkedArrayZarr<3, Pixel> a(path, shape, chunk_shape,
+                                         ChunkedArrayOptions().compression(BITSHUFFLE_LZ4));
+            failTest("unsupported compression method failed to throw exception");
+        }
+        catch(PreconditionViolation & e)
+        {
+            std::string expected("\nPrecondition violation!\nChunkedArrayZarr(): compression method is not supported by Zarr."),
+                        actual(e.what());
+            shouldEqual(actual.substr(0, expected.size()), expected);
+        }
+    }
+
+    void testForeignStore()
+    {
+        // a store as written by other implementations, with nested chunk keys
+        std::string path("chunked_test_foreign.zarr");
+        detail::zarrMakeDirectory(path + "/0", true);
+        std::remove((path + "/1/1").c_str());
+        {
+            std::ofstream stream((path + "/.zarray").c_str());
+            stream << "{\"zarr_format\": 2, \"shape\": [3, 5], \"chunks\": [2, 4],\n"
+                   << " \"dtype\": \"" << detail::zarrDtype<float>() << "\", \"order\": \"C\",\n"
+                   << " \"compressor\": null, \"filters\": null, \"fill_value\": \"NaN\",\n"
+                   << " \"dimension_separator\": \"/\", \"attributes\": {\"name\": \"te\\\"st\", \"list\": [true, false, -1.5e3]}}";
+        }
+        {
+            float chunk[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+            std::ofstream stream((path + "/0/0").c_str(), std::ios::binary);
+            stream.write((char const *)chunk, sizeof(chunk));
+        }
+        {
+            ChunkedArrayZarr<2, float> a(path, ChunkedArrayZarr<2, float>::ReadWrite);
+            shouldEqual(a.shape(), Shape2(5, 3));
+            shouldEqual(a.chunkShape(), Shape2(4, 2));
+            shouldEqual(a.getItem(Shape2(0, 0)), 1.0f);
+            shouldEqual(a.getItem(Shape2(3, 0)), 4.0f);
+            shouldEqual(a.getItem(Shape2(1, 1)), 6.0f);
+            should(std::isnan(a.getItem(Shape2(4, 0))));
+            should(std::isnan(a.getItem(Shape2(0, 2))));
+            a.setItem(Shape2(4, 2), 10.0f);
+        }
+        should(bool(std::ifstream((path + "/1/1").c_str())));
+        {
+            ChunkedArrayZarr<2, float> a(path);
+            shouldEqual(a.getItem(Shape2(4, 2)), 10.0f);
+            should(std::isnan(a.getItem(Shape2(3, 2))));
+        }
+    }
+};
+
+struct ChunkedArrayCompressionTest
+{
+    void testShuffleCodecs()
+    {
+        Shape3 shape(64, 65, 66), chunk_shape(32);
+        MultiArray<3, UInt16> ref(shape), res(shape);
+        RandomMT19937 random(42);
+        for(MultiCoordinateIterator<3> c(shape), end = c.getEndIterator(); c != end; ++c)
+            ref[*c] = UInt16(2000.0 + 1000.0*std::sin((*c)[0] / 5.0)*std::sin((*c)[1] / 7.0)
+                             + random.uniformInt(4));
+
+        CompressionMethod methods[] = { LZ4, SHUFFLE_LZ4, BITSHUFFLE_LZ4 };
+        std::string names[] = { "ChunkedArrayCompressed<LZ4>",
+                                "ChunkedArrayCompressed<SHUFFLE_LZ4>",
+                                "ChunkedArrayCompressed<BITSHUFFLE_LZ4>" };
+        std::size_t bytes[3];
+        for(int m = 0; m < 3; ++m)
+        {
+            ChunkedArrayCompressed<3, UInt16> a(shape, chunk_shape,
+                                   ChunkedArrayOptions().compression(methods[m]).cacheMax(1));
+            shouldEqual(a.backend(), names[m]);
+            a.commitSubarray(Shape3(), ref);
+            a.releaseChunks(Shape3(), shape);
+            bytes[m] = static_cast<ChunkedArray<3, UInt16> &>(a).dataBytes();
+            a.checkoutSubarray(Shape3(), res);
+            should(res == ref);
+        }
+        should(bytes[1] < bytes[0]);
+        should(bytes[2] < bytes[0]);
+    }
+
+    void testParallelTransfer()
+    {
+        Shape3 shape(100, 90, 80), chunk_shape(16),
+               start(5, 7, 3), stop(95, 80, 77);
+        MultiArray<3, float> ref(shape), res(shape), expected(shape, 42.0f);
+        linearSequence(ref.begin(), ref.end());
+        expected.subarray(start, stop) = ref.subarray(start, stop);
+
+        ThreadPool pool(4);
+        ParallelOptions options = ParallelOptions().threadPool(pool);
+        ChunkedArrayCompressed<3, float> a(shape, chunk_shape,
+                                           ChunkedArrayOptions().fillValue(42).cacheMax(8));
+        a.commitSubarray(start, ref.subarray(start, stop), options);
+        a.checkoutSubarray(Shape3(), res, options);
+        should(res == expected);
+        should(a.cacheSize() <= 8);
+
+        // the sequential version must give the same result
+        res = 0.0f;
+        a.checkoutSubarray(Shape3(), res, ParallelOptions().numThreads(0));
+        should(res == expected);
+    }
+
+    void testBackgroundCompression()
+    {
+        Shape3 shape(64), chunk_shape(16);
+        MultiArray<3, UInt16> ref(shape), res(shape);
+        for(MultiCoordinateIterator<3> c(shape), end = c.getEndIterator(); c != end; ++c)
+            ref[*c] = UInt16((*c)[0] + (*c)[1] + (*c)[2]);
+
+        for(int background = 0; background < 2; ++background)
+        {
+            ChunkedArrayCompressed<3, UInt16> a(shape, chunk_shape,
+                                   ChunkedArrayOptions().cacheMax(4).backgroundCompression(background == 1));
+            ChunkedArrayCompressed<3, UInt16>::iterator i = a.begin(), end = a.end();
+            for(MultiArray<3, UInt16>::iterator j = ref.begin(); i != end; ++i, ++j)
+                *i = *j;
+            // chunks evicted while the iterator was active must be reactivated correctly
+            for(i = a.begin(); i != end; ++i)
+                ++*i;
+            a.waitForCompression();
+            should(a.cacheSize() <= 4);
+            std::size_t bytes = static_cast<ChunkedArray<3, UInt16> &>(a).dataBytes();
+            should(bytes < ref.size()*sizeof(UInt16) / 2);
+
+            a.checkoutSubarray(Shape3(), res);
+            ref += UInt16(1);
+            should(res == ref);
+            ref -= UInt16(1);
+        }
+    }
+};
+
+#ifdef HasHDF5
+struct ChunkedArrayHDF5DirectTest
+{
+    void testDirectChunkIO()
+    {
+        // the shape is not a multiple of the chunk shape to exercise edge chunks
+        Shape3 shape(50, 45, 40), chunk_shape(16),
+               start(3, 5, 7), stop(47, 40, 33);
+        MultiArray<3, float> ref(shape), res(shape), expected(shape, 42.0f);
+        linearSequence(ref.begin(), ref.end());
+        expected.subarray(start, stop) = ref.subarray(start, stop);
+
+        ThreadPool pool(4);
+        ParallelOptions options = ParallelOptions().threadPool(pool);
+        CompressionMethod methods[] = { ZLIB_FAST, ZLIB_NONE, NO_COMPRESSION };
+        for(int m = 0; m < 3; ++m)
+        {
+            {
+                HDF5File file("chunked_test_direct.h5", HDF5File::New);
+                ChunkedArrayHDF5<3, float> a(file, "test", HDF5File::New, shape, chunk_shape,
+                                             ChunkedArrayOptions().fillValue(42).cacheMax(4)
+                                                 .compression(methods[m]).directChunkIO(true));
+                should(a.directChunkIO());
+                a.commitSubarray(start, ref.subarray(start, stop), options);
+                a.checkoutSubarray(Shape3(), res, options);
+                should(res == expected);
+            }
+            {
+                // the file is readable by regular HDF5 means
+                HDF5File file("chunked_test_direct.h5", HDF5File::OpenReadOnly);
+                MultiArray<3, float> data;
+                file.readAndResize("test", data);
+                should(data == expected);
+
+                ChunkedArrayHDF5<3, float> a(file, "test", HDF5File::ReadOnly,
+                                             ChunkedArrayOptions().directChunkIO(true));
+                should(a.directChunkIO());
+                res = 0.0f;
+                a.checkoutSubarray(Shape3(), res, options);
+                should(res == expected);
+            }
+        }
+
+        // chunk shapes that don't match fall back to regular I/O
+        {
+            HDF5File file("chunked_test_direct.h5", HDF5File::New);
+            file.write("test", ref, 10, 1);
+        }
+        {
+            HDF5File file("chunked_test_direct.h5", HDF5File::OpenReadOnly);
+            ChunkedArrayHDF5<3, float> a(file, "test", HDF5File::ReadOnly,
+                                         ChunkedArrayOptions().directChunkIO(true));
+            should(!a.directChunkIO());
+            a.checkoutSubarray(Shape3(), res, options);
+            should(res == ref);
+        }
+
+        // datasets of a different type fall back to regular I/O (which converts the values)
+        {
+            HDF5File file("chunked_test_direct.h5", HDF5File::New);
+            ChunkedArrayHDF5<3, double> a(file, "test", HDF5File::New, shape, chunk_shape,
+                                          ChunkedArrayOptions().compression(NO_COMPRESSION));
+            a.commitSubarray(Shape3(), MultiArray<3, double>(ref));
+        }
+        {
+            HDF5File file("chunked_test_direct.h5", HDF5File::OpenReadOnly);
+            ChunkedArrayHDF5<3, float> a(file, "test", HDF5File::ReadOnly,
+                                         ChunkedArrayOptions().directChunkIO(true));
+            should(!a.directChunkIO());
+            res = 0.0f;
+            a.checkoutSubarray(Shape3(), res, options);
+            should(res == ref);
+        }
+        remove("chunked_test_direct.h5");
+    }
+
+    void testDirectChunkIOMultiband()
+    {
+        typedef TinyVector<UInt16, 3> Pixel;
+        Shape3 shape(40, 33, 20), chunk_shape(16);
+        MultiArray<3, Pixel> ref(shape), res(shape);
+        for(MultiCoordinateIterator<3> c(shape), end = c.getEndIterator(); c != end; ++c)
+            ref[*c] = Pixel((*c)[0], (*c)[1], (*c)[2]);
+
+        {
+            HDF5File file("chunked_test_direct.h5", HDF5File::New);
+            ChunkedArrayHDF5<3, Pixel> a(file, "test", HDF5File::New, shape, chunk_shape,
+                                         ChunkedArrayOptions().cacheMax(2).directChunkIO(true));
+            should(a.directChunkIO());
+            a.commitSubarray(Shape3(), ref, ParallelOptions().numThreads(4));
+        }
+        {
+            HDF5File file("chunked_test_direct.h5", HDF5File::OpenReadOnly);
+            MultiArray<3, Pixel> data;
+            file.readAndResize("test", data);
+            should(data == ref);
+
+            ChunkedArrayHDF5<3, Pixel> a(file, "test", HDF5File::ReadOnly, shape, chunk_shape,
+                                         ChunkedArrayOptions().directChunkIO(true));
+            should(a.directChunkIO());
+            a.checkoutSubarray(Shape3(), res, ParallelOptions().numThreads(4));
+            should(res == ref);
+        }
+        remove("chunked_test_direct.h5");
+    }
+};
+#endif
+
+    // Compression ratio and throughput of the CompressionMethods on
+    // a smooth, noisy volume (as typically produced by microscopes).
+template <class T>
+struct CompressionSpeedTest
+{
+    Shape3 shape, chunk_shape;
+    MultiArray<3, T> data;
+
+    CompressionSpeedTest()
+    : shape(128),
+      chunk_shape(64),
+      data(shape)
+    {
+        RandomMT19937 random(42);
+        double range = sizeof(T) == 1 ? 200.0 : 4000.0,
+               scale = NumericTraits<T>::isIntegral::value ? 1.0 : 1.0 / range;
+        for(MultiCoordinateIterator<3> c(shape), end = c.getEndIterator(); c != end; ++c)
+        {
+            double v = 0.5*range*(1.0 + std::sin((*c)[0] / 7.0)*std::sin((*c)[1] / 11.0)*std::sin((*c)[2] / 13.0))
+                       + 0.01*range*(random.uniform() - 0.5);
+            data[*c] = NumericTraits<T>::isIntegral::value
+                           ? T(std::floor(v + 0.5))
+                           : T(v*scale);
+        }
+    }
+
+    void testCompressionSpeed()
+    {
+        std::cerr << "############ compression ratio and speed for " << typeid(T).name() 
+                  << " (" << sizeof(T) << " bytes) #############\n";
+        CompressionMethod methods[] = { LZ4, SHUFFLE_LZ4, BITSHUFFLE_LZ4, ZLIB_FAST,
+                                        ZSTD_FAST, ZSTD, SHUFFLE_ZSTD };
+        char const * names[] = { "LZ4", "SHUFFLE_LZ4", "BITSHUFFLE_LZ4", "ZLIB_FAST",
+                                 "ZSTD_FAST", "ZSTD", "SHUFFLE_ZSTD" };
+        MultiArray<3, T> chunk(chunk_shape), res(chunk_shape);
+        std::size_t chunk_bytes = chunk.size()*sizeof(T),
+                    total_bytes = data.size()*sizeof(T);
+        for(int m = 0; m < 7; ++m)
+        {
+            ArrayVector<char> compressed;
+            std::size_t compressed_bytes = 0;
+            double compress_ms = 0.0, uncompress_ms = 0.0;
+            try
+            {
+                for(MultiCoordinateIterator<3> c(shape / chunk_shape), end = c.getEndIterator(); c != end; ++c)
+                {
+                    chunk = data.subarray(*c*chunk_shape, (*c+Shape3(1))*chunk_shape);
+                    USETICTOC;
+                    TIC;
+                    compress((char const *)chunk.data(), chunk_bytes, compressed, methods[m], sizeof(T));
+                    compress_ms += TOCN;
+                    compressed_bytes += compressed.size();
+                    TIC;
+                    uncompress(compressed.data(), compressed.size(), (char *)res.data(), chunk_bytes,
+                               methods[m], sizeof(T));
+                    uncompress_ms += TOCN;
+                    should(res == chunk);
+                }
+            }
+            catch(ContractViolation &)
+            {
+                std::cerr << "    " << std::setw(15) << std::left << names[m] << "not available\n";
+                continue;
+            }
+            std::cerr << "    " << std::setw(15) << std::left << names[m] << std::right
+                      << "ratio: " << std::setw(6) << std::fixed << std::setprecision(2)
+                      << double(total_bytes) / compressed_bytes
+                      << "  compress: " << std::setw(8) << std::setprecision(1)
+                      << total_bytes / 1000.0 / std::max(compress_ms, 1e-3) << " MB/s"
+                      << "  uncompress: " << std::setw(8)
+                      << total_bytes / 1000.0 / std::max(uncompress_ms, 1e-3) << " MB/s\n";
+        }
+    }
+};
+
 template <class Array>
 class ChunkedMultiArraySpeedTest
 {
@@ -1472,6 +2140,49 @@ public:
         testIteratorSpeed();
     }
 
+    static void readSlices(BaseArray * a, int startIndex, int d,
+                           threading::atomic_long * errors)
+    {
+        Shape3 s = a->shape();
+        Iterator i(a->begin());
+        for(i.setDim(2,startIndex); i.coord(2) < s[2]; i.addDim(2, d))
+            for(i.setDim(1,0); i.coord(1) < s[1]; i.incDim(1))
+                for(i.setDim(0,0); i.coord(0) < s[0]; i.incDim(0))
+                    if(*i != T(i.scanOrderIndex()))
+                        ++*errors;
+    }
+
+    // Each thread reads every n-th z-slice. The cache holds 'cacheSize'
+    // chunks per thread.
+    void readMultiThreaded(int threadCount, std::size_t cacheSize, std::string const & name)
+    {
+        array->setCacheMaxSize(threadCount*cacheSize);
+        threading::atomic_long errors;
+        errors.store(0);
+        std::vector<threading::thread> threads;
+        USETICTOC;
+        TIC;
+        for(int k=0; k<threadCount; ++k)
+            threads.push_back(threading::thread(std::bind(readSlices, array.get(), k, threadCount, &errors)));
+        for(int k=0; k<threadCount; ++k)
+            threads[k].join();
+        std::string t = TOCS;
+        shouldEqual(errors.load(), 0);
+        std::cerr << "    " << threadCount << " threads, " << name << ": " << t << "\n";
+    }
+
+    void testMultiThreadedSpeed()
+    {
+        std::cerr << "    multi-threaded read (" << array->backend() << "):\n";
+        Shape3 cs = array->chunkArrayShape();
+        for(int threadCount = 1; threadCount <= 4; threadCount *= 2)
+        {
+            readMultiThreaded(threadCount, prod(cs), "all in cache");
+            readMultiThreaded(threadCount, cs[0]*cs[1], "1 slice in cache");
+            readMultiThreaded(threadCount, cs[0], "1 row in cache");
+        }
+    }
+
     void testIndexingBaselineSpeed()
     {
         std::cerr << "################## indexing speed ####################\n";
@@ -1527,6 +2238,9 @@ struct ChunkedMultiArrayTestSuite
         add( testCase( &ChunkedMultiArrayTest<Array>::test_iterator ) );
         add( testCase( &ChunkedMultiArrayTest<Array>::testChunkIterator ) );
         add( testCase( &ChunkedMultiArrayTest<Array>::testMultiThreaded ) );
+        add( testCase( &ChunkedMultiArrayTest<Array>::testMultiThreadedSmallCache ) );
+        add( testCase( &ChunkedMultiArrayTest<Array>::testCacheReplacement ) );
+        add( testCase( &ChunkedMultiArrayTest<Array>::testPrefetch ) );
     }
 
     template <class T>
@@ -1545,6 +2259,13 @@ struct ChunkedMultiArrayTestSuite
 #endif
     }
 
+    template <class T>
+    void testMultiThreadedSpeedImpl()
+    {
+        add( testCase( (&ChunkedMultiArraySpeedTest<ChunkedArrayCompressed<3, T> >::testMultiThreadedSpeed )));
+        add( testCase( (&ChunkedMultiArraySpeedTest<ChunkedArrayTmpFile<3, T> >::testMultiThreadedSpeed )));
+    }
+
     template <class T>
     void testIndexingSpeedImpl()
     {
@@ -1565,6 +2286,8 @@ struct ChunkedMultiArrayTestSuite
         testImpl<ChunkedArrayLazy<3, float> >();
         testImpl<ChunkedArrayCompressed<3, float> >();
         testImpl<ChunkedArrayTmpFile<3, float> >();
+        testImpl<ChunkedArrayMmap<3, float> >();
+        testImpl<ChunkedArrayZarr<3, float> >();
 #ifdef HasHDF5
         testImpl<ChunkedArrayHDF5<3, float> >();
 #endif
@@ -1573,6 +2296,8 @@ struct ChunkedMultiArrayTestSuite
         testImpl<ChunkedArrayLazy<3, TinyVector<float, 3> > >();
         testImpl<ChunkedArrayCompressed<3, TinyVector<float, 3> > >();
         testImpl<ChunkedArrayTmpFile<3, TinyVector<float, 3> > >();
+        testImpl<ChunkedArrayMmap<3, TinyVector<float, 3> > >();
+        testImpl<ChunkedArrayZarr<3, TinyVector<float, 3> > >();
 #ifdef HasHDF5
         testImpl<ChunkedArrayHDF5<3, TinyVector<float, 3> > >();
 #endif
@@ -1585,6 +2310,25 @@ struct ChunkedMultiArrayTestSuite
         testIndexingSpeedImpl<float>();
         testIndexingSpeedImpl<double>();
 
+        testMultiThreadedSpeedImpl<float>();
+
+        add( testCase( &ChunkedArrayMmapTest::testReopen ) );
+        add( testCase( &ChunkedArrayZarrTest::testReopen ) );
+        add( testCase( &ChunkedArrayZarrTest::testCodecs ) );
+        add( testCase( &ChunkedArrayZarrTest::testForeignStore ) );
+        add( testCase( &ChunkedArrayCompressionTest::testShuffleCodecs ) );
+        add( testCase( &ChunkedArrayCompressionTest::testParallelTransfer ) );
+        add( testCase( &ChunkedArrayCompressionTest::testBackgroundCompression ) );
+#ifdef HasHDF5
+        add( testCase( &ChunkedArrayHDF5DirectTest::testDirectChunkIO ) );
+        add( testCase( &ChunkedArrayHDF5DirectTest::testDirectChunkIOMultiband ) );
+#endif
+
+        add( testCase( &CompressionSpeedTest<UInt8>::testCompressionSpeed ) );
+        add( testCase( &CompressionSpeedTest<UInt16>::testCompressionSpeed ) );
+        add( testCase( &CompressionSpeedTest<float>::testCompressionSpeed ) );
+        add( testCase( &CompressionSpeedTest<double>::testCompressionSpeed ) );
+
         //add( testCase( &MultiArrayPointoperatorsTest::testInit ) );
         //add( testCase( &MultiArrayPointoperatorsTest::testCopy ) );
         //add( testCase( &MultiArrayPointoperatorsTest::testCopyOuterExpansion ) );
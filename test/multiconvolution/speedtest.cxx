@@ -4,7 +4,7 @@
 #include "vigra/unittest.hxx"
 #include "vigra/multi_array.hxx"
 #include "vigra/multi_pointoperators.hxx"
-//#include "vigra/multi_convolution.hxx"
+#include "vigra/multi_convolution.hxx"
 #include "vigra/basicimageview.hxx"
 #include "vigra/convolution.hxx" 
 #include "vigra/navigator.hxx"
@@ -331,6 +331,57 @@ struct MultiArraySepConvSpeedTest
   }
 
 
+  template <class T>
+  void timePanels( const char *name )
+  {
+    MultiArray<3, T> src( img ), dst( size );
+    const int level = detail::convolutionSIMDLevel();
+    {
+      detail::convolutionSIMDLevel() = detail::ConvolutionLineByLine;
+      Speedy( separableConvolveMultiArray( src, dst, kernels.begin() ),
+              std::string(name) + " line by line" );
+    }
+    {
+      detail::convolutionSIMDLevel() = detail::ConvolutionPanelScalar;
+      Speedy( separableConvolveMultiArray( src, dst, kernels.begin() ),
+              std::string(name) + " panels, scalar" );
+    }
+    {
+      detail::convolutionSIMDLevel() = level;
+      Speedy( separableConvolveMultiArray( src, dst, kernels.begin() ),
+              std::string(name) + " panels, " + (level == detail::ConvolutionPanelAVX ? "AVX" :
+                                                 level == detail::ConvolutionPanelSSE2 ? "SSE2" : "scalar") );
+    }
+  }
+
+  void test4()
+  {
+    timePanels<float>( "separableConvolveMultiArray<float>" );
+    timePanels<double>( "separableConvolveMultiArray<double>" );
+  }
+
+  void test5()
+  {
+    // recursive filters need lines that are long compared to sigma
+    Size3 shape( 128, 128, 128 );
+    MultiArray<3, float> src( shape ), dst( shape );
+    for( int i = 0; i < src.size(); ++i )
+      src[i] = (float)(std::rand() % 256);
+    for( double sigma = 2.0; sigma <= 16.0; sigma *= 2.0 )
+    {
+      std::ostringstream s;
+      s << "gaussianSmoothMultiArray<float>, sigma = " << sigma;
+      {
+        Speedy( gaussianSmoothMultiArray( src, dst, sigma ), s.str() + " FIR" );
+      }
+      {
+        Speedy( gaussianSmoothMultiArray( src, dst, sigma,
+                                          ConvolutionOptions<3>().useRecursiveFilter() ),
+                s.str() + " recursive" );
+      }
+    }
+  }
+
   void makeBox( Image3D &image )
   {
     const int b = 8;
@@ -370,6 +421,8 @@ struct MultiArraySepConvSpeedTestSuite
         add( testCase( &MultiArraySepConvSpeedTest::test3 ) );
         add( testCase( &MultiArraySepConvSpeedTest::test1 ) );
         add( testCase( &MultiArraySepConvSpeedTest::test2 ) );
+        add( testCase( &MultiArraySepConvSpeedTest::test4 ) );
+        add( testCase( &MultiArraySepConvSpeedTest::test5 ) );
         add( testCase( &MultiArraySepConvSpeedTest::testCorrectness ) );
     }
 };
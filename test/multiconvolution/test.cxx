@@ -576,6 +576,163 @@ struct MultiArraySeparableConvolutionTest
         test_gradient1( srcImage, false );
         test_gradient1( srcImage, true );
     }
+
+    template <class Array1, class Array2>
+    static double relativeError(Array1 const & res, Array2 const & ref)
+    {
+        double scale = 0.0, error = 0.0;
+        typename Array1::const_iterator i = res.begin();
+        typename Array2::const_iterator j = ref.begin();
+        for(; j != ref.end(); ++i, ++j)
+        {
+            scale = std::max(scale, std::abs((double)*j));
+            error = std::max(error, std::abs((double)*i - (double)*j));
+        }
+        return error / scale;
+    }
+
+    template <unsigned int N>
+    void testRecursiveImpl(typename MultiArrayShape<N>::type const & shape, double sigma,
+                           double smoothingBound, double derivativeBound)
+    {
+        typedef typename MultiArrayShape<N>::type Shape;
+        static const int M = N*(N+1)/2;
+
+        // white noise is the worst case for the approximation error
+        MultiArray<N, double> src(shape);
+        makeRandom(src);
+
+        // compare with accurate FIR filters in the interior of the array
+        // (the border treatment of the recursive filters differs slightly)
+        ConvolutionOptions<N> fir = ConvolutionOptions<N>().filterWindowSize(5.0),
+                              recursive = ConvolutionOptions<N>().useRecursiveFilter();
+        should(recursive.getUseRecursiveFilter());
+        Shape start(Shape(int(5.0*sigma))), stop(shape - start);
+
+        MultiArray<N, double> smooth(shape), rsmooth(shape);
+        gaussianSmoothMultiArray(src, smooth, sigma, fir);
+        gaussianSmoothMultiArray(src, rsmooth, sigma, recursive);
+        should(relativeError(rsmooth.subarray(start, stop), smooth.subarray(start, stop)) < smoothingBound);
+
+        MultiArray<N, TinyVector<double, int(N)> > grad(shape), rgrad(shape);
+        gaussianGradientMultiArray(src, grad, sigma, fir);
+        gaussianGradientMultiArray(src, rgrad, sigma, recursive);
+        for(int d=0; d<(int)N; ++d)
+            should(relativeError(rgrad.bindElementChannel(d).subarray(start, stop),
+                                 grad.bindElementChannel(d).subarray(start, stop)) < derivativeBound);
+
+        MultiArray<N, TinyVector<double, M> > hessian(shape), rhessian(shape);
+        hessianOfGaussianMultiArray(src, hessian, sigma, fir);
+        hessianOfGaussianMultiArray(src, rhessian, sigma, recursive);
+        for(int d=0; d<M; ++d)
+            should(relativeError(rhessian.bindElementChannel(d).subarray(start, stop),
+                                 hessian.bindElementChannel(d).subarray(start, stop)) < derivativeBound);
+
+        MultiArray<N, double> laplacian(shape), rlaplacian(shape);
+        laplacianOfGaussianMultiArray(src, laplacian, sigma, fir);
+        laplacianOfGaussianMultiArray(src, rlaplacian, sigma, recursive);
+        should(relativeError(rlaplacian.subarray(start, stop), laplacian.subarray(start, stop)) < derivativeBound);
+
+        // a ROI gives the same result as the full array, up to the truncation
+        // of the recursion at the ROI margin
+        Shape rstart(shape / 5), rstop(shape - shape / 3);
+        MultiArray<N, double> rsmoothROI(rstop - rstart);
+        gaussianSmoothMultiArray(src, rsmoothROI, sigma, ConvolutionOptions<N>(recursive).subarray(rstart, rstop));
+        should(relativeError(rsmoothROI, rsmooth.subarray(rstart, rstop)) < smoothingBound);
+        MultiArray<N, TinyVector<double, int(N)> > rgradROI(rstop - rstart);
+        gaussianGradientMultiArray(src, rgradROI, sigma, ConvolutionOptions<N>(recursive).subarray(rstart, rstop));
+        for(int d=0; d<(int)N; ++d)
+            should(relativeError(rgradROI.bindElementChannel(d),
+                                 rgrad.subarray(rstart, rstop).bindElementChannel(d)) < 0.25*derivativeBound);
+
+        // the recursive filters are computed in double precision even for float data
+        MultiArray<N, float> fsrc(src), fsmooth(shape);
+        gaussianSmoothMultiArray(fsrc, fsmooth, sigma, recursive);
+        should(relativeError(fsmooth, rsmooth) < 1e-5);
+
+        MultiArray<N, TinyVector<double, M> > st(shape), rst(shape);
+        structureTensorMultiArray(src, st, sigma, 2.0*sigma, fir);
+        structureTensorMultiArray(src, rst, sigma, 2.0*sigma, recursive);
+        for(int d=0; d<M; ++d)
+            should(relativeError(rst.bindElementChannel(d).subarray(start, stop),
+                                 st.bindElementChannel(d).subarray(start, stop)) < 2.0*derivativeBound);
+    }
+
+    void test_recursive()
+    {
+        // accuracy relative to the maximum response of the FIR filters
+        testRecursiveImpl<3>(Shape3(60, 50, 40), 3.0, 1e-3, 0.02);
+        testRecursiveImpl<2>(Shape2(200, 190), 8.0, 1e-3, 0.02);
+        testRecursiveImpl<2>(Shape2(100, 90), 1.5, 5e-3, 0.08);
+    }
+
+    template <class T>
+    static double maxAbsDifference(MultiArray<3, T> const & a, MultiArray<3, T> const & b)
+    {
+        double res = 0.0;
+        for(int k=0; k<a.size(); ++k)
+            res = std::max(res, std::abs((double)a[k] - (double)b[k]));
+        return res;
+    }
+
+    template <class SrcType, class DestType>
+    void testPanelsImpl(BorderTreatmentMode border, bool derivative)
+    {
+        // odd shape so that the last panel of each line group is only partially filled
+        MultiArray<3, SrcType> src(Shape3(21, 17, 12));
+        makeRandom(src);
+
+        ArrayVector<Kernel1D<double> > kernels(3);
+        kernels[0].initGaussian(1.5);
+        kernels[1].initGaussian(2.0);
+        if(derivative)
+            kernels[2].initGaussianDerivative(1.2, 1);
+        else
+            kernels[2].initGaussian(1.2);
+        for(int k=0; k<3; ++k)
+            kernels[k].setBorderTreatment(border);
+
+        const int level = detail::convolutionSIMDLevel();
+        Shape3 start(3, 2, 1), stop(17, 14, 11);
+
+        detail::convolutionSIMDLevel() = detail::ConvolutionLineByLine;
+        MultiArray<3, DestType> ref(src.shape()), refRoi(stop-start), refT(src.transpose().shape());
+        separableConvolveMultiArray(src, ref, kernels.begin());
+        separableConvolveMultiArray(src, refRoi, kernels.begin(), start, stop);
+        separableConvolveMultiArray(src.transpose(), refT, kernels.begin());
+
+        for(int l = detail::ConvolutionPanelScalar; l <= level; ++l)
+        {
+            detail::convolutionSIMDLevel() = l;
+            MultiArray<3, DestType> res(src.shape()), resRoi(stop-start), resT(src.transpose().shape());
+            separableConvolveMultiArray(src, res, kernels.begin());
+            separableConvolveMultiArray(src, resRoi, kernels.begin(), start, stop);
+            separableConvolveMultiArray(src.transpose(), resT, kernels.begin());
+
+            // the panels apply the kernel taps in the same order and precision,
+            // so the results only differ if the compiler contracts to FMA instructions
+            should(maxAbsDifference(res, ref) <= 1e-6);
+            should(maxAbsDifference(resRoi, refRoi) <= 1e-6);
+            should(maxAbsDifference(resT, refT) <= 1e-6);
+        }
+        detail::convolutionSIMDLevel() = level;
+    }
+
+    void test_panels()
+    {
+        BorderTreatmentMode modes[] = { BORDER_TREATMENT_REFLECT, BORDER_TREATMENT_REPEAT,
+                                        BORDER_TREATMENT_WRAP, BORDER_TREATMENT_ZEROPAD,
+                                        BORDER_TREATMENT_CLIP };
+        for(int m=0; m<5; ++m)
+        {
+            testPanelsImpl<float, float>(modes[m], false);
+            testPanelsImpl<float, float>(modes[m], true);
+            testPanelsImpl<double, double>(modes[m], false);
+            testPanelsImpl<double, double>(modes[m], true);
+            testPanelsImpl<UInt8, float>(modes[m], false);
+            testPanelsImpl<UInt8, UInt8>(modes[m], true);
+        }
+    }
 };                //-- struct MultiArraySeparableConvolutionTest
 
 //--------------------------------------------------------
@@ -596,8 +753,10 @@ struct MultiArraySeparableConvolutionTestSuite
                 add( testCase( &MultiArraySeparableConvolutionTest::test_laplacian ) );
                 add( testCase( &MultiArraySeparableConvolutionTest::test_divergence ) );
                 add( testCase( &MultiArraySeparableConvolutionTest::test_hessian ) );
+                add( testCase( &MultiArraySeparableConvolutionTest::test_recursive ) );
                 add( testCase( &MultiArraySeparableConvolutionTest::test_structureTensor ) );
                 add( testCase( &MultiArraySeparableConvolutionTest::test_gradient_magnitude ) );
+                add( testCase( &MultiArraySeparableConvolutionTest::test_panels ) );
     }
 }; // struct MultiArraySeparableConvolutionTestSuite
 
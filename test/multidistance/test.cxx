@@ -46,6 +46,7 @@
 #include <vigra/vector_distance.hxx>
 #include <vigra/skeleton.hxx>
 #include <vigra/timing.hxx>
+#include <vigra/random.hxx>
 
 
 #include "test_data.hxx"
@@ -354,6 +355,44 @@ struct MultiDistanceTest
         }
     }
 
+    void testDistanceVolumesParallel()
+    {
+        MultiArray<3, UInt8> mask(Shape3(37, 29, 23));
+        RandomMT19937 random;
+        for(auto & m: mask)
+            m = random.uniform() < 0.02 ? 1 : 0;
+
+        TinyVector<double, 3> pixelPitch(1.2, 1.0, 2.4);
+        ParallelOptions options = ParallelOptions().numThreads(4);
+
+        for(int background = 0; background < 2; ++background)
+        {
+            MultiArray<3, UInt32> serial(mask.shape()), parallel(mask.shape());
+            separableMultiDistSquared(mask, serial, background == 1);
+            separableMultiDistSquared(mask, parallel, background == 1, options);
+            should(parallel == serial);
+
+            // strided destination
+            MultiArray<3, UInt32> transposed(reverse(mask.shape()));
+            separableMultiDistSquared(mask, transposed.transpose(), background == 1, options);
+            should(transposed.transpose() == serial);
+
+            MultiArray<3, float> serialf(mask.shape()), parallelf(mask.shape());
+            separableMultiDistSquared(mask, serialf, background == 1, pixelPitch);
+            separableMultiDistSquared(mask, parallelf, background == 1, pixelPitch, options);
+            should(parallelf == serialf);
+
+            separableMultiDistance(mask, serialf, background == 1, pixelPitch);
+            separableMultiDistance(mask, parallelf, background == 1, pixelPitch, options);
+            should(parallelf == serialf);
+
+            // anisotropic pitch with integer output requires a temporary array
+            separableMultiDistance(mask, serial, background == 1, pixelPitch);
+            separableMultiDistance(mask, parallel, background == 1, pixelPitch, options);
+            should(parallel == serial);
+        }
+    }
+
     void distanceTest1D()
     {
         vigra::MultiArray<2,double> res(img2);
@@ -642,6 +681,56 @@ struct BoundaryMultiDistanceTest
             shouldEqualSequence(res.begin(), res.end(), desired);
         }
     }
+
+    void testParallel()
+    {
+        // random blobs of 3 different labels
+        MultiArray<3, UInt32> labels(Shape3(41, 33, 19));
+        MultiArray<3, UInt32> coarse(Shape3(11, 9, 5));
+        RandomMT19937 random;
+        for(auto & c: coarse)
+            c = random.uniformInt(3);
+        for(auto i = labels.begin(); i != labels.end(); ++i)
+            *i = coarse[i.point() / 4];
+
+        TinyVector<double, 3> pixelPitch(1.0, 0.8, 2.5);
+        ParallelOptions options = ParallelOptions().numThreads(4);
+        BoundaryDistanceTag tags[] = { OuterBoundary, InterpixelBoundary, InnerBoundary };
+
+        for(int active = 0; active < 2; ++active)
+        {
+            for(BoundaryDistanceTag tag: tags)
+            {
+                MultiArray<3, float> serial(labels.shape()), parallel(labels.shape());
+                boundaryMultiDistance(labels, serial, active == 1, tag);
+                boundaryMultiDistance(labels, parallel, active == 1, tag, options);
+                should(parallel == serial);
+
+                typedef TinyVector<double, 3> DVec;
+                typedef TinyVector<float, 3>  FVec;
+                MultiArray<3, DVec> vserial(labels.shape()), vparallel(labels.shape());
+                MultiArray<3, FVec> fparallel(labels.shape());
+                boundaryVectorDistance(labels, vserial, active == 1, tag, pixelPitch);
+                boundaryVectorDistance(labels, vparallel, active == 1, tag, pixelPitch, options);
+                boundaryVectorDistance(labels, fparallel, active == 1, tag, pixelPitch, options);
+                should(vparallel == vserial);
+                for(auto i = vserial.begin(); i != vserial.end(); ++i)
+                    should(DVec(fparallel[i.point()]) == *i);
+            }
+        }
+
+        for(int background = 0; background < 2; ++background)
+        {
+            MultiArray<3, Shape3> serial(labels.shape()), parallel(labels.shape());
+            MultiArray<3, TinyVector<float, 3> > fparallel(labels.shape());
+            separableVectorDistance(labels, serial, background == 1, pixelPitch);
+            separableVectorDistance(labels, parallel, background == 1, pixelPitch, options);
+            separableVectorDistance(labels, fparallel, background == 1, pixelPitch, options);
+            should(parallel == serial);
+            for(auto i = serial.begin(); i != serial.end(); ++i)
+                should(Shape3(fparallel[i.point()]) == *i);
+        }
+    }
 };
 
 struct EccentricityTest
@@ -861,11 +950,13 @@ struct DistanceTransformTestSuite
         add( testCase( &MultiDistanceTest::testVectorDistanceBug));
         add( testCase( &MultiDistanceTest::testDistanceAxesPermutation));
         add( testCase( &MultiDistanceTest::testDistanceVolumesAnisotropic));
+        add( testCase( &MultiDistanceTest::testDistanceVolumesParallel));
         add( testCase( &MultiDistanceTest::distanceTransform2DCompare));
         add( testCase( &MultiDistanceTest::distanceTest1D));
         add( testCase( &BoundaryMultiDistanceTest::distanceTest1D));
         add( testCase( &BoundaryMultiDistanceTest::testDistanceVolumes));
         add( testCase( &BoundaryMultiDistanceTest::vectorDistanceTest1D));
+        add( testCase( &BoundaryMultiDistanceTest::testParallel));
         add( testCase( &EccentricityTest::testEccentricityCenters));
         add( testCase( &SkeletonTest::testSkeleton));
         add( testCase( &SkeletonTest::testSkeletonFeatures));
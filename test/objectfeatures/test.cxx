@@ -1492,6 +1492,142 @@ struct AccumulatorTest
     }
 };
 
+struct ParallelFeaturesTest
+{
+    typedef vigra::acc::Select<vigra::acc::DataArg<1>, vigra::acc::LabelArg<2>,
+                               vigra::acc::Count, vigra::acc::Mean, vigra::acc::Variance,
+                               vigra::acc::Skewness, vigra::acc::Minimum, vigra::acc::Maximum,
+                               vigra::acc::RegionCenter, vigra::acc::RegionAnchor,
+                               vigra::acc::Coord<vigra::acc::Range>,
+                               vigra::acc::Coord<vigra::acc::Principal<vigra::acc::Variance> >,
+                               vigra::acc::Global<vigra::acc::Mean>,
+                               vigra::acc::Global<vigra::acc::Count> > Selected;
+    typedef vigra::acc::AccumulatorChainArray<vigra::CoupledArrays<3, double, int>, Selected> A;
+
+    MultiArray<3, double> data;
+    MultiArray<3, int> labels;
+
+    ParallelFeaturesTest()
+    : data(Shape3(21, 19, 23)),
+      labels(data.shape())
+    {
+        for(MultiArrayIndex k=0; k<data.size(); ++k)
+            data[k] = (k*7919) % 1013 / 10.0;
+    }
+
+    void fillLabels(int size)
+    {
+        for(MultiArrayIndex z=0; z<labels.shape(2); ++z)
+            for(MultiArrayIndex y=0; y<labels.shape(1); ++y)
+                for(MultiArrayIndex x=0; x<labels.shape(0); ++x)
+                    labels(x, y, z) = int(x/size + 8*(y/size) + 64*(z/size));
+    }
+
+    void compare(A const & a, A const & b)
+    {
+        using namespace vigra::acc;
+        shouldEqual(a.regionCount(), b.regionCount());
+        shouldEqual(get<Global<Count> >(a), get<Global<Count> >(b));
+        shouldEqualTolerance(get<Global<Mean> >(a), get<Global<Mean> >(b), 1e-10);
+        for(unsigned int k=0; k<a.regionCount(); ++k)
+        {
+            shouldEqual(get<Count>(a, k), get<Count>(b, k));
+            if(get<Count>(a, k) == 0)
+                continue;
+            shouldEqualTolerance(get<Mean>(a, k), get<Mean>(b, k), 1e-10);
+            shouldEqualTolerance(get<Variance>(a, k), get<Variance>(b, k), 1e-8);
+            should(std::abs(get<Skewness>(a, k) - get<Skewness>(b, k)) < 1e-8);
+            shouldEqual(get<Minimum>(a, k), get<Minimum>(b, k));
+            shouldEqual(get<Maximum>(a, k), get<Maximum>(b, k));
+            shouldEqualSequenceTolerance(get<RegionCenter>(a, k).begin(), get<RegionCenter>(a, k).end(),
+                                         get<RegionCenter>(b, k).begin(), 1e-10);
+            shouldEqual(get<RegionAnchor>(a, k), get<RegionAnchor>(b, k));
+            shouldEqual(get<Coord<Range> >(a, k).first, get<Coord<Range> >(b, k).first);
+            shouldEqual(get<Coord<Range> >(a, k).second, get<Coord<Range> >(b, k).second);
+            shouldEqualSequenceTolerance(get<Coord<Principal<Variance> > >(a, k).begin(),
+                                         get<Coord<Principal<Variance> > >(a, k).end(),
+                                         get<Coord<Principal<Variance> > >(b, k).begin(), 1e-8);
+        }
+    }
+
+    void testDense()
+    {
+        fillLabels(11);   // 8 regions
+
+        A serial, parallel;
+        extractFeatures(data, labels, serial);
+        extractFeatures(data, labels, parallel, ParallelOptions().numThreads(4));
+        compare(serial, parallel);
+    }
+
+    void testSparse()
+    {
+        fillLabels(3);    // 448 regions
+
+        A serial, parallel;
+        serial.ignoreLabel(5);
+        parallel.ignoreLabel(5);
+        serial.setCoordinateOffset(Shape3(10, 20, 30));
+        parallel.setCoordinateOffset(Shape3(10, 20, 30));
+        extractFeatures(data, labels, serial);
+        extractFeatures(data, labels, parallel, ParallelOptions().numThreads(4));
+        shouldEqual(get<acc::Count>(parallel, 5), 0);
+        compare(serial, parallel);
+    }
+
+    void testDynamic()
+    {
+        using namespace vigra::acc;
+        fillLabels(3);
+
+        DynamicAccumulatorChainArray<CoupledArrays<3, double, int>,
+                                     Select<DataArg<1>, LabelArg<2>, Count, Minimum, Kurtosis> > serial, parallel;
+        serial.activate<Kurtosis>();
+        parallel.activate<Kurtosis>();
+        extractFeatures(data, labels, serial);
+        extractFeatures(data, labels, parallel, ParallelOptions().numThreads(4));
+
+        should(!parallel.isActive<Minimum>());
+        for(unsigned int k=0; k<serial.regionCount(); ++k)
+        {
+            shouldEqual(get<Count>(serial, k), get<Count>(parallel, k));
+            if(get<Count>(serial, k) > 0)
+                should(std::abs(get<Kurtosis>(serial, k) - get<Kurtosis>(parallel, k)) < 1e-8);
+        }
+    }
+
+    void testFallback()
+    {
+        using namespace vigra::acc;
+        MultiArray<2, double> data2(Shape2(12, 10));
+        MultiArray<2, int> labels2(data2.shape());
+        for(MultiArrayIndex y=0; y<labels2.shape(1); ++y)
+            for(MultiArrayIndex x=0; x<labels2.shape(0); ++x)
+                labels2(x, y) = int(x/4 + 3*(y/4));
+
+        typedef AccumulatorChainArray<CoupledArrays<2, double, int>,
+                                      Select<DataArg<1>, LabelArg<2>, Count, RegionContour> > C;
+        should(!acc_detail::mergeableInPass1(C().next_));
+
+        // the first data value cannot be merged, the first coordinate can
+        typedef AccumulatorChainArray<CoupledArrays<2, double, int>,
+                                      Select<DataArg<1>, LabelArg<2>, FirstSeen> > F;
+        typedef AccumulatorChainArray<CoupledArrays<2, double, int>,
+                                      Select<DataArg<1>, LabelArg<2>, RegionAnchor> > R;
+        should(!acc_detail::mergeableInPass1(F().next_));
+        should(acc_detail::mergeableInPass1(R().next_));
+
+        C serial, parallel;
+        extractFeatures(data2, labels2, serial);
+        extractFeatures(data2, labels2, parallel, ParallelOptions().numThreads(4));
+        for(unsigned int k=0; k<serial.regionCount(); ++k)
+        {
+            shouldEqual(get<Count>(serial, k), get<Count>(parallel, k));
+            shouldEqual(get<RegionContour>(serial, k).size(), get<RegionContour>(parallel, k).size());
+        }
+    }
+};
+
 struct FeaturesTestSuite : public vigra::test_suite
 {
     FeaturesTestSuite()
@@ -1506,6 +1642,11 @@ struct FeaturesTestSuite : public vigra::test_suite
         add(testCase(&AccumulatorTest::testHistogram));
         add(testCase(&AccumulatorTest::testRegionAccumulators));
         add(testCase(&AccumulatorTest::testIndexSpecifiers));
+
+        add(testCase(&ParallelFeaturesTest::testDense));
+        add(testCase(&ParallelFeaturesTest::testSparse));
+        add(testCase(&ParallelFeaturesTest::testDynamic));
+        add(testCase(&ParallelFeaturesTest::testFallback));
     }
 };
 
@@ -0,0 +1,145 @@
+/************************************************************************/
+/*                                                                      */
+/*        Copyright 2014-2015 by Ullrich Koethe and Philip Schill       */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+#include <vigra/unittest.hxx>
+#include <vigra/random_forest_3.hxx>
+#include <vigra/timing.hxx>
+#include <iomanip>
+#include <iostream>
+
+#include "utils.hxx"
+
+using namespace vigra;
+using namespace vigra::rf3;
+
+// Timings of the random forest that are too slow for the unit tests.
+// The corresponding correctness checks on small data are in test.cxx.
+struct RandomForestSpeedTests
+{
+    void test_compiled_forest_speed()
+    {
+        typedef MultiArray<2, float> Features;
+        typedef MultiArray<1, int> Labels;
+
+        Features train_x, test_x;
+        Labels train_y, test_y;
+        randomTrainingData(train_x, train_y, 2000, 8, 3, 3);
+        randomTrainingData(test_x, test_y, 1 << 20, 8, 3, 4);
+
+        RandomForestOptions const options = RandomForestOptions().tree_count(32).n_threads(1);
+        auto rf = random_forest(train_x, train_y, options);
+
+        MultiArray<2, double> ref(Shape2(test_x.shape(0), 3)), probs(ref.shape());
+        USETICTOC;
+
+        TIC;
+        referencePrediction(rf, test_x, ref, allTrees(rf));
+        double t_ref = TOCN;
+
+        TIC;
+        auto compiled = rf.compile();
+        double t_compile = TOCN;
+
+        TIC;
+        compiled.predict_probabilities(test_x, probs);
+        double t_compiled = TOCN;
+        should(probs == ref);
+
+        std::cerr << "    rf3 prediction of " << test_x.shape(0) << " instances, " << rf.num_trees() 
+                  << " trees, " << rf.num_nodes() << " nodes:\n"
+                  << std::fixed << std::setprecision(1)
+                  << "        node graph: " << t_ref << " ms, compiled: " << t_compiled 
+                  << " ms (+ " << t_compile << " ms compilation), speedup " 
+                  << std::setprecision(2) << t_ref / t_compiled << "\n";
+    }
+
+    void test_binned_training_speed()
+    {
+        typedef MultiArray<2, float> Features;
+        typedef MultiArray<1, int> Labels;
+
+        Features train_x, test_x;
+        Labels train_y, test_y;
+        randomTrainingData(train_x, train_y, 1 << 18, 16, 4, 9);
+        randomTrainingData(test_x, test_y, 1 << 16, 16, 4, 10);
+
+        RandomForestOptions const options = RandomForestOptions().tree_count(4).n_threads(1).min_num_instances(20);
+        USETICTOC;
+
+        TIC;
+        auto exact = random_forest(train_x, train_y, options);
+        double t_exact = TOCN;
+
+        TIC;
+        auto binned = random_forest(train_x, train_y, RandomForestOptions(options).max_bins(256));
+        double t_binned = TOCN;
+
+        Labels exact_y(test_y.shape()), binned_y(test_y.shape());
+        exact.predict(test_x, exact_y, 1);
+        binned.predict(test_x, binned_y, 1);
+        int exact_correct = 0, binned_correct = 0;
+        for (int i = 0; i < test_y.size(); ++i)
+        {
+            exact_correct += (exact_y(i) == test_y(i));
+            binned_correct += (binned_y(i) == test_y(i));
+        }
+        should(std::abs(binned_correct - exact_correct) < 0.02 * test_y.size());
+
+        std::cerr << "    rf3 training on " << train_x.shape(0) << " instances, " << train_x.shape(1)
+                  << " features, " << options.tree_count_ << " trees:\n"
+                  << std::fixed << std::setprecision(1)
+                  << "        exact: " << t_exact << " ms (accuracy " << 100.0 * exact_correct / test_y.size()
+                  << "%), 256 bins: " << t_binned << " ms (accuracy " << 100.0 * binned_correct / test_y.size()
+                  << "%), speedup " << std::setprecision(2) << t_exact / t_binned << "\n";
+    }
+};
+
+struct RandomForestSpeedTestSuite : public test_suite
+{
+    RandomForestSpeedTestSuite()
+        :
+        test_suite("RandomForest speed test")
+    {
+        add(testCase(&RandomForestSpeedTests::test_compiled_forest_speed));
+        add(testCase(&RandomForestSpeedTests::test_binned_training_speed));
+    }
+};
+
+int main(int argc, char** argv)
+{
+    RandomForestSpeedTestSuite forest_test;
+    int failed = forest_test.run(testsToBeExecuted(argc, argv));
+    std::cout << forest_test.report() << std::endl;
+    return (failed != 0);
+}
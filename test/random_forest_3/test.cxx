@@ -34,11 +34,16 @@
 /************************************************************************/
 #include <vigra/unittest.hxx>
 #include <vigra/random_forest_3.hxx>
+#include <vigra/random_forest_3_chunked.hxx>
+#include <vigra/random_forest_3_model.hxx>
+#include <cstdio>
 #include <vigra/random.hxx>
 #ifdef HasHDF5
     #include <vigra/random_forest_3_hdf5_impex.hxx>
 #endif
 
+#include "utils.hxx"
+
 using namespace vigra;
 using namespace vigra::rf3;
 
@@ -101,6 +106,92 @@ struct RandomForestTests
         MultiArray<1, int> pred_y(Shape1(8));
         rf.predict(test_x, pred_y, 1);
         shouldEqualSequence(pred_y.begin(), pred_y.end(), test_y.begin());
+
+        // Predict again on the shared default thread pool.
+        pred_y.init(0);
+        rf.predict(test_x, pred_y, ParallelOptions().useDefaultPool());
+        shouldEqualSequence(pred_y.begin(), pred_y.end(), test_y.begin());
+
+        // The compiled forest must give the same probabilities.
+        MultiArray<2, double> probs(Shape2(8, 4)), ref(Shape2(8, 4));
+        referencePrediction(rf, test_x, ref, allTrees(rf));
+        rf.compile().predict_probabilities(test_x, probs);
+        should(probs == ref);
+    }
+
+    void test_compiled_forest()
+    {
+        typedef MultiArray<2, float> Features;
+        typedef MultiArray<1, int> Labels;
+
+        Features train_x, test_x;
+        Labels train_y, test_y;
+        randomTrainingData(train_x, train_y, 500, 6, 4, 1);
+        randomTrainingData(test_x, test_y, 1000, 6, 4, 2);
+
+        RandomForestOptions const options = RandomForestOptions().tree_count(8).n_threads(1);
+        auto rf = random_forest(train_x, train_y, options);
+        typedef decltype(rf) RF;
+
+        RF::Compiled compiled = rf.compile();
+        shouldEqual(compiled.num_trees(), rf.num_trees());
+        shouldEqual(compiled.num_nodes(), rf.num_nodes());
+        shouldEqual(compiled.num_classes(), rf.num_classes());
+        shouldEqual(compiled.num_features(), rf.num_features());
+
+        MultiArray<2, double> ref(Shape2(1000, 4)), probs(Shape2(1000, 4));
+        referencePrediction(rf, test_x, ref, allTrees(rf));
+
+        // all trees, serial and parallel
+        compiled.predict_probabilities(test_x, probs);
+        should(probs == ref);
+        ThreadPool pool(4);
+        probs.init(0.0);
+        compiled.predict_probabilities(test_x, probs, ParallelOptions().threadPool(pool));
+        should(probs == ref);
+
+        // the automatic dispatch in RandomForest
+        probs.init(0.0);
+        rf.predict_probabilities(test_x, probs, ParallelOptions().threadPool(pool));
+        should(probs == ref);
+
+        // a subset of the trees (unsorted and with duplicates, as accepted by RandomForest)
+        std::vector<size_t> trees;
+        trees.push_back(5);
+        trees.push_back(1);
+        trees.push_back(5);
+        trees.push_back(2);
+        std::vector<size_t> sorted_trees;
+        sorted_trees.push_back(1);
+        sorted_trees.push_back(2);
+        sorted_trees.push_back(5);
+        referencePrediction(rf, test_x, ref, sorted_trees);
+        probs.init(0.0);
+        compiled.predict_probabilities(test_x, probs, ParallelOptions(), trees);
+        should(probs == ref);
+
+        // a single instance does not take the compiled path, but gives the same result
+        Features one = test_x.subarray(Shape2(17, 0), Shape2(18, 6));
+        MultiArray<2, double> one_ref(Shape2(1, 4)), one_probs(Shape2(1, 4));
+        referencePrediction(rf, one, one_ref, allTrees(rf));
+        rf.predict_probabilities(one, one_probs, 1);
+        should(one_probs == one_ref);
+        one_probs.init(0.0);
+        compiled.predict_probabilities(one, one_probs);
+        should(one_probs == one_ref);
+
+        try
+        {
+            MultiArray<2, double> wrong(Shape2(1000, 3));
+            compiled.predict_probabilities(test_x, wrong);
+            failTest("CompiledForest::predict_probabilities() failed to throw exception.");
+        }
+        catch(PreconditionViolation & c)
+        {
+            std::string expected("\nPrecondition violation!\nCompiledForest::predict_probabilities(): Number of labels in probabilities differs from training.");
+            std::string message(c.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
     }
 
     void test_default_rf()
@@ -138,6 +229,346 @@ struct RandomForestTests
         }
     }
 
+    void test_feature_bins()
+    {
+        typedef MultiArray<2, float> Features;
+        typedef MultiArray<1, int> Labels;
+
+        Features x;
+        Labels y;
+        randomTrainingData(x, y, 10000, 3, 2, 5);
+        for (int i = 0; i < 10000; ++i)
+            x(i, 2) = (float)(i % 5);
+
+        rf3::detail::FeatureBins<float> bins(x, 64);
+        for (int d = 0; d < 2; ++d)
+        {
+            shouldEqual(bins.num_bins(d), 64);
+            std::vector<int> population(64, 0);
+            for (int i = 0; i < 10000; ++i)
+            {
+                int const b = bins.bins()(i, d);
+                should(bins.bin_min(d)[b] <= x(i, d) && x(i, d) <= bins.bin_max(d)[b]);
+                ++population[b];
+            }
+            for (int b = 0; b < 64; ++b)
+                should(population[b] >= 10000 / 64 - 2 && population[b] <= 10000 / 64 + 2);
+            for (int b = 1; b < 64; ++b)
+                should(bins.bin_max(d)[b-1] < bins.bin_min(d)[b]);
+        }
+
+        // few distinct values: one bin per value
+        shouldEqual(bins.num_bins(2), 5);
+        for (int i = 0; i < 10000; ++i)
+            shouldEqual((int)bins.bins()(i, 2), i % 5);
+    }
+
+    void test_binned_training()
+    {
+        typedef MultiArray<2, float> Features;
+        typedef MultiArray<1, int> Labels;
+
+        // With quantized features, binning is lossless, and the histogram-based 
+        // search must find the same trees as the exact one.
+        Features train_x, test_x;
+        Labels train_y, test_y;
+        randomTrainingData(train_x, train_y, 2000, 5, 3, 6);
+        randomTrainingData(test_x, test_y, 2000, 5, 3, 7);
+        for (auto & v : train_x)
+            v = std::floor(v * 32.0f) / 32.0f;
+
+        std::vector<RandomForestOptionTags> splits;
+        splits.push_back(RF_GINI);
+        splits.push_back(RF_ENTROPY);
+        for (auto split : splits)
+        {
+            RandomForestOptions const options = RandomForestOptions().tree_count(4).split(split).n_threads(1);
+            MersenneTwister exact_engine(42), binned_engine(42);
+            auto exact = random_forest(train_x, train_y, options, RFStopVisiting(), exact_engine);
+            auto binned = random_forest(train_x, train_y, RandomForestOptions(options).max_bins(64), RFStopVisiting(), binned_engine);
+
+            shouldEqual(binned.num_nodes(), exact.num_nodes());
+            for (auto const & p : exact.split_tests_)
+            {
+                shouldEqual(binned.split_tests_.at(p.first).dim_, p.second.dim_);
+                shouldEqual(binned.split_tests_.at(p.first).val_, p.second.val_);
+            }
+            Labels exact_y(test_y.shape()), binned_y(test_y.shape());
+            exact.predict(test_x, exact_y, 1);
+            binned.predict(test_x, binned_y, 1);
+            should(exact_y == binned_y);
+        }
+
+        // With continuous features, the binned forest must be about as good as the exact one.
+        randomTrainingData(train_x, train_y, 5000, 5, 3, 8);
+        RandomForestOptions const options = RandomForestOptions().tree_count(8).n_threads(1);
+        auto exact = random_forest(train_x, train_y, options);
+        auto binned = random_forest(train_x, train_y, RandomForestOptions(options).max_bins(32));
+        Labels exact_y(test_y.shape()), binned_y(test_y.shape());
+        exact.predict(test_x, exact_y, 1);
+        binned.predict(test_x, binned_y, 1);
+        int exact_correct = 0, binned_correct = 0;
+        for (int i = 0; i < test_y.size(); ++i)
+        {
+            exact_correct += (exact_y(i) == test_y(i));
+            binned_correct += (binned_y(i) == test_y(i));
+        }
+        should(binned_correct > 0.8 * test_y.size());
+        should(std::abs(binned_correct - exact_correct) < 0.03 * test_y.size());
+
+        // resampling in the nodes bypasses the histogram cache
+        auto resampled = random_forest(train_x, train_y, RandomForestOptions(options).max_bins(32).resample_count(500));
+        Labels resampled_y(test_y.shape());
+        resampled.predict(test_x, resampled_y, 1);
+        int resampled_correct = 0;
+        for (int i = 0; i < test_y.size(); ++i)
+            resampled_correct += (resampled_y(i) == test_y(i));
+        should(resampled_correct > 0.8 * test_y.size());
+
+        try
+        {
+            RandomForestOptions().max_bins(1000);
+            failTest("RandomForestOptions::max_bins() failed to throw exception.");
+        }
+        catch(PreconditionViolation &)
+        {}
+    }
+
+    void test_chunked_training()
+    {
+        typedef MultiArray<2, float> Features;
+        typedef MultiArray<1, int> Labels;
+
+        Features train_x, test_x;
+        Labels train_y, test_y;
+        randomTrainingData(train_x, train_y, 4000, 5, 3, 11);
+        randomTrainingData(test_x, test_y, 2000, 5, 3, 12);
+
+        ChunkedArrayLazy<2, float> chunked_x(train_x.shape(), Shape2(256, 8));
+        chunked_x.commitSubarray(Shape2(), train_x);
+
+        // Without memory budget, the result equals the in-memory training.
+        RandomForestOptions const options = RandomForestOptions().tree_count(4).n_threads(1);
+        {
+            MersenneTwister engine(17), chunked_engine(17);
+            auto rf = random_forest(train_x, train_y, options, RFStopVisiting(), engine);
+            auto chunked_rf = random_forest_chunked(chunked_x, train_y, options, chunked_engine);
+            shouldEqual(chunked_rf.num_nodes(), rf.num_nodes());
+            Labels pred_y(test_y.shape()), chunked_y(test_y.shape());
+            rf.predict(test_x, pred_y, 1);
+            chunked_rf.predict(test_x, chunked_y, 1);
+            should(pred_y == chunked_y);
+        }
+
+        // With a budget of about 1000 instances, each tree gets its own bag.
+        size_t const budget = 256*5*sizeof(float) + 1000*(5*sizeof(float) + 4*sizeof(size_t) + 2*sizeof(double));
+        std::vector<RandomForestOptions> budget_options;
+        budget_options.push_back(RandomForestOptions(options).tree_count(8).memory_budget(budget));
+        budget_options.push_back(RandomForestOptions(options).tree_count(8).memory_budget(budget).n_threads(3));
+        budget_options.push_back(RandomForestOptions(options).tree_count(8).memory_budget(budget).max_bins(64));
+        for (auto const & opt : budget_options)
+        {
+            auto rf = random_forest_chunked(chunked_x, train_y, opt);
+            shouldEqual(rf.num_trees(), 8);
+            should(rf.problem_spec_.actual_msample_ <= size_t(1000 / std::max(1, opt.n_threads_)));
+            Labels pred_y(test_y.shape());
+            rf.predict(test_x, pred_y, 1);
+            int correct = 0;
+            for (int i = 0; i < test_y.size(); ++i)
+                correct += (pred_y(i) == test_y(i));
+            should(correct > 0.8 * test_y.size());
+        }
+
+        try
+        {
+            random_forest_chunked(chunked_x, train_y, RandomForestOptions(options).memory_budget(1000));
+            failTest("random_forest_chunked() failed to throw exception.");
+        }
+        catch(PreconditionViolation & c)
+        {
+            std::string expected("\nPrecondition violation!\nrandom_forest_chunked(): Memory budget is too small.");
+            std::string message(c.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+
+    void test_half_float()
+    {
+        float values[] = { 0.0f, -0.0f, 1.0f, -2.5f, 0.333251953125f, 65504.0f, 6.103515625e-05f, 5.960464477539063e-08f };
+        for (auto v : values)
+            shouldEqual(rf3::detail::halfToFloat(rf3::detail::floatToHalf(v)), v);
+        shouldEqual(rf3::detail::halfToFloat(rf3::detail::floatToHalf(1.0f + 1.0f/2048.0f)), 1.0f); // ties to even
+        shouldEqual(rf3::detail::halfToFloat(rf3::detail::floatToHalf(1.0f + 3.0f/2048.0f)), 1.0f + 1.0f/512.0f);
+        should(rf3::detail::halfToFloat(rf3::detail::floatToHalf(1e6f)) == std::numeric_limits<float>::infinity());
+        shouldEqual(rf3::detail::halfToFloat(rf3::detail::floatToHalf(0.1f)), 0.0999755859375f);
+    }
+
+    void test_model_file()
+    {
+        typedef MultiArray<2, float> Features;
+        typedef MultiArray<1, int> Labels;
+
+        std::string const filename("rf3_test_model.vrf");
+        Features train_x, test_x;
+        Labels train_y, test_y;
+        randomTrainingData(train_x, train_y, 2000, 5, 3, 13);
+        randomTrainingData(test_x, test_y, 2000, 5, 3, 14);
+        for (auto & v : train_y)
+            v = 10 * v - 3;
+
+        // With quantized features, all representations are lossless.
+        Features quantized_x(train_x);
+        for (auto & v : quantized_x)
+            v = std::floor(v * 32.0f) / 32.0f;
+
+        for (int q = 0; q < 2; ++q)
+        {
+            auto rf = random_forest(q == 0 ? quantized_x : train_x, train_y, RandomForestOptions().tree_count(8).n_threads(1));
+            MultiArray<2, double> ref_probs(Shape2(2000, 3));
+            rf.predict_probabilities(test_x, ref_probs, 1);
+            Labels ref_y(test_y.shape());
+            rf.predict(test_x, ref_y, 1);
+
+            ModelThresholds thresholds[] = { RF_THRESHOLD_FLOAT32, RF_THRESHOLD_FLOAT16, RF_THRESHOLD_UINT8 };
+            for (auto t : thresholds)
+            {
+                random_forest_export_model(rf, filename, t);
+                ForestModel model(filename);
+                shouldEqual(model.num_trees(), rf.num_trees());
+                shouldEqual(model.num_nodes(), rf.num_nodes());
+                shouldEqual(model.num_classes(), 3);
+                shouldEqual(model.num_features(), 5);
+                shouldEqual(model.thresholds(), t);
+
+                MultiArray<2, double> probs(Shape2(2000, 3));
+                model.predict_probabilities(test_x, probs, ParallelOptions().numThreads(2));
+                Labels pred_y(test_y.shape());
+                model.predict(test_x, pred_y);
+                if (q == 0 || t == RF_THRESHOLD_FLOAT32)
+                {
+                    shouldEqualSequenceTolerance(probs.begin(), probs.end(), ref_probs.begin(), 1e-6);
+                    should(pred_y == ref_y);
+                }
+                else
+                {
+                    int agree = 0;
+                    for (int i = 0; i < pred_y.size(); ++i)
+                        agree += (pred_y(i) == ref_y(i));
+                    should(agree > 0.95 * pred_y.size());
+                }
+
+                // conversion back into a RandomForest
+                auto imported = random_forest_import_model<Features, Labels>(filename);
+                shouldEqual(imported.num_nodes(), rf.num_nodes());
+                should(imported.problem_spec_ == rf.problem_spec_);
+                Labels imported_y(test_y.shape());
+                imported.predict(test_x, imported_y, 1);
+                should(imported_y == pred_y);
+            }
+        }
+
+        // file size: 12 or 8 bytes per node, 4 bytes per leaf and class
+        {
+            auto rf = random_forest(train_x, train_y, RandomForestOptions().tree_count(2).n_threads(1));
+            random_forest_export_model(rf, filename, RF_THRESHOLD_FLOAT16);
+            ForestModel model(filename);
+            should(model.file_size() < 1024 + rf.num_nodes() * (8 + 3*4));
+        }
+
+        // not a model file
+        {
+            std::ofstream f(filename.c_str(), std::ios::binary | std::ios::trunc);
+            f << "this is not a forest model file, but it is long enough for the header of one..............................................................................................";
+        }
+        try
+        {
+            ForestModel model(filename);
+            failTest("ForestModel() failed to throw exception.");
+        }
+        catch(PreconditionViolation & c)
+        {
+            std::string expected("\nPrecondition violation!\nForestModel(): not a forest model file.");
+            std::string message(c.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+
+        // truncated and corrupt files
+        {
+            auto rf = random_forest(train_x, train_y, RandomForestOptions().tree_count(2).n_threads(1));
+            random_forest_export_model(rf, filename, RF_THRESHOLD_FLOAT32);
+            std::vector<char> original;
+            {
+                std::ifstream f(filename.c_str(), std::ios::binary);
+                original.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+            }
+            typedef rf3::detail::ModelHeader Header;
+            typedef rf3::detail::ModelNode32 Node;
+            Header const header = *reinterpret_cast<Header const *>(&original[0]);
+            UInt64 const * offsets = reinterpret_cast<UInt64 const *>(&original[header.tree_offsets_pos]);
+            Node const * nodes = reinterpret_cast<Node const *>(&original[header.nodes_pos]);
+            size_t const split = 0;   // the root of the first tree
+            size_t leaf = 0;
+            while (nodes[leaf].child >= 0)
+                ++leaf;
+            should(nodes[split].child >= 0);
+
+            auto check = [&](std::vector<char> const & buffer, std::string const & reason)
+            {
+                {
+                    std::ofstream f(filename.c_str(), std::ios::binary | std::ios::trunc);
+                    f.write(&buffer[0], buffer.size());
+                }
+                try
+                {
+                    ForestModel model(filename);
+                    failTest("ForestModel() failed to throw exception.");
+                }
+                catch(PreconditionViolation & c)
+                {
+                    std::string expected("\nPrecondition violation!\nForestModel(): " + reason);
+                    std::string message(c.what());
+                    should(0 == expected.compare(message.substr(0,expected.size())));
+                }
+            };
+
+            std::vector<char> buffer(original.begin(), original.begin() + original.size() / 2);
+            check(buffer, "file is truncated.");
+
+            // the header is adjusted to the truncated size
+            reinterpret_cast<Header *>(&buffer[0])->file_size = buffer.size();
+            check(buffer, "file is corrupt (section out of range).");
+
+            buffer = original;
+            reinterpret_cast<Header *>(&buffer[0])->num_nodes = UInt64(1) << 60;
+            check(buffer, "file is corrupt (section out of range).");
+
+            buffer = original;
+            reinterpret_cast<Header *>(&buffer[0])->leaves_pos += 8;
+            check(buffer, "file is corrupt (section out of range).");
+
+            buffer = original;
+            reinterpret_cast<UInt64 *>(&buffer[header.tree_offsets_pos])[1] = header.num_nodes + 1;
+            check(buffer, "file is corrupt (invalid tree offsets).");
+
+            buffer = original;
+            reinterpret_cast<Node *>(&buffer[header.nodes_pos])[split].child = (Int32)(offsets[1] - offsets[0]);
+            check(buffer, "file is corrupt (child index out of range).");
+
+            buffer = original;
+            reinterpret_cast<Node *>(&buffer[header.nodes_pos])[split].child = 0;
+            check(buffer, "file is corrupt (child index out of range).");
+
+            buffer = original;
+            reinterpret_cast<Node *>(&buffer[header.nodes_pos])[split].feature = 5;
+            check(buffer, "file is corrupt (feature or threshold out of range).");
+
+            buffer = original;
+            reinterpret_cast<Node *>(&buffer[header.nodes_pos])[leaf].child = ~(Int32)header.num_leaves;
+            check(buffer, "file is corrupt (leaf index out of range).");
+        }
+        std::remove(filename.c_str());
+    }
+
     void test_oob_visitor()
     {
         // Create a (noisy) grid with datapoints and assign classes as in a 4x4 chessboard.
@@ -266,6 +697,12 @@ struct RandomForestTestSuite : public test_suite
     {
         add(testCase(&RandomForestTests::test_base_class));
         add(testCase(&RandomForestTests::test_default_rf));
+        add(testCase(&RandomForestTests::test_compiled_forest));
+        add(testCase(&RandomForestTests::test_feature_bins));
+        add(testCase(&RandomForestTests::test_binned_training));
+        add(testCase(&RandomForestTests::test_chunked_training));
+        add(testCase(&RandomForestTests::test_half_float));
+        add(testCase(&RandomForestTests::test_model_file));
         add(testCase(&RandomForestTests::test_oob_visitor));
         add(testCase(&RandomForestTests::test_var_importance_visitor));
 #ifdef HasHDF5
@@ -0,0 +1,95 @@
+/************************************************************************/
+/*                                                                      */
+/*        Copyright 2014-2015 by Ullrich Koethe and Philip Schill       */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef VIGRA_RANDOM_FOREST_3_TEST_UTILS_HXX
+#define VIGRA_RANDOM_FOREST_3_TEST_UTILS_HXX
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <vigra/multi_array.hxx>
+#include <vigra/random.hxx>
+
+// Per-instance prediction that walks the node graph directly, used as 
+// reference for the compiled forest.
+template <typename RF, typename PROBS>
+void referencePrediction(RF const & rf, typename RF::Features const & features, PROBS & probs,
+                         std::vector<size_t> const & tree_indices)
+{
+    for (vigra::MultiArrayIndex i = 0; i < features.shape()[0]; ++i)
+    {
+        typename RF::ACC acc;
+        std::vector<typename RF::AccInputType> tree_results;
+        auto const sub_features = features.template bind<0>(i);
+        for (auto k : tree_indices)
+        {
+            typename RF::Node node = rf.graph_.getRoot(k);
+            while (rf.graph_.outDegree(node) > 0)
+                node = rf.graph_.getChild(node, rf.split_tests_.at(node)(sub_features));
+            tree_results.push_back(rf.node_responses_.at(node));
+        }
+        auto sub_probs = probs.template bind<0>(i);
+        acc(tree_results.begin(), tree_results.end(), sub_probs.begin());
+    }
+}
+
+template <typename RF>
+std::vector<size_t> allTrees(RF const & rf)
+{
+    std::vector<size_t> trees(rf.num_trees());
+    std::iota(trees.begin(), trees.end(), 0);
+    return trees;
+}
+
+// Random training data with some structure: the label depends on the 
+// first features, the remaining features are noise.
+inline void randomTrainingData(vigra::MultiArray<2, float> & x, vigra::MultiArray<1, int> & y, 
+                               int num_instances, int num_features, int num_classes, vigra::UInt32 seed)
+{
+    vigra::RandomMT19937 random(seed);
+    x.reshape(vigra::Shape2(num_instances, num_features));
+    y.reshape(vigra::Shape1(num_instances));
+    for (int i = 0; i < num_instances; ++i)
+    {
+        for (int j = 0; j < num_features; ++j)
+            x(i, j) = (float)random.uniform();
+        int label = (int)((x(i, 0) + x(i, 1)) * 0.5 * num_classes);
+        if (random.uniform() < 0.1)
+            label = random.uniformInt(num_classes);
+        y(i) = std::min(label, num_classes - 1);
+    }
+}
+
+#endif // VIGRA_RANDOM_FOREST_3_TEST_UTILS_HXX
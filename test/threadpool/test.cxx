@@ -38,6 +38,8 @@
 #include <vigra/threadpool.hxx>
 #include <vigra/timing.hxx>
 #include <numeric>
+#include <algorithm>
+#include <cmath>
 
 using namespace vigra;
 
@@ -70,6 +72,88 @@ struct ThreadPoolTests
         shouldEqualSequence(v.begin(), v.end(), v_expected.begin());
     }
 
+    void test_threadpool_work_stealing()
+    {
+        size_t const n = 10000;
+        std::vector<int> v(n);
+        ThreadPool pool(ParallelOptions().numThreads(4).workStealing());
+        should(pool.workStealing());
+        for (size_t i = 0; i < v.size(); ++i)
+        {
+            pool.enqueue(
+                [&v, i](size_t /*thread_id*/)
+                {
+                    v[i] = 0;
+                    for (size_t k = 0; k < i+1; ++k)
+                    {
+                        v[i] += k;
+                    }
+                }
+            );
+        }
+        pool.waitFinished();
+
+        std::vector<int> v_expected(n);
+        for (size_t i = 0; i < v_expected.size(); ++i)
+            v_expected[i] = i*(i+1)/2;
+
+        shouldEqualSequence(v.begin(), v.end(), v_expected.begin());
+    }
+
+    void test_threadpool_work_stealing_nested()
+    {
+        // tasks enqueued from within a worker go to that worker's own deque
+        size_t const n = 100, m = 100;
+        std::vector<int> v(n*m, 0);
+        ThreadPool pool(ParallelOptions().numThreads(4).workStealing());
+        for (size_t i = 0; i < n; ++i)
+        {
+            pool.enqueue(
+                [&v, &pool, i, m](size_t /*thread_id*/)
+                {
+                    for (size_t k = 0; k < m; ++k)
+                        pool.enqueue(
+                            [&v, i, k, m](size_t /*thread_id*/)
+                            {
+                                v[i*m+k] = int(i*m+k);
+                            }
+                        );
+                }
+            );
+        }
+        pool.waitFinished();
+
+        std::vector<int> v_expected(n*m);
+        std::iota(v_expected.begin(), v_expected.end(), 0);
+        shouldEqualSequence(v.begin(), v.end(), v_expected.begin());
+    }
+
+    void test_threadpool_run_pending_task()
+    {
+        // a waiting worker only executes pending tasks of the requested group
+        ThreadPool pool(ParallelOptions().numThreads(1).workStealing());
+        int ungrouped = 0, grouped = 0, ungrouped_while_waiting = -1;
+        bool ran_grouped = false, ran_other = true, ran_outside = pool.runPendingTask(&grouped);
+        pool.enqueue(
+            [&](size_t /*thread_id*/)
+            {
+                pool.enqueue([&ungrouped](size_t /*thread_id*/) { ++ungrouped; });
+                pool.enqueue([&grouped](size_t /*thread_id*/) { ++grouped; }, &grouped);
+                ran_grouped = pool.runPendingTask(&grouped);
+                ran_other = pool.runPendingTask(&grouped) || pool.runPendingTask(&ran_other);
+                ungrouped_while_waiting = ungrouped;
+            }
+        ).get();
+        pool.waitFinished();
+
+        should(!ran_outside);
+        should(ran_grouped);
+        should(!ran_other);
+        shouldEqual(ungrouped_while_waiting, 0);
+        shouldEqual(grouped, 1);
+        shouldEqual(ungrouped, 1);
+    }
+
     void test_threadpool_exception()
     {
         bool caught = false;
@@ -150,6 +234,178 @@ struct ThreadPoolTests
         should(caught);
     }
 
+    void test_parallel_foreach_work_stealing()
+    {
+        size_t const n_threads = 4;
+        size_t const n = 10000;
+        std::vector<int> v_in(n);
+        std::iota(v_in.begin(), v_in.end(), 0);
+        std::vector<int> v_out(n, 0);
+        std::vector<size_t> results(n_threads, 0);
+        parallel_foreach(ParallelOptions().numThreads(n_threads).workStealing(),
+            v_in.begin(), v_in.end(),
+            [&v_out, &results](size_t thread_id, int x)
+            {
+                v_out[x] += x*(x+1)/2;
+                results[thread_id] += x;
+            }
+        );
+
+        std::vector<int> v_expected(n);
+        for (size_t i = 0; i < v_expected.size(); ++i)
+            v_expected[i] = i*(i+1)/2;
+
+        shouldEqualSequence(v_out.begin(), v_out.end(), v_expected.begin());
+        size_t const sum = std::accumulate(results.begin(), results.end(), (size_t)0);
+        shouldEqual(sum, (n*(n-1))/2);
+
+        // also check the degenerate cases of fewer items than threads
+        for (size_t k = 0; k < 4; ++k)
+        {
+            std::vector<int> w(k, 0);
+            parallel_foreach(ParallelOptions().numThreads(n_threads).workStealing(), k,
+                [&w](size_t /*thread_id*/, size_t i)
+                {
+                    ++w[i];
+                }
+            );
+            shouldEqual(std::count(w.begin(), w.end(), 1), (std::ptrdiff_t)k);
+        }
+    }
+
+    void test_parallel_foreach_work_stealing_exception()
+    {
+        size_t const n = 10000;
+        bool caught = false;
+        std::string exception_string = "the test exception";
+        try
+        {
+            parallel_foreach(ParallelOptions().numThreads(4).workStealing(), n,
+                [&exception_string](size_t /*thread_id*/, size_t x)
+                {
+                    if (x == 5000)
+                        throw std::runtime_error(exception_string);
+                }
+            );
+        }
+        catch (std::runtime_error & ex)
+        {
+            if (ex.what() == exception_string)
+                caught = true;
+        }
+        should(caught);
+    }
+
+    void test_parallel_foreach_default_pool()
+    {
+        ParallelOptions opt = ParallelOptions().useDefaultPool();
+        should(opt.getThreadPool() == &ThreadPool::defaultPool());
+        shouldEqual(opt.getNumThreads(), (int)ThreadPool::defaultPool().nThreads());
+        should(ThreadPool::defaultPool().workStealing() || ThreadPool::defaultPool().nThreads() == 0);
+
+        size_t const n = 2000;
+        for (int k = 0; k < 10; ++k)
+        {
+            // repeated calls reuse the same workers
+            std::vector<size_t> results(opt.getActualNumThreads(), 0);
+            parallel_foreach(opt, n,
+                [&results](size_t thread_id, size_t x)
+                {
+                    results[thread_id] += x;
+                }
+            );
+            size_t const sum = std::accumulate(results.begin(), results.end(), (size_t)0);
+            shouldEqual(sum, (n*(n-1))/2);
+        }
+
+        // numThreads() switches back to a private pool
+        opt.numThreads(2);
+        should(opt.getThreadPool() == 0);
+        shouldEqual(opt.getNumThreads(), 2);
+
+        ThreadPool pool(3);
+        opt.threadPool(pool);
+        should(opt.getThreadPool() == &pool);
+        shouldEqual(opt.getNumThreads(), 3);
+    }
+
+    void test_parallel_foreach_nested()
+    {
+        size_t const n = 50, m = 200;
+        std::vector<ParallelOptions> options;
+        ThreadPool shared_pool(4), stealing_pool(ParallelOptions().numThreads(4).workStealing());
+        options.push_back(ParallelOptions().threadPool(shared_pool));
+        options.push_back(ParallelOptions().threadPool(stealing_pool));
+        options.push_back(ParallelOptions().useDefaultPool());
+        options.push_back(ParallelOptions().numThreads(4));
+
+        for (auto const & opt : options)
+        {
+            std::vector<size_t> v(n*m, 0);
+            std::vector<size_t> results(opt.getActualNumThreads(), 0);
+            parallel_foreach(opt, n,
+                [&](size_t /*thread_id*/, size_t i)
+                {
+                    // nested calls with the same options run cooperatively or inline
+                    parallel_foreach(opt, m,
+                        [&](size_t thread_id, size_t k)
+                        {
+                            v[i*m+k] = i*m+k;
+                            results[thread_id] += 1;
+                        }
+                    );
+                }
+            );
+            std::vector<size_t> v_expected(n*m);
+            std::iota(v_expected.begin(), v_expected.end(), 0);
+            shouldEqualSequence(v.begin(), v.end(), v_expected.begin());
+            shouldEqual(std::accumulate(results.begin(), results.end(), (size_t)0), n*m);
+        }
+
+        // a worker waiting for a nested call only helps with the nested call's own items,
+        // so that an outer item's per-thread state is never re-entered by another outer item
+        {
+            ThreadPool pool(ParallelOptions().numThreads(4).workStealing());
+            std::vector<int> active(pool.nThreads(), 0);
+            threading::atomic<int> reentered(0);
+            parallel_foreach(pool, 32,
+                [&](size_t thread_id, size_t /*i*/)
+                {
+                    if(active[thread_id]++ != 0)
+                        ++reentered;
+                    parallel_foreach(pool, 8,
+                        [](size_t /*thread_id*/, size_t /*k*/)
+                        {
+                            // give the other workers a chance to steal
+                            for(int j = 0; j < 100; ++j)
+                                threading::this_thread::yield();
+                        }
+                    );
+                    --active[thread_id];
+                }
+            );
+            shouldEqual(reentered.load(), 0);
+        }
+
+        // nested calls that would create a new pool run in the calling thread
+        std::vector<int> same_thread(n, 0);
+        parallel_foreach(4, n,
+            [&same_thread](size_t /*thread_id*/, size_t i)
+            {
+                threading::thread::id outer = threading::this_thread::get_id();
+                bool same = true;
+                parallel_foreach(4, 10,
+                    [&same, outer](size_t thread_id, size_t /*k*/)
+                    {
+                        same = same && thread_id == 0 && threading::this_thread::get_id() == outer;
+                    }
+                );
+                same_thread[i] = same ? 1 : 0;
+            }
+        );
+        shouldEqual(std::count(same_thread.begin(), same_thread.end(), 1), (std::ptrdiff_t)n);
+    }
+
     void test_parallel_foreach_sum()
     {
         size_t const n_threads = 4;
@@ -231,6 +487,46 @@ struct ThreadPoolTests
         size_t const sum = std::accumulate(results.begin(), results.end(), 0);
         shouldEqual(sum, n);
     }
+
+    void test_parallel_foreach_skewed_timing()
+    {
+        // benchmark: the cost of an item grows cubically with its index, so that
+        // a static partition of the range leaves most workers idle at the end
+        size_t const n_threads = 4;
+        size_t const n = 400;
+        std::vector<double> out_shared(n), out_stealing(n);
+
+        auto work = [](size_t x)
+        {
+            double s = 0.0;
+            size_t const count = x*x*x / 256;
+            for (size_t k = 0; k < count; ++k)
+                s += std::sqrt((double)k);
+            return s;
+        };
+
+        USETICTOC;
+
+        TIC;
+        parallel_foreach(ParallelOptions().numThreads(n_threads), n,
+            [&](size_t /*thread_id*/, size_t x)
+            {
+                out_shared[x] = work(x);
+            }
+        );
+        std::cout << "parallel_foreach with skewed workload (shared queue) took " << TOCS << std::endl;
+
+        TIC;
+        parallel_foreach(ParallelOptions().numThreads(n_threads).workStealing(), n,
+            [&](size_t /*thread_id*/, size_t x)
+            {
+                out_stealing[x] = work(x);
+            }
+        );
+        std::cout << "parallel_foreach with skewed workload (work-stealing) took " << TOCS << std::endl;
+
+        shouldEqualSequence(out_shared.begin(), out_shared.end(), out_stealing.begin());
+    }
 };
 
 struct ThreadPoolTestSuite : public test_suite
@@ -246,9 +542,17 @@ struct ThreadPoolTestSuite : public test_suite
         add(testCase(&ThreadPoolTests::test_parallel_foreach_sum_serial));
 #if !defined(USE_BOOST_THREAD) || \
     defined(BOOST_THREAD_PROVIDES_VARIADIC_THREAD)
+        add(testCase(&ThreadPoolTests::test_threadpool_work_stealing));
+        add(testCase(&ThreadPoolTests::test_threadpool_work_stealing_nested));
+        add(testCase(&ThreadPoolTests::test_threadpool_run_pending_task));
+        add(testCase(&ThreadPoolTests::test_parallel_foreach_work_stealing));
+        add(testCase(&ThreadPoolTests::test_parallel_foreach_work_stealing_exception));
+        add(testCase(&ThreadPoolTests::test_parallel_foreach_default_pool));
+        add(testCase(&ThreadPoolTests::test_parallel_foreach_nested));
         add(testCase(&ThreadPoolTests::test_parallel_foreach_sum));
         add(testCase(&ThreadPoolTests::test_parallel_foreach_sum_auto));
         add(testCase(&ThreadPoolTests::test_parallel_foreach_timing));
+        add(testCase(&ThreadPoolTests::test_parallel_foreach_skewed_timing));
 #endif
     }
 };
@@ -38,6 +38,7 @@
 #include <iterator>
 #include <algorithm>
 #include <queue>
+#include <cmath>
 #include <set>
 
 #include "vigra/unittest.hxx"
@@ -403,6 +404,84 @@ struct BucketQueueTest
         shouldEqual(0u, bqueue.size());
         shouldEqual(true, bqueue.empty());
     }
+
+    // Use the queue like a watershed: new priorities are never smaller than the last top
+    // priority. The reference is a heap which resolves ties by insertion order.
+    template <class T>
+    void checkRadixHeap(T start, T max_step)
+    {
+        typedef std::pair<T, int> Entry;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > reference;
+        RadixHeap<int, T> queue;
+        int count = 0;
+        std::srand(42);
+
+        for(int k = 0; k < 20; ++k, ++count)
+        {
+            T p = start + (T)(std::rand() % 8) * max_step;
+            reference.push(Entry(p, count));
+            queue.push(count, p);
+        }
+        while(!reference.empty())
+        {
+            shouldEqual(queue.size(), reference.size());
+            should(queue.topPriority() == reference.top().first);
+            shouldEqual(queue.top(), reference.top().second);
+            T p = queue.topPriority();
+            queue.pop();
+            reference.pop();
+
+            // create many ties
+            int new_elements = count < 5000 ? std::rand() % 3 : 0;
+            for(int k = 0; k < new_elements; ++k, ++count)
+            {
+                T q = p + (T)(std::rand() % 4) * max_step;
+                reference.push(Entry(q, count));
+                queue.push(count, q);
+            }
+        }
+        should(queue.empty());
+
+        // an empty queue accepts arbitrary priorities again
+        queue.push(1, start);
+        shouldEqual(queue.top(), 1);
+        queue.pop();
+    }
+
+    void testRadixHeap()
+    {
+        checkRadixHeap<UInt8>(0, 1);
+        checkRadixHeap<UInt16>(100, 3);
+        checkRadixHeap<int>(-1000, 7);
+        checkRadixHeap<Int64>(-(Int64(1) << 40), Int64(1) << 30);
+        checkRadixHeap<UInt64>(1, UInt64(1) << 50);
+        checkRadixHeap<float>(-1.5f, 0.25f);
+        checkRadixHeap<double>(-1e10, 1e9);
+
+        // negative and positive zero are the same priority
+        RadixHeap<int, float> queue;
+        queue.push(0, 0.0f);
+        queue.push(1, -0.0f);
+        queue.push(2, -1.0f);
+        shouldEqual(queue.top(), 2);
+        queue.pop();
+        shouldEqual(queue.top(), 0);
+        queue.pop();
+        shouldEqual(queue.top(), 1);
+        should(queue.topPriority() == 0.0f);
+
+        try
+        {
+            queue.push(3, -0.5f);
+            failTest("no exception thrown");
+        }
+        catch(PreconditionViolation & e)
+        {
+            std::string expected("\nPrecondition violation!\nRadixHeap::push(): priority must not be smaller than the current top priority."),
+                        message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
 };
 
 
@@ -1265,6 +1344,97 @@ struct CompressionTest
         shouldEqualSequence(data.begin(), data.end(), decompressed.begin());
     }
 
+    void testZSTD()
+    {
+        ArrayVector<char> compressed;
+    #ifdef HasZSTD
+        compress(data.begin(), data.size(), compressed, ZSTD);
+
+        should(compressed.size() < data.size() / 100);
+
+        ArrayVector<char> decompressed(data.size());
+
+        uncompress(compressed.begin(), compressed.size(),
+                   decompressed.begin(), decompressed.size(), ZSTD);
+
+        shouldEqualSequence(data.begin(), data.end(), decompressed.begin());
+
+        compress(data.begin(), data.size(), compressed, zstdCompression(12));
+        std::fill(decompressed.begin(), decompressed.end(), 0);
+        uncompress(compressed.begin(), compressed.size(),
+                   decompressed.begin(), decompressed.size(), zstdCompression(12));
+        shouldEqualSequence(data.begin(), data.end(), decompressed.begin());
+    #else
+        try
+        {
+            compress(data.begin(), data.size(), compressed, ZSTD);
+            failTest("missing ZSTD did not throw exception.");
+        }
+        catch(ContractViolation & c)
+        {
+            std::string expected("\nPrecondition violation!\ncompress(): VIGRA was compiled without ZSTD compression.");
+            std::string message(c.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    #endif
+        shouldEqual(zstdCompression(1), ZSTD_FAST);
+        shouldEqual(zstdCompression(3), ZSTD);
+        shouldEqual(zstdCompression(19), ZSTD_BEST);
+        try
+        {
+            zstdCompression(23);
+            failTest("zstdCompression(23) did not throw exception.");
+        }
+        catch(ContractViolation &)
+        {}
+    }
+
+    void testShuffle()
+    {
+        // smooth 16-bit and float signals, where shuffling pays off
+        ArrayVector<UInt16> words(100003);
+        ArrayVector<float> floats(100003);
+        for(unsigned int k = 0; k < words.size(); ++k)
+        {
+            words[k] = UInt16(20000.0 + 10000.0*std::sin(k / 1000.0));
+            floats[k] = float(std::sin(k / 1000.0));
+        }
+
+        CompressionMethod methods[] = { SHUFFLE_LZ4, BITSHUFFLE_LZ4 };
+        for(int m = 0; m < 2; ++m)
+        {
+            ArrayVector<char> plain, shuffled;
+            compress((char const *)words.data(), words.size()*2, plain, LZ4);
+            compress((char const *)words.data(), words.size()*2, shuffled, methods[m], 2);
+            should(shuffled.size() < plain.size());
+
+            ArrayVector<UInt16> words_back(words.size());
+            uncompress(shuffled.begin(), shuffled.size(),
+                       (char *)words_back.data(), words.size()*2, methods[m], 2);
+            shouldEqualSequence(words.begin(), words.end(), words_back.begin());
+
+            compress((char const *)floats.data(), floats.size()*4, plain, LZ4);
+            compress((char const *)floats.data(), floats.size()*4, shuffled, methods[m], 4);
+            should(shuffled.size() < plain.size());
+
+            ArrayVector<float> floats_back(floats.size());
+            uncompress(shuffled.begin(), shuffled.size(),
+                       (char *)floats_back.data(), floats.size()*4, methods[m], 4);
+            shouldEqualSequence(floats.begin(), floats.end(), floats_back.begin());
+
+            // odd type sizes and buffers that are not a multiple of the type size
+            std::size_t typesizes[] = { 1, 3, 8, 12 };
+            for(int t = 0; t < 4; ++t)
+            {
+                compress(data.begin(), data.size() - 5, shuffled, methods[m], typesizes[t]);
+                ArrayVector<char> decompressed(data.size() - 5);
+                uncompress(shuffled.begin(), shuffled.size(),
+                           decompressed.begin(), decompressed.size(), methods[m], typesizes[t]);
+                shouldEqualSequence(decompressed.begin(), decompressed.end(), data.begin());
+            }
+        }
+    }
+
     void testNoCompression()
     {
         ArrayVector<char> compressed;
@@ -1534,6 +1704,7 @@ struct UtilitiesTestSuite
         add( testCase( &BucketQueueTest::testAscending));
         add( testCase( &BucketQueueTest::testDescendingMapped));
         add( testCase( &BucketQueueTest::testAscendingMapped));
+        add( testCase( &BucketQueueTest::testRadixHeap));
         add( testCase( &ChangeablePriorityQueueTest::testMinQueue));
         add( testCase( &ChangeablePriorityQueueTest::testMaxQueue));
         add( testCase( &SizedIntTest::testSizedInt));
@@ -1544,6 +1715,8 @@ struct UtilitiesTestSuite
         add( testCase( &stringTest));
         add( testCase( &CompressionTest::testZLIB));
         add( testCase( &CompressionTest::testLZ4));
+        add( testCase( &CompressionTest::testZSTD));
+        add( testCase( &CompressionTest::testShuffle));
         add( testCase( &CompressionTest::testNoCompression));
 
         add( testCase( &AnyTest::test));
@@ -0,0 +1,118 @@
+/************************************************************************/
+/*                                                                      */
+/*     Copyright 2006-2007 by F. Heinrich, B. Seppke, Ullrich Koethe    */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */                
+/*                                                                      */
+/************************************************************************/
+
+
+#include <iostream>
+#include <functional>
+#include <iomanip>
+#include "vigra/unittest.hxx"
+
+#include "vigra/multi_labeling.hxx"
+#include "vigra/blockwise_labeling.hxx"
+#include "vigra/random.hxx"
+#include "vigra/timing.hxx"
+
+using namespace vigra;
+
+struct LabelingSpeedTest
+{
+    template <unsigned int N>
+    void labelingSpeed(typename MultiArrayShape<N>::type const & shape, double foreground)
+    {
+        // random binary data (small foreground fractions give many tiny components)
+        MultiArray<N, UInt8> data(shape);
+        RandomMT19937 random(42);
+        for(auto i = data.begin(); i != data.end(); ++i)
+            *i = random.uniform() < foreground ? 1 : 0;
+        MultiArray<N, UInt32> res(shape), ref(shape);
+        GridGraph<N, undirected_tag> graph(shape, IndirectNeighborhood);
+        USETICTOC;
+
+        TIC;
+        UInt32 count = lemon_graph::labelGraphWithBackground(graph, data, ref, UInt8(0), std::equal_to<UInt8>());
+        double t_graph = TOCN;
+
+        TIC;
+        shouldEqual(labelMultiArrayWithBackground(data, res, IndirectNeighborhood, UInt8(0)), count);
+        double t_runs = TOCN;
+        should(res == ref);
+
+        BlockwiseLabelOptions options;
+        options.neighborhood(IndirectNeighborhood).ignoreBackgroundValue(UInt8(0));
+        TIC;
+        shouldEqual(labelMultiArrayParallel(data, res, options), count);
+        double t_parallel = TOCN;
+        should(res == ref);
+
+        double megabytes = data.size() / 1048576.0;
+        std::cerr << "    labeling " << shape << ", " << int(foreground * 100.0) << "% foreground ("
+                  << count << " components):\n"
+                  << std::fixed << std::setprecision(1)
+                  << "        graph: " << megabytes / t_graph * 1000.0 << " MB/s, runs: "
+                  << megabytes / t_runs * 1000.0 << " MB/s, speedup "
+                  << std::setprecision(2) << t_graph / t_runs << "\n"
+                  << std::setprecision(1)
+                  << "        parallel (" << options.getActualNumThreads() << " threads): "
+                  << megabytes / t_parallel * 1000.0 << " MB/s\n";
+    }
+
+    void labelingRunsSpeedTest()
+    {
+        labelingSpeed<2>(Shape2(2048, 2048), 0.1);
+        labelingSpeed<2>(Shape2(2048, 2048), 0.5);
+        labelingSpeed<3>(Shape3(160, 160, 160), 0.1);
+        labelingSpeed<3>(Shape3(160, 160, 160), 0.5);
+    }
+};
+
+struct LabelingSpeedTestSuite
+: public vigra::test_suite
+{
+    LabelingSpeedTestSuite()
+    : vigra::test_suite("LabelingSpeedTestSuite")
+    {
+        add( testCase( &LabelingSpeedTest::labelingRunsSpeedTest));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    LabelingSpeedTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+    return (failed != 0);
+}
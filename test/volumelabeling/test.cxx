@@ -40,6 +40,8 @@
 
 #include "vigra/labelvolume.hxx"
 #include "vigra/multi_labeling.hxx"
+#include "vigra/blockwise_labeling.hxx"
+#include "vigra/random.hxx"
 
 using namespace vigra;
 
@@ -457,6 +459,118 @@ struct VolumeLabelingTest
         shouldEqualSequence(res.begin(), res.end(), out6);
     }
 
+    template <unsigned int N, class T>
+    void fillRandom(MultiArrayView<N, T> data, int values, UInt32 seed)
+    {
+        RandomMT19937 random(seed);
+        for(auto i = data.begin(); i != data.end(); ++i)
+            *i = (T)random.uniformInt(values);
+    }
+
+    // the run-based algorithm must reproduce the labels of the graph-based one exactly
+    template <unsigned int N, class T, class S>
+    void checkRunLabeling(MultiArrayView<N, T, S> const & data)
+    {
+        MultiArray<N, UInt32> res(data.shape()), ref(data.shape());
+        NeighborhoodType neighborhoods[] = { DirectNeighborhood, IndirectNeighborhood };
+        for(NeighborhoodType neighborhood : neighborhoods)
+        {
+            GridGraph<N, undirected_tag> graph(data.shape(), neighborhood);
+
+            UInt32 count = lemon_graph::labelGraph(graph, data, ref, std::equal_to<T>());
+            shouldEqual(labelMultiArray(data, res, neighborhood), count);
+            should(res == ref);
+
+            count = lemon_graph::labelGraphWithBackground(graph, data, ref, T(1), std::equal_to<T>());
+            shouldEqual(labelMultiArrayWithBackground(data, res, neighborhood, T(1)), count);
+            should(res == ref);
+        }
+    }
+
+    void labelingRunsTest()
+    {
+        MultiArray<2, UInt8> image(Shape2(97, 61));
+        MultiArray<3, UInt8> volume(Shape3(23, 17, 11));
+        MultiArray<3, UInt32> volume32(Shape3(31, 7, 13));
+
+        for(int values = 2; values <= 3; ++values)
+        {
+            fillRandom<2>(image, values, values);
+            fillRandom<3>(volume, values, values + 10);
+            fillRandom<3>(volume32, values, values + 20);
+
+            checkRunLabeling(image);
+            checkRunLabeling(image.transpose());
+            checkRunLabeling(image.subarray(Shape2(3, 2), Shape2(90, 50)));
+            checkRunLabeling(volume);
+            checkRunLabeling(volume.transpose());
+            checkRunLabeling(volume.bindAt(1, 5));
+            checkRunLabeling(volume32);
+        }
+
+        // degenerate shapes
+        MultiArray<2, UInt8> line(Shape2(1, 50)), column(Shape2(50, 1));
+        fillRandom<2>(line, 2, 3);
+        fillRandom<2>(column, 2, 4);
+        checkRunLabeling(line);
+        checkRunLabeling(column);
+    }
+
+    // the parallel algorithm must reproduce the labels of labelMultiArray() exactly
+    template <unsigned int N, class T, class S>
+    void checkParallelLabeling(MultiArrayView<N, T, S> const & data, int threads)
+    {
+        MultiArray<N, UInt32> res(data.shape()), ref(data.shape());
+        NeighborhoodType neighborhoods[] = { DirectNeighborhood, IndirectNeighborhood };
+        for(NeighborhoodType neighborhood : neighborhoods)
+        {
+            BlockwiseLabelOptions options;
+            options.neighborhood(neighborhood).numThreads(threads);
+
+            UInt32 count = labelMultiArray(data, ref, neighborhood);
+            shouldEqual(labelMultiArrayParallel(data, res, options), count);
+            should(res == ref);
+
+            count = labelMultiArrayWithBackground(data, ref, neighborhood, T(1));
+            shouldEqual(labelMultiArrayParallel(data, res, options.ignoreBackgroundValue(T(1))), count);
+            should(res == ref);
+        }
+    }
+
+    void labelingParallelTest()
+    {
+        MultiArray<2, UInt8> image(Shape2(97, 61));
+        MultiArray<3, UInt8> volume(Shape3(23, 17, 11));
+        MultiArray<4, UInt32> volume4(Shape4(9, 7, 5, 6));
+
+        for(int values = 2; values <= 3; ++values)
+        {
+            fillRandom<2>(image, values, values);
+            fillRandom<3>(volume, values, values + 10);
+            fillRandom<4>(volume4, values, values + 20);
+
+            for(int threads = 1; threads <= 4; threads += 3)
+            {
+                checkParallelLabeling(image, threads);
+                checkParallelLabeling(image.transpose(), threads);
+                checkParallelLabeling(volume, threads);
+                checkParallelLabeling(volume.transpose(), threads);
+                checkParallelLabeling(volume.subarray(Shape3(1, 2, 0), Shape3(20, 15, 9)), threads);
+                checkParallelLabeling(volume4, threads);
+            }
+        }
+
+        // a single large component crossing all slabs
+        MultiArray<3, UInt8> spiral(Shape3(16, 16, 40));
+        for(int z = 0; z < spiral.shape(2); ++z)
+            spiral(z % 16, (z / 16) % 16, z) = 1;
+        checkParallelLabeling(spiral, 4);
+
+        MultiArray<1, UInt8> line(Shape1(50));
+        fillRandom<1>(line, 2, 5);
+        checkParallelLabeling(line, 4);
+    }
+
     IntVolume vol1, vol2, vol3;
     DoubleVolume vol4, vol5, vol6;
 };
@@ -479,6 +593,8 @@ struct VolumeLabelingTestSuite
         add( testCase( &VolumeLabelingTest::labelingTwentySixTest3));
         add( testCase( &VolumeLabelingTest::labelingTwentySixWithBackgroundTest1));
         add( testCase( &VolumeLabelingTest::labelingAllTest));
+        add( testCase( &VolumeLabelingTest::labelingRunsTest));
+        add( testCase( &VolumeLabelingTest::labelingParallelTest));
     }
 };
 
@@ -0,0 +1,123 @@
+/************************************************************************/
+/*                                                                      */
+/*       Copyright 2004 by F. Heinrich, B. Seppke, Ullrich Koethe       */
+/*                                                                      */
+/*    This file is part of the VIGRA computer vision library.           */
+/*    The VIGRA Website is                                              */
+/*        http://hci.iwr.uni-heidelberg.de/vigra/                       */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include "vigra/unittest.hxx"
+#include "vigra/multi_array.hxx"
+#include "vigra/multi_watersheds.hxx"
+#include "vigra/random.hxx"
+#include "vigra/timing.hxx"
+
+using namespace vigra;
+
+struct WatershedQueueTest
+{
+    // compare the RadixHeap with PriorityQueue, which is a BucketQueue for 8- and 16-bit costs
+    template <class T>
+    void watershedSpeed(const char * name, double range)
+    {
+        Shape3 shape(128);
+        MultiArray<3, T> data(shape);
+        MultiArray<3, UInt32> seeds(shape);
+        RandomMT19937 random(42);
+        for(auto i = createCoupledIterator(data); i != i.getEndIterator(); ++i)
+        {
+            Shape3 p = i.point();
+            double v = 3.0 + std::sin(p[0] / 5.0) + std::sin(p[1] / 7.0) + std::sin(p[2] / 3.0) + random.uniform();
+            i.template get<1>() = T(v / 7.0 * range);
+        }
+        UInt32 label = 0;
+        for(int z = 4; z < shape[2]; z += 16)
+            for(int y = 4; y < shape[1]; y += 16)
+                for(int x = 4; x < shape[0]; x += 16)
+                    seeds(x, y, z) = ++label;
+
+        GridGraph<3, undirected_tag> graph(shape, DirectNeighborhood);
+        WatershedOptions options;
+        MultiArray<3, UInt32> radix_labels(seeds), queue_labels(seeds);
+        USETICTOC;
+
+        TIC;
+        RadixHeap<GridGraph<3, undirected_tag>::Node, T> radix_heap;
+        lemon_graph::graph_detail::seededWatersheds(graph, data, radix_labels, options, radix_heap);
+        double t_radix = TOCN;
+
+        TIC;
+        PriorityQueue<GridGraph<3, undirected_tag>::Node, T, true> queue;
+        lemon_graph::graph_detail::seededWatersheds(graph, data, queue_labels, options, queue);
+        double t_queue = TOCN;
+
+        should(radix_labels.all());
+        should(queue_labels.all());
+        if(std::is_integral<T>::value)
+            should(radix_labels == queue_labels); // both queues are first-in first-out on ties
+
+        std::cerr << "    seeded watersheds on " << shape << " " << name << " volume:\n"
+                  << std::fixed << std::setprecision(1)
+                  << "        PriorityQueue: " << t_queue << " ms, RadixHeap: " << t_radix << " ms, speedup "
+                  << std::setprecision(2) << t_queue / t_radix << "\n";
+    }
+
+    void testWatershedQueueSpeed()
+    {
+        watershedSpeed<UInt8>("uint8", 255.0);
+        watershedSpeed<UInt16>("uint16", 65535.0);
+        watershedSpeed<Int32>("int32", 1e6);
+        watershedSpeed<float>("float", 1.0);
+    }
+};
+
+struct WatershedQueueSpeedTestSuite
+: public test_suite
+{
+    WatershedQueueSpeedTestSuite()
+    : test_suite("WatershedQueueSpeedTestSuite")
+    {
+        add( testCase( &WatershedQueueTest::testWatershedQueueSpeed));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    WatershedQueueSpeedTestSuite test;
+
+    int failed = test.run(testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+    return (failed != 0);
+}
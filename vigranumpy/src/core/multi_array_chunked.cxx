@@ -939,12 +939,24 @@ void defineChunkedArray()
          "   ``Compression.ZLIB_NONE:``\n      ZLIB no compression (level = 0)\n"
          "   ``Compression.ZLIB_FAST:``\n      ZLIB fast compression (level = 1)\n"
          "   ``Compression.ZLIB_BEST:``\n      ZLIB best compression (level = 9)\n"
-         "   ``Compression.LZ4:``\n      LZ4 compression (very fast)\n\n")
+         "   ``Compression.LZ4:``\n      LZ4 compression (very fast)\n"
+         "   ``Compression.SHUFFLE_LZ4:``\n      byte shuffle + LZ4 (good for 16-bit and float data)\n"
+         "   ``Compression.BITSHUFFLE_LZ4:``\n      bit shuffle + LZ4\n"
+         "   ``Compression.SHUFFLE_ZSTD:``\n      byte shuffle + ZSTD (level = 3)\n"
+         "   ``Compression.ZSTD_FAST:``\n      ZSTD fast compression (level = 1)\n"
+         "   ``Compression.ZSTD:``\n      ZSTD default compression (level = 3)\n"
+         "   ``Compression.ZSTD_BEST:``\n      ZSTD best compression (level = 19)\n\n")
         .value("ZLIB", vigra::ZLIB)
         .value("ZLIB_NONE", vigra::ZLIB_NONE)
         .value("ZLIB_FAST", vigra::ZLIB_FAST)
         .value("ZLIB_BEST", vigra::ZLIB_BEST)
         .value("LZ4", vigra::LZ4)
+        .value("SHUFFLE_LZ4", vigra::SHUFFLE_LZ4)
+        .value("BITSHUFFLE_LZ4", vigra::BITSHUFFLE_LZ4)
+        .value("SHUFFLE_ZSTD", vigra::SHUFFLE_ZSTD)
+        .value("ZSTD_FAST", vigra::ZSTD_FAST)
+        .value("ZSTD", vigra::ZSTD)
+        .value("ZSTD_BEST", vigra::ZSTD_BEST)
     ;
 
 #ifdef HasHDF5
@@ -1009,8 +1021,8 @@ void defineChunkedArray()
         "be powers of 2.\n\n"
         "'dtype' can currently be ``uint8``, ``uint32``, and ``float32``.\n\n"
         "'fill_value' is returned for all array elements that have never been written.\n\n"
-        "'compression' can be any of the flags defined in the :class:`~vigra.Compression` enum\n"
-        "except for `LZ4`.\n\n"
+        "'compression' can be any of the flags defined in the :class:`~vigra.Compression` enum.\n"
+        "The LZ4, shuffle and ZSTD variants require the corresponding HDF5 filter plugins.\n\n"
         "'cache_max' specifies how many chunks may reside in memory at the same time.\n"
         "If it is '-1', vigra will choose a sensible default, but other values may\n"
         "better fit your data access patterns. This is a soft limit, i.e. may be exceeded\n"